@@ -35,7 +35,8 @@ public class Resampler extends Task {
         BOX,                 //!< "0.5-order": anti-aliasing box filter; identical to nearest neighbor when upsampling
         LINEAR,              //!< first order: bilinear interpolation
         CUBIC,               //!< third order: bicubic interpolation
-        CONVNET              //!< upsampling x2 using a convolutional neural network
+        CONVNET,             //!< upsampling x2 using a convolutional neural network
+        LANCZOS              //!< Lanczos filter of order 3; antialiasing when downsampling
     };
 
     private static native long newResampler(Context context);
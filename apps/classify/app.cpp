@@ -75,7 +75,7 @@ int mainThatThrowsExceptions(int argc, char* argv[]) {
 
     // Init classifier. By convention, the chunk having empty name contains the model description in a YML-like format
     // that can be feed to DeserializedModel constructor.
-    Beatmup::ChunkFile modelData(PATH_TO_MODEL_DATA);
+    Beatmup::MappedChunkFile modelData(PATH_TO_MODEL_DATA);
     Beatmup::NNets::DeserializedModel classifier(ctx, modelData.read<std::string>(""));
 
     // Keep a reference to the Softmax layer providing the output.
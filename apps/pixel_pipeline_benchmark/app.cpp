@@ -0,0 +1,142 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+    Benchmarking the fused pixel pipeline against the equivalent chain of tasks materializing intermediate bitmaps.
+    A 4K frame is converted to RGBA, color-corrected, multiplied by a mask and optionally downsampled to 1080p.
+*/
+
+#include "context.h"
+#include "bitmap/converter.h"
+#include "bitmap/internal_bitmap.h"
+#include "bitmap/operator.h"
+#include "bitmap/pixel_pipeline.h"
+#include "bitmap/resampler.h"
+#include "filters/color_matrix.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+using namespace Beatmup;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+
+static void fillRandomly(AbstractBitmap& bitmap) {
+    std::default_random_engine rng;
+    std::uniform_int_distribution<int> distr(0, 255);
+    AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(bitmap);
+    pixbyte* data = bitmap.getData(0, 0);
+    for (msize i = 0; i < bitmap.getMemorySize(); ++i)
+        data[i] = (pixbyte)distr(rng);
+}
+
+
+/**
+    Runs a function several times and prints the median execution time
+*/
+template<class Function> static void measure(const std::string& title, int numIterations, const Function& function) {
+    function();     // warming up
+    std::vector<double> times;
+    for (int i = 0; i < numIterations; ++i) {
+        const auto startTime = Clock::now();
+        function();
+        times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - startTime).count());
+    }
+    std::sort(times.begin(), times.end());
+    std::cout << std::left << std::setw(40) << title << std::right << std::fixed << std::setprecision(2)
+              << std::setw(9) << times[times.size() / 2] << " ms" << std::endl;
+}
+
+
+int main(int argc, const char* argv[]) {
+    static const int
+        INPUT_WIDTH = 3840, INPUT_HEIGHT = 2160,
+        OUTPUT_WIDTH = 1920, OUTPUT_HEIGHT = 1080,
+        NUM_ITERATIONS = 10;
+
+    Context context;
+    std::cout << "Thread pool size: " << (int)context.maxAllowedWorkerCount() << std::endl << std::endl;
+
+    InternalBitmap
+        input(context, PixelFormat::TripleByte, INPUT_WIDTH, INPUT_HEIGHT),
+        mask(context, PixelFormat::QuadByte, INPUT_WIDTH, INPUT_HEIGHT),
+        converted(context, PixelFormat::QuadByte, INPUT_WIDTH, INPUT_HEIGHT),
+        filtered(context, PixelFormat::QuadByte, INPUT_WIDTH, INPUT_HEIGHT),
+        combined(context, PixelFormat::QuadByte, INPUT_WIDTH, INPUT_HEIGHT),
+        output(context, PixelFormat::QuadByte, OUTPUT_WIDTH, OUTPUT_HEIGHT);
+    fillRandomly(input);
+    fillRandomly(mask);
+
+    // staged version
+    Filters::ColorMatrix colorMatrix;
+    colorMatrix.setHSVCorrection(30, 0.9f, 1.1f);
+    colorMatrix.setInput(&converted);
+    colorMatrix.setOutput(&filtered);
+
+    BitmapBinaryOperation multiplication;
+    multiplication.setOperand1(&filtered);
+    multiplication.setOperand2(&mask);
+    multiplication.setOutput(&combined);
+    multiplication.setOperation(BitmapBinaryOperation::Operation::MULTIPLY);
+    multiplication.resetCrop();
+
+    BitmapResampler resampler(context);
+    resampler.setMode(BitmapResampler::Mode::LINEAR);
+    resampler.setInput(&combined);
+    resampler.setOutput(&output);
+
+    FormatConverter converter;
+    converter.setBitmaps(&input, &converted);
+
+    // fused version
+    PixelPipeline pipeline;
+    pipeline.setInput(&input);
+    pipeline
+        .addColorMatrix(colorMatrix.getMatrix(), color4f{ 0, 0, 0, 0 })
+        .addBinaryOperation(BitmapBinaryOperation::Operation::MULTIPLY, &mask);
+
+    std::cout << "Color matrix and multiplication, " << INPUT_WIDTH << "x" << INPUT_HEIGHT << std::endl;
+    measure("  Staged", NUM_ITERATIONS, [&]() {
+        context.performTask(converter);
+        context.performTask(colorMatrix);
+        context.performTask(multiplication);
+    });
+    pipeline.setOutput(&combined);
+    measure("  Fused", NUM_ITERATIONS, [&]() {
+        context.performTask(pipeline);
+    });
+
+    std::cout << "Same followed by bilinear resampling to " << OUTPUT_WIDTH << "x" << OUTPUT_HEIGHT << std::endl;
+    measure("  Staged", NUM_ITERATIONS, [&]() {
+        context.performTask(converter);
+        context.performTask(colorMatrix);
+        context.performTask(multiplication);
+        context.performTask(resampler);
+    });
+    pipeline.setResampling(BitmapResampler::Mode::LINEAR);
+    pipeline.setOutput(&output);
+    measure("  Fused", NUM_ITERATIONS, [&]() {
+        context.performTask(pipeline);
+    });
+
+    return 0;
+}
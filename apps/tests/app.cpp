@@ -20,19 +20,55 @@
     Bunch of unit tests
 */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <random>
 #include <sstream>
+#include <thread>
 #include "shading/shader_applicator.h"
+#include "audio/sample_conversion.h"
+#include "audio/signal.h"
+#include "audio/signal_converter.h"
+#include "audio/wav_stream.h"
+#include "bitmap/bitmap_view.h"
+#include "bitmap/converter.h"
+#include "bitmap/crop.h"
 #include "bitmap/internal_bitmap.h"
+#include "bitmap/mapped_bitmap.h"
+#include "bitmap/metric.h"
+#include "bitmap/operator.h"
+#include "bitmap/pixel_pipeline.h"
+#include "bitmap/processing.h"
+#include "bitmap/resampler.h"
+#include "bitmap/resampling_kernels.h"
+#include "bitmap/simd_kernels.h"
+#include "bitmap/tiled_executor.h"
+#include "filters/color_matrix.h"
 #include "context.h"
 #include "gpu/float16.h"
 #include "gpu/linear_mapping.h"
+#include "gpu/program_cache.h"
 #include "gpu/swapper.h"
+#include "gpu/texture_pool.h"
+#include "masking/flood_fill.h"
+#include "memory.h"
+#include "nnets/classifier.h"
+#include "nnets/conv2d.h"
 #include "nnets/deserialized_model.h"
+#include "nnets/dense.h"
+#include "nnets/image_sampler.h"
 #include "nnets/inference_task.h"
+#include "nnets/pooling2d.h"
+#include "nnets/softmax.h"
+#include "pipelining/multitask.h"
+#include "pipelining/task_graph.h"
+#include "scene/renderer.h"
 #include "shading/image_shader.h"
 #include "utils/bitmap_from_chunk.h"
 #include "utils/string_utils.h"
@@ -444,6 +480,2464 @@ class StoragePushingPullingTest : public GpuTestTask {
 };
 
 
+/**
+    Checks that vectorized bitmap processing routines produce exactly the same output as the generic code
+*/
+class SimdKernelsTest {
+private:
+    Context context;
+    std::default_random_engine rng;
+
+    void fillRandomly(AbstractBitmap& bitmap) {
+        AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(bitmap);
+        if (bitmap.isFloat()) {
+            // going a bit out of 0..1 range to check clipping
+            std::uniform_real_distribution<float> distr(-0.25f, 1.25f);
+            float* data = (float*)bitmap.getData(0, 0);
+            for (msize i = 0; i < bitmap.getMemorySize() / sizeof(float); ++i)
+                data[i] = distr(rng);
+        }
+        else {
+            std::uniform_int_distribution<int> distr(0, 255);
+            pixbyte* data = bitmap.getData(0, 0);
+            for (msize i = 0; i < bitmap.getMemorySize(); ++i)
+                data[i] = (pixbyte)distr(rng);
+        }
+    }
+
+    std::vector<pixbyte> getContent(AbstractBitmap& bitmap) {
+        AbstractBitmap::ReadLock lock(bitmap);
+        const pixbyte* data = bitmap.getData(0, 0);
+        return std::vector<pixbyte>(data, data + bitmap.getMemorySize());
+    }
+
+    /**
+        Runs a task with different instruction sets and compares the outputs
+    */
+    void check(AbstractTask& task, AbstractBitmap& output, const std::string& title) {
+        using SimdKernels::InstructionSet;
+        SimdKernels::limitInstructionSet(InstructionSet::NONE);
+        fillRandomly(output);
+        const auto reference = getContent(output);
+        context.performTask(task);
+        const auto expected = getContent(output);
+
+        for (InstructionSet set : { InstructionSet::SSE41, InstructionSet::AVX2 })
+            if (set <= SimdKernels::getSupportedInstructionSet()) {
+                SimdKernels::limitInstructionSet(set);
+                {
+                    AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(output);
+                    std::memcpy(output.getData(0, 0), reference.data(), reference.size());
+                }
+                context.performTask(task);
+                if (getContent(output) != expected) {
+                    SimdKernels::limitInstructionSet(InstructionSet::AVX2);
+                    throw std::runtime_error(title + ": vectorized output does not match the generic one");
+                }
+            }
+
+        SimdKernels::limitInstructionSet(InstructionSet::AVX2);
+    }
+
+public:
+    void operator()() {
+        static const PixelFormat FORMATS[] = { SingleByte, TripleByte, QuadByte, SingleFloat, TripleFloat, QuadFloat };
+        const int width = 123, height = 45;
+
+        // format conversion
+        for (PixelFormat inFormat : FORMATS)
+            for (PixelFormat outFormat : FORMATS)
+                if (inFormat != outFormat) {
+                    InternalBitmap input(context, inFormat, width, height), output(context, outFormat, width, height);
+                    fillRandomly(input);
+                    FormatConverter converter;
+                    converter.setBitmaps(&input, &output);
+                    check(converter, output, std::string("Conversion from ") + AbstractBitmap::PIXEL_FORMAT_NAMES[inFormat]
+                        + " to " + AbstractBitmap::PIXEL_FORMAT_NAMES[outFormat]);
+                }
+
+        // binary operations
+        for (PixelFormat format : FORMATS) {
+            InternalBitmap op1(context, format, width, height), op2(context, format, width, height), output(context, format, width, height);
+            fillRandomly(op1);
+            fillRandomly(op2);
+            BitmapBinaryOperation operation;
+            operation.setOperand1(&op1);
+            operation.setOperand2(&op2);
+            operation.setOutput(&output);
+            operation.setCropSize(width - 5, height - 3);
+            operation.setOp1Origin(IntPoint(1, 2));
+            operation.setOp2Origin(IntPoint(3, 0));
+            operation.setOutputOrigin(IntPoint(5, 1));
+            for (auto op : { BitmapBinaryOperation::Operation::ADD, BitmapBinaryOperation::Operation::MULTIPLY }) {
+                operation.setOperation(op);
+                check(operation, output, std::string("Binary operation on ") + AbstractBitmap::PIXEL_FORMAT_NAMES[format]);
+            }
+        }
+
+        // color matrix
+        for (PixelFormat inFormat : { QuadByte, QuadFloat })
+            for (PixelFormat outFormat : { QuadByte, QuadFloat }) {
+                InternalBitmap input(context, inFormat, width, height), output(context, outFormat, width, height);
+                Filters::ColorMatrix filter;
+                filter.setInput(&input);
+                filter.setOutput(&output);
+                filter.setHSVCorrection(40, 1.2f, 0.9f);
+                filter.applyContrast(1.1f);
+                filter.setCoefficients(3, 0.1f, 0.2f, 0.1f, 0.0f, 0.7f);
+                for (bool intApprox : { false, true }) {
+                    fillRandomly(input);
+                    filter.allowIntegerApproximations(intApprox);
+                    check(filter, output, std::string("Color matrix from ") + AbstractBitmap::PIXEL_FORMAT_NAMES[inFormat]
+                        + " to " + AbstractBitmap::PIXEL_FORMAT_NAMES[outFormat]);
+                }
+            }
+
+        // resampling
+        {
+            InternalBitmap input(context, QuadByte, width, height);
+            fillRandomly(input);
+            for (int scale : { 3, 7 }) {
+                InternalBitmap output(context, QuadByte, width * scale / 5, height * scale / 5);
+                BitmapResampler resampler(context);
+                resampler.setInput(&input);
+                resampler.setOutput(&output);
+                resampler.setMode(BitmapResampler::Mode::BOX);
+                check(resampler, output, "Resampling");
+            }
+        }
+
+        // neural network-based upsampling on CPU
+        {
+            InternalBitmap input(context, TripleByte, width, height), output(context, QuadByte, 2 * width, 2 * height);
+            fillRandomly(input);
+            BitmapResampler resampler(context);
+            resampler.setInput(&input);
+            resampler.setOutput(&output);
+            resampler.setMode(BitmapResampler::Mode::CONVNET);
+            resampler.setUsingGpuIfAvailable(false);
+            check(resampler, output, "Convnet resampling");
+        }
+    }
+};
+
+
+/**
+    Checks that chunks of work are handed out exactly once when workers run at different speed
+*/
+class WorkStealingTest : public AbstractTask {
+private:
+    static const int NUM_ITEMS = 10000, CHUNK_SIZE = 7;
+    Context context;
+    std::vector<std::atomic<int>> counters;
+
+    ThreadIndex getMaxThreads() const { return MAX_THREAD_INDEX; }
+    TaskDeviceRequirement getUsedDevices() const { return TaskDeviceRequirement::CPU_ONLY; }
+
+    void processRound(TaskThread& thread, int round) {
+        msize start, stop;
+        while (thread.nextChunk(NUM_ITEMS, CHUNK_SIZE, start, stop)) {
+            if (start % CHUNK_SIZE != 0 || stop - start > CHUNK_SIZE)
+                throw std::runtime_error("Work stealing test failed: misaligned chunk");
+            // slowing down the first worker to get its chunks stolen
+            if (thread.currentThread() == 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            for (msize i = start; i < stop; ++i)
+                counters[i] += round;
+        }
+    }
+
+    bool process(TaskThread& thread) {
+        processRound(thread, 1);
+        thread.synchronize();
+        processRound(thread, 2);
+        return true;
+    }
+
+public:
+    WorkStealingTest(): counters(NUM_ITEMS) {
+        context.limitWorkerCount(4);
+    }
+
+    void operator()() {
+        for (int repeat = 0; repeat < 3; ++repeat) {
+            for (auto& _ : counters)
+                _ = 0;
+            context.performTask(*this);
+            for (const auto& _ : counters)
+                if (_ != 3)
+                    throw std::runtime_error("Work stealing test failed: an item is processed " + std::to_string(_) + " times instead of once per round");
+        }
+    }
+};
+
+
+/**
+    Checks that frames flow through a pipelined Multitask correctly, with its tasks running concurrently
+*/
+class PipelinedMultitaskTest : public CustomPipeline::FrameBinder {
+private:
+    static const int NUM_STAGES = 3, NUM_FRAMES = 12, FRAME_SIZE = 1000, STAGE_DURATION_MS = 20;
+
+    /**
+        Order of the stages starts and stops, and the largest number of stages running at the same time
+    */
+    struct Events {
+        std::mutex access;
+        int clock;                                  // incremented at every event
+        int running;
+        int maxRunning;
+        int start[NUM_STAGES][NUM_FRAMES];          // event number of a stage starting a frame
+        int stop[NUM_STAGES][NUM_FRAMES];           // event number of a stage finishing a frame
+        std::vector<int> frames[NUM_STAGES];        // frames processed by each stage, in order
+
+        void reset() {
+            clock = running = maxRunning = 0;
+            for (auto& _ : frames)
+                _.clear();
+        }
+    };
+
+    /**
+        Adds a constant to every sample of a frame, and waits a bit
+    */
+    class Stage : public AbstractTask {
+    private:
+        ThreadIndex getMaxThreads() const { return 2; }
+        TaskDeviceRequirement getUsedDevices() const { return TaskDeviceRequirement::CPU_ONLY; }
+
+        bool process(TaskThread& thread) {
+            if (thread.isManaging()) {
+                std::lock_guard<std::mutex> lock(events->access);
+                events->start[index][frame] = ++events->clock;
+                events->frames[index].push_back(frame);
+                events->maxRunning = std::max(events->maxRunning, ++events->running);
+            }
+            thread.synchronize();
+            msize start, stop;
+            while (thread.nextChunk(FRAME_SIZE, 100, start, stop))
+                for (msize i = start; i < stop; ++i)
+                    (*output)[i] = (*input)[i] + addend;
+            thread.synchronize();
+            if (thread.isManaging()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds((long)STAGE_DURATION_MS));
+                std::lock_guard<std::mutex> lock(events->access);
+                events->stop[index][frame] = ++events->clock;
+                events->running--;
+            }
+            return true;
+        }
+
+    public:
+        const std::vector<int>* input;
+        std::vector<int>* output;
+        int addend;
+        int index;
+        int frame;
+        Events* events;
+    };
+
+    Context context;
+    Multitask multitask;
+    Stage stages[NUM_STAGES];
+    Events events;
+    std::vector<int> inputs[2];                     // double-buffered input
+    std::vector<int> buffers[NUM_STAGES - 1][2];    // double-buffered stages outputs
+    std::vector<int> outputs[NUM_FRAMES];
+
+    bool bindFrame(CustomPipeline::TaskHolder& task, unsigned long frame) {
+        if (frame >= NUM_FRAMES)
+            return false;
+        const int idx = multitask.getTaskIndex(task);
+        if (idx == 0) {
+            // feed a new frame
+            for (int i = 0; i < FRAME_SIZE; ++i)
+                inputs[frame % 2][i] = (int)frame * FRAME_SIZE + i;
+            stages[idx].input = &inputs[frame % 2];
+        }
+        else
+            stages[idx].input = &buffers[idx - 1][frame % 2];
+        stages[idx].output = idx == NUM_STAGES - 1 ? &outputs[frame] : &buffers[idx][frame % 2];
+        stages[idx].frame = (int)frame;
+        return true;
+    }
+
+    static void check(bool condition, const std::string& message) {
+        if (!condition)
+            throw std::runtime_error("Pipelined multitask test failed: " + message);
+    }
+
+    void check() {
+        int sum = 0;
+        for (const auto& stage : stages)
+            sum += stage.addend;
+        for (int frame = 0; frame < NUM_FRAMES; ++frame)
+            for (int i = 0; i < FRAME_SIZE; ++i)
+                check(outputs[frame][i] == frame * FRAME_SIZE + i + sum, "wrong result in frame " + std::to_string(frame));
+
+        // every stage takes the frames in order, once the previous stage is done with them
+        for (int stage = 0; stage < NUM_STAGES; ++stage) {
+            check((int)events.frames[stage].size() == NUM_FRAMES, "unexpected number of frames processed by a stage");
+            for (int frame = 0; frame < NUM_FRAMES; ++frame) {
+                check(events.frames[stage][frame] == frame, "frames are processed out of order");
+                if (stage > 0)
+                    check(events.start[stage][frame] > events.stop[stage - 1][frame], "a frame is processed before its input is ready");
+            }
+        }
+    }
+
+public:
+    PipelinedMultitaskTest() {
+        for (auto& _ : inputs)
+            _.resize(FRAME_SIZE);
+        for (auto& _ : buffers)
+            _[0].resize(FRAME_SIZE), _[1].resize(FRAME_SIZE);
+        for (auto& _ : outputs)
+            _.resize(FRAME_SIZE);
+        for (int i = 0; i < NUM_STAGES; ++i) {
+            stages[i].addend = 1 << i;
+            stages[i].index = i;
+            stages[i].events = &events;
+            multitask.addTask(stages[i]);
+        }
+        multitask.measure();
+    }
+
+    void operator()() {
+        // sequential processing
+        context.limitWorkerCount(2 * NUM_STAGES);
+        events.reset();
+        for (int frame = 0; frame < NUM_FRAMES; ++frame) {
+            for (int i = 0; i < NUM_STAGES; ++i)
+                bindFrame(multitask.getTask(i), frame);
+            context.performTask(multitask);
+        }
+        check();
+        check(events.maxRunning == 1, "stages overlap when not pipelined");
+
+        // pipelined processing, with a thread per stage at least and with less threads than stages
+        for (ThreadIndex numThreads : { 2 * NUM_STAGES, 2 }) {
+            for (auto& _ : outputs)
+                std::fill(_.begin(), _.end(), 0);
+            context.limitWorkerCount(numThreads);
+            multitask.enablePipelining(this);
+            events.reset();
+            for (int step = 0; step < NUM_FRAMES + NUM_STAGES - 1; ++step)
+                context.performTask(multitask);
+            check();
+            if (numThreads > NUM_STAGES)
+                check(events.maxRunning > 1, "stages are not run concurrently");
+        }
+        multitask.enablePipelining(nullptr);
+    }
+};
+
+
+/**
+    Checks that single-threaded jobs submitted to the same pool run at the same time
+*/
+class ConcurrentJobsTest {
+private:
+    /**
+        Single-threaded task waiting for the other instances to start
+    */
+    class RendezvousTask : public AbstractTask {
+    private:
+        std::atomic<int>& arrived;
+        const int expected;
+
+        ThreadIndex getMaxThreads() const { return 1; }
+        TaskDeviceRequirement getUsedDevices() const { return TaskDeviceRequirement::CPU_ONLY; }
+
+        bool process(TaskThread& thread) {
+            arrived++;
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (arrived < expected && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::yield();
+            met = arrived >= expected;
+            return true;
+        }
+
+    public:
+        bool met;
+        RendezvousTask(std::atomic<int>& arrived, int expected): arrived(arrived), expected(expected), met(false) {}
+    };
+
+    /**
+        Single-threaded task counting its runs overlapping in time
+    */
+    class OverlapCountingTask : public AbstractTask {
+    private:
+        std::atomic<int> running;
+
+        ThreadIndex getMaxThreads() const { return 1; }
+        TaskDeviceRequirement getUsedDevices() const { return TaskDeviceRequirement::CPU_ONLY; }
+
+        bool process(TaskThread& thread) {
+            if (++running > 1)
+                overlapped = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            --running;
+            runs++;
+            return true;
+        }
+
+    public:
+        bool overlapped;
+        int runs;
+        OverlapCountingTask(): running(0), overlapped(false), runs(0) {}
+    };
+
+    Context context;
+
+public:
+    void operator()() {
+        static const int NUM_JOBS = 3;
+        context.limitWorkerCount(NUM_JOBS + 1);
+
+        std::atomic<int> arrived(0);
+        std::vector<std::unique_ptr<RendezvousTask>> tasks;
+        std::vector<Job> jobs;
+        for (int i = 0; i < NUM_JOBS; ++i) {
+            tasks.emplace_back(new RendezvousTask(arrived, NUM_JOBS));
+            jobs.push_back(context.submitTask(*tasks.back()));
+        }
+
+        for (auto job : jobs)
+            context.waitForJob(job);
+        context.check();
+        for (const auto& task : tasks)
+            if (!task->met)
+                throw std::runtime_error("Concurrent jobs test failed: single-threaded jobs were not run concurrently");
+
+        // submitting the same task several times runs it several times, but never concurrently
+        OverlapCountingTask task;
+        jobs.clear();
+        for (int i = 0; i < NUM_JOBS; ++i)
+            jobs.push_back(context.submitTask(task));
+        for (auto job : jobs)
+            context.waitForJob(job);
+        context.check();
+        if (task.runs != NUM_JOBS)
+            throw std::runtime_error("Concurrent jobs test failed: a task submitted several times is not run as many times");
+        if (task.overlapped)
+            throw std::runtime_error("Concurrent jobs test failed: runs of the same task overlap");
+    }
+};
+
+
+/**
+    Checks that a task graph orders tasks by the bitmaps they access and runs independent tasks concurrently
+*/
+class TaskGraphTest {
+private:
+    /**
+        Sums the first pixel of input bitmaps, adds a constant and stores the result in the first pixel of the output bitmap
+    */
+    class SumTask : public AbstractTask {
+    private:
+        ThreadIndex getMaxThreads() const { return 1; }
+        TaskDeviceRequirement getUsedDevices() const { return TaskDeviceRequirement::CPU_ONLY; }
+
+        bool process(TaskThread& thread) {
+            start = ++*clock;
+            if (fail)
+                throw std::runtime_error("Expected failure");
+
+            // meet the tasks expected to run concurrently
+            if (rendezvous) {
+                (*rendezvous)++;
+                const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+                while (*rendezvous < 2 && std::chrono::steady_clock::now() < deadline)
+                    std::this_thread::yield();
+            }
+
+            int sum = addend;
+            for (auto input : inputs) {
+                AbstractBitmap::ReadLock lock(*input);
+                sum += *input->getData(0, 0);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(duration));
+            AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(*output);
+            *output->getData(0, 0) = (pixbyte)sum;
+            stop = ++*clock;
+            return true;
+        }
+
+    public:
+        std::vector<AbstractBitmap*> inputs;
+        AbstractBitmap* output;
+        int addend, duration;
+        bool fail;
+        std::atomic<int>* clock;            // incremented at every task start and stop
+        std::atomic<int>* rendezvous;       // number of concurrent tasks arrived, if any
+        int start, stop;                    // clock values when the task started and stopped
+
+        SumTask(std::vector<AbstractBitmap*> inputs, AbstractBitmap& output, int addend, int duration = 0):
+            inputs(inputs), output(&output), addend(addend), duration(duration), fail(false), clock(nullptr), rendezvous(nullptr)
+        {}
+    };
+
+    static void check(bool condition, const char* message) {
+        if (!condition)
+            throw std::runtime_error(std::string("Task graph test failed: ") + message);
+    }
+
+    static int valueOf(AbstractBitmap& bitmap) {
+        AbstractBitmap::ReadLock lock(bitmap);
+        return *bitmap.getData(0, 0);
+    }
+
+    Context context;
+
+public:
+    TaskGraphTest(): context(2) {}
+
+    void operator()() {
+        static const int BRANCH_DURATION_MS = 100;
+        InternalBitmap
+            a(context, PixelFormat::SingleByte, 4, 4),
+            b(context, PixelFormat::SingleByte, 4, 4),
+            c(context, PixelFormat::SingleByte, 4, 4),
+            d(context, PixelFormat::SingleByte, 4, 4),
+            e(context, PixelFormat::SingleByte, 4, 4);
+
+        // a = 1; b = a + 2 and c = a + 4 in parallel; d = b + c + 8; a = 16 once b and c are computed; e = a + d
+        SumTask
+            source({}, a, 1),
+            branch1({ &a }, b, 2, BRANCH_DURATION_MS),
+            branch2({ &a }, c, 4, BRANCH_DURATION_MS),
+            merge({ &b, &c }, d, 8),
+            overwrite({}, a, 16),
+            result({ &a, &d }, e, 0);
+
+        std::atomic<int> clock(0), rendezvous(0);
+        branch1.rendezvous = branch2.rendezvous = &rendezvous;
+
+        TaskGraph graph;
+        for (auto task : { &source, &branch1, &branch2, &merge, &overwrite, &result }) {
+            task->clock = &clock;
+            graph.addTask(*task, task->inputs, { task->output });
+        }
+        check(graph.getNode(0).getDependencyCount() == 0, "unexpected dependencies of the source");
+        check(graph.getNode(1).getDependencyCount() == 1 && graph.getNode(2).getDependencyCount() == 1, "unexpected dependencies of branches");
+        check(graph.getNode(3).getDependencyCount() == 2, "unexpected dependencies of the merge");
+        check(graph.getNode(4).getDependencyCount() == 3, "unexpected dependencies of the overwriting task");
+        check(graph.getNode(5).getDependencyCount() == 2, "unexpected dependencies of the result");
+
+        for (int run = 0; run < 2; ++run) {
+            rendezvous = 0;
+            graph.submit(context).get();
+            check(valueOf(d) == 16 && valueOf(a) == 16 && valueOf(e) == 32, "wrong result");
+            check(branch1.start > source.stop && branch2.start > source.stop, "a bitmap is read before being written");
+            check(merge.start > branch1.stop && merge.start > branch2.stop, "a bitmap is read before being written");
+            check(overwrite.start > branch1.stop && overwrite.start > branch2.stop, "a bitmap is overwritten before being read");
+            check(result.start > overwrite.stop && result.start > merge.stop, "a bitmap is read before being written");
+            check(branch1.start < branch2.stop && branch2.start < branch1.stop, "independent tasks are not run concurrently");
+            check(graph.getNode(1).getPool() != graph.getNode(2).getPool(), "independent tasks are run in the same pool");
+            check(graph.getNode(1).getRunTime() >= BRANCH_DURATION_MS, "unexpected task run time");
+        }
+
+        // failing task: the dependent tasks are not run
+        branch2.fail = true;
+        branch1.rendezvous = branch2.rendezvous = nullptr;
+        e.zero();
+        bool thrown = false;
+        try {
+            graph.run(context);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        check(thrown, "the exception of a failed task is not rethrown");
+        check(valueOf(e) == 0, "a task depending on a failed task is run");
+        thrown = false;
+        try {
+            context.check(graph.getNode(2).getPool());
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        check(thrown, "the exception of a failed task is not stored by the thread pool");
+    }
+};
+
+
+class MemoryPoolTest {
+private:
+    Context context;
+
+    static void check(bool condition, const char* message) {
+        if (!condition)
+            throw std::runtime_error(std::string("Memory pool test failed: ") + message);
+    }
+
+public:
+    void operator()() {
+        static const int WIDTH = 640, HEIGHT = 480, NUM_FRAMES = 10;
+        MemoryPool& pool = context.getMemoryPool();
+        const size_t blockSize = MemoryPool::getBlockSize(WIDTH * HEIGHT * 4);
+        check(blockSize >= WIDTH * HEIGHT * 4 && blockSize <= WIDTH * HEIGHT * 5, "unexpected block size");
+        pool.setCapacity(4 * blockSize);
+
+        // same-sized bitmaps are expected to reuse the same block
+        const void* firstAddr = nullptr;
+        for (int i = 0; i < NUM_FRAMES; ++i) {
+            InternalBitmap bitmap(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+            if (i == 0)
+                firstAddr = bitmap.getData(0, 0);
+            else
+                check(bitmap.getData(0, 0) == firstAddr, "a released block is not reused");
+        }
+        MemoryPool::Statistics stats = pool.getStatistics();
+        check(stats.misses == 1 && stats.hits == NUM_FRAMES - 1, "unexpected hits/misses count");
+        check(stats.cachedBlocks == 1 && stats.cachedBytes == blockSize && stats.usedBytes == 0, "unexpected pool state");
+
+        // reshaping to a size of the same class keeps using the pool
+        {
+            InternalBitmap bitmap(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+            bitmap.reshape(HEIGHT, WIDTH - 1);
+            check(pool.getStatistics().hits == NUM_FRAMES + 1, "reshaping does not reuse the block");
+        }
+
+        // exceeding the capacity evicts least recently released blocks
+        {
+            std::vector<std::unique_ptr<InternalBitmap>> bitmaps;
+            for (int i = 0; i < 6; ++i)
+                bitmaps.emplace_back(new InternalBitmap(context, PixelFormat::QuadByte, WIDTH, HEIGHT));
+            check(pool.getStatistics().usedBytes == 6 * blockSize, "unexpected used memory size");
+        }
+        stats = pool.getStatistics();
+        check(stats.cachedBlocks == 4 && stats.evictions == 2 && stats.peakUsedBytes == 6 * blockSize, "capacity is not respected");
+
+        // small buffers are not pooled
+        {
+            InternalBitmap bitmap(context, PixelFormat::SingleByte, 16, 16);
+        }
+        check(pool.getStatistics().cachedBlocks == 4, "a small buffer is pooled");
+
+        pool.trim();
+        check(pool.getStatistics().cachedBytes == 0, "trimming does not empty the pool");
+
+        // a CPU bitmap may outlive its context
+        std::unique_ptr<InternalBitmap> orphan;
+        {
+            Context shortLived;
+            orphan.reset(new InternalBitmap(shortLived, PixelFormat::QuadByte, WIDTH, HEIGHT));
+            orphan->zero();
+        }
+        check(orphan->getData(0, 0) != nullptr, "a bitmap outliving its context loses its pixels");
+        orphan.reset();
+    }
+};
+
+
+/**
+    Compares the fused pixel pipeline output to the one of the equivalent chain of tasks
+*/
+class PixelPipelineTest {
+private:
+    Context context;
+    std::default_random_engine rng;
+
+    void fillRandomly(AbstractBitmap& bitmap) {
+        AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(bitmap);
+        std::uniform_int_distribution<int> distr(0, 255);
+        pixbyte* data = bitmap.getData(0, 0);
+        for (msize i = 0; i < bitmap.getMemorySize(); ++i)
+            data[i] = (pixbyte)distr(rng);
+    }
+
+    /**
+        The staged version rounds intermediate values down to integers at every step, and the resampling kernels accumulate the interpolated
+        value in integer, so that small differences are expected. Larger ones occur where bicubic interpolation overshoots.
+    */
+    void compare(AbstractBitmap& reference, AbstractBitmap& output, const std::string& title) {
+        static const int MAX_ERROR = 16;
+        static const float MAX_MEAN_ERROR = 1.5f;
+        AbstractBitmap::ReadLock lock1(reference), lock2(output);
+        const pixbyte *ref = reference.getData(0, 0), *out = output.getData(0, 0);
+        msize errorSum = 0;
+        for (msize i = 0; i < reference.getMemorySize(); ++i) {
+            const int error = std::abs((int)ref[i] - (int)out[i]);
+            if (error > MAX_ERROR)
+                throw std::runtime_error(title + ": fused pipeline output does not match the staged one");
+            errorSum += error;
+        }
+        if (errorSum > MAX_MEAN_ERROR * reference.getMemorySize())
+            throw std::runtime_error(title + ": fused pipeline output does not match the staged one");
+    }
+
+public:
+    void operator()() {
+        static const int WIDTH = 250, HEIGHT = 150;
+        InternalBitmap
+            input(context, PixelFormat::TripleByte, WIDTH, HEIGHT),
+            operand(context, PixelFormat::QuadByte, WIDTH, HEIGHT),
+            converted(context, PixelFormat::QuadByte, WIDTH, HEIGHT),
+            filtered(context, PixelFormat::QuadByte, WIDTH, HEIGHT),
+            combined(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+        fillRandomly(input);
+        fillRandomly(operand);
+
+        // setting up the staged version; the values are kept in 0..1 range
+        Filters::ColorMatrix colorMatrix;
+        colorMatrix.setCoefficients(0, 0.1f, 0.6f, 0.1f, 0.1f, 0.0f);
+        colorMatrix.setCoefficients(1, 0.0f, 0.2f, 0.5f, 0.2f, 0.0f);
+        colorMatrix.setCoefficients(2, 0.2f, 0.0f, 0.1f, 0.7f, 0.0f);
+        colorMatrix.setCoefficients(3, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+        colorMatrix.setInput(&converted);
+        colorMatrix.setOutput(&filtered);
+
+        BitmapBinaryOperation multiplication;
+        multiplication.setOperand1(&filtered);
+        multiplication.setOperand2(&operand);
+        multiplication.setOutput(&combined);
+        multiplication.setOperation(BitmapBinaryOperation::Operation::MULTIPLY);
+        multiplication.resetCrop();
+
+        FormatConverter::convert(input, converted);
+        context.performTask(colorMatrix);
+        context.performTask(multiplication);
+
+        // setting up the fused version
+        PixelPipeline pipeline;
+        pipeline.setInput(&input);
+        pipeline.addColorMatrix(colorMatrix.getMatrix(), color4f{ 0.1f, 0.0f, 0.2f, 0.0f })
+            .addBinaryOperation(BitmapBinaryOperation::Operation::MULTIPLY, &operand);
+
+        // no resampling
+        {
+            InternalBitmap output(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+            pipeline.setOutput(&output);
+            context.performTask(pipeline);
+            compare(combined, output, "No resampling");
+        }
+
+        // resampling
+        BitmapResampler resampler(context);
+        resampler.setInput(&combined);
+        static const BitmapResampler::Mode MODES[] = {
+            BitmapResampler::Mode::NEAREST_NEIGHBOR, BitmapResampler::Mode::BOX, BitmapResampler::Mode::LINEAR, BitmapResampler::Mode::CUBIC
+        };
+        static const char* MODE_NAMES[] = { "Nearest neighbor", "Box", "Linear", "Cubic" };
+        static const int SIZES[][2] = { { 97, 61 }, { 333, 222 } };
+        for (int mode = 0; mode < 4; ++mode)
+            for (auto size : SIZES) {
+                InternalBitmap
+                    reference(context, PixelFormat::QuadByte, size[0], size[1]),
+                    output(context, PixelFormat::QuadByte, size[0], size[1]);
+                resampler.setMode(MODES[mode]);
+                resampler.setOutput(&reference);
+                context.performTask(resampler);
+
+                pipeline.setResampling(MODES[mode]);
+                pipeline.setOutput(&output);
+                context.performTask(pipeline);
+                compare(reference, output, std::string(MODE_NAMES[mode]) + " resampling to " + std::to_string(size[0]) + "x" + std::to_string(size[1]));
+            }
+
+        // halves are rounded the same way in every column
+        {
+            InternalBitmap floatInput(context, PixelFormat::QuadFloat, WIDTH, HEIGHT), output(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+            {
+                AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(floatInput);
+                float* data = (float*)floatInput.getData(0, 0);
+                for (msize i = 0; i < floatInput.getMemorySize() / sizeof(float); ++i)
+                    data[i] = 100.5f / 255;
+            }
+            PixelPipeline identity;
+            identity.setInput(&floatInput);
+            identity.setOutput(&output);
+            context.performTask(identity);
+            AbstractBitmap::ReadLock lock(output);
+            const pixbyte* data = output.getData(0, 0);
+            for (msize i = 0; i < output.getMemorySize(); ++i)
+                if (data[i] != 101)
+                    throw std::runtime_error("Fused pipeline rounds values differently across a row");
+        }
+    }
+};
+
+/**
+    Checks separable resampling against the 2D kernels and sanity of Lanczos resampling
+*/
+class SeparableResamplingTest {
+private:
+    Context context;
+    std::default_random_engine rng;
+
+    /**
+        Bilinear or bicubic resampling performed by the generic 2D kernels
+    */
+    class ReferenceResampling : public AbstractTask {
+    private:
+        AbstractBitmap &input, &output;
+        BitmapResampler::Mode mode;
+    public:
+        ReferenceResampling(AbstractBitmap& input, AbstractBitmap& output, BitmapResampler::Mode mode):
+            input(input), output(output), mode(mode)
+        {}
+
+        bool process(TaskThread& thread) {
+            IntRectangle src = input.getSize().halfOpenedRectangle(), dst = output.getSize().halfOpenedRectangle();
+            if (mode == BitmapResampler::Mode::LINEAR)
+                BitmapProcessing::pipeline<Kernels::BilinearResampling>(input, output, src, dst, thread);
+            else
+                BitmapProcessing::pipeline<Kernels::BicubicResampling>(input, output, src, dst, BitmapResampler::DEFAULT_CUBIC_PARAMETER, thread);
+            return true;
+        }
+
+        TaskDeviceRequirement getUsedDevices() const { return TaskDeviceRequirement::CPU_ONLY; }
+    };
+
+    void fillRandomly(AbstractBitmap& bitmap) {
+        std::uniform_int_distribution<int> distr(0, 255);
+        AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(bitmap);
+        pixbyte* data = bitmap.getData(0, 0);
+        for (msize i = 0; i < bitmap.getMemorySize(); ++i)
+            data[i] = (pixbyte)distr(rng);
+    }
+
+    /**
+        Returns the maximum absolute difference between two bitmaps of the same size and byte format.
+        \param[in] first, second   The bitmaps to compare
+        \param[in] width           Number of leftmost columns to compare
+    */
+    static int maxDifference(AbstractBitmap& first, AbstractBitmap& second, int width) {
+        AbstractBitmap::ReadLock lock1(first), lock2(second);
+        const int count = width * first.getNumberOfChannels();
+        int result = 0;
+        for (int y = 0; y < first.getHeight(); ++y) {
+            const pixbyte *a = first.getData(0, y), *b = second.getData(0, y);
+            for (int i = 0; i < count; ++i)
+                result = std::max(result, std::abs((int)a[i] - (int)b[i]));
+        }
+        return result;
+    }
+
+    /**
+        Returns the range of values in a byte bitmap
+    */
+    static std::pair<int, int> getRange(AbstractBitmap& bitmap) {
+        AbstractBitmap::ReadLock lock(bitmap);
+        const pixbyte* data = bitmap.getData(0, 0);
+        const auto range = std::minmax_element(data, data + bitmap.getMemorySize());
+        return std::make_pair((int)*range.first, (int)*range.second);
+    }
+
+public:
+    void operator()() {
+        static const int WIDTH = 123, HEIGHT = 45;
+        BitmapResampler resampler(context);
+
+        // bilinear and bicubic: separable vs 2D kernels; the latter truncate the result instead of rounding and do not replicate the
+        // rightmost column properly, so that the last output columns are not compared
+        for (auto mode : { BitmapResampler::Mode::LINEAR, BitmapResampler::Mode::CUBIC })
+            for (PixelFormat format : { SingleByte, TripleByte, QuadByte }) {
+                InternalBitmap input(context, format, WIDTH, HEIGHT);
+                fillRandomly(input);
+                for (int scale : { 3, 7 }) {
+                    InternalBitmap
+                        reference(context, format, WIDTH * scale / 5, HEIGHT * scale / 5),
+                        output(context, format, WIDTH * scale / 5, HEIGHT * scale / 5);
+                    ReferenceResampling referenceTask(input, reference, mode);
+                    {
+                        AbstractBitmap::ReadLock lock(input);
+                        AbstractBitmap::WriteLock<ProcessingTarget::CPU> writeLock(reference);
+                        context.performTask(referenceTask);
+                    }
+                    resampler.setInput(&input);
+                    resampler.setOutput(&output);
+                    resampler.setMode(mode);
+                    context.performTask(resampler);
+                    int width = 0;
+                    while ((width * WIDTH + (WIDTH - output.getWidth()) / 2) / output.getWidth() < WIDTH - 2)
+                        ++width;
+                    if (maxDifference(reference, output, width) > 2)
+                        throw std::runtime_error(std::string("Separable resampling of ") + AbstractBitmap::PIXEL_FORMAT_NAMES[format]
+                            + " does not match the 2D one");
+                }
+            }
+
+        resampler.setMode(BitmapResampler::Mode::LANCZOS);
+
+        // Lanczos: resampling to the same size is identity
+        {
+            InternalBitmap input(context, QuadByte, WIDTH, HEIGHT), output(context, QuadByte, WIDTH, HEIGHT);
+            fillRandomly(input);
+            resampler.setInput(&input);
+            resampler.setOutput(&output);
+            context.performTask(resampler);
+            if (maxDifference(input, output, WIDTH) != 0)
+                throw std::runtime_error("Lanczos resampling to the same size changes the image");
+        }
+
+        // Lanczos: resampling to the same size rounds halves the same way in every column, float input
+        {
+            InternalBitmap input(context, QuadFloat, WIDTH, HEIGHT), output(context, QuadByte, WIDTH, HEIGHT);
+            {
+                AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(input);
+                float* data = (float*)input.getData(0, 0);
+                for (msize i = 0; i < input.getMemorySize() / sizeof(float); ++i)
+                    data[i] = 100.5f / 255;
+            }
+            resampler.setInput(&input);
+            resampler.setOutput(&output);
+            context.performTask(resampler);
+            const auto range = getRange(output);
+            if (range.first != 101 || range.second != 101)
+                throw std::runtime_error("Lanczos resampling rounds values differently across a row");
+        }
+
+        // Lanczos: a constant image remains constant when upsampling, float input
+        {
+            InternalBitmap input(context, QuadFloat, WIDTH, HEIGHT), output(context, QuadByte, 2 * WIDTH + 1, 2 * HEIGHT + 1);
+            {
+                AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(input);
+                float* data = (float*)input.getData(0, 0);
+                for (msize i = 0; i < input.getMemorySize() / sizeof(float); ++i)
+                    data[i] = 0.5f;
+            }
+            resampler.setInput(&input);
+            resampler.setOutput(&output);
+            context.performTask(resampler);
+            const auto range = getRange(output);
+            if (range.first < 127 || range.second > 128)
+                throw std::runtime_error("Lanczos resampling does not preserve a constant image");
+        }
+
+        // Lanczos: downsampling a checkerboard pattern produces uniform gray
+        {
+            InternalBitmap input(context, SingleByte, 8 * WIDTH, 8 * HEIGHT), output(context, SingleByte, WIDTH, HEIGHT);
+            {
+                AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(input);
+                for (int y = 0; y < input.getHeight(); ++y)
+                    for (int x = 0; x < input.getWidth(); ++x)
+                        *input.getData(x, y) = (x + y) % 2 ? 255 : 0;
+            }
+            resampler.setInput(&input);
+            resampler.setOutput(&output);
+            context.performTask(resampler);
+            const auto range = getRange(output);
+            if (range.first < 120 || range.second > 135)
+                throw std::runtime_error("Lanczos downsampling is not antialiasing");
+        }
+    }
+};
+
+
+/**
+    Compares the neural network-based upsampling on CPU with the GPU version, and the multithreaded CPU version with the single-threaded one
+*/
+class CpuConvnetTest {
+private:
+    Context context;
+
+    std::vector<pixbyte> getContent(AbstractBitmap& bitmap) {
+        AbstractBitmap::ReadLock lock(bitmap);
+        const pixbyte* data = bitmap.getData(0, 0);
+        return std::vector<pixbyte>(data, data + bitmap.getMemorySize());
+    }
+
+public:
+    void operator()() {
+        static const int WIDTH = 157, HEIGHT = 93;     // not multiples of the tile size
+        static const float MIN_PSNR = 40;
+
+        // smooth image with some noise
+        InternalBitmap input(context, QuadByte, WIDTH, HEIGHT);
+        {
+            std::default_random_engine rng;
+            std::uniform_int_distribution<int> noise(-20, 20);
+            AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(input);
+            for (int y = 0; y < HEIGHT; ++y)
+                for (int x = 0; x < WIDTH; ++x) {
+                    pixbyte* pixel = input.getData(x, y);
+                    for (int c = 0; c < 3; ++c)
+                        pixel[c] = (pixbyte)std::max(0, std::min(255,
+                            (int)(128 + 100 * std::sin(0.1f * x * (c + 1) + 0.07f * y) * std::cos(0.05f * y * (3 - c))) + noise(rng)));
+                    pixel[3] = 255;
+                }
+        }
+
+        InternalBitmap
+            gpuOutput(context, QuadByte, 2 * WIDTH, 2 * HEIGHT),
+            cpuOutput(context, QuadByte, 2 * WIDTH, 2 * HEIGHT);
+        BitmapResampler resampler(context);
+        resampler.setMode(BitmapResampler::Mode::CONVNET);
+        resampler.setInput(&input);
+
+        // GPU, ES 2.0 backend reproduced by the CPU version; extra threads have nothing to do
+        resampler.setOutput(&gpuOutput);
+        context.limitWorkerCount(3);
+        context.performTask(resampler);
+
+        // CPU, single thread
+        resampler.setUsingGpuIfAvailable(false);
+        resampler.setOutput(&cpuOutput);
+        context.limitWorkerCount(1);
+        context.performTask(resampler);
+        const float psnr = Metric::psnr(gpuOutput, cpuOutput);
+        if (psnr < MIN_PSNR)
+            throw std::runtime_error("Convnet upsampling on CPU does not match the GPU version: PSNR = " + std::to_string(psnr) + " dB");
+
+        // CPU, multiple threads
+        const auto expected = getContent(cpuOutput);
+        context.limitWorkerCount(3);
+        context.performTask(resampler);
+        if (getContent(cpuOutput) != expected)
+            throw std::runtime_error("Multithreaded convnet upsampling on CPU does not match the single-threaded one");
+    }
+};
+
+
+/**
+    Compares scene rendering on CPU with the GPU version, and the multithreaded CPU version with the single-threaded one
+*/
+class CpuSceneRenderingTest {
+private:
+    Context context;
+
+    std::vector<pixbyte> getContent(AbstractBitmap& bitmap) {
+        AbstractBitmap::ReadLock lock(bitmap);
+        const pixbyte* data = bitmap.getData(0, 0);
+        return std::vector<pixbyte>(data, data + bitmap.getMemorySize());
+    }
+
+    void fill(AbstractBitmap& bitmap, float phase, pixbyte alpha) {
+        AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(bitmap);
+        const int channels = bitmap.getNumberOfChannels();
+        for (int y = 0; y < bitmap.getHeight(); ++y)
+            for (int x = 0; x < bitmap.getWidth(); ++x) {
+                pixbyte* pixel = bitmap.getData(x, y);
+                for (int c = 0; c < std::min(channels, 3); ++c)
+                    pixel[c] = (pixbyte)(128 + 120 * std::sin(phase + 0.05f * x * (c + 1)) * std::cos(0.04f * y * (3 - c)));
+                if (channels == 4)
+                    pixel[3] = alpha;
+            }
+    }
+
+public:
+    void operator()() {
+        static const int WIDTH = 301, HEIGHT = 217;     // not multiples of the tile size
+        static const float MIN_PSNR = 40;
+
+        InternalBitmap
+            image(context, QuadByte, 120, 80),
+            subimage(context, QuadByte, 50, 70),
+            mask(context, SingleByte, 60, 40),
+            background(context, QuadByte, 40, 30),
+            gpuOutput(context, QuadByte, WIDTH, HEIGHT),
+            cpuOutput(context, QuadByte, WIDTH, HEIGHT);
+        fill(image, 0, 255);
+        fill(subimage, 1, 255);
+        fill(mask, 2, 255);
+        fill(background, 3, 255);
+
+        Scene scene, subscene;
+        {
+            Scene::BitmapLayer& layer = scene.newBitmapLayer();
+            layer.setBitmap(&image);
+            layer.getMapping().scale(0.6f);
+            layer.getMapping().rotateDegrees(15);
+            layer.getMapping().translate(Point(0.1f, 0.05f));
+            layer.setModulationColor(color4i{ 255, 200, 180, 255 });
+        }
+        {
+            Scene::MaskedBitmapLayer& layer = scene.newMaskedBitmapLayer();
+            layer.setBitmap(&image);
+            layer.setMask(&mask);
+            layer.getMapping().scale(0.5f);
+            layer.getMapping().rotateDegrees(-10);
+            layer.getMapping().translate(Point(0.45f, 0.1f));
+            layer.getMaskMapping().scale(1.2f);
+            layer.getMaskMapping().translate(Point(-0.1f, -0.05f));
+            layer.setBackgroundColor(color4i{ 0, 0, 128, 128 });
+        }
+        {
+            Scene::ShapedBitmapLayer& layer = scene.newShapedBitmapLayer();
+            layer.setBitmap(&image);
+            layer.getMapping().scale(0.4f);
+            layer.getMapping().translate(Point(0.05f, 0.3f));
+            layer.getBitmapMapping().scale(0.9f);
+            layer.setCornerRadius(0.1f);
+            layer.setBorderWidth(0.02f);
+            layer.setSlopeWidth(0.01f);
+            layer.setBackgroundColor(color4i{ 255, 255, 255, 255 });
+            layer.setModulationColor(color4i{ 200, 200, 200, 200 });
+        }
+        {
+            Scene::ShapedBitmapLayer& layer = scene.newShapedBitmapLayer();
+            layer.setBitmap(&subimage);
+            layer.getMapping().scale(0.3f);
+            layer.getMapping().rotateDegrees(30);
+            layer.getMapping().translate(Point(0.6f, 0.25f));
+            layer.setInPixels(true);
+            layer.setCornerRadius(15);
+            layer.setBorderWidth(3);
+            layer.setSlopeWidth(2);
+        }
+        {
+            Scene::BitmapLayer& layer = subscene.newBitmapLayer();
+            layer.setBitmap(&subimage);
+            layer.getMapping().rotateDegrees(-20);
+            Scene::SceneLayer& sceneLayer = scene.addScene(subscene);
+            sceneLayer.getMapping().scale(0.4f);
+            sceneLayer.getMapping().translate(Point(0.55f, 0.35f));
+        }
+
+        SceneRenderer renderer;
+        renderer.setScene(&scene);
+        renderer.setOutputMapping(SceneRenderer::OutputMapping::FIT_WIDTH);
+        renderer.setOutputPixelsFetching(true);
+        renderer.setBackgroundImage(&background);     // opaque, so that the initial output content does not matter
+
+        // GPU; extra threads have nothing to do
+        renderer.setOutput(&gpuOutput);
+        context.limitWorkerCount(3);
+        context.performTask(renderer);
+
+        // CPU, single thread
+        renderer.setUsingGpuIfAvailable(false);
+        renderer.setOutput(&cpuOutput);
+        context.limitWorkerCount(1);
+        context.performTask(renderer);
+        const float psnr = Metric::psnr(gpuOutput, cpuOutput);
+        if (psnr < MIN_PSNR)
+            throw std::runtime_error("Scene rendering on CPU does not match the GPU version: PSNR = " + std::to_string(psnr) + " dB");
+
+        // CPU, multiple threads
+        const auto expected = getContent(cpuOutput);
+        context.limitWorkerCount(3);
+        context.performTask(renderer);
+        if (getContent(cpuOutput) != expected)
+            throw std::runtime_error("Multithreaded scene rendering on CPU does not match the single-threaded one");
+    }
+};
+
+
+/**
+    Checks flood fill against a breadth-first search and its multithreaded single seed processing against the single-threaded one
+*/
+class FloodFillTest {
+private:
+    Context context;
+
+    /**
+        Fills a region pixel by pixel
+    */
+    static void referenceFill(AbstractBitmap& input, AbstractBitmap& mask, IntPoint seed, int tolerance) {
+        AbstractBitmap::ReadLock inputLock(input);
+        AbstractBitmap::WriteLock<ProcessingTarget::CPU> maskLock(mask);
+        const int width = input.getWidth(), height = input.getHeight();
+        const pixbyte ref = *input.getData(seed.x, seed.y);
+        std::vector<IntPoint> queue{ seed };
+        for (size_t i = 0; i < queue.size(); ++i) {
+            const IntPoint p = queue[i];
+            for (const IntPoint& q : { IntPoint(p.x - 1, p.y), IntPoint(p.x, p.y - 1), IntPoint(p.x + 1, p.y), IntPoint(p.x, p.y + 1) })
+                if (q.x >= 0 && q.y >= 0 && q.x < width && q.y < height) {
+                    const int diff = std::abs((int)*input.getData(q.x, q.y) - (int)ref);
+                    const int value = tolerance > 0 && diff > 0 ? 255 * (tolerance - diff) / tolerance + 1 : 255;
+                    if (diff <= tolerance && *mask.getData(q.x, q.y) < value) {
+                        *mask.getData(q.x, q.y) = value;
+                        queue.push_back(q);
+                    }
+                }
+        }
+    }
+
+    static std::vector<pixbyte> getContent(AbstractBitmap& bitmap) {
+        AbstractBitmap::ReadLock lock(bitmap);
+        const pixbyte* data = bitmap.getData(0, 0);
+        return std::vector<pixbyte>(data, data + bitmap.getMemorySize());
+    }
+
+public:
+    void operator()() {
+        static const int WIDTH = 1100, HEIGHT = 1000;
+        InternalBitmap input(context, PixelFormat::SingleByte, WIDTH, HEIGHT);
+        {
+            std::default_random_engine rng;
+            std::uniform_int_distribution<int> noise(0, 40);
+            AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(input);
+            for (int y = 0; y < HEIGHT; ++y)
+                for (int x = 0; x < WIDTH; ++x)
+                    *input.getData(x, y) = (pixbyte)(100 + 60 * std::sin(0.03f * x + 0.02f * y) * std::cos(0.025f * y) + noise(rng));
+        }
+
+        const IntPoint seed(WIDTH / 2, HEIGHT / 2);
+        for (int tolerance : { 0, 20, 90, 255 }) {
+            InternalBitmap reference(context, PixelFormat::SingleByte, WIDTH, HEIGHT);
+            reference.zero();
+            referenceFill(input, reference, seed, tolerance);
+
+            std::vector<IntegerContour2D> singleThreadedContours;
+            for (int numThreads : { 1, 4 }) {
+                context.limitWorkerCount(numThreads);
+                InternalBitmap mask(context, PixelFormat::SingleByte, WIDTH, HEIGHT);
+                mask.zero();
+                FloodFill floodFill;
+                floodFill.setInput(&input);
+                floodFill.setOutput(&mask);
+                floodFill.setSeeds(&seed, 1);
+                floodFill.setTolerance((float)tolerance);
+                floodFill.setComputeContours(true);
+                context.performTask(floodFill);
+
+                const auto content = getContent(mask);
+                if (content != getContent(reference))
+                    throw std::runtime_error("Flood fill mask does not match the reference, tolerance " + std::to_string(tolerance));
+
+                std::vector<IntegerContour2D> contours;
+                for (int i = 0; i < floodFill.getContourCount(); ++i)
+                    contours.push_back(floodFill.getContour(i));
+                if (numThreads == 1)
+                    singleThreadedContours = contours;
+                else {
+                    bool same = contours.size() == singleThreadedContours.size();
+                    for (size_t i = 0; i < contours.size() && same; ++i) {
+                        same = contours[i].getPointCount() == singleThreadedContours[i].getPointCount();
+                        for (int j = 0; j < contours[i].getPointCount() && same; ++j)
+                            same = contours[i].getPoint(j) == singleThreadedContours[i].getPoint(j);
+                    }
+                    if (!same)
+                        throw std::runtime_error("Flood fill contours depend on the number of threads, tolerance " + std::to_string(tolerance));
+                }
+            }
+        }
+    }
+};
+
+
+/**
+    Checks that tasks give the same result on a bitmap view as on a copy of the viewed area
+*/
+class BitmapViewTest {
+private:
+    Context context;
+
+    static void check(bool condition, const std::string& message) {
+        if (!condition)
+            throw std::runtime_error("Bitmap view test failed: " + message);
+    }
+
+    static void fillRandomly(AbstractBitmap& bitmap) {
+        std::default_random_engine rng;
+        std::uniform_int_distribution<int> distr(0, 255);
+        AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(bitmap);
+        pixbyte* data = bitmap.getData(0, 0);
+        for (msize i = 0; i < bitmap.getMemorySize(); ++i)
+            data[i] = (pixbyte)distr(rng);
+    }
+
+    /**
+        Compares the pixel data of two bitmaps row by row
+    */
+    static bool equal(AbstractBitmap& bitmap1, AbstractBitmap& bitmap2) {
+        if (bitmap1.getSize() != bitmap2.getSize() || bitmap1.getPixelFormat() != bitmap2.getPixelFormat())
+            return false;
+        AbstractBitmap::ReadLock lock1(bitmap1), lock2(bitmap2);
+        const size_t rowSize = (bitmap1.getWidth() * bitmap1.getBitsPerPixel() + 7) / 8;
+        for (int y = 0; y < bitmap1.getHeight(); ++y)
+            if (memcmp(bitmap1.getData(0, y), bitmap2.getData(0, y), rowSize) != 0)
+                return false;
+        return true;
+    }
+
+public:
+    void operator()() {
+        static const int WIDTH = 320, HEIGHT = 200;
+        const IntRectangle area(40, 21, 240, 171);
+
+        InternalBitmap parent(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+        fillRandomly(parent);
+        BitmapView view(parent, area);
+        std::unique_ptr<AbstractBitmap> copy(Crop::run(parent, area));
+        check(view.getWidth() == area.width() && view.getHeight() == area.height() && view.getStride() == parent.getStride(), "wrong view size");
+        check(!view.isDense() && parent.isDense(), "wrong memory layout");
+        check(equal(view, *copy), "view content mismatch");
+
+        // format conversion
+        for (PixelFormat format : { SingleByte, TripleByte, QuadByte, SingleFloat, TripleFloat, QuadFloat }) {
+            InternalBitmap fromView(context, format, area.width(), area.height()), fromCopy(context, format, area.width(), area.height());
+            FormatConverter::convert(view, fromView);
+            FormatConverter::convert(*copy, fromCopy);
+            check(equal(fromView, fromCopy), std::string("conversion mismatch to ") + AbstractBitmap::PIXEL_FORMAT_NAMES[format]);
+        }
+
+        // resampling to a bitmap with the same and a different number of channels to run separable and 2D kernels
+        BitmapResampler resampler(context);
+        for (auto mode : { BitmapResampler::Mode::NEAREST_NEIGHBOR, BitmapResampler::Mode::BOX, BitmapResampler::Mode::LINEAR,
+                           BitmapResampler::Mode::CUBIC, BitmapResampler::Mode::LANCZOS })
+            for (PixelFormat format : { QuadByte, TripleByte })
+                for (const IntPoint& size : { IntPoint(90, 70), IntPoint(260, 190) }) {
+                    if (mode == BitmapResampler::Mode::LANCZOS && format != QuadByte)
+                        continue;
+                    InternalBitmap fromView(context, format, size.x, size.y), fromCopy(context, format, size.x, size.y);
+                    resampler.setMode(mode);
+                    resampler.setInput(&view);
+                    resampler.setOutput(&fromView);
+                    context.performTask(resampler);
+                    resampler.setInput(copy.get());
+                    resampler.setOutput(&fromCopy);
+                    context.performTask(resampler);
+                    check(equal(fromView, fromCopy), "resampling mismatch, mode " + std::to_string((int)mode));
+                }
+
+        // writing to a view
+        {
+            InternalBitmap output(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+            output.zero();
+            BitmapView outputView(output, area);
+            FormatConverter::convert(*copy, outputView);
+            check(equal(outputView, *copy), "written view content mismatch");
+            AbstractBitmap::ReadLock lock(output);
+            for (int y = 0; y < HEIGHT; ++y)
+                for (int x = 0; x < WIDTH; ++x)
+                    if (!area.isInsideHalfOpened(IntPoint(x, y)))
+                        check(output.getPixelInt(x, y, 0) == 0 && output.getPixelInt(x, y, 3) == 0, "pixels outside of the view are modified");
+        }
+
+        // metric
+        {
+            InternalBitmap other(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+            fillRandomly(other);
+            BitmapView otherView(other, area);
+            Metric metric;
+            metric.setBitmaps(&parent, area, &other, area);
+            context.performTask(metric);
+            const double reference = metric.getResult();
+            metric.setBitmaps(&view, &otherView);
+            context.performTask(metric);
+            check(metric.getResult() == reference, "metric mismatch");
+        }
+
+        // flood fill of a single byte view into a binary mask view
+        {
+            InternalBitmap input(context, PixelFormat::SingleByte, WIDTH, HEIGHT);
+            {
+                AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(input);
+                for (int y = 0; y < HEIGHT; ++y)
+                    for (int x = 0; x < WIDTH; ++x)
+                        *input.getData(x, y) = (pixbyte)(128 + 100 * std::sin(0.05f * x) * std::cos(0.07f * y));
+            }
+            BitmapView inputView(input, area);
+            std::unique_ptr<AbstractBitmap> inputCopy(Crop::run(input, area));
+
+            InternalBitmap mask(context, PixelFormat::BinaryMask, WIDTH, HEIGHT), maskOfCopy(context, PixelFormat::BinaryMask, area.width(), area.height());
+            mask.zero();
+            maskOfCopy.zero();
+            BitmapView maskView(mask, area);
+
+            const IntPoint seed(area.width() / 2, area.height() / 2);
+            FloodFill floodFill;
+            floodFill.setSeeds(&seed, 1);
+            floodFill.setTolerance(60);
+            floodFill.setInput(&inputView);
+            floodFill.setOutput(&maskView);
+            context.performTask(floodFill);
+            floodFill.setInput(inputCopy.get());
+            floodFill.setOutput(&maskOfCopy);
+            context.performTask(floodFill);
+            check(equal(maskView, maskOfCopy), "flood fill mismatch");
+        }
+
+        // invalid views
+        bool thrown = false;
+        try {
+            BitmapView(parent, IntRectangle(0, 0, WIDTH + 1, HEIGHT));
+        }
+        catch (const InvalidArgument&) {
+            thrown = true;
+        }
+        check(thrown, "out-of-bounds view is created");
+
+        thrown = false;
+        try {
+            InternalBitmap mask(context, PixelFormat::BinaryMask, WIDTH, HEIGHT);
+            BitmapView(mask, IntRectangle(3, 0, 11, 10));
+        }
+        catch (const InvalidArgument&) {
+            thrown = true;
+        }
+        check(thrown, "misaligned mask view is created");
+    }
+};
+
+
+/**
+    Checks that processing memory-mapped bitmaps band by band gives the same result as processing whole bitmaps
+*/
+class TiledExecutorTest {
+private:
+    Context context;
+
+    static void check(bool condition, const std::string& message) {
+        if (!condition)
+            throw std::runtime_error("Tiled executor test failed: " + message);
+    }
+
+    static bool equal(AbstractBitmap& bitmap1, AbstractBitmap& bitmap2) {
+        if (bitmap1.getSize() != bitmap2.getSize() || bitmap1.getPixelFormat() != bitmap2.getPixelFormat())
+            return false;
+        AbstractBitmap::ReadLock lock1(bitmap1), lock2(bitmap2);
+        const size_t rowSize = (bitmap1.getWidth() * bitmap1.getBitsPerPixel() + 7) / 8;
+        for (int y = 0; y < bitmap1.getHeight(); ++y)
+            if (memcmp(bitmap1.getData(0, y), bitmap2.getData(0, y), rowSize) != 0)
+                return false;
+        return true;
+    }
+
+    /**
+        Returns the maximum absolute difference between the pixel values of two integer bitmaps of the same format and size
+    */
+    static int maxDifference(AbstractBitmap& bitmap1, AbstractBitmap& bitmap2) {
+        AbstractBitmap::ReadLock lock1(bitmap1), lock2(bitmap2);
+        const int rowSize = bitmap1.getWidth() * bitmap1.getNumberOfChannels();
+        int result = 0;
+        for (int y = 0; y < bitmap1.getHeight(); ++y)
+            for (int x = 0; x < rowSize; ++x)
+                result = std::max(result, std::abs((int)bitmap1.getData(0, y)[x] - (int)bitmap2.getData(0, y)[x]));
+        return result;
+    }
+
+public:
+    void operator()() {
+        static const char
+            *INPUT_FILENAME = "tiled_executor_test_input.raw",
+            *OUTPUT_FILENAME = "tiled_executor_test_output.raw",
+            *MASK_FILENAME = "tiled_executor_test_mask.raw";
+        static const int WIDTH = 300, HEIGHT = 960, BAND_HEIGHT = 16;
+
+        // writing a bitmap to a file
+        {
+            MappedBitmap input(context, PixelFormat::QuadByte, WIDTH, HEIGHT, INPUT_FILENAME);
+            check(input.isWritable() && input.isDense(), "wrong mapped bitmap properties");
+            std::default_random_engine rng;
+            std::uniform_int_distribution<int> distr(0, 255);
+            AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(input);
+            for (int y = 0; y < HEIGHT; ++y) {
+                for (int x = 0; x < WIDTH * 4; ++x)
+                    input.getData(0, y)[x] = (pixbyte)distr(rng);
+                if (y % 100 == 99)
+                    input.unloadRows(0, y);
+            }
+        }
+
+        MappedBitmap input(context, PixelFormat::QuadByte, WIDTH, HEIGHT, INPUT_FILENAME, false);
+        InternalBitmap reference(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+        FormatConverter::convert(input, reference);
+        TiledExecutor executor(context, BAND_HEIGHT);
+
+        // resampling with different ratios between input and output heights, including coprime heights
+        BitmapResampler resampler(context);
+        for (auto mode : { BitmapResampler::Mode::NEAREST_NEIGHBOR, BitmapResampler::Mode::BOX, BitmapResampler::Mode::LINEAR,
+                           BitmapResampler::Mode::CUBIC, BitmapResampler::Mode::LANCZOS })
+            for (PixelFormat format : { QuadByte, TripleByte })
+                for (const IntPoint& size : { IntPoint(200, 720), IntPoint(150, 320), IntPoint(400, 1440), IntPoint(77, 250),
+                                              IntPoint(200, 959), IntPoint(120, 97) }) {
+                    if (mode == BitmapResampler::Mode::LANCZOS && format != QuadByte)
+                        continue;
+                    MappedBitmap output(context, format, size.x, size.y, OUTPUT_FILENAME);
+                    InternalBitmap expected(context, format, size.x, size.y);
+                    resampler.setMode(mode);
+                    executor.resample(resampler, input, output);
+                    check(resampler.getInput() == &input && resampler.getOutput() == &output, "resampler bitmaps are not restored");
+                    resampler.setInput(&reference);
+                    resampler.setOutput(&expected);
+                    context.performTask(resampler);
+                    // the source positions are computed in floating point in both cases, which causes small rounding differences
+                    check(maxDifference(output, expected) <= 2, "resampling mismatch, mode " + std::to_string((int)mode) +
+                        ", size " + std::to_string(size.x) + "x" + std::to_string(size.y));
+                }
+
+        // format conversion
+        for (PixelFormat format : { SingleByte, SingleFloat, QuadFloat }) {
+            MappedBitmap output(context, format, WIDTH, HEIGHT, OUTPUT_FILENAME);
+            InternalBitmap expected(context, format, WIDTH, HEIGHT);
+            executor.convert(input, output);
+            FormatConverter::convert(reference, expected);
+            check(equal(output, expected), std::string("conversion mismatch to ") + AbstractBitmap::PIXEL_FORMAT_NAMES[format]);
+        }
+
+        // conversion of masks of a width not fitting whole bytes
+        for (PixelFormat format : { BinaryMask, HexMask }) {
+            static const int MASK_WIDTH = 123;
+            MappedBitmap mask(context, format, MASK_WIDTH, HEIGHT, MASK_FILENAME);
+            InternalBitmap expected(context, PixelFormat::QuadByte, MASK_WIDTH, HEIGHT);
+            {
+                AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(mask);
+                for (msize i = 0; i < mask.getMemorySize(); ++i)
+                    mask.getData(0, 0)[i] = (pixbyte)(i * 37);
+            }
+            MappedBitmap output(context, PixelFormat::QuadByte, MASK_WIDTH, HEIGHT, OUTPUT_FILENAME);
+            executor.convert(mask, output);
+            FormatConverter::convert(mask, expected);
+            check(equal(output, expected), std::string("conversion mismatch from ") + AbstractBitmap::PIXEL_FORMAT_NAMES[format]);
+        }
+
+        // color matrix
+        {
+            MappedBitmap output(context, PixelFormat::QuadByte, WIDTH, HEIGHT, OUTPUT_FILENAME);
+            InternalBitmap expected(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+            Filters::ColorMatrix colorMatrix;
+            colorMatrix.setHSVCorrection(30, 0.9f, 1.1f);
+            executor.apply(colorMatrix, input, output);
+            colorMatrix.setInput(&reference);
+            colorMatrix.setOutput(&expected);
+            context.performTask(colorMatrix);
+            check(equal(output, expected), "color matrix mismatch");
+        }
+
+        // binary operation
+        {
+            MappedBitmap output(context, PixelFormat::QuadByte, WIDTH, HEIGHT, OUTPUT_FILENAME);
+            InternalBitmap expected(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+            BitmapBinaryOperation multiplication;
+            multiplication.setOperation(BitmapBinaryOperation::Operation::MULTIPLY);
+            executor.apply(multiplication, input, input, output);
+            multiplication.setOperand1(&reference);
+            multiplication.setOperand2(&reference);
+            multiplication.setOutput(&expected);
+            multiplication.resetCrop();
+            context.performTask(multiplication);
+            check(equal(output, expected), "binary operation mismatch");
+        }
+
+        // the file content is kept once the mapping is closed
+        {
+            InternalBitmap expected(context, PixelFormat::QuadByte, WIDTH / 2, HEIGHT / 2);
+            {
+                MappedBitmap output(context, PixelFormat::QuadByte, WIDTH / 2, HEIGHT / 2, OUTPUT_FILENAME);
+                resampler.setMode(BitmapResampler::Mode::BOX);
+                executor.resample(resampler, input, output);
+                FormatConverter::convert(output, expected);
+            }
+            MappedBitmap output(context, PixelFormat::QuadByte, WIDTH / 2, HEIGHT / 2, OUTPUT_FILENAME, false);
+            check(equal(output, expected), "file content mismatch");
+        }
+
+        // opening a file too small to contain the bitmap
+        bool thrown = false;
+        try {
+            MappedBitmap(context, PixelFormat::QuadByte, WIDTH, HEIGHT + 1, INPUT_FILENAME, false);
+        }
+        catch (const IOError&) {
+            thrown = true;
+        }
+        check(thrown, "a too small file is mapped");
+
+        std::remove(INPUT_FILENAME);
+        std::remove(OUTPUT_FILENAME);
+        std::remove(MASK_FILENAME);
+    }
+};
+
+
+/**
+    Checks that classifying a batch of images gives the same results as classifying the images one by one, on GPU and on CPU
+*/
+class BatchedInferenceTest {
+private:
+    Context context;
+
+    static void check(bool condition, const std::string& message) {
+        if (!condition)
+            throw std::runtime_error("Batched inference test failed: " + message);
+    }
+
+    static void writeRandom(ChunkFileWriter& writer, const std::string& id, size_t size, std::default_random_engine& rng) {
+        std::uniform_real_distribution<float> distr(-0.5f, 0.5f);
+        std::vector<float> values(size);
+        for (auto& v : values)
+            v = distr(rng);
+        writer(id, values.data(), values.size() * sizeof(float));
+    }
+
+public:
+    void operator()() {
+        static const char* FILENAME = "batched_inference_test.chunks";
+        static const int BATCH_SIZE = 5, NUM_CHANNELS = 8, NUM_CLASSES = 4;
+
+        // write random model data
+        std::default_random_engine rng;
+        {
+            ChunkFileWriter writer(FILENAME);
+            writeRandom(writer, "conv/w", 3 * 3 * 3 * NUM_CHANNELS, rng);
+            writeRandom(writer, "conv/b", NUM_CHANNELS, rng);
+            writeRandom(writer, "fc/w", NUM_CHANNELS * NUM_CLASSES, rng);
+            writeRandom(writer, "fc/b", NUM_CLASSES, rng);
+        }
+
+        // generate inputs
+        std::vector<std::unique_ptr<InternalBitmap>> images;
+        std::vector<AbstractBitmap*> batch;
+        std::uniform_int_distribution<int> distr(0, 255);
+        for (int i = 0; i < BATCH_SIZE; ++i) {
+            images.emplace_back(new InternalBitmap(context, PixelFormat::TripleByte, 40 + i, 40));
+            AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(*images.back());
+            for (msize j = 0; j < images.back()->getMemorySize(); ++j)
+                images.back()->getData(0, 0)[j] = (pixbyte)distr(rng);
+            batch.push_back(images.back().get());
+        }
+
+        {
+            MappedChunkFile data(FILENAME);
+            NNets::Classifier classifier(context, data);
+            classifier.append({
+                new NNets::ImageSampler("input", IntPoint(17, 17)),
+                new NNets::Conv2D("conv", 3, 3, NUM_CHANNELS, 2),
+                new NNets::Pooling2D("pool", NNets::Pooling2D::Operator::AVERAGE, 8),
+                new NNets::Dense(context, "fc", NUM_CLASSES, true),
+                new NNets::Softmax("softmax")
+            }, true);
+
+            for (bool useGpu : { true, false }) {
+                classifier.enableGpu(useGpu);
+                std::vector<std::vector<float>> expected;
+                for (auto image : batch)
+                    expected.push_back(classifier(*image));
+                check(classifier.getBatchSize() == 1, "wrong batch size");
+
+                const auto& result = classifier(batch);
+                check(classifier.getBatchSize() == BATCH_SIZE && result.size() == BATCH_SIZE, "wrong batch size");
+                check(result == expected, std::string("results mismatch on ") + (useGpu ? "GPU" : "CPU"));
+                check(classifier.getProbabilities() == expected.back(), "wrong last image probabilities");
+            }
+
+            // empty batch
+            bool thrown = false;
+            try {
+                classifier(std::vector<AbstractBitmap*>());
+            }
+            catch (const InvalidArgument&) {
+                thrown = true;
+            }
+            check(thrown, "an empty batch is accepted");
+        }
+
+        std::remove(FILENAME);
+    }
+};
+
+
+/**
+    Checks that storages of a model run on CPU are packed in a memory arena according to their lifetime without affecting the inference result
+*/
+class MemoryPlanningTest {
+private:
+    Context context;
+
+    static void check(bool condition, const std::string& message) {
+        if (!condition)
+            throw std::runtime_error("Memory planning test failed: " + message);
+    }
+
+    static void writeRandom(ChunkFileWriter& writer, const std::string& id, size_t size, std::default_random_engine& rng) {
+        std::uniform_real_distribution<float> distr(-0.3f, 0.3f);
+        std::vector<float> values(size);
+        for (auto& v : values)
+            v = distr(rng);
+        writer(id, values.data(), values.size() * sizeof(float));
+    }
+
+public:
+    void operator()() {
+        static const char* FILENAME = "memory_planning_test.chunks";
+        static const int NUM_CHANNELS = 8, NUM_CLASSES = 4;
+
+        // write random model data
+        std::default_random_engine rng;
+        {
+            ChunkFileWriter writer(FILENAME);
+            writeRandom(writer, "conv1/w", 3 * 3 * 3 * NUM_CHANNELS, rng);
+            for (const char* name : { "conv2", "conv3" })
+                writeRandom(writer, std::string(name) + "/w", 3 * 3 * NUM_CHANNELS * NUM_CHANNELS, rng);
+            writeRandom(writer, "conv4/w", NUM_CHANNELS * NUM_CHANNELS, rng);
+            for (const char* name : { "conv1", "conv2", "conv3", "conv4" })
+                writeRandom(writer, std::string(name) + "/b", NUM_CHANNELS, rng);
+            writeRandom(writer, "fc/w", NUM_CHANNELS * NUM_CLASSES, rng);
+            writeRandom(writer, "fc/b", NUM_CLASSES, rng);
+        }
+
+        InternalBitmap image(context, PixelFormat::TripleByte, 64, 64);
+        {
+            std::uniform_int_distribution<int> distr(0, 255);
+            AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(image);
+            for (msize i = 0; i < image.getMemorySize(); ++i)
+                image.getData(0, 0)[i] = (pixbyte)distr(rng);
+        }
+
+        {
+            MappedChunkFile data(FILENAME);
+            NNets::Classifier classifier(context, data);
+            classifier.append({
+                new NNets::ImageSampler("input", IntPoint(10, 10)),
+                new NNets::Conv2D("conv1", 3, 3, NUM_CHANNELS),
+                new NNets::Conv2D("conv2", 3, NUM_CHANNELS, NUM_CHANNELS, 1, NNets::Size::Padding::SAME),
+                new NNets::Conv2D("conv3", 3, NUM_CHANNELS, NUM_CHANNELS, 1, NNets::Size::Padding::SAME),
+                new NNets::Conv2D("conv4", 1, NUM_CHANNELS, NUM_CHANNELS),
+                new NNets::Pooling2D("pool", NNets::Pooling2D::Operator::AVERAGE, 8),
+                new NNets::Dense(context, "fc", NUM_CLASSES, true),
+                new NNets::Softmax("softmax")
+            }, true);
+            // residual connection keeping conv1 output alive till conv3
+            classifier.addConnection("conv1", "conv3", 0, 1);
+            classifier.addOutput("conv4");
+
+            Profiler profiler;
+            classifier.setProfiler(&profiler);
+            std::vector<float> result[2], features[2];
+            for (bool useGpu : { true, false }) {
+                classifier.enableGpu(useGpu);
+                result[useGpu] = classifier(image);
+                size_t numSamples;
+                const float* ptr = classifier.getOutputData(numSamples, "conv4");
+                features[useGpu].assign(ptr, ptr + numSamples);
+            }
+
+            // the arena is smaller than the storages all together, but cannot be smaller than the live storages at any point
+            const uint64_t
+                naive = profiler.getCounter("memory: naive, bytes"),
+                planned = profiler.getCounter("memory: planned, bytes");
+            check(planned == classifier.getMemorySize(), "planned memory size mismatch");
+            check(planned < naive, "no memory saved: " + std::to_string(planned) + " vs " + std::to_string(naive) + " bytes");
+
+            // results on CPU and GPU match up to quantization errors
+            check(features[0].size() == features[1].size() && !features[0].empty(), "feature size mismatch");
+            float maxDiff = 0;
+            for (size_t i = 0; i < features[0].size(); ++i)
+                maxDiff = std::max(maxDiff, std::abs(features[0][i] - features[1][i]));
+            check(maxDiff < 0.05f, "features mismatch: " + std::to_string(maxDiff));
+            for (int i = 0; i < NUM_CLASSES; ++i)
+                check(std::abs(result[0][i] - result[1][i]) < 0.05f, "probabilities mismatch");
+
+            // running again gives the same result
+            check(classifier(image) == result[0], "results differ from run to run");
+        }
+
+        std::remove(FILENAME);
+    }
+};
+
+
+/**
+    Reads rendered bitmaps back asynchronously, with more bitmaps pending than the number of staging buffers, and checks that the pixels are
+    correct when locked on CPU, including for a bitmap rendered again after its readback has started.
+*/
+class AsyncReadbackTest {
+private:
+    Context context;
+    ImageShader shader;
+    ShaderApplicator applicator;
+
+    void render(AbstractBitmap& bitmap, float value) {
+        shader.setFloat("value", value);
+        applicator.setOutputBitmap(&bitmap);
+        context.performTask(applicator);
+    }
+
+public:
+    AsyncReadbackTest(): shader(context) {
+        shader.setSourceCode(BEATMUP_SHADER_CODE(
+            uniform highp float value;
+            void main() {
+                gl_FragColor = vec4(value, 1.0 - value, 0.5 * value, 1.0);
+            }
+        ));
+        applicator.setShader(&shader);
+    }
+
+    void operator()() {
+        static const int NUM_BITMAPS = 5;
+        std::vector<std::unique_ptr<InternalBitmap>> bitmaps;
+        std::vector<int> values;
+        for (int i = 0; i < NUM_BITMAPS; ++i) {
+            bitmaps.emplace_back(new InternalBitmap(context, PixelFormat::QuadByte, 67 + 10 * i, 45 + i));
+            values.push_back(40 * i + 20);
+            render(*bitmaps.back(), values.back() / 255.0f);
+            Swapper::pullPixelsAsync(*bitmaps.back());
+        }
+
+        // render the last bitmap once again: the pending readback must be dropped
+        values.back() = 250;
+        render(*bitmaps.back(), values.back() / 255.0f);
+
+        for (int i = 0; i < NUM_BITMAPS; ++i) {
+            InternalBitmap& bitmap = *bitmaps[i];
+            AbstractBitmap::ReadLock lock(bitmap);
+            const int channels = bitmap.getNumberOfChannels();
+            const int expected[] = { values[i], 255 - values[i], values[i] / 2, 255 };
+            const pixbyte* ptr = bitmap.getData(0, 0);
+            for (msize p = 0; p < bitmap.getSize().numPixels(); ++p)
+                for (int c = 0; c < channels; ++c, ++ptr)
+                    if (std::abs(*ptr - expected[c]) > 1) {
+                        std::stringstream ss;
+                        ss << "Asynchronous readback test failed for bitmap #" << i << ": expected " << expected[c]
+                           << " in channel " << c << " of pixel " << p << ", got " << (int)*ptr;
+                        throw std::runtime_error(ss.str());
+                    }
+        }
+    }
+};
+
+
+/**
+    Checks that textures of released bitmaps are reused by new bitmaps of the same size and format
+*/
+class TexturePoolTest {
+private:
+    Context context;
+    ImageShader shader;
+    ShaderApplicator applicator;
+
+    static void check(bool condition, const char* message) {
+        if (!condition)
+            throw std::runtime_error(std::string("Texture pool test failed: ") + message);
+    }
+
+    void render(AbstractBitmap& bitmap, int value) {
+        shader.setFloat("value", value / 255.0f);
+        applicator.setOutputBitmap(&bitmap);
+        context.performTask(applicator);
+    }
+
+    void checkContent(AbstractBitmap& bitmap, int value) {
+        Swapper::pullPixels(bitmap);
+        AbstractBitmap::ReadLock lock(bitmap);
+        const pixbyte* ptr = bitmap.getData(0, 0);
+        for (msize i = 0; i < bitmap.getMemorySize(); i += 4)
+            if (std::abs(ptr[i] - value) > 1 || std::abs(ptr[i + 1] - (255 - value)) > 1)
+                check(false, "unexpected content of a reused texture");
+    }
+
+public:
+    TexturePoolTest(): shader(context) {
+        shader.setSourceCode(BEATMUP_SHADER_CODE(
+            uniform highp float value;
+            void main() {
+                gl_FragColor = vec4(value, 1.0 - value, 0.0, 1.0);
+            }
+        ));
+        applicator.setShader(&shader);
+    }
+
+    void operator()() {
+        static const int WIDTH = 320, HEIGHT = 240, NUM_FRAMES = 10;
+        GL::TexturePool& pool = context.getGpuTexturePool();
+        const size_t textureSize = GL::TexturePool::getTextureSize(WIDTH, HEIGHT, GL::TextureHandler::TextureFormat::RGBAx8);
+        check(textureSize == WIDTH * HEIGHT * 4, "unexpected texture size");
+        pool.setCapacity(2 * textureSize);
+
+        // same-sized bitmaps are expected to reuse the same texture
+        for (int i = 0; i < NUM_FRAMES; ++i) {
+            InternalBitmap bitmap(context, PixelFormat::QuadByte, WIDTH, HEIGHT);
+            render(bitmap, 20 * i);
+            checkContent(bitmap, 20 * i);
+        }
+        GL::TexturePool::Statistics stats = pool.getStatistics();
+        check(stats.misses == 1 && stats.hits == NUM_FRAMES - 1, "unexpected hits/misses count");
+        check(stats.cachedTextures == 1 && stats.cachedBytes == textureSize, "unexpected pool state");
+
+        // a bitmap of a different format does not take the texture
+        {
+            InternalBitmap bitmap(context, PixelFormat::TripleByte, WIDTH, HEIGHT);
+            render(bitmap, 0);
+        }
+        stats = pool.getStatistics();
+        check(stats.misses == 2 && stats.cachedTextures == 2, "a texture of a different format is reused");
+
+        // masks are not pooled
+        {
+            InternalBitmap mask(context, PixelFormat::BinaryMask, WIDTH, HEIGHT);
+            Swapper::pushPixels(mask);
+        }
+        check(pool.getStatistics().cachedTextures == 2, "a mask texture is pooled");
+
+        // reshaping releases the texture of the previous size
+        {
+            InternalBitmap bitmap(context, PixelFormat::QuadByte, HEIGHT, WIDTH);
+            render(bitmap, 0);
+            bitmap.reshape(WIDTH, HEIGHT);
+            render(bitmap, 100);
+            checkContent(bitmap, 100);
+        }
+
+        // exceeding the capacity evicts least recently released textures
+        stats = pool.getStatistics();
+        check(stats.cachedTextures == 2 && stats.evictions == 2, "capacity is not respected");
+
+        pool.trim();
+        check(pool.getStatistics().cachedBytes == 0, "trimming does not empty the pool");
+        context.getGpuRecycleBin()->emptyBin();
+    }
+};
+
+
+/**
+    Builds a shader in several contexts sharing a program cache directory: first from source, then from the cached binary, then from source
+    again after the cached binary is damaged.
+*/
+class ProgramCacheTest {
+private:
+    static const char* SOURCE_CODE;
+
+    static void check(bool condition, const std::string& message) {
+        if (!condition)
+            throw std::runtime_error("Program cache test failed: " + message);
+    }
+
+    /**
+        Renders the shader in a new context and checks the result
+    */
+    static GL::ProgramCache::Statistics render(bool enableCache) {
+        Context context;
+        if (enableCache)
+            context.getProgramCache().setDirectory(".");
+        ImageShader shader(context);
+        shader.setSourceCode(SOURCE_CODE);
+        InternalBitmap bitmap(context, PixelFormat::QuadByte, 16, 16);
+        ShaderApplicator applicator;
+        applicator.setShader(&shader);
+        applicator.setOutputBitmap(&bitmap);
+        context.performTask(applicator);
+
+        AbstractBitmap::ReadLock lock(bitmap);
+        const pixbyte* ptr = bitmap.getData(0, 0);
+        check(ptr[0] == 255 && ptr[1] == 128 && ptr[2] == 0 && ptr[3] == 255, "unexpected rendering result");
+        return context.getProgramCache().getStatistics();
+    }
+
+public:
+    void operator()() {
+        GL::ProgramCache cache;
+        cache.setDirectory(".");
+        const std::string filename = cache.getFilename(GL::ProgramCache::getRenderingProgramKey(SOURCE_CODE, GL::Extensions::BEATMUP_DIALECT));
+        std::remove(filename.c_str());
+
+        // cache disabled
+        auto stats = render(false);
+        check(stats.hits == 0 && stats.misses == 0 && stats.stores == 0, "disabled cache is used");
+        check(!ChunkFile::readable(filename), "disabled cache is written");
+
+        // cold start
+        stats = render(true);
+        check(stats.hits == 0 && stats.misses == 1, "unexpected cache hit");
+        if (stats.stores == 0) {
+            std::cout << "  Program binaries are not supported by the GPU, skipping" << std::endl;
+            return;
+        }
+        check(ChunkFile::readable(filename), "no binary stored");
+
+        // warm start
+        stats = render(true);
+        check(stats.hits == 1 && stats.misses == 0 && stats.stores == 0, "cached binary not used");
+
+        // damaged binary
+        {
+            ChunkFile file(filename);
+            const std::string driver = file.read<std::string>("driver");
+            const std::string key = file.read<std::string>("key");
+            file.close();
+            ChunkFileWriter writer(filename);
+            writer("driver", driver.data(), driver.size());
+            writer("key", key.data(), key.size());
+            std::vector<uint8_t> garbage(256, 123);
+            writer("binary", garbage.data(), garbage.size());
+        }
+        stats = render(true);
+        check(stats.rejections == 1 && stats.hits == 0 && stats.stores == 1, "damaged binary not rejected");
+
+        // binary of another driver
+        {
+            ChunkFile file(filename);
+            Chunk binary(file, "binary");
+            const std::string key = file.read<std::string>("key");
+            file.close();
+            ChunkFileWriter writer(filename);
+            writer("driver", "another GPU", 11);
+            writer("key", key.data(), key.size());
+            binary.writeTo(writer, "binary");
+        }
+        stats = render(true);
+        check(stats.misses == 1 && stats.hits == 0 && stats.rejections == 0 && stats.stores == 1, "binary of another driver is used");
+
+        std::remove(filename.c_str());
+    }
+};
+
+const char* ProgramCacheTest::SOURCE_CODE = BEATMUP_SHADER_CODE(
+    void main() {
+        gl_FragColor = vec4(1.0, 0.502, 0.0, 1.0);
+    }
+);
+
+
+/**
+    Checks that a memory-mapped chunk file gives the same content as ChunkFile, without copying
+*/
+class MappedChunkFileTest {
+private:
+    static void check(bool condition, const char* message) {
+        if (!condition)
+            throw std::runtime_error(std::string("Mapped chunk file test failed: ") + message);
+    }
+
+public:
+    void operator()() {
+        static const char* FILENAME = "mapped_chunkfile_test.chunks";
+        static const int NUM_WEIGHTS = 100000;
+
+        // write a file
+        std::vector<float> weights(NUM_WEIGHTS);
+        std::default_random_engine rng;
+        std::uniform_real_distribution<float> distr(-1, 1);
+        for (auto& w : weights)
+            w = distr(rng);
+        const std::string text("Beatmup");
+        {
+            ChunkFileWriter writer(FILENAME);
+            writer("", text.data(), text.size());
+            writer("weights", weights.data(), weights.size() * sizeof(float));
+            writer("empty", nullptr, 0);
+            writer("answer", 42);
+        }
+
+        {
+            ChunkFile file(FILENAME);
+            MappedChunkFile mapped(FILENAME);
+
+            // compare to ChunkFile
+            check(mapped.isOpen() && mapped.size() == 4 && mapped.size() == file.size(), "chunk count mismatch");
+            for (const char* id : { "", "weights", "empty", "answer" }) {
+                check(mapped.chunkExists(id), "chunk not found");
+                check(mapped.chunkSize(id) == file.chunkSize(id), "chunk size mismatch");
+            }
+            check(!mapped.chunkExists("missing") && mapped.chunkSize("missing") == 0 && !mapped.chunkData("missing"), "unexpected chunk found");
+            check(mapped.read<std::string>("") == text && mapped.read<int>("answer") == 42, "chunk content mismatch");
+            check(mapped.readVector<float>("weights") == file.readVector<float>("weights"), "chunk content mismatch");
+
+            // chunks from the mapped file refer to the file content
+            {
+                const Chunk chunk(mapped, "weights");
+                check(!chunk.isOwning() && chunk() == mapped.chunkData("weights"), "the chunk content is copied");
+                check(std::equal(weights.begin(), weights.end(), chunk.ptr<float>()), "chunk content mismatch");
+                const Chunk copy(file, "weights");
+                check(copy.isOwning(), "the chunk content is not copied");
+            }
+
+            // chunks list is kept after closing, but not the content
+            mapped.close();
+            check(!mapped.isOpen() && mapped.chunkExists("weights") && !mapped.chunkData("weights"), "unexpected state after closing");
+            bool thrown = false;
+            try {
+                mapped.read<int>("answer");
+            }
+            catch (const RuntimeError&) {
+                thrown = true;
+            }
+            check(thrown, "reading a closed file does not fail");
+
+            mapped.open();
+            check(mapped.read<int>("answer") == 42, "cannot read after reopening");
+        }
+
+        // truncated file
+        {
+            std::ofstream stream(FILENAME, std::ios::binary | std::ios::out | std::ios::app);
+            const uint32_t header[2] = { 0, 1000 };
+            stream.write((const char*)header, sizeof(header));
+        }
+        bool thrown = false;
+        try {
+            MappedChunkFile mapped(FILENAME);
+        }
+        catch (const IOError&) {
+            thrown = true;
+        }
+        check(thrown, "truncated file not detected");
+
+        std::remove(FILENAME);
+    }
+};
+
+
+/**
+    Writes channelwise-multiplexed samples to a signal starting from a given time, fragment by fragment
+*/
+static void writeSignal(Audio::Signal& signal, dtime time, const void* samples, dtime length) {
+    const int blockSize = signal.getChannelCount() * AUDIO_SAMPLE_SIZE[signal.getSampleFormat()];
+    signal.reserve(time + length);
+    Audio::Signal::Writer writer(signal, time);
+    const uint8_t* data = (const uint8_t*)samples;
+    for (; length > 0 && writer.hasData(); writer.step()) {
+        void* buffer;
+        const dtime written = writer.acquireBuffer(buffer, length);
+        memcpy(buffer, data, written * blockSize);
+        writer.releaseBuffer();
+        data += written * blockSize;
+        length -= written;
+    }
+}
+
+
+/**
+    Reads all the channelwise-multiplexed samples of a signal
+*/
+static std::vector<uint8_t> readSignal(Audio::Signal& signal) {
+    const int blockSize = signal.getChannelCount() * AUDIO_SAMPLE_SIZE[signal.getSampleFormat()];
+    std::vector<uint8_t> samples;
+    Audio::Signal::Reader reader(signal, 0);
+    for (; reader.hasData(); reader.step()) {
+        const void* data;
+        const dtime length = reader.acquireBuffer(data);
+        samples.insert(samples.end(), (const uint8_t*)data, (const uint8_t*)data + length * blockSize);
+        reader.releaseBuffer();
+    }
+    return samples;
+}
+
+
+class DynamicsLookupTest {
+private:
+    typedef int16_t sample_t;
+    static const int CHANNELS = 2;
+
+    static void check(bool condition, const std::string& message) {
+        if (!condition)
+            throw std::runtime_error("Dynamics lookup test failed: " + message);
+    }
+
+    /**
+        Checks that two signals give the same measurements in a given window
+    */
+    static void compare(Audio::Signal& signal, Audio::Signal& reference, dtime time, dtime length, int resolution) {
+        for (auto mode : { Audio::Signal::Meter::MeasuringMode::approximateUsingLookup,
+                           Audio::Signal::Meter::MeasuringMode::preciseUsingLookupAndSamples }) {
+            std::vector<sample16> min(resolution * CHANNELS), max(resolution * CHANNELS), refMin(min.size()), refMax(max.size());
+            Audio::Signal::Meter meter(signal, time, mode), refMeter(reference, time, mode);
+            meter.measure<sample16>(length, resolution, min.data(), max.data());
+            refMeter.measure<sample16>(length, resolution, refMin.data(), refMax.data());
+            for (size_t i = 0; i < min.size(); ++i)
+                check(min[i].x == refMin[i].x && max[i].x == refMax[i].x,
+                    "mismatch at " + std::to_string(time) + "+" + std::to_string(length) + ", resolution " + std::to_string(resolution));
+        }
+    }
+
+public:
+    void operator()() {
+        static const int SAMPLE_RATE = 44100, LENGTH = 100000, NUM_EDITS = 50;
+        static const float FRAGMENT_LENGTH = 0.5f;
+        Context context;
+        std::default_random_engine rng;
+        std::uniform_int_distribution<int> sampleDistr(-32768, 32767), timeDistr(0, LENGTH - 1), lengthDistr(1, 3000);
+
+        // filling a signal with random samples
+        std::vector<sample_t> samples(LENGTH * CHANNELS);
+        for (auto& _ : samples)
+            _ = (sample_t)sampleDistr(rng);
+        Audio::Signal signal(context, AudioSampleFormat::Int16, SAMPLE_RATE, CHANNELS, FRAGMENT_LENGTH);
+        writeSignal(signal, 0, samples.data(), LENGTH);
+        Audio::Signal::Meter::prepareSignal(signal);
+
+        // editing small parts of the signal, measuring random windows in between, so that the lookup is partially updated
+        for (int edit = 0; edit < NUM_EDITS; ++edit) {
+            const dtime time = timeDistr(rng), length = std::min(lengthDistr(rng), LENGTH - time);
+            for (dtime i = time * CHANNELS; i < (time + length) * CHANNELS; ++i)
+                samples[i] = (sample_t)sampleDistr(rng);
+            writeSignal(signal, time, samples.data() + time * CHANNELS, length);
+
+            const dtime start = timeDistr(rng), stop = std::min(start + 20 * lengthDistr(rng), LENGTH);
+            std::vector<sample16> min(100 * CHANNELS), max(100 * CHANNELS);
+            Audio::Signal::Meter(signal, start).measure<sample16>(stop - start, 100, min.data(), max.data());
+            if (edit % 10 == 9)
+                Audio::Signal::Meter::prepareSignal(signal, edit % 20 == 9);
+        }
+
+        // comparing with the lookup computed from scratch on the same samples
+        Audio::Signal reference(context, AudioSampleFormat::Int16, SAMPLE_RATE, CHANNELS, FRAGMENT_LENGTH);
+        writeSignal(reference, 0, samples.data(), LENGTH);
+        for (int resolution : { 1, 7, 100, 1000 })
+            compare(signal, reference, 0, LENGTH, resolution);
+        for (int i = 0; i < 100; ++i) {
+            const dtime start = timeDistr(rng), stop = std::min(start + 20 * lengthDistr(rng), LENGTH);
+            compare(signal, reference, start, stop - start, 1 + i % 50);
+        }
+    }
+};
+
+
+/**
+    Checks the vectorized audio sample conversion against the generic one, and the multithreaded SignalConverter against a single thread
+*/
+class SampleConversionTest {
+private:
+    Context context;
+    std::default_random_engine rng;
+
+    static void check(bool condition, const std::string& message) {
+        if (!condition) {
+            SimdKernels::limitInstructionSet(SimdKernels::InstructionSet::AVX2);
+            throw std::runtime_error("Sample conversion test failed: " + message);
+        }
+    }
+
+    /**
+        Fills a buffer with random samples; floating point values go a bit out of -1..1 range to check clamping
+    */
+    void fillRandomly(AudioSampleFormat format, void* data, msize count) {
+        if (format == Float32) {
+            std::uniform_real_distribution<float> distr(-1.25f, 1.25f);
+            for (msize i = 0; i < count; ++i)
+                ((float*)data)[i] = distr(rng);
+            // exact bounds
+            if (count > 1) {
+                ((float*)data)[0] = -1.0f;
+                ((float*)data)[count - 1] = 1.0f;
+            }
+        }
+        else {
+            std::uniform_int_distribution<int> distr(0, 255);
+            for (msize i = 0; i < count * AUDIO_SAMPLE_SIZE[format]; ++i)
+                ((uint8_t*)data)[i] = (uint8_t)distr(rng);
+        }
+    }
+
+    /**
+        Converts a signal using a given number of threads
+    */
+    std::vector<uint8_t> convert(Audio::Signal& input, AudioSampleFormat outFormat, bool dithering, ThreadIndex threadCount) {
+        Audio::Signal output(context, outFormat, 8191, input.getChannelCount(), 1.0f);
+        Audio::SignalConverter converter;
+        converter.setInput(&input);
+        converter.setOutput(&output);
+        converter.setDithering(dithering, 123);
+        context.limitWorkerCount(threadCount);
+        context.performTask(converter);
+        return readSignal(output);
+    }
+
+public:
+    void operator()() {
+        using SimdKernels::InstructionSet;
+        static const AudioSampleFormat FORMATS[] = { Int8, Int16, Int32, Float32 };
+
+        // every format pair, lengths not multiple of the vector size, misaligned buffers
+        for (AudioSampleFormat inFormat : FORMATS)
+            for (AudioSampleFormat outFormat : FORMATS)
+                for (msize count : { 1, 7, 15, 16, 17, 33, 1001 })
+                    for (msize misalignment : { 0, 1 }) {
+                        const std::string title = std::string(AUDIO_FORMAT_NAME[inFormat]) + " to " + AUDIO_FORMAT_NAME[outFormat] +
+                            ", " + std::to_string(count) + " samples";
+                        std::vector<uint8_t>
+                            input((count + misalignment) * AUDIO_SAMPLE_SIZE[inFormat]),
+                            expected((count + misalignment) * AUDIO_SAMPLE_SIZE[outFormat]);
+                        uint8_t* in = input.data() + misalignment * AUDIO_SAMPLE_SIZE[inFormat];
+                        fillRandomly(inFormat, in, count);
+
+                        SimdKernels::limitInstructionSet(InstructionSet::NONE);
+                        Audio::SampleConversion::convert(inFormat, outFormat, in, expected.data() + misalignment * AUDIO_SAMPLE_SIZE[outFormat], count);
+                        for (InstructionSet set : { InstructionSet::SSE41, InstructionSet::AVX2 })
+                            if (set <= SimdKernels::getSupportedInstructionSet()) {
+                                SimdKernels::limitInstructionSet(set);
+                                std::vector<uint8_t> output(expected.size());
+                                Audio::SampleConversion::convert(inFormat, outFormat, in, output.data() + misalignment * AUDIO_SAMPLE_SIZE[outFormat], count);
+                                check(output == expected, title + ": vectorized output does not match the generic one");
+                            }
+                    }
+
+        // dithering: bit-exact across instruction sets and independent of the chunking
+        {
+            static const msize COUNT = 1001;
+            std::vector<float> input(COUNT);
+            fillRandomly(Float32, input.data(), COUNT);
+            std::vector<sample16> expected(COUNT);
+            SimdKernels::limitInstructionSet(InstructionSet::NONE);
+            Audio::SampleConversion::convertWithDither((const sample32f*)input.data(), expected.data(), COUNT, 0, 5);
+            for (InstructionSet set : { InstructionSet::NONE, InstructionSet::SSE41, InstructionSet::AVX2 })
+                if (set <= SimdKernels::getSupportedInstructionSet()) {
+                    SimdKernels::limitInstructionSet(set);
+                    for (msize chunk : { COUNT, (msize)17, (msize)100 }) {
+                        std::vector<sample16> output(COUNT);
+                        for (msize i = 0; i < COUNT; i += chunk)
+                            Audio::SampleConversion::convertWithDither((const sample32f*)input.data() + i, output.data() + i,
+                                std::min(chunk, COUNT - i), i, 5);
+                        for (msize i = 0; i < COUNT; ++i)
+                            check(output[i].x == expected[i].x, "dithered output mismatch, chunks of " + std::to_string(chunk));
+                    }
+                }
+            SimdKernels::limitInstructionSet(InstructionSet::AVX2);
+        }
+
+        // SignalConverter: the multithreaded conversion of a fragmented signal matches the single-threaded one
+        {
+            static const int CHANNELS = 2;
+            static const dtime LENGTH = 50001;      // several conversion chunks, fragments of an odd length
+            const ThreadIndex workerCount = context.maxAllowedWorkerCount();
+            for (AudioSampleFormat inFormat : FORMATS) {
+                std::vector<uint8_t> samples(LENGTH * CHANNELS * AUDIO_SAMPLE_SIZE[inFormat]);
+                fillRandomly(inFormat, samples.data(), LENGTH * CHANNELS);
+                Audio::Signal input(context, inFormat, 8191, CHANNELS, 1.0f);
+                writeSignal(input, 0, samples.data(), LENGTH);
+
+                for (AudioSampleFormat outFormat : FORMATS)
+                    for (bool dithering : { false, true }) {
+                        if (inFormat == outFormat || (dithering && (inFormat != Float32 || outFormat != Int16)))
+                            continue;
+                        const std::string title = std::string(AUDIO_FORMAT_NAME[inFormat]) + " to " + AUDIO_FORMAT_NAME[outFormat] +
+                            (dithering ? " with dithering" : "");
+                        const auto expected = convert(input, outFormat, dithering, 1);
+                        check(expected.size() == (size_t)(LENGTH * CHANNELS * AUDIO_SAMPLE_SIZE[outFormat]), title + ": wrong output length");
+                        check(convert(input, outFormat, dithering, 4) == expected, title + ": multithreaded output mismatch");
+                    }
+            }
+            context.limitWorkerCount(workerCount);
+        }
+    }
+};
+
+
+/**
+    Checks that signals written to WAV files by WAV::Writer are read back unchanged by WAV::Reader
+*/
+class WavStreamTest {
+private:
+    Context context;
+
+    static void check(bool condition, const std::string& message) {
+        if (!condition)
+            throw std::runtime_error("WAV stream test failed: " + message);
+    }
+
+public:
+    void operator()() {
+        static const char* FILENAME = "wav_stream_test.wav";
+        static const int SAMPLE_RATE = 8191;                // fragments of an odd length
+        static const dtime LENGTH = 20011, WRITING_BUFFER_LENGTH = 1000, READING_BUFFER_LENGTH = 777;
+        std::default_random_engine rng;
+        std::uniform_int_distribution<int> byteDistr(0, 255);
+        std::uniform_real_distribution<float> floatDistr(-1, 1);
+
+        for (AudioSampleFormat format : { Int8, Int16, Int32, Float32 })
+            for (int channels : { 1, 2, 3 }) {
+                const std::string title = std::string(AUDIO_FORMAT_NAME[format]) + ", " + std::to_string(channels) + " channels";
+                std::vector<uint8_t> samples(LENGTH * channels * AUDIO_SAMPLE_SIZE[format]);
+                if (format == Float32)
+                    for (size_t i = 0; i < samples.size() / sizeof(float); ++i)
+                        ((float*)samples.data())[i] = floatDistr(rng);
+                else
+                    for (auto& _ : samples)
+                        _ = (uint8_t)byteDistr(rng);
+                Audio::Signal signal(context, format, SAMPLE_RATE, channels, 1.0f);
+                writeSignal(signal, 0, samples.data(), LENGTH);
+
+                // writing in two runs appending to the same file
+                {
+                    Audio::Signal::Source source(signal);
+                    Audio::WAV::Writer writer(FILENAME);
+                    writer.setSource(&source);
+                    writer.initialize(Audio::AbstractPlayback::Mode(SAMPLE_RATE, format, channels, WRITING_BUFFER_LENGTH));
+                    writer.setLength(LENGTH / 3);
+                    context.performTask(writer);
+                    writer.setLength(LENGTH - LENGTH / 3);
+                    context.performTask(writer);
+                    writer.close();
+                }
+
+                // reading by blocks not aligned with the writing buffers nor with the fragments of the output signal
+                for (bool mapped : { false, true }) {
+                    Audio::WAV::Reader reader(FILENAME, mapped);
+                    check(reader.getSampleFormat() == format && reader.getChannelCount() == channels && reader.getSampleRate() == SAMPLE_RATE,
+                        title + ": header mismatch");
+                    check(reader.getDuration() == LENGTH, title + ": wrong duration");
+                    if (mapped)
+                        check(memcmp(reader.getData(), samples.data(), samples.size()) == 0, title + ": mapped samples mismatch");
+
+                    Audio::Signal output(context, format, SAMPLE_RATE, channels, 0.1f);
+                    Audio::OfflinePlayback playback;
+                    playback.setSource(&reader);
+                    playback.setOutput(&output);
+                    playback.initialize(Audio::AbstractPlayback::Mode(SAMPLE_RATE, format, channels, READING_BUFFER_LENGTH));
+                    playback.setLength(LENGTH);
+                    context.performTask(playback);
+                    check(readSignal(output) == samples, title + (mapped ? ": mapped" : ": streamed") + " samples mismatch");
+                }
+
+                std::remove(FILENAME);
+            }
+    }
+};
+
+
+/**
+    Checks that OfflinePlayback renders the same signal in one and in several threads
+*/
+class OfflinePlaybackTest {
+private:
+    Context context;
+
+    static void check(bool condition, const std::string& message) {
+        if (!condition)
+            throw std::runtime_error("Offline playback test failed: " + message);
+    }
+
+    /**
+        Renders a source to a signal using a given number of threads, in one or two runs
+    */
+    std::vector<uint8_t> render(Audio::Source& source, const Audio::AbstractPlayback::Mode& mode, dtime length, ThreadIndex threadCount, bool split) {
+        Audio::Signal output(context, mode.sampleFormat, mode.sampleRate, mode.numChannels, 1.0f);
+        Audio::OfflinePlayback playback;
+        playback.setSource(&source);
+        playback.setOutput(&output);
+        playback.initialize(mode);
+        context.limitWorkerCount(threadCount);
+        if (split) {
+            playback.setLength(length / 2);
+            context.performTask(playback);
+            playback.setLength(length - length / 2);
+        }
+        else
+            playback.setLength(length);
+        context.performTask(playback);
+        check(playback.getRenderedLength() == length, "wrong rendered length");
+        return readSignal(output);
+    }
+
+public:
+    void operator()() {
+        static const int SAMPLE_RATE = 8191;                        // output fragments of an odd length
+        static const dtime LENGTH = 33333, BUFFER_LENGTH = 5000;    // buffers of several blocks, incomplete last block
+        const ThreadIndex workerCount = context.maxAllowedWorkerCount();
+
+        // a signal of random samples
+        std::default_random_engine rng;
+        std::uniform_int_distribution<int> distr(0, 255);
+        std::vector<uint8_t> samples(LENGTH * 2 * AUDIO_SAMPLE_SIZE[Int16]);
+        for (auto& _ : samples)
+            _ = (uint8_t)distr(rng);
+        Audio::Signal signal(context, Int16, SAMPLE_RATE, 2, 0.3f);
+        writeSignal(signal, 0, samples.data(), LENGTH);
+
+        Audio::Signal::Source signalSource(signal);
+        Audio::HarmonicSource harmonicSource;
+        for (Audio::Source* source : std::initializer_list<Audio::Source*>{ &signalSource, &harmonicSource })
+            for (AudioSampleFormat format : { Int16, Float32 })
+                for (int channels : { 1, 2 }) {
+                    const std::string title = std::string(source == &signalSource ? "signal" : "harmonic") + " source, " +
+                        AUDIO_FORMAT_NAME[format] + ", " + std::to_string(channels) + " channels";
+                    const Audio::AbstractPlayback::Mode mode(SAMPLE_RATE, format, channels, BUFFER_LENGTH);
+                    const auto expected = render(*source, mode, LENGTH, 1, false);
+                    check(expected.size() == (size_t)(LENGTH * channels * AUDIO_SAMPLE_SIZE[format]), title + ": wrong output size");
+                    check(render(*source, mode, LENGTH, 4, false) == expected, title + ": multithreaded output mismatch");
+                    check(render(*source, mode, LENGTH, 3, true) == expected, title + ": output mismatch when rendered in two runs");
+                }
+
+        context.limitWorkerCount(workerCount);
+    }
+};
+
+
 int main() {
     try {
         std::cout << "Basic shading test..." << std::endl;
@@ -466,6 +2960,75 @@ int main() {
         std::cout << "Storage push and pull test..." << std::endl;
         StoragePushingPullingTest()();
 
+        std::cout << "Vectorized bitmap processing test..." << std::endl;
+        SimdKernelsTest()();
+
+        std::cout << "Work stealing test..." << std::endl;
+        WorkStealingTest()();
+
+        std::cout << "Pipelined multitask test..." << std::endl;
+        PipelinedMultitaskTest()();
+
+        std::cout << "Concurrent jobs test..." << std::endl;
+        ConcurrentJobsTest()();
+
+        std::cout << "Task graph test..." << std::endl;
+        TaskGraphTest()();
+
+        std::cout << "Memory pool test..." << std::endl;
+        MemoryPoolTest()();
+
+        std::cout << "Fused pixel pipeline test..." << std::endl;
+        PixelPipelineTest()();
+
+        std::cout << "Separable resampling test..." << std::endl;
+        SeparableResamplingTest()();
+
+        std::cout << "Convnet upsampling on CPU test..." << std::endl;
+        CpuConvnetTest()();
+
+        std::cout << "Scene rendering on CPU test..." << std::endl;
+        CpuSceneRenderingTest()();
+
+        std::cout << "Flood fill test..." << std::endl;
+        FloodFillTest()();
+
+        std::cout << "Mapped chunk file test..." << std::endl;
+        MappedChunkFileTest()();
+
+        std::cout << "Bitmap view test..." << std::endl;
+        BitmapViewTest()();
+
+        std::cout << "Tiled executor test..." << std::endl;
+        TiledExecutorTest()();
+
+        std::cout << "Batched inference test..." << std::endl;
+        BatchedInferenceTest()();
+
+        std::cout << "Memory planning test..." << std::endl;
+        MemoryPlanningTest()();
+
+        std::cout << "Asynchronous readback test..." << std::endl;
+        AsyncReadbackTest()();
+
+        std::cout << "Texture pool test..." << std::endl;
+        TexturePoolTest()();
+
+        std::cout << "Program cache test..." << std::endl;
+        ProgramCacheTest()();
+
+        std::cout << "Audio sample conversion test..." << std::endl;
+        SampleConversionTest()();
+
+        std::cout << "WAV streaming test..." << std::endl;
+        WavStreamTest()();
+
+        std::cout << "Offline playback test..." << std::endl;
+        OfflinePlaybackTest()();
+
+        std::cout << "Dynamics lookup test..." << std::endl;
+        DynamicsLookupTest()();
+
         // replaying
         static const char* TESTS_FILE = "tests.chunks";
         if (ChunkFile::readable(TESTS_FILE)) {
@@ -0,0 +1,378 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+    Benchmarking the thread pool overhead: job submission latency and threads synchronization cost.
+    The lock-free submission queue and the spinning barrier are compared to their mutex-based counterparts.
+*/
+
+#include "context.h"
+#include "utils/mpsc_queue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+
+/**
+    Task recording the time its processing starts
+*/
+class TimestampTask : public Beatmup::AbstractTask {
+private:
+    Beatmup::ThreadIndex getMaxThreads() const { return 1; }
+    TaskDeviceRequirement getUsedDevices() const { return TaskDeviceRequirement::CPU_ONLY; }
+
+    bool process(Beatmup::TaskThread& thread) {
+        startTime = Clock::now();
+        return true;
+    }
+
+public:
+    Clock::time_point startTime;
+};
+
+
+/**
+    Task calling TaskThread::synchronize() many times in all the threads of the pool.
+    The time is measured once all the threads are running the task, so that waking them up is not counted.
+*/
+class SynchronizationTask : public Beatmup::AbstractTask {
+private:
+    const int numSyncs;
+
+    Beatmup::ThreadIndex getMaxThreads() const { return Beatmup::MAX_THREAD_INDEX; }
+    TaskDeviceRequirement getUsedDevices() const { return TaskDeviceRequirement::CPU_ONLY; }
+
+    bool process(Beatmup::TaskThread& thread) {
+        thread.synchronize();
+        const auto startTime = Clock::now();
+        for (int i = 0; i < numSyncs; ++i)
+            thread.synchronize();
+        if (thread.isManaging())
+            time = std::chrono::duration<double, std::micro>(Clock::now() - startTime).count();
+        return true;
+    }
+
+public:
+    double time;        //!< time taken by the synchronizations in microseconds
+
+    SynchronizationTask(int numSyncs): numSyncs(numSyncs), time(0) {}
+};
+
+
+/**
+    Mutex-based barrier, as in the thread pool before the spinning barrier was introduced
+*/
+class MutexBarrier {
+private:
+    std::mutex access;
+    std::condition_variable cvar;
+    int hitsCount, hitsBound;
+    const int numThreads;
+
+public:
+    MutexBarrier(int numThreads): hitsCount(0), hitsBound(0), numThreads(numThreads) {}
+
+    void synchronize() {
+        std::unique_lock<std::mutex> lock(access);
+        hitsCount++;
+        if (hitsCount >= hitsBound + numThreads) {
+            hitsBound = hitsCount;
+            lock.unlock();
+            cvar.notify_all();
+        }
+        else {
+            const int myBound = hitsBound;
+            while (myBound + numThreads - hitsCount > 0)
+                cvar.wait(lock);
+        }
+    }
+};
+
+
+/**
+    Worker thread picking up jobs from a mutex-protected queue and woken up by a condition variable, as the thread pool submitted jobs
+    before the lock-free queue was introduced. Running a job only records its start time: the figures measure the submission mechanism
+    alone, without the task setup done by the thread pool.
+*/
+class MutexJobDispatcher {
+private:
+    std::mutex access;
+    std::condition_variable jobCvar, doneCvar;
+    std::deque<TimestampTask*> jobs;
+    std::thread worker;
+    int pendingCount;
+    bool stopping;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(access);
+        while (true) {
+            jobCvar.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            TimestampTask* job = jobs.front();
+            jobs.pop_front();
+            lock.unlock();
+            job->startTime = Clock::now();
+            lock.lock();
+            if (--pendingCount == 0)
+                doneCvar.notify_all();
+        }
+    }
+
+public:
+    MutexJobDispatcher(): pendingCount(0), stopping(false) {
+        worker = std::thread(&MutexJobDispatcher::run, this);
+    }
+
+    ~MutexJobDispatcher() {
+        {
+            std::lock_guard<std::mutex> lock(access);
+            stopping = true;
+        }
+        jobCvar.notify_all();
+        worker.join();
+    }
+
+    void submit(TimestampTask& task) {
+        {
+            std::lock_guard<std::mutex> lock(access);
+            jobs.push_back(&task);
+            pendingCount++;
+        }
+        jobCvar.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(access);
+        doneCvar.wait(lock, [this]() { return pendingCount == 0; });
+    }
+};
+
+
+/**
+    Mutex-protected queue, as the jobs queue in the thread pool before the lock-free queue was introduced
+*/
+template<typename T> class MutexQueue {
+private:
+    std::mutex access;
+    std::deque<T> items;
+
+public:
+    void push(const T& value) {
+        std::lock_guard<std::mutex> lock(access);
+        items.push_back(value);
+    }
+
+    bool pop(T& value) {
+        std::lock_guard<std::mutex> lock(access);
+        if (items.empty())
+            return false;
+        value = items.front();
+        items.pop_front();
+        return true;
+    }
+};
+
+
+static void printStats(const std::string& title, std::vector<double>& values, const std::string& unit) {
+    std::sort(values.begin(), values.end());
+    double sum = 0;
+    for (auto _ : values)
+        sum += _;
+    std::cout << std::left << std::setw(52) << title << std::right << std::fixed << std::setprecision(2)
+              << "median " << std::setw(9) << values[values.size() / 2] << " " << unit
+              << ", mean " << std::setw(9) << sum / values.size() << " " << unit
+              << ", 90% " << std::setw(9) << values[values.size() * 9 / 10] << " " << unit << std::endl;
+}
+
+
+/**
+    Measures the time between submitting a job to an idle pool and the start of its processing
+*/
+static void measureSubmitToStartLatency(Beatmup::Context& context, int numIterations) {
+    TimestampTask task;
+    std::vector<double> latencies;
+    for (int i = 0; i < numIterations; ++i) {
+        const auto submitTime = Clock::now();
+        context.waitForJob(context.submitTask(task));
+        latencies.push_back(std::chrono::duration<double, std::micro>(task.startTime - submitTime).count());
+    }
+    printStats("Submit-to-start latency, idle pool", latencies, "us");
+}
+
+
+/**
+    Measures the time between submitting a job to an idle mutex-based dispatcher and the start of its processing
+*/
+static void measureReferenceSubmitToStartLatency(int numIterations) {
+    MutexJobDispatcher dispatcher;
+    TimestampTask task;
+    std::vector<double> latencies;
+    for (int i = 0; i < numIterations; ++i) {
+        const auto submitTime = Clock::now();
+        dispatcher.submit(task);
+        dispatcher.wait();
+        latencies.push_back(std::chrono::duration<double, std::micro>(task.startTime - submitTime).count());
+    }
+    printStats("Submit-to-start latency, mutex-based (reference)", latencies, "us");
+}
+
+
+/**
+    Measures the time taken by submitting a burst of jobs to the pool and running them
+*/
+static void measureBurst(Beatmup::Context& context, int numIterations, int burstSize) {
+    std::vector<TimestampTask> tasks(burstSize);
+    std::vector<Beatmup::Job> jobs(burstSize);
+    std::vector<double> submissionTimes, totalTimes;
+    for (int i = 0; i < numIterations; ++i) {
+        const auto startTime = Clock::now();
+        for (int j = 0; j < burstSize; ++j)
+            jobs[j] = context.submitTask(tasks[j]);
+        const auto submittedTime = Clock::now();
+        context.wait();
+        const auto stopTime = Clock::now();
+        submissionTimes.push_back(std::chrono::duration<double, std::micro>(submittedTime - startTime).count() / burstSize);
+        totalTimes.push_back(std::chrono::duration<double, std::micro>(stopTime - startTime).count() / burstSize);
+    }
+    printStats("Submission time per job, burst of " + std::to_string(burstSize), submissionTimes, "us");
+    printStats("Total time per job, burst of " + std::to_string(burstSize), totalTimes, "us");
+}
+
+
+/**
+    Measures the time taken by submitting a burst of jobs to the mutex-based dispatcher and running them
+*/
+static void measureReferenceBurst(int numIterations, int burstSize) {
+    MutexJobDispatcher dispatcher;
+    std::vector<TimestampTask> tasks(burstSize);
+    std::vector<double> submissionTimes, totalTimes;
+    for (int i = 0; i < numIterations; ++i) {
+        const auto startTime = Clock::now();
+        for (auto& task : tasks)
+            dispatcher.submit(task);
+        const auto submittedTime = Clock::now();
+        dispatcher.wait();
+        const auto stopTime = Clock::now();
+        submissionTimes.push_back(std::chrono::duration<double, std::micro>(submittedTime - startTime).count() / burstSize);
+        totalTimes.push_back(std::chrono::duration<double, std::micro>(stopTime - startTime).count() / burstSize);
+    }
+    printStats("Submission time per job, mutex-based (reference)", submissionTimes, "us");
+    printStats("Total time per job, mutex-based (reference)", totalTimes, "us");
+}
+
+
+/**
+    Measures the cost of TaskThread::synchronize() in all the threads of the pool
+*/
+static void measurePoolBarrier(Beatmup::Context& context, int numIterations, int numSyncs) {
+    SynchronizationTask task(numSyncs);
+    std::vector<double> times;
+    for (int i = 0; i < numIterations; ++i) {
+        context.performTask(task);
+        times.push_back(task.time / numSyncs);
+    }
+    printStats("Thread pool synchronization", times, "us");
+}
+
+
+/**
+    Measures the cost of the mutex-based barrier in the same number of threads.
+    As for the thread pool, the time is measured once all the threads are started.
+*/
+static void measureMutexBarrier(int numThreads, int numIterations, int numSyncs) {
+    std::vector<double> times;
+    for (int i = 0; i < numIterations; ++i) {
+        MutexBarrier barrier(numThreads);
+        double time = 0;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < numThreads; ++t)
+            threads.emplace_back([&, t]() {
+                barrier.synchronize();
+                const auto startTime = Clock::now();
+                for (int j = 0; j < numSyncs; ++j)
+                    barrier.synchronize();
+                if (t == 0)
+                    time = std::chrono::duration<double, std::micro>(Clock::now() - startTime).count();
+            });
+        for (auto& _ : threads)
+            _.join();
+        times.push_back(time / numSyncs);
+    }
+    printStats("Mutex-based barrier (reference)", times, "us");
+}
+
+
+/**
+    Measures the push and pop cost of a queue with several producers and a single consumer
+*/
+template<class Queue> static void measureQueue(const std::string& title, int numProducers, int numItems) {
+    Queue queue;
+    std::atomic<int> popped(0);
+    const auto startTime = Clock::now();
+    std::vector<std::thread> producers;
+    for (int p = 0; p < numProducers; ++p)
+        producers.emplace_back([&]() {
+            for (int i = 0; i < numItems; ++i)
+                queue.push(i);
+        });
+    int value;
+    while (popped < numProducers * numItems)
+        if (queue.pop(value))
+            popped++;
+    for (auto& _ : producers)
+        _.join();
+    const double time = std::chrono::duration<double, std::nano>(Clock::now() - startTime).count() / (numProducers * numItems);
+    std::cout << std::left << std::setw(52) << title << std::right << std::fixed << std::setprecision(2)
+              << "mean " << std::setw(9) << time << " ns per item" << std::endl;
+}
+
+
+int main(int argc, const char* argv[]) {
+    static const int NUM_ITERATIONS = 1000, NUM_SYNCS = 1000, BURST_SIZE = 16, NUM_ITEMS = 100000;
+
+    // the number of threads in the pool may be given in the command line
+    Beatmup::Context context;
+    if (argc > 1)
+        context.limitWorkerCount((Beatmup::ThreadIndex)std::max(1, std::min(std::atoi(argv[1]), (int)Beatmup::MAX_THREAD_INDEX)));
+    const int numThreads = context.maxAllowedWorkerCount();
+    std::cout << "Thread pool size: " << numThreads << std::endl << std::endl;
+
+    measureSubmitToStartLatency(context, NUM_ITERATIONS);
+    measureReferenceSubmitToStartLatency(NUM_ITERATIONS);
+    measureBurst(context, NUM_ITERATIONS / 10, BURST_SIZE);
+    measureReferenceBurst(NUM_ITERATIONS / 10, BURST_SIZE);
+    measurePoolBarrier(context, NUM_ITERATIONS / 10, NUM_SYNCS);
+    measureMutexBarrier(numThreads, NUM_ITERATIONS / 10, NUM_SYNCS);
+
+    const int numProducers = std::max(2, numThreads - 1);
+    measureQueue<Beatmup::MpscQueue<int>>("Lock-free queue, " + std::to_string(numProducers) + " producers", numProducers, NUM_ITEMS);
+    measureQueue<MutexQueue<int>>("Mutex-protected queue (reference)", numProducers, NUM_ITEMS);
+
+    return 0;
+}
@@ -18,6 +18,8 @@
 
 #include "../../debug.h"
 #include "abstract_playback.h"
+#include "../../utils/utils.hpp"
+#include <algorithm>
 
 using namespace Beatmup;
 using namespace Audio;
@@ -78,7 +80,10 @@ void AbstractPlayback::initialize(AbstractPlayback::Mode mode) {
 
 
 ThreadIndex AbstractPlayback::getMaxThreads() const {
-    return source ? source->getMaxThreads() : 1;
+    if (!source)
+        return 1;
+    // no more threads than blocks in a buffer
+    return std::min(source->getMaxThreads(), validThreadCount(ceili(mode.bufferLength, Source::BLOCK_LENGTH)));
 }
 
 void AbstractPlayback::beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline *gpu) {
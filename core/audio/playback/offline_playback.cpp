@@ -0,0 +1,91 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "offline_playback.h"
+#include <algorithm>
+
+using namespace Beatmup;
+using namespace Audio;
+
+
+OfflinePlayback::OfflinePlayback():
+    output(nullptr), block(nullptr), blockLength(0), length(0), startClock(0)
+{}
+
+
+void OfflinePlayback::initialize(Mode mode) {
+    AbstractPlayback::initialize(mode);
+    buffer.clear();
+}
+
+
+sample8* OfflinePlayback::lockBlock(dtime& length) {
+    if (output) {
+        // render straight to the signal; the pointer is released right away, but the data stays in place till the signal is edited
+        output->reserve(clock + length);
+        Signal::Writer pointer(*output, clock);
+        void* data;
+        length = pointer.acquireBuffer(data, length);
+        pointer.releaseBuffer();
+        return (sample8*)data;
+    }
+
+    buffer.resize(mode.bufferLength * mode.numChannels * AUDIO_SAMPLE_SIZE[mode.sampleFormat]);
+    return buffer.data();
+}
+
+
+void OfflinePlayback::beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu) {
+    NullTaskInput::check(source, "audio source");
+    if (output)
+        InvalidArgument::check(output->getSampleFormat() == mode.sampleFormat && output->getChannelCount() == mode.numChannels,
+            "Output signal format does not match the playback mode");
+    AbstractPlayback::beforeProcessing(threadCount, target, gpu);
+    startClock = clock;
+    block = nullptr;
+    blockLength = 0;
+}
+
+
+bool OfflinePlayback::process(TaskThread& thread) {
+    while (true) {
+        // the managing thread completes the previous block and sets up the next one
+        if (thread.isManaging()) {
+            if (block) {
+                unlockBlock(block, blockLength);
+                clock += blockLength;
+                block = nullptr;
+            }
+
+            blockLength = mode.bufferLength;
+            if (length > 0)
+                blockLength = std::min(blockLength, startClock + length - clock);
+            if (blockLength > 0 && !thread.isTaskAborted())
+                block = lockBlock(blockLength);
+        }
+        thread.synchronize();
+
+        if (!block)
+            break;
+        source->render(thread, block, blockLength);
+        thread.synchronize();
+    }
+
+    return true;
+}
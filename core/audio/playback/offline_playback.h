@@ -0,0 +1,93 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "abstract_playback.h"
+#include "../signal.h"
+#include <vector>
+
+namespace Beatmup {
+    namespace Audio {
+
+        /**
+            Playback rendering a Source as fast as possible, with no audio device involved.
+            The timeline is rendered block by block; every block of Mode::bufferLength samples is rendered by all the threads running the
+            task, each one filling its own part of the block if the source is multithreaded. The rendered signal is written to an output
+            Signal if set, directly in its memory; the signal is prolongated if needed. Otherwise the blocks are rendered to an internal
+            buffer. Subclasses may further process every block once it is rendered (e.g., write it to a file).
+            Every run renders the given number of samples starting from the time the previous run stopped at.
+        */
+        class OfflinePlayback : public AbstractPlayback {
+        private:
+            Signal* output;
+            std::vector<sample8> buffer;        //!< rendered samples when there is no output signal
+            sample8* block;                     //!< address of the block being rendered
+            dtime blockLength;                  //!< length of the block being rendered in samples
+            dtime length;                       //!< number of samples per channel to render in every run; 0 if unlimited
+            dtime startClock;                   //!< clock value at the beginning of the current run
+
+        protected:
+            /**
+                Provides the memory to render a block to. Called in the managing thread.
+                \param[in,out] length   Number of samples per channel to render; may be decreased
+                \return address of the block.
+            */
+            virtual sample8* lockBlock(dtime& length);
+
+            /**
+                Called in the managing thread once a block is rendered.
+                \param[in] block        Address of the rendered block
+                \param[in] length       Number of samples per channel in the block
+            */
+            virtual void unlockBlock(const sample8* block, dtime length) {}
+
+            void beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu);
+            bool process(TaskThread& thread);
+
+        public:
+            OfflinePlayback();
+
+            /**
+                Initializes the playback and resets the clock. The number of buffers in the mode is irrelevant.
+            */
+            void initialize(Mode mode);
+
+            /**
+                Sets the signal to render to.
+                \param[in] output   The output signal, or null to not store the rendered samples. The signal sample format and number of
+                                    channels must match the playback mode.
+            */
+            inline void setOutput(Signal* output) { this->output = output; }
+            inline Signal* getOutput() const { return output; }
+
+            /**
+                Sets the number of samples per channel to render in every run.
+                \param[in] length   The length in samples; 0 to render until the task is aborted.
+            */
+            inline void setLength(dtime length) { this->length = length; }
+            inline dtime getLength() const { return length; }
+
+            /**
+                \return number of samples per channel rendered since the playback is initialized.
+            */
+            inline dtime getRenderedLength() const { return clock; }
+        };
+
+    }
+}
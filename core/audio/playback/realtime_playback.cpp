@@ -18,6 +18,7 @@
 
 #include "../../debug.h"
 #include "realtime_playback.h"
+#include <cstring>
 
 using namespace Beatmup;
 using namespace Audio;
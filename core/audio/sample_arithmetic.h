@@ -19,6 +19,7 @@
 #pragma once
 #include "../basic_types.h"
 #include "../utils/utils.hpp"
+#include <algorithm>
 
 namespace Beatmup {
 
@@ -32,7 +33,7 @@ namespace Beatmup {
         Float32     //!< floating point, 32 bit per sample
     };
 
-    const int AUDIO_SAMPLE_SIZE[] = { 1, 2, 3, 4 };
+    const int AUDIO_SAMPLE_SIZE[] = { 1, 2, 4, 4 };
     const char* const AUDIO_FORMAT_NAME[] = { "8 bit", "16 bit", "32 bit", "32 bit float" };
 
     struct sample8;
@@ -52,6 +53,7 @@ namespace Beatmup {
         static const int
             MIN_VALUE = -128,
             MAX_VALUE = +127;
+        static const AudioSampleFormat FORMAT = Int8;
     };
 
     struct sample16 {
@@ -66,6 +68,7 @@ namespace Beatmup {
         static const int
             MIN_VALUE = -32768,
             MAX_VALUE = +32767;
+        static const AudioSampleFormat FORMAT = Int16;
     };
 
     struct sample32 {
@@ -80,6 +83,7 @@ namespace Beatmup {
         static const long
             MIN_VALUE = -2147483647-1,
             MAX_VALUE = +2147483647;
+        static const AudioSampleFormat FORMAT = Int32;
     };
 
     struct sample32f {
@@ -94,8 +98,25 @@ namespace Beatmup {
         static const float
             MIN_VALUE,
             MAX_VALUE;
+        static const AudioSampleFormat FORMAT = Float32;
     };
 
+    /**
+        Converts a floating point sample to an integer one: scales, clamps and rounds it.
+        \param[in] x        The sample value
+        \param[in] scale    Scaling factor
+        \param[in] min      The smallest scaled value
+        \param[in] max      The largest scaled value
+    */
+    inline int quantizeSample(float x, float scale, float min, float max) {
+        return roundf_fast(std::min(std::max(x * scale, min), max));
+    }
+
+    /**
+        The largest float not exceeding the 32-bit integer range
+    */
+    const float SAMPLE32_MAX_FLOAT = 2147483520.0f;
+
     //////////////////////////////////////////////////////////////
     //						8 bit integer						//
     //////////////////////////////////////////////////////////////
@@ -105,7 +126,7 @@ namespace Beatmup {
     }
 
     inline sample8::operator sample32() const {
-        return sample32{ x << 2 };
+        return sample32{ x << 24 };
     }
 
     inline sample8::operator sample32f() const {
@@ -121,7 +142,7 @@ namespace Beatmup {
     }
 
     inline void sample8::operator =(const sample32f S) {
-        x = (decltype(x)) roundf_fast(S.x * 127);
+        x = (decltype(x)) quantizeSample(S.x, 127, -128, 127);
     }
 
 
@@ -146,11 +167,11 @@ namespace Beatmup {
     }
     
     inline void sample16::operator =(const sample32 S) {
-        x = (decltype(x))( S.x >> 8 );
+        x = (decltype(x))( S.x >> 16 );
     }
 
     inline void sample16::operator =(const sample32f S) {
-        x = (decltype(x)) roundf_fast(S.x * 32767);
+        x = (decltype(x)) quantizeSample(S.x, 32767, -32768, 32767);
     }
 
     //////////////////////////////////////////////////////////////
@@ -178,7 +199,7 @@ namespace Beatmup {
     }
 
     inline void sample32::operator =(const sample32f S) {
-        x = roundf_fast(S.x * 2147483647);
+        x = quantizeSample(S.x, 2147483647, -2147483648.0f, SAMPLE32_MAX_FLOAT);
     }
 
     //////////////////////////////////////////////////////////////
@@ -186,15 +207,15 @@ namespace Beatmup {
     //////////////////////////////////////////////////////////////
     
     inline sample32f::operator sample8() const {
-        return sample8{ (decltype(sample8::x)) roundf_fast(x *127) };
+        return sample8{ (decltype(sample8::x)) quantizeSample(x, 127, -128, 127) };
     }
 
     inline sample32f::operator sample16() const {
-        return sample16{ (decltype(sample16::x)) roundf_fast(x * 32767) };
+        return sample16{ (decltype(sample16::x)) quantizeSample(x, 32767, -32768, 32767) };
     }
 
     inline sample32f::operator sample32() const {
-        return sample32{ roundf_fast(x * 2147483647) };
+        return sample32{ quantizeSample(x, 2147483647, -2147483648.0f, SAMPLE32_MAX_FLOAT) };
     }
 
     inline void sample32f::operator =(const sample8 S) {
@@ -218,6 +239,10 @@ namespace Beatmup {
     }
 
 
+    /**
+        Converts samples from one format to another, one by one.
+        Audio::SampleConversion::convert() is a faster equivalent for long buffers.
+    */
     template<typename in, typename out> void convertSamples(in* const input, void* output, msize count) {
         const in* stop = input + count;
         out* po = (out*)output;
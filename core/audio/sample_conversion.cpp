@@ -0,0 +1,510 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "sample_conversion.h"
+#include "processing.h"
+#include "../bitmap/simd_kernels.h"
+#include "../platform.h"
+#include <cstring>
+
+#ifdef BEATMUP_ARCH_X86_64
+    #include <immintrin.h>
+    // The instruction set is enabled per function, so that no specific compiler flags are needed to build this file
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #define BEATMUP_TARGET_SSE41
+        #define BEATMUP_TARGET_AVX2
+    #else
+        #define BEATMUP_TARGET_SSE41 __attribute__((target("sse4.1")))
+        #define BEATMUP_TARGET_AVX2  __attribute__((target("avx2")))
+    #endif
+#endif
+
+using namespace Beatmup;
+using namespace Audio;
+
+
+/**
+    Integer hash giving the dither noise for a sample index
+*/
+static inline uint32_t hashIndex(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+
+/**
+    Dither noise of triangular probability density in -1..1 range: a difference of two uniformly distributed 16-bit values
+*/
+static inline float ditherNoise(uint32_t x) {
+    const uint32_t hash = hashIndex(x);
+    return (float)((int)(hash & 0xFFFF) - (int)(hash >> 16)) * (1.0f / 65536);
+}
+
+
+namespace Kernels {
+    template<typename in_t, typename out_t> class ConvertSamples {
+    public:
+        static void process(const in_t* input, out_t* output, msize count) {
+            for (msize i = 0; i < count; ++i)
+                output[i] = input[i];
+        }
+    };
+
+
+    template<typename sample_t> inline void interleave(const void* const* channels, int numChannels, void* output, msize start, msize length) {
+        sample_t* out = (sample_t*)output + start * numChannels;
+        for (msize i = start; i < length; ++i)
+            for (int c = 0; c < numChannels; ++c)
+                *out++ = ((const sample_t*)channels[c])[i];
+    }
+
+
+    template<typename sample_t> inline void deinterleave(const void* input, int numChannels, void* const* channels, msize start, msize length) {
+        const sample_t* in = (const sample_t*)input + start * numChannels;
+        for (msize i = start; i < length; ++i)
+            for (int c = 0; c < numChannels; ++c)
+                ((sample_t*)channels[c])[i] = *in++;
+    }
+}
+
+
+#ifdef BEATMUP_ARCH_X86_64
+
+namespace Sse41 {
+
+    /**
+        Converts floating point samples to integers as quantizeSample() does
+    */
+    BEATMUP_TARGET_SSE41 inline __m128i quantize(__m128 x, __m128 scale, __m128 min, __m128 max) {
+        return _mm_cvtps_epi32(_mm_floor_ps(_mm_add_ps(
+            _mm_min_ps(_mm_max_ps(_mm_mul_ps(x, scale), min), max),
+            _mm_set1_ps(0.5f)
+        )));
+    }
+
+
+    /**
+        Computes the dither noise of four consecutive samples as ditherNoise() does
+    */
+    BEATMUP_TARGET_SSE41 inline __m128 ditherNoise(__m128i x) {
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        x = _mm_mullo_epi32(x, _mm_set1_epi32(0x7feb352d));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+        x = _mm_mullo_epi32(x, _mm_set1_epi32((int)0x846ca68bu));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        const __m128i diff = _mm_sub_epi32(_mm_and_si128(x, _mm_set1_epi32(0xFFFF)), _mm_srli_epi32(x, 16));
+        return _mm_mul_ps(_mm_cvtepi32_ps(diff), _mm_set1_ps(1.0f / 65536));
+    }
+
+
+    /**
+        Converts samples in blocks of 16.
+        \return the number of converted samples.
+    */
+    BEATMUP_TARGET_SSE41 msize convert(AudioSampleFormat inFormat, AudioSampleFormat outFormat, const void* input, void* output, msize count) {
+        const __m128i zero = _mm_setzero_si128();
+        const msize n = count - count % 16;
+
+        switch (inFormat) {
+        case Int8: {
+            const pixbyte* in = (const pixbyte*)input;
+            for (msize i = 0; i < n; i += 16) {
+                const __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+                switch (outFormat) {
+                case Int16:
+                    _mm_storeu_si128((__m128i*)output + i / 8,     _mm_unpacklo_epi8(zero, x));
+                    _mm_storeu_si128((__m128i*)output + i / 8 + 1, _mm_unpackhi_epi8(zero, x));
+                    break;
+                case Int32: {
+                    const __m128i lo = _mm_unpacklo_epi8(zero, x), hi = _mm_unpackhi_epi8(zero, x);
+                    _mm_storeu_si128((__m128i*)output + i / 4,     _mm_unpacklo_epi16(zero, lo));
+                    _mm_storeu_si128((__m128i*)output + i / 4 + 1, _mm_unpackhi_epi16(zero, lo));
+                    _mm_storeu_si128((__m128i*)output + i / 4 + 2, _mm_unpacklo_epi16(zero, hi));
+                    _mm_storeu_si128((__m128i*)output + i / 4 + 3, _mm_unpackhi_epi16(zero, hi));
+                    break;
+                }
+                case Float32: {
+                    const __m128 scale = _mm_set1_ps(1.0f / 128);
+                    float* out = (float*)output + i;
+                    _mm_storeu_ps(out,      _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi8_epi32(x)), scale));
+                    _mm_storeu_ps(out + 4,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_srli_si128(x, 4))), scale));
+                    _mm_storeu_ps(out + 8,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_srli_si128(x, 8))), scale));
+                    _mm_storeu_ps(out + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_srli_si128(x, 12))), scale));
+                    break;
+                }
+                default:
+                    return 0;
+                }
+            }
+            return n;
+        }
+
+        case Int16: {
+            const __m128i* in = (const __m128i*)input;
+            for (msize i = 0; i < n; i += 16) {
+                const __m128i
+                    x0 = _mm_loadu_si128(in + i / 8),
+                    x1 = _mm_loadu_si128(in + i / 8 + 1);
+                switch (outFormat) {
+                case Int8:
+                    _mm_storeu_si128((__m128i*)output + i / 16, _mm_packs_epi16(_mm_srai_epi16(x0, 8), _mm_srai_epi16(x1, 8)));
+                    break;
+                case Int32:
+                    _mm_storeu_si128((__m128i*)output + i / 4,     _mm_unpacklo_epi16(zero, x0));
+                    _mm_storeu_si128((__m128i*)output + i / 4 + 1, _mm_unpackhi_epi16(zero, x0));
+                    _mm_storeu_si128((__m128i*)output + i / 4 + 2, _mm_unpacklo_epi16(zero, x1));
+                    _mm_storeu_si128((__m128i*)output + i / 4 + 3, _mm_unpackhi_epi16(zero, x1));
+                    break;
+                case Float32: {
+                    const __m128 scale = _mm_set1_ps(1.0f / 32768);
+                    float* out = (float*)output + i;
+                    _mm_storeu_ps(out,      _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(x0)), scale));
+                    _mm_storeu_ps(out + 4,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(x0, 8))), scale));
+                    _mm_storeu_ps(out + 8,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(x1)), scale));
+                    _mm_storeu_ps(out + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(x1, 8))), scale));
+                    break;
+                }
+                default:
+                    return 0;
+                }
+            }
+            return n;
+        }
+
+        case Int32: {
+            const __m128i* in = (const __m128i*)input;
+            for (msize i = 0; i < n; i += 16) {
+                __m128i x[4];
+                for (int j = 0; j < 4; ++j)
+                    x[j] = _mm_loadu_si128(in + i / 4 + j);
+                switch (outFormat) {
+                case Int8: {
+                    const __m128i
+                        lo = _mm_packs_epi32(_mm_srai_epi32(x[0], 24), _mm_srai_epi32(x[1], 24)),
+                        hi = _mm_packs_epi32(_mm_srai_epi32(x[2], 24), _mm_srai_epi32(x[3], 24));
+                    _mm_storeu_si128((__m128i*)output + i / 16, _mm_packs_epi16(lo, hi));
+                    break;
+                }
+                case Int16:
+                    _mm_storeu_si128((__m128i*)output + i / 8,     _mm_packs_epi32(_mm_srai_epi32(x[0], 16), _mm_srai_epi32(x[1], 16)));
+                    _mm_storeu_si128((__m128i*)output + i / 8 + 1, _mm_packs_epi32(_mm_srai_epi32(x[2], 16), _mm_srai_epi32(x[3], 16)));
+                    break;
+                case Float32: {
+                    const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+                    for (int j = 0; j < 4; ++j)
+                        _mm_storeu_ps((float*)output + i + 4 * j, _mm_mul_ps(_mm_cvtepi32_ps(x[j]), scale));
+                    break;
+                }
+                default:
+                    return 0;
+                }
+            }
+            return n;
+        }
+
+        case Float32: {
+            const float* in = (const float*)input;
+            __m128 scale, min, max;
+            switch (outFormat) {
+            case Int8:
+                scale = _mm_set1_ps(127), min = _mm_set1_ps(-128), max = _mm_set1_ps(127);
+                break;
+            case Int16:
+                scale = _mm_set1_ps(32767), min = _mm_set1_ps(-32768), max = _mm_set1_ps(32767);
+                break;
+            case Int32:
+                scale = _mm_set1_ps(2147483647), min = _mm_set1_ps(-2147483648.0f), max = _mm_set1_ps(SAMPLE32_MAX_FLOAT);
+                break;
+            default:
+                return 0;
+            }
+
+            for (msize i = 0; i < n; i += 16) {
+                __m128i q[4];
+                for (int j = 0; j < 4; ++j)
+                    q[j] = quantize(_mm_loadu_ps(in + i + 4 * j), scale, min, max);
+                switch (outFormat) {
+                case Int8:
+                    _mm_storeu_si128((__m128i*)output + i / 16, _mm_packs_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3])));
+                    break;
+                case Int16:
+                    _mm_storeu_si128((__m128i*)output + i / 8,     _mm_packs_epi32(q[0], q[1]));
+                    _mm_storeu_si128((__m128i*)output + i / 8 + 1, _mm_packs_epi32(q[2], q[3]));
+                    break;
+                default:
+                    for (int j = 0; j < 4; ++j)
+                        _mm_storeu_si128((__m128i*)output + i / 4 + j, q[j]);
+                }
+            }
+            return n;
+        }
+        }
+
+        return 0;
+    }
+
+
+    BEATMUP_TARGET_SSE41 msize convertWithDither(const float* input, short* output, msize count, uint32_t base) {
+        const __m128
+            scale = _mm_set1_ps(32767), min = _mm_set1_ps(-32768), max = _mm_set1_ps(32767), half = _mm_set1_ps(0.5f);
+        const __m128i offset = _mm_setr_epi32(0, 1, 2, 3);
+        const msize n = count - count % 8;
+        for (msize i = 0; i < n; i += 8) {
+            __m128i q[2];
+            for (int j = 0; j < 2; ++j) {
+                const __m128 noise = ditherNoise(_mm_add_epi32(_mm_set1_epi32((int)(base + (uint32_t)(i + 4 * j))), offset));
+                const __m128 x = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(input + i + 4 * j), scale), noise);
+                q[j] = _mm_cvtps_epi32(_mm_floor_ps(_mm_add_ps(_mm_min_ps(_mm_max_ps(x, min), max), half)));
+            }
+            _mm_storeu_si128((__m128i*)(output + i), _mm_packs_epi32(q[0], q[1]));
+        }
+        return n;
+    }
+
+
+    /**
+        Interleaves two channels in blocks of 16 bytes.
+        \return the number of processed samples per channel.
+    */
+    BEATMUP_TARGET_SSE41 msize interleave(int sampleSize, const void* left, const void* right, void* output, msize length) {
+        const msize blockLength = 16 / sampleSize;
+        const msize n = length - length % blockLength;
+        for (msize i = 0; i < n; i += blockLength) {
+            const __m128i
+                l = _mm_loadu_si128((const __m128i*)left + i / blockLength),
+                r = _mm_loadu_si128((const __m128i*)right + i / blockLength);
+            __m128i* out = (__m128i*)output + 2 * i / blockLength;
+            switch (sampleSize) {
+            case 1:
+                _mm_storeu_si128(out,     _mm_unpacklo_epi8(l, r));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(l, r));
+                break;
+            case 2:
+                _mm_storeu_si128(out,     _mm_unpacklo_epi16(l, r));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(l, r));
+                break;
+            default:
+                _mm_storeu_si128(out,     _mm_unpacklo_epi32(l, r));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(l, r));
+            }
+        }
+        return n;
+    }
+
+
+    /**
+        Deinterleaves two channels in blocks of 16 bytes.
+        \return the number of processed samples per channel.
+    */
+    BEATMUP_TARGET_SSE41 msize deinterleave(int sampleSize, const void* input, void* left, void* right, msize length) {
+        static const char
+            EVEN_ODD_BYTES[16] = { 0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15 },
+            EVEN_ODD_WORDS[16] = { 0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15 };
+        const __m128i mask = _mm_loadu_si128((const __m128i*)(sampleSize == 1 ? EVEN_ODD_BYTES : EVEN_ODD_WORDS));
+        const msize blockLength = 16 / sampleSize;
+        const msize n = length - length % blockLength;
+        for (msize i = 0; i < n; i += blockLength) {
+            const __m128i* in = (const __m128i*)input + 2 * i / blockLength;
+            const __m128i x0 = _mm_loadu_si128(in), x1 = _mm_loadu_si128(in + 1);
+            __m128i l, r;
+            if (sampleSize == 4) {
+                l = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(x0), _mm_castsi128_ps(x1), _MM_SHUFFLE(2, 0, 2, 0)));
+                r = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(x0), _mm_castsi128_ps(x1), _MM_SHUFFLE(3, 1, 3, 1)));
+            }
+            else {
+                // every register gets its left channel samples in the lower half and right channel samples in the upper half
+                const __m128i y0 = _mm_shuffle_epi8(x0, mask), y1 = _mm_shuffle_epi8(x1, mask);
+                l = _mm_unpacklo_epi64(y0, y1);
+                r = _mm_unpackhi_epi64(y0, y1);
+            }
+            _mm_storeu_si128((__m128i*)left + i / blockLength, l);
+            _mm_storeu_si128((__m128i*)right + i / blockLength, r);
+        }
+        return n;
+    }
+}
+
+
+namespace Avx2 {
+
+    BEATMUP_TARGET_AVX2 inline __m256i quantize(__m256 x, __m256 scale, __m256 min, __m256 max) {
+        return _mm256_cvtps_epi32(_mm256_floor_ps(_mm256_add_ps(
+            _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(x, scale), min), max),
+            _mm256_set1_ps(0.5f)
+        )));
+    }
+
+
+    BEATMUP_TARGET_AVX2 inline __m256 ditherNoise(__m256i x) {
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+        x = _mm256_mullo_epi32(x, _mm256_set1_epi32(0x7feb352d));
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+        x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x846ca68bu));
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+        const __m256i diff = _mm256_sub_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0xFFFF)), _mm256_srli_epi32(x, 16));
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(diff), _mm256_set1_ps(1.0f / 65536));
+    }
+
+
+    /**
+        Converts 16-bit integer samples to floating point and back in blocks of 16; the other conversions are left to SSE.
+        \return the number of converted samples.
+    */
+    BEATMUP_TARGET_AVX2 msize convert(AudioSampleFormat inFormat, AudioSampleFormat outFormat, const void* input, void* output, msize count) {
+        const msize n = count - count % 16;
+        if (inFormat == Int16 && outFormat == Float32) {
+            const __m256 scale = _mm256_set1_ps(1.0f / 32768);
+            const __m128i* in = (const __m128i*)input;
+            float* out = (float*)output;
+            for (msize i = 0; i < n; i += 16) {
+                _mm256_storeu_ps(out + i,     _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(in + i / 8))), scale));
+                _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(in + i / 8 + 1))), scale));
+            }
+            return n;
+        }
+
+        if (inFormat == Float32 && outFormat == Int16) {
+            const __m256 scale = _mm256_set1_ps(32767), min = _mm256_set1_ps(-32768), max = _mm256_set1_ps(32767);
+            const float* in = (const float*)input;
+            for (msize i = 0; i < n; i += 16) {
+                const __m256i
+                    q0 = quantize(_mm256_loadu_ps(in + i), scale, min, max),
+                    q1 = quantize(_mm256_loadu_ps(in + i + 8), scale, min, max);
+                // packing works within 128-bit lanes, so the 64-bit blocks are reordered
+                _mm256_storeu_si256((__m256i*)output + i / 16, _mm256_permute4x64_epi64(_mm256_packs_epi32(q0, q1), 0xD8));
+            }
+            return n;
+        }
+
+        return 0;
+    }
+
+
+    BEATMUP_TARGET_AVX2 msize convertWithDither(const float* input, short* output, msize count, uint32_t base) {
+        const __m256
+            scale = _mm256_set1_ps(32767), min = _mm256_set1_ps(-32768), max = _mm256_set1_ps(32767), half = _mm256_set1_ps(0.5f);
+        const __m256i offset = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const msize n = count - count % 16;
+        for (msize i = 0; i < n; i += 16) {
+            __m256i q[2];
+            for (int j = 0; j < 2; ++j) {
+                const __m256 noise = ditherNoise(_mm256_add_epi32(_mm256_set1_epi32((int)(base + (uint32_t)(i + 8 * j))), offset));
+                const __m256 x = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(input + i + 8 * j), scale), noise);
+                q[j] = _mm256_cvtps_epi32(_mm256_floor_ps(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(x, min), max), half)));
+            }
+            _mm256_storeu_si256((__m256i*)(output + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(q[0], q[1]), 0xD8));
+        }
+        return n;
+    }
+}
+
+#endif
+
+
+void SampleConversion::convert(AudioSampleFormat inFormat, AudioSampleFormat outFormat, const void* input, void* output, msize count) {
+    if (inFormat == outFormat) {
+        if (input != output)
+            memcpy(output, input, count * AUDIO_SAMPLE_SIZE[inFormat]);
+        return;
+    }
+
+    msize done = 0;
+#ifdef BEATMUP_ARCH_X86_64
+    const SimdKernels::InstructionSet instructionSet = SimdKernels::getInstructionSet();
+    if (instructionSet == SimdKernels::InstructionSet::AVX2)
+        done = Avx2::convert(inFormat, outFormat, input, output, count);
+    if (done == 0 && instructionSet != SimdKernels::InstructionSet::NONE)
+        done = Sse41::convert(inFormat, outFormat, input, output, count);
+#endif
+
+    // converting the remaining samples one by one
+    Processing::pipeline<Kernels::ConvertSamples>(inFormat, outFormat,
+        (const sample8*)input + done * AUDIO_SAMPLE_SIZE[inFormat],
+        (sample8*)output + done * AUDIO_SAMPLE_SIZE[outFormat],
+        count - done);
+}
+
+
+void SampleConversion::convertWithDither(const sample32f* input, sample16* output, msize count, msize index, uint32_t seed) {
+    const uint32_t base = seed + (uint32_t)index;
+    msize i = 0;
+#ifdef BEATMUP_ARCH_X86_64
+    switch (SimdKernels::getInstructionSet()) {
+    case SimdKernels::InstructionSet::AVX2:
+        i = Avx2::convertWithDither((const float*)input, (short*)output, count, base);
+        break;
+    case SimdKernels::InstructionSet::SSE41:
+        i = Sse41::convertWithDither((const float*)input, (short*)output, count, base);
+        break;
+    default:
+        break;
+    }
+#endif
+
+    for (; i < count; ++i) {
+        const float x = input[i].x * 32767 + ditherNoise(base + (uint32_t)i);
+        output[i].x = (short)roundf_fast(std::min(std::max(x, -32768.0f), 32767.0f));
+    }
+}
+
+
+void SampleConversion::interleave(AudioSampleFormat format, const void* const* channels, int numChannels, void* output, msize length) {
+    const int sampleSize = AUDIO_SAMPLE_SIZE[format];
+    msize done = 0;
+#ifdef BEATMUP_ARCH_X86_64
+    if (numChannels == 2 && SimdKernels::getInstructionSet() != SimdKernels::InstructionSet::NONE)
+        done = Sse41::interleave(sampleSize, channels[0], channels[1], output, length);
+#endif
+
+    switch (sampleSize) {
+    case 1:
+        Kernels::interleave<uint8_t>(channels, numChannels, output, done, length);
+        break;
+    case 2:
+        Kernels::interleave<uint16_t>(channels, numChannels, output, done, length);
+        break;
+    default:
+        Kernels::interleave<uint32_t>(channels, numChannels, output, done, length);
+    }
+}
+
+
+void SampleConversion::deinterleave(AudioSampleFormat format, const void* input, int numChannels, void* const* channels, msize length) {
+    const int sampleSize = AUDIO_SAMPLE_SIZE[format];
+    msize done = 0;
+#ifdef BEATMUP_ARCH_X86_64
+    if (numChannels == 2 && SimdKernels::getInstructionSet() != SimdKernels::InstructionSet::NONE)
+        done = Sse41::deinterleave(sampleSize, input, channels[0], channels[1], length);
+#endif
+
+    switch (sampleSize) {
+    case 1:
+        Kernels::deinterleave<uint8_t>(input, numChannels, channels, done, length);
+        break;
+    case 2:
+        Kernels::deinterleave<uint16_t>(input, numChannels, channels, done, length);
+        break;
+    default:
+        Kernels::deinterleave<uint32_t>(input, numChannels, channels, done, length);
+    }
+}
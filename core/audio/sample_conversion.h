@@ -0,0 +1,80 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "sample_arithmetic.h"
+#include <cstdint>
+
+namespace Beatmup {
+    namespace Audio {
+
+        /**
+            Conversion of audio samples between formats and layouts, vectorized when possible.
+            The instruction set is the one used by SimdKernels, selected at runtime according to the CPU capabilities. The results are exactly
+            the same as the ones of the generic code converting samples one by one through the sample assignment operators.
+        */
+        namespace SampleConversion {
+
+            /**
+                Converts samples from one format to another.
+                Floating point values out of -1..1 range are clamped when converted to integers.
+                \param[in] inFormat     Input sample format
+                \param[in] outFormat    Output sample format
+                \param[in] input        Input samples
+                \param[out] output      Output samples; may not overlap the input unless the formats are the same
+                \param[in] count        Number of samples to convert
+            */
+            void convert(AudioSampleFormat inFormat, AudioSampleFormat outFormat, const void* input, void* output, msize count);
+
+            /**
+                Converts floating point samples to 16-bit integers adding a dither noise.
+                The noise has triangular probability density in -1..1 LSB range (TPDF dither). It decorrelates the quantization error from the
+                signal, which makes the quantization distortion of quiet sounds a constant noise floor. The noise is a function of the seed
+                and the sample index only, so that a signal converted in chunks is identical to the signal converted at once.
+                \param[in] input        Input samples
+                \param[out] output      Output samples
+                \param[in] count        Number of samples to convert
+                \param[in] index        Index of the first sample in the signal
+                \param[in] seed         Noise generator seed
+            */
+            void convertWithDither(const sample32f* input, sample16* output, msize count, msize index, uint32_t seed = 0);
+
+            /**
+                Multiplexes separate channels into a single buffer, sample by sample (interleaving).
+                \param[in] format       Sample format
+                \param[in] channels     Pointers to samples of every channel
+                \param[in] numChannels  Number of channels
+                \param[out] output      Channelwise-multiplexed output samples
+                \param[in] length       Number of samples per channel
+            */
+            void interleave(AudioSampleFormat format, const void* const* channels, int numChannels, void* output, msize length);
+
+            /**
+                Splits a channelwise-multiplexed buffer into separate channels (deinterleaving).
+                \param[in] format       Sample format
+                \param[in] input        Channelwise-multiplexed input samples
+                \param[in] numChannels  Number of channels
+                \param[out] channels    Pointers to samples of every channel
+                \param[in] length       Number of samples per channel
+            */
+            void deinterleave(AudioSampleFormat format, const void* input, int numChannels, void* const* channels, msize length);
+        }
+
+    }
+}
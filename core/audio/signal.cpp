@@ -19,10 +19,12 @@
 #include "signal.h"
 #include "signal_fragment.h"
 #include "processing.h"
+#include "sample_conversion.h"
 #include "wav_utilities.h"
 #include "../utils/input_stream.h"
 #include "../exception.h"
 #include <algorithm>
+#include <cstring>
 
 using namespace Beatmup;
 using namespace Audio;
@@ -167,16 +169,27 @@ dtime Signal::Reader::acquireBuffer(const void* &data) {
 }
 
 
-Signal::Writer::Writer(Signal& signal, dtime time) : Pointer(signal, time, true) {};
+Signal::Writer::Writer(Signal& signal, dtime time) : Pointer(signal, time, true), acquiredLength(0) {};
 
 dtime Signal::Writer::acquireBuffer(void* &data) {
+    return acquireBuffer(data, pointer.length);
+}
+
+dtime Signal::Writer::acquireBuffer(void* &data, dtime length) {
     if (pointer.isNull()) {
         data = nullptr;
         return 0;
     }
     SignalFragment* fragment = (SignalFragment*)pointer.fragment;
     data = fragment->getData() + pointer.offset * fragment->getBlockSize();
-    return pointer.length;
+    acquiredLength = std::min(length, pointer.length);
+    return acquiredLength;
+}
+
+void Signal::Writer::releaseBuffer() {
+    if (!pointer.isNull() && acquiredLength > 0)
+        ((SignalFragment*)pointer.fragment)->invalidateDynamicsLookup(pointer.offset, pointer.offset + acquiredLength);
+    acquiredLength = 0;
 }
 
 
@@ -329,26 +342,31 @@ namespace Kernels {
                     chunk = length;
 
                 const in_t* input = (const in_t*)data;
-                for (int t = 0; t < chunk; ++t, input += inCh, output += outCh) {
-                    int c = 0;
-                    for (; c < numc; ++c)
-                        output[c] = input[c];
-                    for (; c < outCh; ++c)
-                        output[c] = _0;
+                if (inCh == outCh) {
+                    SampleConversion::convert(in_t::FORMAT, out_t::FORMAT, input, output, chunk * inCh);
+                    output += chunk * outCh;
                 }
+                else
+                    for (int t = 0; t < chunk; ++t, input += inCh, output += outCh) {
+                        int c = 0;
+                        for (; c < numc; ++c)
+                            output[c] = input[c];
+                        for (; c < outCh; ++c)
+                            output[c] = _0;
+                    }
 
                 ptr.releaseBuffer();
                 ptr.jump(chunk);
                 length -= chunk;
             }
 
-            memset(output, 0, length * outCh);
+            memset(output, 0, length * outCh * sizeof(out_t));
         }
     };
 }
 
 
-Signal::Source::Source(Signal& signal): signal(&signal) {}
+Signal::Source::Source(Signal& signal): signal(&signal), time(0), sampleFormat(signal.getSampleFormat()), numChannels(signal.getChannelCount()) {}
 
 
 void Signal::Source::prepare(
@@ -372,9 +390,18 @@ void Signal::Source::render(
     sample8* buffer,
     const dtime bufferLength
 ) {
-    Reader ptr(*signal, time);
-    Processing::pipeline<Kernels::RenderAudio>(signal->getSampleFormat(), sampleFormat, nullptr, buffer, ptr, bufferLength, signal->getChannelCount(), numChannels);
-    time += bufferLength;
+    dtime start, stop;
+    splitBuffer(thread, bufferLength, start, stop);
+    if (start < stop) {
+        Reader ptr(*signal, time + start);
+        sample8* part = buffer + start * numChannels * AUDIO_SAMPLE_SIZE[sampleFormat];
+        Processing::pipeline<Kernels::RenderAudio>(signal->getSampleFormat(), sampleFormat, nullptr, part, ptr, stop - start, signal->getChannelCount(), numChannels);
+    }
+
+    // advance the clock once all the threads are done
+    thread.synchronize();
+    if (thread.isManaging())
+        time += bufferLength;
 }
 
 
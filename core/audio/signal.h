@@ -60,9 +60,33 @@ namespace Audio {
             Provides writing access to the signal
         */
         class Writer : public Pointer {
+        private:
+            dtime acquiredLength;       //!< number of samples per channel acquired for writing
+
         public:
             Writer(Signal& signal, dtime time);
+
+            /**
+                Provides access to the samples from the current position till the end of the current fragment.
+                All of them are considered as changed when the buffer is released.
+                \param[out] data    Address of the samples
+                \return number of available samples per channel.
+            */
             dtime acquireBuffer(void* &data);
+
+            /**
+                Provides access to a limited number of samples from the current position. Only these samples are considered as changed
+                when the buffer is released, which keeps the update of the dynamics lookup short after small edits.
+                \param[out] data    Address of the samples
+                \param[in] length   Number of samples per channel to access
+                \return number of available samples per channel, not exceeding the requested length.
+            */
+            dtime acquireBuffer(void* &data, dtime length);
+
+            /**
+                Releases the buffer and marks the acquired samples as changed.
+            */
+            void releaseBuffer();
         };
 
         /**
@@ -130,6 +154,8 @@ namespace Audio {
 
             /**
                 Measures signal dynamics in a given period of time.
+                The dynamics lookup of the measured fragments is brought up to date if needed, so that meters of the same signal are not to
+                be used concurrently unless the signal is prepared first (see prepareSignal()).
                 \param len          Period length in samples
                 \param resolution   Number of output points
                 \param min          Channelwise multiplexed magnitude minima, (resolution) points per channel
@@ -153,7 +179,7 @@ namespace Audio {
         public:
             Source(Signal&);
 
-            ThreadIndex getMaxThreads() { return 1; }
+            ThreadIndex getMaxThreads() { return MAX_THREAD_INDEX; }
 
             void prepare(
                 const dtime sampleRate,
@@ -223,6 +249,10 @@ namespace Audio {
         */
         void saveWAV(const char* filename);
 
+        /**
+            Loads a PCM-encoded WAV file entirely in memory.
+            Long recordings are better streamed with WAV::Reader and WAV::Writer, which only keep a buffer of samples in memory.
+        */
         static Signal* loadWAV(Context& ctx, const char* fileName);
         static Signal* loadWAV(Context& ctx, InputStream& inputStream);
 
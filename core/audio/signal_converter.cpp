@@ -0,0 +1,104 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "signal_converter.h"
+#include "sample_conversion.h"
+#include "../exception.h"
+#include <algorithm>
+
+using namespace Beatmup;
+using namespace Audio;
+
+
+SignalConverter::SignalConverter(): input(nullptr), output(nullptr), dithering(false), seed(0) {}
+
+
+ThreadIndex SignalConverter::getMaxThreads() const {
+    return AbstractTask::validThreadCount(input ? ceili(input->getDuration(), CHUNK_LENGTH) : 1);
+}
+
+
+void SignalConverter::beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu) {
+    NullTaskInput::check(input, "input signal");
+    NullTaskInput::check(output, "output signal");
+    InvalidArgument::check(input != output, "Input and output signals are the same");
+    InvalidArgument::check(input->getChannelCount() == output->getChannelCount(),
+        "Input and output signals have different number of channels");
+
+    // Pointers to the signals are set up here in a single thread: the threads then access the sample data directly.
+    // The writer is moved fragment by fragment, as moving a writing pointer within a fragment may reallocate it.
+    output->reserve(input->getDuration());
+    spans.clear();
+    const int outBlockSize = output->getChannelCount() * AUDIO_SAMPLE_SIZE[output->getSampleFormat()];
+    Signal::Reader reader(*input, 0);
+    Signal::Writer writer(*output, 0);
+    dtime time = 0;
+    while (reader.hasData() && writer.hasData()) {
+        void* out;
+        const dtime outStart = time, outStop = time + writer.acquireBuffer(out);
+        while (time < outStop && reader.hasData()) {
+            const void* in;
+            const dtime length = std::min(reader.acquireBuffer(in), outStop - time);
+            spans.push_back(Span{ (const sample8*)in, (sample8*)out + (time - outStart) * outBlockSize, time, length });
+            reader.releaseBuffer();
+            time += length;
+            reader.moveTo(time);
+        }
+        writer.releaseBuffer();
+        if (reader.hasData())
+            writer.moveTo(time);
+    }
+}
+
+
+void SignalConverter::afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted) {
+    spans.clear();
+}
+
+
+bool SignalConverter::process(TaskThread& thread) {
+    if (spans.empty())
+        return true;
+
+    const AudioSampleFormat inFormat = input->getSampleFormat(), outFormat = output->getSampleFormat();
+    const int numChannels = input->getChannelCount();
+    const int inBlockSize = numChannels * AUDIO_SAMPLE_SIZE[inFormat], outBlockSize = numChannels * AUDIO_SAMPLE_SIZE[outFormat];
+    const bool dither = dithering && inFormat == Float32 && outFormat == Int16;
+    const dtime duration = spans.back().time + spans.back().length;
+
+    msize start, stop;
+    while (thread.nextChunk(duration, CHUNK_LENGTH, start, stop) && !thread.isTaskAborted()) {
+        // find the span containing the chunk start
+        auto span = std::upper_bound(spans.cbegin(), spans.cend(), (dtime)start,
+            [](dtime time, const Span& span) { return time < span.time; }) - 1;
+
+        for (dtime time = (dtime)start; time < (dtime)stop; ++span) {
+            const dtime offset = time - span->time, length = std::min((dtime)stop, span->time + span->length) - time;
+            const sample8* in = span->input + offset * inBlockSize;
+            sample8* out = span->output + offset * outBlockSize;
+            if (dither)
+                SampleConversion::convertWithDither((const sample32f*)in, (sample16*)out, length * numChannels, (msize)time * numChannels, seed);
+            else
+                SampleConversion::convert(inFormat, outFormat, in, out, length * numChannels);
+            time += length;
+        }
+    }
+
+    return true;
+}
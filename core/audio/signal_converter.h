@@ -0,0 +1,78 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "../parallelism.h"
+#include "signal.h"
+#include <cstdint>
+#include <vector>
+
+namespace Beatmup {
+    namespace Audio {
+
+        /**
+            Converts an audio signal into another one of a different sample format, in multiple threads.
+            The output signal is prolonged to the input signal duration if needed, and its content is overwritten. Both signals are to have
+            the same number of channels. The conversion of floating point samples to 16-bit integers may be dithered (see
+            SampleConversion::convertWithDither()).
+        */
+        class SignalConverter : public AbstractTask {
+        private:
+            /**
+                Continuous pieces of the input and output signals in memory
+            */
+            struct Span {
+                const sample8* input;
+                sample8* output;
+                dtime time;                     //!< time of the first sample of the span in the signals
+                dtime length;                   //!< number of samples per channel
+            };
+
+            static const int CHUNK_LENGTH = 16384;  //!< number of samples per channel converted at once by a thread
+
+            Signal *input, *output;
+            std::vector<Span> spans;
+            bool dithering;
+            uint32_t seed;
+
+        protected:
+            bool process(TaskThread& thread);
+            void beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu);
+            void afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted);
+            ThreadIndex getMaxThreads() const;
+
+        public:
+            SignalConverter();
+
+            inline void setInput(Signal* input) { this->input = input; }
+            inline void setOutput(Signal* output) { this->output = output; }
+            inline Signal* getInput() const { return input; }
+            inline Signal* getOutput() const { return output; }
+
+            /**
+                Enables or disables the dithering when converting floating point samples to 16-bit integers.
+                \param[in] enable       If `true`, the dithering is enabled
+                \param[in] seed         Dither noise generator seed
+            */
+            inline void setDithering(bool enable, uint32_t seed = 0) { dithering = enable; this->seed = seed; }
+            inline bool isDithering() const { return dithering; }
+        };
+
+    }
+}
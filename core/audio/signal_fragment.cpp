@@ -18,6 +18,7 @@
 
 #include "signal_fragment.h"
 #include <math.h>
+#include <cstring>
 
 using namespace Beatmup;
 using namespace Audio;
@@ -57,11 +58,14 @@ void SignalFragment::DynamicsLookup::disposeTree() {
     }
     if (minmax)
         free(minmax);
+    minmax = nullptr;
     size = 0;
+    step = stepTime = 0;
+    dirtyStart = dirtyStop = 0;
 }
 
 
-void SignalFragment::DynamicsLookup::configureTree(unsigned char channelCount, int levelCount, int fineStepSize, int coarserStepSize) {
+void SignalFragment::DynamicsLookup::configureTree(unsigned char channelCount, int sampleCount, int levelCount, int fineStepSize, int coarserStepSize) {
     this->channelCount = channelCount;
     if (levelCount == 1) {
         // fine level
@@ -74,27 +78,80 @@ void SignalFragment::DynamicsLookup::configureTree(unsigned char channelCount, i
         if (!prev)
             prev = new DynamicsLookup();
         step = coarserStepSize;
-        prev->configureTree(channelCount, levelCount - 1, fineStepSize, coarserStepSize);
+        prev->configureTree(channelCount, sampleCount, levelCount - 1, fineStepSize, coarserStepSize);
         stepTime = step * prev->stepTime;
     }
+
+    // the content is computed on demand
+    if (minmax)
+        free(minmax);
+    minmax = nullptr;
+    size = ceili(sampleCount, stepTime);
+    dirtyStart = 0;
+    dirtyStop = size;
+}
+
+
+template<typename sample> void SignalFragment::DynamicsLookup::copyTree(const DynamicsLookup& source) {
+    disposeTree();
+    channelCount = source.channelCount;
+    size = source.size;
+    step = source.step;
+    stepTime = source.stepTime;
+    dirtyStart = source.dirtyStart;
+    dirtyStop = source.dirtyStop;
+    if (source.minmax) {
+        const size_t bytes = size * 2 * channelCount * sizeof(sample);
+        minmax = malloc(bytes);
+        memcpy(minmax, source.minmax, bytes);
+    }
+    if (source.prev) {
+        prev = new DynamicsLookup();
+        prev->copyTree<sample>(*source.prev);
+    }
+}
+
+
+void SignalFragment::DynamicsLookup::invalidate(dtime time0, dtime time1) {
+    if (!isConfigured())
+        return;
+    const int start = std::max(0, time0 / stepTime), stop = std::min(size, ceili(time1, stepTime));
+    if (start < stop) {
+        if (dirtyStart >= dirtyStop) {
+            dirtyStart = start;
+            dirtyStop = stop;
+        }
+        else {
+            dirtyStart = std::min(dirtyStart, start);
+            dirtyStop = std::max(dirtyStop, stop);
+        }
+    }
+    if (prev)
+        prev->invalidate(time0, time1);
 }
 
 
-template<typename sample> inline void SignalFragment::DynamicsLookup::updateTree(const sample* data, int sampleCount) {
+template<typename sample> void SignalFragment::DynamicsLookup::update(const sample* data, int sampleCount, int start, int stop) {
+    // only update points that are out of date
+    start = std::max(start, dirtyStart);
+    stop = std::min(stop, dirtyStop);
+    if (start >= stop)
+        return;
+
+    if (!minmax) {
+        minmax = malloc(size * 2 * channelCount * sizeof(sample));
+        start = 0;
+        stop = size;
+    }
+
     // if there is a finer scale ...
     if (prev) {
-        // ... send sample data to it recursively
-        prev->updateTree(data, sampleCount);
-        // update the current level: reallocate table first
-        int newSize = ceili(prev->size, step);
-        if (newSize != size) {
-            minmax = realloc(minmax, newSize * 2 * channelCount * sizeof(sample));
-            size = newSize;
-        }
-        // fill it then
-        sample *out = (sample*)minmax;
+        // ... bring it up to date first
+        prev->update(data, sampleCount, start * step, stop * step);
+        // fill the current level then
+        sample *out = (sample*)minmax + start * 2 * channelCount;
         const int skip = 2 * channelCount;
-        for (int block = 0; block < prev->size; block += step) {
+        for (int block = start * step; block < std::min(stop * step, prev->size); block += step) {
             const int blockSize = std::min(step, prev->size - block);
             // channel multiplexing
             for (int ch = 0; ch < channelCount; ch++) {
@@ -111,16 +168,10 @@ template<typename sample> inline void SignalFragment::DynamicsLookup::updateTree
             }
         }
     }
-    // update finest scale level: reallocate table first
+    // update finest scale level
     else {
-        int newSize = ceili(sampleCount, step);
-        if (newSize != size) {
-            minmax = realloc(minmax, newSize * 2 * channelCount * sizeof(sample));
-            size = newSize;
-        }
-        // fill it then
-        sample *out = (sample*)minmax;
-        for (int time = 0; time < sampleCount; time += step) {
+        sample *out = (sample*)minmax + start * 2 * channelCount;
+        for (int time = start * step; time < std::min(stop * step, sampleCount); time += step) {
             const int blockSize = std::min(step, sampleCount - time);
             const sample *start = data + time * channelCount, *stop = start + blockSize * channelCount;
             // channel demultiplexing
@@ -133,6 +184,19 @@ template<typename sample> inline void SignalFragment::DynamicsLookup::updateTree
             }
         }
     }
+
+    // shrink the range of points to recompute; if the updated part is strictly inside, the range is kept as is
+    if (start <= dirtyStart)
+        dirtyStart = std::max(dirtyStart, stop);
+    else if (stop >= dirtyStop)
+        dirtyStop = std::min(dirtyStop, start);
+}
+
+
+template<typename sample> void SignalFragment::DynamicsLookup::updateTree(const sample* data, int sampleCount) {
+    update(data, sampleCount, 0, size);
+    if (prev)
+        prev->updateTree(data, sampleCount);
 }
 
 template void SignalFragment::DynamicsLookup::updateTree(const sample8* data, int sampleCount);
@@ -141,7 +205,7 @@ template void SignalFragment::DynamicsLookup::updateTree(const sample32* data, i
 template void SignalFragment::DynamicsLookup::updateTree(const sample32f* data, int sampleCount);
 
 
-template<typename sample> void SignalFragment::DynamicsLookup::measure(dtime time0, dtime time1, sample* min, sample* max, const void* data) const {
+template<typename sample> void SignalFragment::DynamicsLookup::measure(dtime time0, dtime time1, sample* min, sample* max, const sample* data, int sampleCount, bool precise) {
     int b0, b1;			// bounding block indices
     // if there is a finer level, take the inset and ask for the remaining parts this finer level
     if (prev) {
@@ -152,18 +216,18 @@ template<typename sample> void SignalFragment::DynamicsLookup::measure(dtime tim
             t1 = b1 * stepTime;
         if (t0 >= t1) {
             // this level is too coarse
-            prev->measure<sample>(time0, time1, min, max, data);
+            prev->measure<sample>(time0, time1, min, max, data, sampleCount, precise);
             return;
         }
 
         if (time0 < t0)
-            prev->measure<sample>(time0, t0, min, max, data);
+            prev->measure<sample>(time0, t0, min, max, data, sampleCount, precise);
         if (t1 < time1)
-            prev->measure<sample>(t1, time1, min, max, data);
+            prev->measure<sample>(t1, time1, min, max, data, sampleCount, precise);
     }
 
-    // if not, but if there is some sample data, take an inset and measure leftovers using the sample data
-    else if (data) {
+    // if not, but if the measurement is precise, take an inset and measure leftovers using the sample data
+    else if (precise) {
         b0 = ceili(time0, stepTime);
         b1 = time1 / stepTime;
         // if there are some blocks (more than one)
@@ -176,15 +240,15 @@ template<typename sample> void SignalFragment::DynamicsLookup::measure(dtime tim
                 for (int ch = 0; ch < channelCount; ch++, pMin++, pMax++) {
                     if (time0 < t0)
                         measureMultiplexedChannelDynamics(
-                            (sample*)data + time0 * channelCount + ch,
-                            (sample*)data + t0 * channelCount + ch,
+                            data + time0 * channelCount + ch,
+                            data + t0 * channelCount + ch,
                             channelCount,
                             *pMin, *pMax
                         );
                     if (t1 < time1)
                         measureMultiplexedChannelDynamics(
-                            (sample*)data + t1 * channelCount + ch,
-                            (sample*)data + time1 * channelCount + ch,
+                            data + t1 * channelCount + ch,
+                            data + time1 * channelCount + ch,
                             channelCount,
                             *pMin, *pMax
                         );
@@ -195,8 +259,8 @@ template<typename sample> void SignalFragment::DynamicsLookup::measure(dtime tim
         else {
             for (int ch = 0; ch < channelCount; ch++, min++, max++)
                 measureMultiplexedChannelDynamics(
-                    (sample*)data + time0 * channelCount + ch,
-                    (sample*)data + time1 * channelCount + ch,
+                    data + time0 * channelCount + ch,
+                    data + time1 * channelCount + ch,
                     channelCount,
                     *min, *max
                 );
@@ -212,6 +276,9 @@ template<typename sample> void SignalFragment::DynamicsLookup::measure(dtime tim
 
     BEATMUP_ASSERT_DEBUG(b1 <= size);
 
+    // make sure the selected blocks are up to date
+    update(data, sampleCount, b0, b1);
+
     // scan selected block set
     const int skip = 2 * channelCount;
     for (int chSkip = 0; chSkip < skip; chSkip += 2) {
@@ -226,10 +293,10 @@ template<typename sample> void SignalFragment::DynamicsLookup::measure(dtime tim
     }
 }
 
-template void SignalFragment::DynamicsLookup::measure(dtime time0, dtime time1, sample8* min, sample8* max, const void* data) const;
-template void SignalFragment::DynamicsLookup::measure(dtime time0, dtime time1, sample16* min, sample16* max, const void* data) const;
-template void SignalFragment::DynamicsLookup::measure(dtime time0, dtime time1, sample32* min, sample32* max, const void* data) const;
-template void SignalFragment::DynamicsLookup::measure(dtime time0, dtime time1, sample32f* min, sample32f* max, const void* data) const;
+template void SignalFragment::DynamicsLookup::measure(dtime time0, dtime time1, sample8* min, sample8* max, const sample8* data, int sampleCount, bool precise);
+template void SignalFragment::DynamicsLookup::measure(dtime time0, dtime time1, sample16* min, sample16* max, const sample16* data, int sampleCount, bool precise);
+template void SignalFragment::DynamicsLookup::measure(dtime time0, dtime time1, sample32* min, sample32* max, const sample32* data, int sampleCount, bool precise);
+template void SignalFragment::DynamicsLookup::measure(dtime time0, dtime time1, sample32f* min, sample32f* max, const sample32f* data, int sampleCount, bool precise);
 
 
 SignalFragment::DynamicsLookup::~DynamicsLookup() {
@@ -251,24 +318,45 @@ SignalFragment* SignalFragment::clone() const {
     memcpy(copy->data(), data(), getSizeBytes());
     copy->plot.fineLevelStep = plot.fineLevelStep;
     copy->plot.coarserLevelStep = plot.coarserLevelStep;
-    // do not copy the lookup; it will be recomputed when needed
-    copy->plot.lookup.disposeTree();
+    // copy the lookup, so that only the parts of the copy edited afterwards are recomputed
+    switch (format) {
+    case Int8:
+        copy->plot.lookup.copyTree<sample8>(plot.lookup);
+        break;
+    case Int16:
+        copy->plot.lookup.copyTree<sample16>(plot.lookup);
+        break;
+    case Int32:
+        copy->plot.lookup.copyTree<sample32>(plot.lookup);
+        break;
+    case Float32:
+        copy->plot.lookup.copyTree<sample32f>(plot.lookup);
+        break;
+    default:
+        Insanity::insanity("Unknown sample format");
+    }
     return copy;
 }
 
 
 void SignalFragment::zero() {
-    memchr(data(), 0, getSizeBytes());
+    memset(data(), 0, getSizeBytes());
+    invalidateDynamicsLookup(0, sampleCount);
+}
+
+
+void SignalFragment::configureDynamicsLookup() {
+    // coarser levels are added as long as they have more than one point
+    int levelCount = 1;
+    for (int size = ceili(sampleCount, plot.fineLevelStep); size > plot.coarserLevelStep; size = ceili(size, plot.coarserLevelStep))
+        levelCount++;
+    plot.lookup.configureTree(channelCount, sampleCount, levelCount, plot.fineLevelStep, plot.coarserLevelStep);
 }
 
 
 void SignalFragment::updateDynamicsLookup() {
-    plot.lookup.configureTree(
-        channelCount,
-        ilogb(sampleCount / channelCount / plot.fineLevelStep) / ilogb(plot.coarserLevelStep),
-        plot.fineLevelStep,
-        plot.coarserLevelStep
-    );
+    if (!plot.lookup.isConfigured())
+        configureDynamicsLookup();
 
     switch (format) {
     case Int8:
@@ -293,34 +381,29 @@ template<typename sample> void SignalFragment::measureDynamics(int time0, int ti
     BEATMUP_ASSERT_DEBUG(time0 <= time1);
     BEATMUP_ASSERT_DEBUG(AUDIO_SAMPLE_SIZE[format] == sizeof(sample));
 
+    // an empty range happens when a measured bin ends at the fragment end; there is nothing to measure, and there may be no sample there
+    if (time0 >= time1)
+        return;
+
     const bool useLookup =
         mode == Signal::Meter::MeasuringMode::approximateUsingLookup ||
         mode == Signal::Meter::MeasuringMode::preciseUsingLookupAndSamples;
 
-    if (useLookup)
-        RuntimeError::check(plot.lookup.isReady(), "Dynamics lookup is not ready");
-
-    const void* sampleData = nullptr;
-
-    // precise measurement
-    if (
-        mode == Signal::Meter::MeasuringMode::preciseUsingSamples ||
-        mode == Signal::Meter::MeasuringMode::preciseUsingLookupAndSamples
-    ) {
-        sampleData = data();
+    // use lookup; it is computed where needed
+    if (useLookup) {
+        if (!plot.lookup.isConfigured())
+            configureDynamicsLookup();
+        plot.lookup.measure(time0, time1, min, max, data.ptr<sample>(), sampleCount,
+            mode == Signal::Meter::MeasuringMode::preciseUsingLookupAndSamples);
     }
 
-    // use lookup
-    if (useLookup)
-        plot.lookup.measure(time0, time1, min, max, (sample*)sampleData);
-
     // don't use lookup
     else {
-        BEATMUP_ASSERT_DEBUG(sampleData);
+        const sample* sampleData = data.ptr<sample>();
         for (int ch = 0; ch < channelCount; ch++, min++, max++)
             measureMultiplexedChannelDynamics(
-                (sample*)sampleData + time0*channelCount + ch,
-                (sample*)sampleData + time1*channelCount + ch,
+                sampleData + time0*channelCount + ch,
+                sampleData + time1*channelCount + ch,
                 channelCount,
                 *min, *max
             );
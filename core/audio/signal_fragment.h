@@ -39,7 +39,11 @@ namespace Audio {
     private:
 
         /**
-            Data structure allowing to plot efficiently audio signal graphs
+            Data structure allowing to plot efficiently audio signal graphs.
+            Every level stores the minimum and maximum sample values of consecutive blocks of samples, the blocks of every level being
+            made of a few blocks of the previous (finer) level. The levels are computed lazily, when first needed to measure the dynamics.
+            Every level keeps track of a range of blocks changed since they were computed, so that the update after an edit is
+            proportional to the size of the edit rather than to the fragment length.
         */
         class DynamicsLookup {
         private:
@@ -49,11 +53,21 @@ namespace Audio {
             int size;							//!< buffer size in points in one channel, i.e., size in bytes is 2*channelCount*sizeof(magnitude)*size
             int step;							//!< step (block) size in points w.r.t. previous layer (points = samples if there's no previous layer)
             int stepTime;						//!< step (block) size in absolute time units
+            int dirtyStart, dirtyStop;          //!< range of points to recompute; empty if dirtyStart >= dirtyStop
 
             DynamicsLookup(const DynamicsLookup&) = delete;		//!< disabling copying constructor
 
+            /**
+                Brings a range of points of the current level up to date, updating the finer levels if needed.
+                \param data				Pointer to the input sample data
+                \param sampleCount		Number of samples pointed by the data in each channel
+                \param start			First point of the range
+                \param stop				The point following the last one of the range
+            */
+            template<typename sample> void update(const sample* data, int sampleCount, int start, int stop);
+
         public:
-            DynamicsLookup() : prev(nullptr), minmax(nullptr), channelCount(0), size(0), step(0), stepTime(0) {}
+            DynamicsLookup() : prev(nullptr), minmax(nullptr), channelCount(0), size(0), step(0), stepTime(0), dirtyStart(0), dirtyStop(0) {}
             ~DynamicsLookup();
 
             /**
@@ -62,35 +76,52 @@ namespace Audio {
             void disposeTree();
 
             /**
-                Sets up the tree structure
+                Sets up the tree structure. The content is computed on demand.
                 \param channelCount			Number of channels
+                \param sampleCount			Number of samples in each channel
                 \param levelCount			Number of detail levels
                 \param fineStepSize			The most detailed level step size in samples
                 \param coarserStepSize		Size of step in points for every upper (less detailed) level
             */
-            void configureTree(unsigned char channelCount, int levelCount, int fineStepSize, int coarserStepSize);
+            void configureTree(unsigned char channelCount, int sampleCount, int levelCount, int fineStepSize, int coarserStepSize);
 
+            /**
+                Copies the tree structure and content from another lookup.
+            */
+            template<typename sample> void copyTree(const DynamicsLookup& source);
 
             /**
-                Updates tree from raw sample data
+                Marks a period of time as changed at all levels.
+                \param time0		Start time
+                \param time1		Stop time
+            */
+            void invalidate(dtime time0, dtime time1);
+
+            /**
+                Brings the entire tree up to date.
                 \param data				Pointer to the input data
                 \param sampleCount		Number of samples pointed by the data in each channel
             */
             template<typename sample> void updateTree(const sample* data, int sampleCount);
 
-
             /**
-                Measures dynamics from time0 to time1 in each channels separately.
+                Measures dynamics from time0 to time1 in each channels separately. The levels used for the measurement are updated if needed.
                 \param time0		Start time
                 \param time1		Stop time
                 \param min			Channelwise multiplexed minima
                 \param max			Channelwise multiplexed maxima
-                \param data			Channelwise multiplexed sample data for a more precise measurement; may be null
+                \param data			Channelwise multiplexed sample data
+                \param sampleCount	Number of samples pointed by the data in each channel
+                \param precise		If `true`, the sample data is used for a more precise measurement
             */
-            template<typename sample> void measure(dtime time0, dtime time1, sample* min, sample* max, const void* data) const;
+            template<typename sample> void measure(dtime time0, dtime time1, sample* min, sample* max, const sample* data, int sampleCount, bool precise);
 
+            inline bool isConfigured() const { return stepTime > 0; }
 
-            inline bool isReady() const { return minmax != NULL; }
+            /**
+                \return `true` if all the levels are computed and up to date.
+            */
+            inline bool isReady() const { return minmax != nullptr && dirtyStart >= dirtyStop && (!prev || prev->isReady()); }
         };
 
     private:
@@ -105,6 +136,8 @@ namespace Audio {
             Plot() : fineLevelStep(50), coarserLevelStep(10) {}
         } plot;
 
+        void configureDynamicsLookup();
+
     public:
         SignalFragment(AudioSampleFormat format, unsigned char channels, int samples);
 
@@ -118,9 +151,25 @@ namespace Audio {
 
         void zero();
 
+        /**
+            \return `true` if the dynamics lookup is entirely computed and up to date with the sample data.
+        */
         inline bool isDynamicsLookupAvailable() const { return plot.lookup.isReady(); }
+
+        /**
+            Brings the dynamics lookup entirely up to date. Only the parts marked as changed since the last computation are recomputed (see
+            invalidateDynamicsLookup()); samples changed without a Signal::Writer need to be marked first. Invalidating the whole fragment
+            forces a full recomputation.
+        */
         void updateDynamicsLookup();
 
+        /**
+            Marks a part of the fragment as changed, so that the dynamics lookup is updated there when needed.
+            \param time0		Start time
+            \param time1		Stop time
+        */
+        inline void invalidateDynamicsLookup(dtime time0, dtime time1) { plot.lookup.invalidate(time0, time1); }
+
         /**
             Measures dynamics from time0 to time1 in each channels separately.
             \param time0		Start time
@@ -227,6 +227,8 @@ void SignalPlot::beforeProcessing(ThreadIndex threadCount, ProcessingTarget targ
     NullTaskInput::check(signal, "input signal");
     NullTaskInput::check(bitmap, "output bitmap");
     writeLock(gpu, bitmap,  ProcessingTarget::CPU);
+    // the lookup is updated lazily when measuring; bringing it up to date here keeps the threads from updating it concurrently
+    Signal::Meter::prepareSignal(*signal, false);
     outputRect.normalize();
     signalWindow.normalize();
 }
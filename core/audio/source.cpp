@@ -19,6 +19,7 @@
 #include "source.h"
 #include "../exception.h"
 #include "../debug.h"
+#include "../utils/utils.hpp"
 #include <cmath>
 #include <algorithm>
 
@@ -31,6 +32,14 @@ void Source::setClock(dtime time) {
 }
 
 
+void Source::splitBuffer(const TaskThread& thread, dtime bufferLength, dtime& start, dtime& stop) {
+    const dtime numBlocks = ceili(bufferLength, BLOCK_LENGTH);
+    const ThreadIndex idx = thread.currentThread(), num = thread.numThreads();
+    start = std::min(bufferLength, numBlocks * idx / num * BLOCK_LENGTH);
+    stop = std::min(bufferLength, numBlocks * (idx + 1) / num * BLOCK_LENGTH);
+}
+
+
 template <typename sample> inline void fillSin(
         sample8* buffer,
         dtime time,
@@ -68,27 +77,34 @@ void HarmonicSource::prepare(
 
 void HarmonicSource::render(TaskThread& thread, sample8* buffer, const dtime bufferLength) {
     BEATMUP_DEBUG_I("FILLING BUFFER OF %d SAMPLES at time %d", bufferLength, time);
+    dtime start, stop;
+    splitBuffer(thread, bufferLength, start, stop);
+    sample8* part = buffer + start * numChannels * AUDIO_SAMPLE_SIZE[sampleFormat];
     switch (sampleFormat) {
         case Int8:
-            fillSin<sample8>(buffer, time, bufferLength, amplitude, frequency, phase, sampleRate, numChannels, 127);
+            fillSin<sample8>(part, time + start, stop - start, amplitude, frequency, phase, sampleRate, numChannels, 127);
             break;
 
         case Int16:
-            fillSin<sample16>(buffer, time, bufferLength, amplitude, frequency, phase, sampleRate, numChannels, 0x7FFF);
+            fillSin<sample16>(part, time + start, stop - start, amplitude, frequency, phase, sampleRate, numChannels, 0x7FFF);
             break;
 
         case Int32:
-            fillSin<sample32>(buffer, time, bufferLength, amplitude, frequency, phase, sampleRate, numChannels, 0x7FFFFFFF);
+            fillSin<sample32>(part, time + start, stop - start, amplitude, frequency, phase, sampleRate, numChannels, 0x7FFFFFFF);
             break;
 
         case Float32:
-            fillSin<sample32f>(buffer, time, bufferLength, amplitude, frequency, phase, sampleRate, numChannels, 1);
+            fillSin<sample32f>(part, time + start, stop - start, amplitude, frequency, phase, sampleRate, numChannels, 1);
             break;
 
         default:
             Insanity::insanity("Unsupported sample format");
     }
-    time += bufferLength;
+
+    // advance the clock once all the threads are done
+    thread.synchronize();
+    if (thread.isManaging())
+        time += bufferLength;
 }
 
 
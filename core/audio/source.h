@@ -62,12 +62,17 @@ namespace Beatmup {
              */
             virtual ThreadIndex getMaxThreads() { return 1; }
 
+            static const dtime BLOCK_LENGTH = 1024;     //!< granularity of buffers splitting among threads, in samples
+
 
             /**
              * Renders audio data to the target output buffer given by the user.
              * Called after at least one call to prepare(). The sampling parameters must match the ones communicated
              * on the preparation phase. The requested buffer length does not exceed the one set before. The time is
              * given by the clock set before, and with every call it advances by {bufferLength} samples.
+             * When rendering in multiple threads, all of them call this function with the same arguments. A
+             * multithreaded source then renders a part of the buffer in every thread (see splitBuffer()) and advances
+             * its clock once all the threads are done with it.
              * \param thread            the task thread issuing this rendering call
              * \param buffer            a pointer to the beginning of a channelwise-multiplexed output buffer
              * \param bufferLength      the requested buffer length, in samples per single channel
@@ -77,6 +82,17 @@ namespace Beatmup {
                     sample8* buffer,
                     const dtime bufferLength
             ) = 0;
+
+        protected:
+            /**
+             * Computes the part of a buffer to render in a given thread, when the buffer is rendered by multiple
+             * threads in parallel. The buffer is split in chunks of a multiple of BLOCK_LENGTH samples.
+             * \param thread            the task thread rendering the buffer
+             * \param bufferLength      the buffer length, in samples per single channel
+             * \param start             the first sample of the part to render by the thread
+             * \param stop              the sample following the last one of the part to render by the thread
+             */
+            static void splitBuffer(const TaskThread& thread, dtime bufferLength, dtime& start, dtime& stop);
         };
 
 
@@ -90,7 +106,7 @@ namespace Beatmup {
             float amplitude, frequency, phase;
             unsigned char numChannels;
         public:
-            HarmonicSource() : amplitude(0.05), frequency(800), phase(0) {}
+            HarmonicSource() : sampleFormat(Int16), sampleRate(0), time(0), amplitude(0.05), frequency(800), phase(0), numChannels(1) {}
 
             void setFrequency(float hz) { frequency = hz; }
             float getFrequency() const { return frequency; }
@@ -101,6 +117,8 @@ namespace Beatmup {
             void setAmplitude(float amp) { this->amplitude = amp; }
             float getAmplitude() const { return amplitude; }
 
+            ThreadIndex getMaxThreads() { return MAX_THREAD_INDEX; }
+
             void prepare(
                     const dtime sampleRate,
                     const AudioSampleFormat sampleFormat,
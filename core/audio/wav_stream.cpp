@@ -0,0 +1,291 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "wav_stream.h"
+#include "sample_conversion.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace Beatmup;
+using namespace Audio;
+using namespace WAV;
+
+
+static const uint16_t
+    WAVE_FORMAT_PCM = 1,
+    WAVE_FORMAT_IEEE_FLOAT = 3;
+
+static const msize MAX_DATA_SIZE = 0xFFFFFFFF - sizeof(Header) + 8;     //!< max number of bytes of samples in a WAV file
+
+
+Reader::Reader(InputStream& stream):
+    length(0), dataOffset(0), stream(&stream),
+    outFormat(Int16), outChannels(1), time(0), position(0)
+{
+    readHeader(stream);
+}
+
+
+Reader::Reader(const char* filename, bool mapped):
+    length(0), dataOffset(0), stream(nullptr),
+    outFormat(Int16), outChannels(1), time(0), position(0), filename(filename)
+{
+    if (mapped) {
+        mapping.map(filename);
+        if (!mapping.isMapped())
+            throw IOError(filename, "Cannot map file in memory");
+        // the samples are mostly read sequentially
+        mapping.adviseSequentialAccess();
+        try {
+            MemoryInputStream content(mapping.getData(), mapping.getSize());
+            readHeader(content);
+        }
+        catch (...) {
+            mapping.unmap();
+            throw;
+        }
+        // the header may be not up to date if the file is incomplete
+        length = std::min<msize>(length, (mapping.getSize() - dataOffset) / header.blockAlign);
+    }
+    else {
+        file.open(filename);
+        if (!file.isOpen())
+            throw IOError(filename, "Unable to open for reading");
+        stream = &file;
+        readHeader(file);
+    }
+}
+
+
+Reader::~Reader() {}
+
+
+void Reader::readHeader(InputStream& stream) {
+    // RIFF header
+    if (!stream(&header.m_RIFF, sizeof(header.m_RIFF)) || header.m_RIFF != Header::__RIFF)
+        throw InvalidWavFile("Incorrect WAV file: 'RIFF' marker missing");
+    stream(&header.chunkSize, sizeof(header.chunkSize));
+    if (!stream(&header.m_WAVE, sizeof(header.m_WAVE)) || header.m_WAVE != Header::__WAVE)
+        throw InvalidWavFile("Incorrect WAV file: 'WAVE' marker missing");
+
+    // go through the chunks till the data; others than the format are skipped
+    msize pos = 3 * sizeof(uint32_t);
+    bool formatFound = false;
+    while (true) {
+        uint32_t id, size;
+        if (!stream(&id, sizeof(id)) || !stream(&size, sizeof(size)))
+            throw InvalidWavFile(formatFound ? "Incorrect WAV file: 'data' marker missing" : "Incorrect WAV file: 'fmt ' marker missing");
+        pos += sizeof(id) + sizeof(size);
+
+        if (id == Header::__data) {
+            if (!formatFound)
+                throw InvalidWavFile("Incorrect WAV file: 'fmt ' marker missing");
+            header.m_data = id;
+            header.dataSizeBytes = size;
+            dataOffset = pos;
+            break;
+        }
+
+        if (id == Header::__fmt_) {
+            if (size < 16)
+                throw InvalidWavFile("Incorrect WAV file: bad subchunk size");
+            header.m_fmt_ = id;
+            header.__16 = size;
+            stream(&header.audioFormat, sizeof(header.audioFormat));
+            stream(&header.numChannels, sizeof(header.numChannels));
+            stream(&header.sampleRate, sizeof(header.sampleRate));
+            stream(&header.byteRate, sizeof(header.byteRate));
+            stream(&header.blockAlign, sizeof(header.blockAlign));
+            stream(&header.bitsPerSample, sizeof(header.bitsPerSample));
+            formatFound = true;
+        }
+
+        // chunks are word-aligned
+        pos += size + (size & 1);
+        stream.seek(pos);
+    }
+
+    // get sample format
+    if (header.audioFormat == WAVE_FORMAT_PCM && header.bitsPerSample == 8)
+        format = Int8;
+    else if (header.audioFormat == WAVE_FORMAT_PCM && header.bitsPerSample == 16)
+        format = Int16;
+    else if (header.audioFormat == WAVE_FORMAT_PCM && header.bitsPerSample == 32)
+        format = Int32;
+    else if (header.audioFormat == WAVE_FORMAT_IEEE_FLOAT && header.bitsPerSample == 32)
+        format = Float32;
+    else
+        throw InvalidWavFile("Incorrect WAV file: unsupported audio format");
+
+    if (header.numChannels <= 0 || header.numChannels > 255)
+        throw InvalidWavFile("Incorrect WAV file: unsupported channel count");
+    if (header.blockAlign != header.numChannels * AUDIO_SAMPLE_SIZE[format])
+        throw InvalidWavFile("Incorrect WAV file: bad block alignment");
+
+    length = (dtime)(header.dataSizeBytes / header.blockAlign);
+    position = 0;
+}
+
+
+void Reader::prepare(
+    const dtime sampleRate,
+    const AudioSampleFormat sampleFormat,
+    const unsigned char numChannels,
+    const dtime maxBufferLen
+) {
+    outFormat = sampleFormat;
+    outChannels = numChannels;
+    if (!mapping.isMapped())
+        buffer.resize(std::max(maxBufferLen, 1) * header.blockAlign);
+}
+
+
+void Reader::setClock(dtime time) {
+    this->time = time;
+}
+
+
+void Reader::convert(const void* input, sample8* output, dtime length) const {
+    if (header.numChannels == outChannels) {
+        SampleConversion::convert(format, outFormat, input, output, (msize)length * outChannels);
+        return;
+    }
+
+    // different number of channels: extra input channels are dropped, extra output channels are zeroed
+    const int
+        inSampleSize = AUDIO_SAMPLE_SIZE[format],
+        outSampleSize = AUDIO_SAMPLE_SIZE[outFormat],
+        numc = std::min<int>(header.numChannels, outChannels);
+    const uint8_t* in = static_cast<const uint8_t*>(input);
+    uint8_t* out = reinterpret_cast<uint8_t*>(output);
+    for (dtime t = 0; t < length; ++t, in += header.numChannels * inSampleSize, out += outChannels * outSampleSize) {
+        SampleConversion::convert(format, outFormat, in, out, numc);
+        std::memset(out + numc * outSampleSize, 0, (outChannels - numc) * outSampleSize);
+    }
+}
+
+
+void Reader::render(
+    TaskThread& thread,
+    sample8* buffer,
+    const dtime bufferLength
+) {
+    const msize outFrameSize = outChannels * AUDIO_SAMPLE_SIZE[outFormat];
+    dtime done = 0;
+
+    if (mapping.isMapped()) {
+        // convert straight from the mapped file
+        if (0 <= time && time < length) {
+            done = std::min(bufferLength, length - time);
+            convert(mapping.getData() + dataOffset + (msize)time * header.blockAlign, buffer, done);
+        }
+    }
+
+    else if (0 <= time && time < length) {
+        const dtime capacity = (dtime)(this->buffer.size() / header.blockAlign);
+        if (position != time) {
+            stream->seek(dataOffset + (msize)time * header.blockAlign);
+            position = time;
+        }
+
+        // read and convert by blocks fitting the buffer
+        const dtime stop = std::min(bufferLength, length - time);
+        while (done < stop) {
+            const dtime chunk = std::min(capacity, stop - done);
+            if (!(*stream)(this->buffer.data(), (msize)chunk * header.blockAlign)) {
+                // the file is shorter than its header tells: consider it ended here
+                length = position;
+                break;
+            }
+            convert(this->buffer.data(), buffer + done * outFrameSize, chunk);
+            position += chunk;
+            done += chunk;
+        }
+    }
+
+    // pad with zeros
+    if (done < bufferLength)
+        std::memset(buffer + done * outFrameSize, 0, (bufferLength - done) * outFrameSize);
+    time += bufferLength;
+}
+
+
+Writer::Writer(const char* filename):
+    filename(filename), dataSize(0)
+{}
+
+
+Writer::~Writer() {
+    close();
+}
+
+
+void Writer::writeHeader() {
+    const unsigned char sampleSize = AUDIO_SAMPLE_SIZE[mode.sampleFormat];
+    Header header;
+    header.set(mode.sampleRate, sampleSize * 8, mode.numChannels, (uint32_t)dataSize);
+    if (mode.sampleFormat == Float32)
+        header.audioFormat = WAVE_FORMAT_IEEE_FLOAT;
+    file.seekp(0);
+    file.write((const char*)&header, sizeof(header));
+    file.seekp(0, std::ios::end);
+}
+
+
+void Writer::initialize(Mode mode) {
+    OfflinePlayback::initialize(mode);
+    close();
+    file.open(filename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (!file.is_open())
+        throw IOError(filename, "Unable to open for writing");
+    dataSize = 0;
+    writeHeader();
+}
+
+
+void Writer::beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu) {
+    if (!file.is_open())
+        throw IOError(filename, "The file is not open; the writer must be initialized first");
+    OfflinePlayback::beforeProcessing(threadCount, target, gpu);
+}
+
+
+void Writer::unlockBlock(const sample8* block, dtime length) {
+    const msize size = length * mode.numChannels * AUDIO_SAMPLE_SIZE[mode.sampleFormat];
+    if (dataSize + size > MAX_DATA_SIZE)
+        throw IOError(filename, "WAV file size limit exceeded");
+    file.write((const char*)block, size);
+    if (file.fail())
+        throw IOError(filename, "Failed while writing");
+    dataSize += size;
+}
+
+
+void Writer::afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted) {
+    writeHeader();
+    file.flush();
+}
+
+
+void Writer::close() {
+    if (file.is_open()) {
+        writeHeader();
+        file.close();
+    }
+}
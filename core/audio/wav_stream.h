@@ -0,0 +1,161 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "wav_utilities.h"
+#include "source.h"
+#include "playback/offline_playback.h"
+#include "../utils/input_stream.h"
+#include "../utils/file_mapping.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Beatmup {
+namespace Audio {
+namespace WAV {
+
+    /**
+        Audio::Source decoding a PCM-encoded WAV file on the fly.
+        Unlike Signal::loadWAV(), the file content is never loaded in memory entirely: the samples are read from an InputStream block by
+        block when rendered, so that the memory footprint is bounded by the rendering buffer length whatever the file duration is.
+        Alternatively, the file may be mapped in the process address space. The samples are then converted to the output buffers directly
+        from the mapping and are also accessible through getData() without any copy, e.g. to process PCM16 recordings in place.
+        The output sample format and channel count are the ones requested on prepare(). Extra output channels are filled with zeros,
+        extra input channels are dropped. No sample rate conversion is performed. The output is padded with zeros past the end of the file.
+    */
+    class Reader : public Audio::Source {
+    private:
+        Header header;
+        AudioSampleFormat format;           //!< sample format in the file
+        dtime length;                       //!< number of samples per channel in the file
+        msize dataOffset;                   //!< position of the first sample in the file in bytes
+        FileInputStream file;               //!< stream reading from file when streaming from a file by name
+        InputStream* stream;                //!< stream to read from when streaming; null when mapped
+        FileMapping mapping;                //!< the mapped file content, if the file is mapped
+        std::vector<uint8_t> buffer;        //!< samples read from the stream before conversion
+        AudioSampleFormat outFormat;        //!< output sample format
+        unsigned char outChannels;          //!< output number of channels
+        dtime time;                         //!< current rendering time
+        dtime position;                     //!< time of the next sample to be read from the stream
+        const std::string filename;
+
+        void readHeader(InputStream& stream);
+        void convert(const void* input, sample8* output, dtime length) const;
+
+    public:
+        /**
+            Streams a WAV file from a given input stream.
+            The stream must stay valid during the reader lifetime and is accessed from the thread rendering the audio.
+            \param[in] stream       The input stream positioned at the beginning of the WAV file
+        */
+        Reader(InputStream& stream);
+
+        /**
+            Opens a WAV file.
+            \param[in] filename     The file name / path
+            \param[in] mapped       If `true`, the file is mapped in memory. Otherwise it is read by blocks on rendering. The mapping is
+                                    preferable for random access to long files on 64-bit platforms, as it consumes address space but no
+                                    physical memory beyond the pages the operating system keeps cached.
+        */
+        Reader(const char* filename, bool mapped = false);
+
+        ~Reader();
+
+        void prepare(
+            const dtime sampleRate,
+            const AudioSampleFormat sampleFormat,
+            const unsigned char numChannels,
+            const dtime maxBufferLen
+        );
+
+        void setClock(dtime time);
+
+        void render(
+            TaskThread& thread,
+            sample8* buffer,
+            const dtime bufferLength
+        );
+
+        /**
+            \return the WAV file header.
+        */
+        inline const Header& getHeader() const { return header; }
+
+        inline AudioSampleFormat getSampleFormat() const { return format; }
+        inline unsigned char getChannelCount() const { return (unsigned char)header.numChannels; }
+        inline int getSampleRate() const { return header.sampleRate; }
+
+        /**
+            \return the file duration in samples per channel.
+        */
+        inline dtime getDuration() const { return length; }
+
+        inline bool isMapped() const { return mapping.isMapped(); }
+
+        /**
+            \return pointer to the channelwise-multiplexed samples in the mapped file, or null if the file is not mapped.
+        */
+        inline const void* getData() const { return mapping.isMapped() ? mapping.getData() + dataOffset : nullptr; }
+    };
+
+
+    /**
+        Playback writing the sampled Source to a WAV file as the signal is being rendered.
+        The source is rendered as fast as possible, and only one block of samples is kept in memory unless an output signal is set as well.
+        The header is updated at the end of every run, so that the file is valid between runs and every new run appends the signal to the
+        file. 32-bit floating point samples are stored in IEEE float WAV format.
+        The data size field of the WAV header limits the file size to 4 GB. The rendering stops with an IOError if the limit is reached.
+    */
+    class Writer : public OfflinePlayback {
+    private:
+        std::ofstream file;
+        const std::string filename;
+        msize dataSize;                     //!< number of bytes of samples written so far
+
+        void writeHeader();
+
+    protected:
+        void unlockBlock(const sample8* block, dtime length);
+        void beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu);
+        void afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted);
+
+    public:
+        /**
+            Creates a writer.
+            \param[in] filename     The output file name / path. The file is created or truncated when the writer is initialized.
+        */
+        Writer(const char* filename);
+        ~Writer();
+
+        /**
+            Opens the output file and writes an empty WAV file header there.
+            \param[in] mode     The playback mode. The number of buffers is irrelevant.
+        */
+        void initialize(Mode mode);
+
+        /**
+            Completes the file and closes it.
+        */
+        void close();
+    };
+
+}
+}
+}
@@ -24,7 +24,9 @@
 #include "../gpu/bgl.h"
 #include "../exception.h"
 #include "../gpu/swapper.h"
+#include "../gpu/texture_pool.h"
 #include "../utils/bmp_file.h"
+#include "../utils/utils.hpp"
 #include <cstring>
 
 
@@ -52,6 +54,15 @@ const unsigned char AbstractBitmap::CHANNELS_PER_PIXEL[] = {
 
 
 void AbstractBitmap::prepare(GraphicPipeline& gpu) {
+    // take an allocated texture from the pool, if any
+    if (!hasValidHandle()) {
+        textureWidth = getWidth();
+        textureHeight = getHeight();
+        // masks are not pooled: their texture format does not determine the texture storage
+        textureFormat = isMask() ? TextureFormat::OES_Ext : getTextureFormat();
+        ctx.getGpuTexturePool().acquire(textureWidth, textureHeight, textureFormat, textureHandle);
+    }
+
     const bool handleValid = hasValidHandle();
 
     if (!handleValid)
@@ -61,14 +72,14 @@ void AbstractBitmap::prepare(GraphicPipeline& gpu) {
     // setup alignment
     if (isMask()) {
         // masks are stored as horizontally-stretched bitmaps
-        const int textureWidth = getWidth() / (8 / getBitsPerPixel());
+        const int maskTextureWidth = getWidth() / (8 / getBitsPerPixel());
 
 #ifdef BEATMUP_OPENGLVERSION_GLES20
         if (!handleValid)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, textureWidth, getHeight(), 0, GL_ALPHA, GL_UNSIGNED_BYTE, nullptr);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, maskTextureWidth, getHeight(), 0, GL_ALPHA, GL_UNSIGNED_BYTE, nullptr);
 #else
         if (!handleValid)
-            glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, textureWidth, getHeight());
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, maskTextureWidth, getHeight());
 #endif
         GL::GLException::check("allocating texture image (mask)");
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -113,12 +124,22 @@ bool AbstractBitmap::isDirty() const {
 }
 
 
+int AbstractBitmap::getStride() const {
+    return ceili(getWidth() * getBitsPerPixel(), 8);
+}
+
+
+bool AbstractBitmap::isDense() const {
+    return getStride() * 8 == getWidth() * getBitsPerPixel() || getHeight() == 1;
+}
+
+
 int AbstractBitmap::getPixelInt(int x, int y, int cha) const {
     PixelFormat pf = getPixelFormat();
     if (isMask(pf)) {
         unsigned char
             pixPerByte = 8 / BITS_PER_PIXEL[pf],
-            offset = (x + y*getWidth()) % pixPerByte;			// offset from byte-aligned bound in pixels
+            offset = x % pixPerByte;			// offset from byte-aligned bound in pixels
         const pixbyte* p = getData(x, y);
         return ((*p) >> (offset*BITS_PER_PIXEL[pf])) & ((1 << BITS_PER_PIXEL[pf]) - 1);
     }
@@ -187,6 +208,14 @@ std::string AbstractBitmap::toString() const {
 
 
 void AbstractBitmap::saveBmp(const char* filename) {
+    if (!isDense()) {
+        // make a densely packed copy first
+        InternalBitmap copy(ctx, getPixelFormat(), getWidth(), getHeight());
+        FormatConverter::convert(*this, copy);
+        copy.saveBmp(filename);
+        return;
+    }
+
     if (!isUpToDate(ProcessingTarget::CPU)) {
         // Grab output bitmap from GPU memory to RAM
         Swapper::pullPixels(*this);
@@ -205,15 +234,23 @@ void AbstractBitmap::saveBmp(const char* filename) {
 }
 
 
-AbstractBitmap::AbstractBitmap(Context& ctx) : ctx(ctx) {
+AbstractBitmap::AbstractBitmap(Context& ctx) :
+    textureWidth(0), textureHeight(0), textureFormat(TextureFormat::OES_Ext), ctx(ctx)
+{
     upToDate[ProcessingTarget::CPU] = true;
     upToDate[ProcessingTarget::GPU] = false;
 }
 
 
 AbstractBitmap::~AbstractBitmap() {
+    releaseTexture();
+}
+
+
+void AbstractBitmap::releaseTexture() {
     if (hasValidHandle()) {
-        TextureHandler::invalidate(*ctx.getGpuRecycleBin());
+        ctx.getGpuTexturePool().release(textureHandle, textureWidth, textureHeight, textureFormat);
+        textureHandle = 0;
     }
 }
 
@@ -225,7 +262,13 @@ Context& AbstractBitmap::getContext() const {
 
 void AbstractBitmap::zero() {
     lockPixelData();
-    memset(getData(0, 0), 0, getMemorySize());
+    if (isDense())
+        memset(getData(0, 0), 0, getMemorySize());
+    else {
+        const msize rowSize = ceili(getWidth() * getBitsPerPixel(), 8);
+        for (int y = 0; y < getHeight(); ++y)
+            memset(getData(0, y), 0, rowSize);
+    }
     unlockPixelData();
     upToDate[ProcessingTarget::CPU] = true;
     upToDate[ProcessingTarget::GPU] = false;
@@ -59,12 +59,16 @@ namespace Beatmup {
         \subsection ssecGpuGarbage GPU garbage collection
         When a bitmap is destroyed in the application code, its GPU storage is not destroyed immediately. This is due to the fact that destroying a
         texture representing the bitmap content in the GPU memory needs to be done in a thread that has access to the GPU, which is one of the
-        threads in the thread pool. The textures of destroyed bitmaps are marked as unused anymore and put into a "GPU trash bin". The latter is
-        emptied by calling GL::RecycleBin::emptyBin() function on a recycle bin object instance returned by Context::getGpuRecycleBin(). Note that
-        the recycle bin instance is only allocated is the GPU is actually used within the given Context.
-
-        In applications doing repeated allocations and deallocations of images (e.g., processing video frames in a loop), it is recommended to empty
-        the GPU recycle bin periodically in the described way in order to prevent running out of memory.
+        threads in the thread pool. The textures of destroyed bitmaps are returned to a texture pool instead, returned by
+        Context::getGpuTexturePool(). When a new bitmap of the same size and pixel format is used on GPU, it takes a texture from the pool rather
+        than allocating a new one. This avoids reallocating textures for every frame in applications processing images in a loop, e.g. video
+        frames. The pool keeps a limited amount of GPU memory (GL::TexturePool::DEFAULT_CAPACITY by default); the least recently released
+        textures are evicted when the limit is exceeded. Masks are not pooled.
+
+        The evicted textures, as well as the textures of destroyed masks, are marked as unused anymore and put into a "GPU trash bin". The latter
+        is emptied by calling GL::RecycleBin::emptyBin() function on a recycle bin object instance returned by Context::getGpuRecycleBin(). In
+        applications doing repeated allocations and deallocations of images of different sizes, it is recommended to empty the GPU recycle bin
+        periodically in the described way in order to prevent running out of memory. Setting the texture pool capacity to zero disables pooling.
     */
 
     enum PixelFormat {
@@ -95,9 +99,13 @@ namespace Beatmup {
         friend class AbstractBitmap::ReadLock;
         friend class AbstractBitmap::WriteLock<ProcessingTarget::CPU>;
         friend class AbstractBitmap::WriteLock<ProcessingTarget::GPU>;
+        friend class BitmapView;
 
         AbstractBitmap(const AbstractBitmap& that) = delete;		//!< disabling copying constructor
 
+        int textureWidth, textureHeight;                    //!< size of the texture storage allocated on GPU
+        TextureFormat textureFormat;                        //!< format of the texture storage allocated on GPU; OES_Ext if not to be pooled
+
     protected:
         Context& ctx;									//!< context managing this bitmap
         bool upToDate[2];									//!< bitmap up-to-date state on CPU and GPU
@@ -114,6 +122,12 @@ namespace Beatmup {
         */
         virtual void unlockPixelData() = 0;
 
+        /**
+            Disposes the texture storing the bitmap content on GPU, if any. The texture is returned to the context texture pool to be reused
+            by another bitmap of the same size and pixel format.
+        */
+        void releaseTexture();
+
         // overridden methods from TextureHandler
         virtual void prepare(GraphicPipeline& gpu);
 
@@ -153,6 +167,27 @@ namespace Beatmup {
         virtual const pixbyte* getData(int x, int y) const = 0;
         virtual pixbyte* getData(int x, int y) = 0;
 
+        /**
+            Returns the distance in bytes between the beginnings of two consecutive rows of pixels in memory.
+            By default, the rows are assumed densely packed.
+        */
+        virtual int getStride() const;
+
+        /**
+            Returns `true` if the rows of pixels follow each other in memory without gaps, so that the whole bitmap content can be accessed
+            as a contiguous memory block of getMemorySize() bytes starting at getData(0, 0).
+        */
+        bool isDense() const;
+
+        /**
+            Tells that a range of rows is not going to be accessed for a while, so that the memory they occupy may be freed.
+            Bitmaps stored in files (e.g., MappedBitmap) unload the rows, which are loaded again when accessed. Does nothing by default.
+            Must not be called while the rows are being accessed.
+            \param[in] firstRow     The first row
+            \param[in] lastRow      The row following the last row
+        */
+        virtual void unloadRows(int firstRow, int lastRow) {}
+
         /**
             Retrieves integer value of given channel at given pixel
             \param x			target pixel horizontal coordinate
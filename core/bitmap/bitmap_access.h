@@ -68,12 +68,13 @@ namespace Beatmup {
         pixel* data;			//!< bitmap data
         pixel* ptr;				//!< pointer to the current pixel
         int width, height;		//!< bitmap sizes in pixels
+        int stride;				//!< distance between consecutive rows in bytes
 
         /**
             Retrieves pixel address at a given position;
         */
         inline pixel* jump(int x, int y) const {
-            return data + num_channels*(width*y + x);
+            return (pixel*)((pixbyte*)data + (msize)stride * y) + num_channels * x;
         }
     public:
         typedef pixel pixvaltype;
@@ -110,7 +111,7 @@ namespace Beatmup {
 #ifdef BEATMUP_DEBUG
             DebugAssertion::check(x >= 0 && y >= 0 && x < width && y < height, "Coordinates outside of image: %d %d (width=%d, height=%d)", x, y, width, height);
 #endif
-            ptr = data + num_channels*(width*y + x);
+            ptr = jump(x, y);
         }
 
         /**
@@ -136,6 +137,7 @@ namespace Beatmup {
 #endif
             width = bitmap.getWidth();
             height = bitmap.getHeight();
+            stride = bitmap.getStride();
             data = (pixel*)bitmap.getData(0, 0);
             goTo(x, y);
         }
@@ -161,7 +163,7 @@ namespace Beatmup {
             Returns value at pixel (x,y) position
         */
         inline pixint1 operator()(int x, int y) const {
-            return pixint1{ data[y * width + x] };
+            return pixint1{ *jump(x, y) };
         }
 
         /**
@@ -189,8 +191,8 @@ namespace Beatmup {
         }
 
         inline pixint3 operator()(int x, int y) const {
-            int i = 3 * (y * width + x);
-            return pixint3{ data[i + CHANNELS_3.R], data[i + CHANNELS_3.G], data[i + CHANNELS_3.B] };
+            const pixbyte* p = jump(x, y);
+            return pixint3{ p[CHANNELS_3.R], p[CHANNELS_3.G], p[CHANNELS_3.B] };
         }
 
         /**
@@ -219,8 +221,8 @@ namespace Beatmup {
         }
 
         inline pixint4 operator()(int x, int y) const {
-            int i = 4 * (y * width + x);
-            return pixint4(data[i + CHANNELS_4.R], data[i + CHANNELS_4.G], data[i + CHANNELS_4.B], data[i + CHANNELS_4.A]);
+            const pixbyte* p = jump(x, y);
+            return pixint4(p[CHANNELS_4.R], p[CHANNELS_4.G], p[CHANNELS_4.B], p[CHANNELS_4.A]);
         }
 
         /**
@@ -249,7 +251,7 @@ namespace Beatmup {
         }
 
         inline pixfloat1 operator()(int x, int y) const {
-            return pixfloat1{ data[y * width + x] };
+            return pixfloat1{ *jump(x, y) };
         }
 
         /**
@@ -277,8 +279,8 @@ namespace Beatmup {
         }
 
         inline pixfloat3 operator()(int x, int y) const {
-            int i = 3 * (y * width + x);
-            return pixfloat3{ data[i + CHANNELS_3.R], data[i + CHANNELS_3.G], data[i + CHANNELS_3.B] };
+            const pixfloat* p = jump(x, y);
+            return pixfloat3{ p[CHANNELS_3.R], p[CHANNELS_3.G], p[CHANNELS_3.B] };
         }
 
         /**
@@ -308,13 +310,13 @@ namespace Beatmup {
         }
 
         inline pixfloat4 operator()(int x, int y) const {
-            int i = 4 * (y * width + x);
-            return pixfloat4(data[i + CHANNELS_4.R], data[i + CHANNELS_4.G], data[i + CHANNELS_4.B], data[i + CHANNELS_4.A]);
+            const pixfloat* p = jump(x, y);
+            return pixfloat4(p[CHANNELS_4.R], p[CHANNELS_4.G], p[CHANNELS_4.B], p[CHANNELS_4.A]);
         }
 
         inline pixfloat4 at(int x, int y) const {
-            int i = 4 * (y * width + x);
-            return pixfloat4(ptr[i + CHANNELS_4.R], ptr[i + CHANNELS_4.G], ptr[i + CHANNELS_4.B], ptr[i + CHANNELS_4.A]);
+            const pixfloat* p = (const pixfloat*)((const pixbyte*)ptr + (msize)stride * y) + 4 * x;
+            return pixfloat4(p[CHANNELS_4.R], p[CHANNELS_4.G], p[CHANNELS_4.B], p[CHANNELS_4.A]);
         }
 
         /**
@@ -0,0 +1,95 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bitmap_view.h"
+#include "../exception.h"
+#include "../utils/utils.hpp"
+
+using namespace Beatmup;
+
+
+BitmapView::BitmapView(AbstractBitmap& parent, const IntRectangle& area) :
+    AbstractBitmap(parent.getContext()),
+    parent(parent), area(area)
+{
+    this->area.normalize();
+    InvalidArgument::check(this->area.a.x >= 0 && this->area.a.y >= 0 &&
+        this->area.b.x <= parent.getWidth() && this->area.b.y <= parent.getHeight(),
+        "The view area is out of the parent bitmap bounds");
+    if (parent.isMask()) {
+        const int pixelsPerByte = 8 / parent.getBitsPerPixel();
+        InvalidArgument::check(this->area.a.x % pixelsPerByte == 0 &&
+            (this->area.width() % pixelsPerByte == 0 || this->area.b.x == parent.getWidth()),
+            "Mask view area is not aligned to byte boundaries");
+    }
+}
+
+
+void BitmapView::lockPixelData() {
+    RuntimeError::check(parent.isUpToDate(ProcessingTarget::CPU) || !parent.isUpToDate(ProcessingTarget::GPU),
+        "The parent bitmap content is not available on CPU");
+    parent.lockPixelData();
+    parent.upToDate[ProcessingTarget::CPU] = true;
+    parent.upToDate[ProcessingTarget::GPU] = false;
+}
+
+
+void BitmapView::unlockPixelData() {
+    parent.unlockPixelData();
+}
+
+
+void BitmapView::prepare(GraphicPipeline& gpu) {
+    throw ImplementationUnsupported("Bitmap views cannot be used on GPU");
+}
+
+
+const PixelFormat BitmapView::getPixelFormat() const {
+    return parent.getPixelFormat();
+}
+
+
+const int BitmapView::getWidth() const {
+    return area.width();
+}
+
+
+const int BitmapView::getHeight() const {
+    return area.height();
+}
+
+
+const msize BitmapView::getMemorySize() const {
+    return (msize)ceili(getWidth() * getBitsPerPixel(), 8) * getHeight();
+}
+
+
+const pixbyte* BitmapView::getData(int x, int y) const {
+    const AbstractBitmap& parent = this->parent;
+    return parent.getData(area.a.x + x, area.a.y + y);
+}
+
+
+pixbyte* BitmapView::getData(int x, int y) {
+    return parent.getData(area.a.x + x, area.a.y + y);
+}
+
+
+int BitmapView::getStride() const {
+    return parent.getStride();
+}
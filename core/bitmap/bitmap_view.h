@@ -0,0 +1,69 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "abstract_bitmap.h"
+#include "../geometry.h"
+
+namespace Beatmup {
+
+    /**
+        Rectangular area of another bitmap accessed as a bitmap, without copying the pixel data.
+        The view shares the pixels of its parent bitmap: everything written to the view is written to the parent bitmap and vice versa. The rows
+        of the view are generally not contiguous in memory; the distance between them is given by getStride() and is the one of the parent
+        bitmap. Tasks processing bitmaps on CPU row by row (e.g., BitmapResampler, Metric, FormatConverter, FloodFill) accept views in input
+        and output, which allows to process a region of interest or a tile of a big image with no intermediate copy.
+
+        The view is only accessible on CPU: it cannot be used as a texture. Its parent bitmap needs to be up-to-date on CPU when the view
+        content is accessed. Accessing the view content outdates the parent bitmap on GPU, as the view does not tell reads from writes.
+        The parent bitmap must outlive the view.
+    */
+    class BitmapView : public AbstractBitmap {
+    private:
+        AbstractBitmap& parent;
+        IntRectangle area;              //!< the area of the parent bitmap covered by the view
+
+        void lockPixelData();
+        void unlockPixelData();
+
+    protected:
+        void prepare(GraphicPipeline& gpu);
+
+    public:
+        /**
+            Creates a view of a rectangular area of a bitmap.
+            For masks, the horizontal position and the width of the area must be multiples of the number of pixels stored in a byte, unless
+            the area extends to the right edge of the parent bitmap.
+            \param[in] parent       The bitmap to access
+            \param[in] area         The area in pixels. Must be within the parent bitmap bounds.
+        */
+        BitmapView(AbstractBitmap& parent, const IntRectangle& area);
+
+        const PixelFormat getPixelFormat() const;
+        const int getWidth() const;
+        const int getHeight() const;
+        const msize getMemorySize() const;
+        const pixbyte* getData(int x, int y) const;
+        pixbyte* getData(int x, int y);
+        int getStride() const;
+
+        inline AbstractBitmap& getParent() const { return parent; }
+        inline const IntRectangle& getArea() const { return area; }
+    };
+
+}
@@ -20,7 +20,9 @@
 #include "../bitmap/converter.h"
 #include "../bitmap/bitmap_access.h"
 #include "../bitmap/mask_bitmap_access.h"
+#include "../bitmap/simd_kernels.h"
 #include "../exception.h"
+#include "../utils/utils.hpp"
 #include <algorithm>
 #include <cstring>
 
@@ -76,38 +78,56 @@ bool FormatConverter::process(TaskThread& thread) {
     if (input == output)
         return true;
 
+    msize start, stop;
+
     // if pixel formats are identical, just copy
     if (input->getPixelFormat() == output->getPixelFormat()) {
-        if (thread.currentThread() == 0)
-            memcpy(
-                output->getData(0,0),
-                input->getData(0,0),
-                input->getMemorySize()
-            );
+        if (input->isDense() && output->isDense()) {
+            const msize bytesPerChunk = PIXEL_COUNT_PER_CHUNK * AbstractBitmap::BITS_PER_PIXEL[input->getPixelFormat()] / 8;
+            const pixbyte* src = input->getData(0, 0);
+            pixbyte* dst = output->getData(0, 0);
+            while (thread.nextChunk(input->getMemorySize(), bytesPerChunk, start, stop) && !thread.isTaskAborted())
+                memcpy(dst + start, src + start, stop - start);
+        }
+        else {
+            // copy row by row
+            const msize rowSize = ceili(input->getWidth() * input->getBitsPerPixel(), 8);
+            const msize rowsPerChunk = std::max(1, PIXEL_COUNT_PER_CHUNK / input->getWidth());
+            while (thread.nextChunk(input->getHeight(), rowsPerChunk, start, stop) && !thread.isTaskAborted())
+                for (msize y = start; y < stop; ++y)
+                    memcpy(output->getData(0, (int)y), input->getData(0, (int)y), rowSize);
+        }
         return true;
     }
 
-    // compute splitting accordingly to the current thread index
-    int w = output->getWidth();
-    msize
-        npix = w * output->getHeight(),
-        start = npix * thread.currentThread() / thread.numThreads(),
-        stop = npix * (1 + thread.currentThread()) / thread.numThreads();
-
-    // computing initial position
-    int outx = (int)(start % w), outy = (int)(start / w);
-
-    const int LOOK_AROUND_INTERVAL = 123456;
-    while (start < stop && !thread.isTaskAborted()) {
-        doConvert(outx, outy, stop-start);
-        start += LOOK_AROUND_INTERVAL;
-    }
+    // convert chunk by chunk
+    const int w = output->getWidth();
+    const msize npix = (msize)w * output->getHeight();
+    while (thread.nextChunk(npix, PIXEL_COUNT_PER_CHUNK, start, stop) && !thread.isTaskAborted())
+        doConvert((int)(start % w), (int)(start / w), stop - start);
 
     return true;
 }
 
 
 void FormatConverter::doConvert(int outX, int outY, msize nPix) {
+    // if the rows are not contiguous in memory, convert row by row
+    const int width = output->getWidth();
+    if (nPix > (msize)(width - outX) && !(input->isDense() && output->isDense())) {
+        while (nPix > 0) {
+            const msize n = std::min(nPix, (msize)(width - outX));
+            doConvert(outX, outY, n);
+            nPix -= n;
+            outX = 0;
+            outY++;
+        }
+        return;
+    }
+
+    // try vectorized conversion first
+    if (SimdKernels::convert(*input, *output, outX, outY, nPix))
+        return;
+
 #define CALL_CONVERT_AND_RETURN(IN_T, OUT_T) \
     convertBlock < IN_T, OUT_T >(*input, *output, outX, outY, nPix); return;
 
@@ -28,6 +28,7 @@ namespace Beatmup {
     class FormatConverter : public AbstractTask, private BitmapContentLock {
     private:
         const int MIN_PIXEL_COUNT_PER_THREAD = 1000;		//!< minimum number of pixels per worker
+        const int PIXEL_COUNT_PER_CHUNK = 16384;			//!< number of pixels converted at once by a worker
         AbstractBitmap *input, *output;						//!< input and output bitmaps
         
         void doConvert(int outX, int outY, msize nPix);
@@ -25,6 +25,7 @@ namespace Beatmup {
 
     /**
         A task to clip images on CPU.
+        Copies the pixels; to access a rectangular area of a bitmap without copying, use BitmapView.
     */
     class Crop : public AbstractTask, private BitmapContentLock {
     private:
@@ -33,7 +33,7 @@ InternalBitmap::InternalBitmap(Context& ctx, PixelFormat pixelFormat, int width,
         this->width = ceili(width, n) * n;
     }
     if (allocate)
-        memory = AlignedMemory(getMemorySize());
+        memory = AlignedMemory(getMemorySize(), ctx.getMemoryPool());
     upToDate[ProcessingTarget::CPU] = allocate;
 }
 
@@ -66,25 +66,27 @@ InternalBitmap::InternalBitmap(Context& ctx, const char* bmpFilename) :
     this->height = bmp.getHeight();
 
     // allocate & read
-    memory = AlignedMemory(getMemorySize());
+    memory = AlignedMemory(getMemorySize(), ctx.getMemoryPool());
     bmp.load(memory(), getMemorySize());
 }
 
 
 void Beatmup::InternalBitmap::reshape(int width, int height) {
+    // the texture is of the current size, disposing it before changing the size
+    releaseTexture();
+
     if (this->width * this->height != width * height && memory) {
         this->width = width;
         this->height = height;
-        memory = AlignedMemory(getMemorySize());
+        // releasing the current block first so that it can be reused if the new size falls into the same size class
+        memory.free();
+        memory = AlignedMemory(getMemorySize(), ctx.getMemoryPool());
     }
     else {
         this->width = width;
         this->height = height;
     }
 
-    if (upToDate[ProcessingTarget::GPU])
-        TextureHandler::invalidate(*ctx.getGpuRecycleBin());
-
     upToDate[ProcessingTarget::CPU] = false;
     upToDate[ProcessingTarget::GPU] = false;
 }
@@ -122,5 +124,5 @@ pixbyte* InternalBitmap::getData(int x, int y) {
 
 void InternalBitmap::lockPixelData() {
     if (!memory)
-        memory = AlignedMemory(getMemorySize());
+        memory = AlignedMemory(getMemorySize(), ctx.getMemoryPool());
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mapped_bitmap.h"
+#include "../utils/utils.hpp"
+
+using namespace Beatmup;
+
+
+MappedBitmap::MappedBitmap(Context& ctx, PixelFormat pixelFormat, int width, int height, const std::string& filename,
+    bool writable, msize offset
+):
+    AbstractBitmap(ctx),
+    pixelFormat(pixelFormat), width(width), height(height), offset(offset)
+{
+    InvalidArgument::check(width > 0 && height > 0, "Bitmap size must be positive");
+    mapping.map(filename, writable, offset + getMemorySize());
+}
+
+
+MappedBitmap::~MappedBitmap() {}
+
+
+void MappedBitmap::prepare(GraphicPipeline& gpu) {
+    throw ImplementationUnsupported("Memory-mapped bitmaps cannot be used on GPU");
+}
+
+
+const PixelFormat MappedBitmap::getPixelFormat() const {
+    return pixelFormat;
+}
+
+
+const int MappedBitmap::getWidth() const {
+    return width;
+}
+
+
+const int MappedBitmap::getHeight() const {
+    return height;
+}
+
+
+const msize MappedBitmap::getMemorySize() const {
+    return (msize)ceili(width * BITS_PER_PIXEL[pixelFormat], 8) * height;
+}
+
+
+const pixbyte* MappedBitmap::getData(int x, int y) const {
+    return mapping.getData() + offset + (msize)y * getStride() + x * BITS_PER_PIXEL[pixelFormat] / 8;
+}
+
+
+pixbyte* MappedBitmap::getData(int x, int y) {
+    return mapping.getData() + offset + (msize)y * getStride() + x * BITS_PER_PIXEL[pixelFormat] / 8;
+}
+
+
+void MappedBitmap::unloadRows(int firstRow, int lastRow) {
+    if (firstRow < 0)
+        firstRow = 0;
+    if (lastRow > height)
+        lastRow = height;
+    if (firstRow >= lastRow)
+        return;
+    mapping.unload(getData(0, firstRow), (msize)(lastRow - firstRow) * getStride());
+}
+
+
+void MappedBitmap::flush() {
+    mapping.flush();
+}
@@ -0,0 +1,88 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "abstract_bitmap.h"
+#include "../utils/file_mapping.h"
+#include <string>
+
+namespace Beatmup {
+
+    /**
+        Bitmap stored in a file and accessed through a memory mapping.
+        The file contains raw pixel data in the bitmap pixel format, row after row with no padding, starting at a given offset. The operating
+        system loads the pixel data from the file on demand, so that bitmaps much bigger than the available RAM can be processed. To keep the
+        memory use bounded, the rows that are no longer accessed need to be unloaded with unloadRows() (TiledExecutor does this after every band
+        of rows it processes).
+
+        The bitmap is only accessible on CPU: it cannot be used as a texture. A bitmap opened in read-only mode must not be written to.
+    */
+    class MappedBitmap : public AbstractBitmap {
+    private:
+        PixelFormat pixelFormat;
+        int width, height;
+        FileMapping mapping;                //!< the mapped file content
+        msize offset;                       //!< position of the pixel data in the file
+
+        inline void lockPixelData() {}
+        inline void unlockPixelData() {}
+
+    protected:
+        void prepare(GraphicPipeline& gpu);
+
+    public:
+        /**
+            Maps a file containing a bitmap.
+            \param ctx              A Beatmup context instance
+            \param pixelFormat      Pixel format
+            \param width            Bitmap width in pixels
+            \param height           Bitmap height in pixels
+            \param filename         Name of the file containing the pixel data
+            \param writable         If `true`, the file is opened for reading and writing. It is created if it does not exist and extended if
+                                    it is too small to store the bitmap; the added content is zero. Otherwise, the file is opened read-only
+                                    and must exist.
+            \param offset           Position of the pixel data in the file in bytes, e.g. to skip a header
+        */
+        MappedBitmap(Context& ctx, PixelFormat pixelFormat, int width, int height, const std::string& filename,
+            bool writable = true, msize offset = 0);
+
+        ~MappedBitmap();
+
+        const PixelFormat getPixelFormat() const;
+        const int getWidth() const;
+        const int getHeight() const;
+        const msize getMemorySize() const;
+        const pixbyte* getData(int x, int y) const;
+        pixbyte* getData(int x, int y);
+
+        /**
+            Unloads a range of rows from memory.
+            The modified pixels are written back to the file; the rows are loaded again from the file when accessed next time.
+        */
+        void unloadRows(int firstRow, int lastRow);
+
+        /**
+            Writes all the modified pixels to the file and waits till the writing is complete.
+        */
+        void flush();
+
+        inline const std::string& getFilename() const { return mapping.getFilename(); }
+        inline bool isWritable() const { return mapping.isWritable(); }
+    };
+
+}
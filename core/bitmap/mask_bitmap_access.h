@@ -32,6 +32,7 @@ namespace Beatmup {
             *ptr,				//!< pointer to current pixel
             bit;				//!< current position bit
         int width, height;		//!< bitmap size in pixels
+        int stride;				//!< distance between consecutive rows in bytes
 
         MaskScanner(const AbstractBitmap& bitmap) {
 #ifdef BEATMUP_DEBUG
@@ -40,6 +41,7 @@ namespace Beatmup {
 #endif
             width = bitmap.getWidth();
             height = bitmap.getHeight();
+            stride = bitmap.getStride();
             data = (unsigned char*)bitmap.getData(0, 0);
         }
 
@@ -95,10 +97,9 @@ namespace Beatmup {
             Returns 0..MAX_UNNORM_VALUE value at (x,y) position
         */
         inline unsigned char getValue(int x, int y) const {
-            msize n = (this->width*y + x);
             uint8_t
-                *p = this->data + n / pointsPerByte,
-                b = (unsigned char)(n % pointsPerByte);
+                *p = this->data + (msize)this->stride * y + x / pointsPerByte,
+                b = (unsigned char)(x % pointsPerByte);
             return ((*p) >> (b*num_bits)) & this->MAX_UNNORM_VALUE;
         }
 
@@ -163,9 +164,8 @@ namespace Beatmup {
             DebugAssertion::check(x >= 0 && y >= 0 && x < this->width && y < this->height,
                 "Coordinates outside of image: %d %d (width=%d, height=%d)", x, y, this->width, this->height);
 #endif
-            msize n = (this->width*y + x);
-            this->ptr = this->data + n / pointsPerByte,
-            this->bit = (unsigned char)(n % pointsPerByte) * num_bits;
+            this->ptr = this->data + (msize)this->stride * y + x / pointsPerByte,
+            this->bit = (unsigned char)(x % pointsPerByte) * num_bits;
         }
 
         LookupMaskScanner(const AbstractBitmap& bitmap, int x = 0, int y = 0):
@@ -306,7 +306,7 @@ namespace Beatmup {
             Returns 0..MAX_UNNORM_VALUE value at (x,y) position
         */
         inline unsigned char getValue(int x, int y) const {
-            return data[width*y + x];
+            return data[(msize)stride * y + x];
         }
 
         /**
@@ -353,7 +353,7 @@ namespace Beatmup {
             DebugAssertion::check(x >= 0 && y >= 0 && x < width && y < height,
                 "Coordinates outside of image: %d %d (width=%d, height=%d)", x, y, width, height);
 #endif
-            ptr = data + (width*y + x);
+            ptr = data + (msize)stride * y + x;
         }
 
         SingleByteMaskReader(const AbstractBitmap& bitmap, int x = 0, int y = 0):
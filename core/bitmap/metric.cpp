@@ -18,6 +18,7 @@
 
 #include "metric.h"
 #include "processing.h"
+#include "../utils/utils.hpp"
 
 using namespace Beatmup;
 
@@ -65,7 +66,7 @@ namespace Kernels {
 }
 
 
-Metric::Metric(): bitmap{ nullptr, nullptr }, norm(Norm::L2), result(0)
+Metric::Metric(): bitmap{ nullptr, nullptr }, norm(Norm::L2), chunkHeight(1), result(0)
 {}
 
 
@@ -94,13 +95,16 @@ void Metric::beforeProcessing(ThreadIndex threadCount, ProcessingTarget target,
     RuntimeError::check(roi[0] && roi[1], "Regions of interest are of different size");
     readLock(gpu, bitmap[0], ProcessingTarget::CPU);
     readLock(gpu, bitmap[1], ProcessingTarget::CPU);
-    results.resize(threadCount);
+    static const int PIXEL_COUNT_PER_CHUNK = 16384;
+    chunkHeight = std::max(1, PIXEL_COUNT_PER_CHUNK / std::max(1, roi[0].width()));
+    results.assign(ceili(roi[0].height(), chunkHeight), 0);
 }
 
 
 void Metric::afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted) {
     unlock(bitmap[0], bitmap[1]);
 
+    // partial results are summed up in the same order whatever thread computed them
     double sum = 0;
     for (const auto& _ : results)
         sum += _;
@@ -118,18 +122,24 @@ void Metric::afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool
 
 
 bool Metric::process(TaskThread& thread) {
-    const IntRectangle
-        myRoi1 = roi[0].split(thread.currentThread(), thread.numThreads()),
-        myRoi2 = roi[1].split(thread.currentThread(), thread.numThreads());
-
-    switch (norm) {
-    case Norm::L1:
-        BitmapProcessing::write<Kernels::ComputeL1Metric>(*bitmap[0], *bitmap[1], myRoi1, myRoi2, results[thread.currentThread()]);
-        break;
-
-    case Norm::L2:
-        BitmapProcessing::write<Kernels::ComputeSquaredL2Metric>(*bitmap[0], *bitmap[1], myRoi1, myRoi2, results[thread.currentThread()]);
-        break;
+    msize start, stop;
+    while (thread.nextChunk(roi[0].height(), chunkHeight, start, stop) && !thread.isTaskAborted()) {
+        IntRectangle myRoi1(roi[0]), myRoi2(roi[1]);
+        myRoi1.a.y = roi[0].a.y + (int)start;
+        myRoi1.b.y = roi[0].a.y + (int)stop;
+        myRoi2.a.y = roi[1].a.y + (int)start;
+        myRoi2.b.y = roi[1].a.y + (int)stop;
+        double& result = results[start / chunkHeight];
+
+        switch (norm) {
+        case Norm::L1:
+            BitmapProcessing::write<Kernels::ComputeL1Metric>(*bitmap[0], *bitmap[1], myRoi1, myRoi2, result);
+            break;
+
+        case Norm::L2:
+            BitmapProcessing::write<Kernels::ComputeSquaredL2Metric>(*bitmap[0], *bitmap[1], myRoi1, myRoi2, result);
+            break;
+        }
     }
 
     return true;
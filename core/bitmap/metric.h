@@ -40,7 +40,8 @@ namespace Beatmup {
         AbstractBitmap* bitmap[2];
         IntRectangle roi[2];
         Norm norm;
-        std::vector<double> results;
+        std::vector<double> results;    //!< partial results, one per chunk of rows
+        int chunkHeight;                //!< number of rows in a chunk
         double result;
 
         inline ThreadIndex getMaxThreads() const { return  MAX_THREAD_INDEX; }
@@ -19,6 +19,7 @@
 #include "operator.h"
 #include "bitmap_access.h"
 #include "mask_bitmap_access.h"
+#include "simd_kernels.h"
 
 
 using namespace Beatmup;
@@ -26,16 +27,58 @@ using namespace Beatmup;
 
 namespace Kernels {
 
+    /**
+        Performs a binary operation on a range of rows of two bitmaps using vectorized kernels
+        \return `false` if no vectorized kernel is available for the given pixel format and operation.
+    */
+    static bool processVectorized(
+            const AbstractBitmap& op1, const AbstractBitmap& op2, AbstractBitmap& out,
+            BitmapBinaryOperation::Operation operation,
+            int width, int startRow, int stopRow,
+            const IntPoint& op1Origin,
+            const IntPoint& op2Origin,
+            const IntPoint& outOrigin,
+            const TaskThread& tt
+    ) {
+        bool (*rowKernel)(PixelFormat, const void*, const void*, void*, int);
+        switch (operation) {
+            case BitmapBinaryOperation::Operation::ADD:
+                rowKernel = &SimdKernels::add;
+                break;
+            case BitmapBinaryOperation::Operation::MULTIPLY:
+                rowKernel = &SimdKernels::multiply;
+                break;
+            default:
+                return false;
+        }
+
+        const PixelFormat format = out.getPixelFormat();
+        for (int y = startRow; y < stopRow; ++y) {
+            // the outcome only depends on the pixel format and the operation, so it may only fail on the first row
+            if (!rowKernel(format,
+                    op1.getData(op1Origin.x, op1Origin.y + y),
+                    op2.getData(op2Origin.x, op2Origin.y + y),
+                    out.getData(outOrigin.x, outOrigin.y + y),
+                    width))
+                return false;
+
+            if (tt.isTaskAborted())
+                break;
+        }
+        return true;
+    }
+
+
     template<class in_t, class out_t> class BinaryOpBody {
     public:
 
         /**
-            Performs a binary operation on two bitmaps
+            Performs a binary operation on a range of rows of two bitmaps
         */
         static void process(
                 in_t op1, in_t op2, out_t out,
                 BitmapBinaryOperation::Operation operation,
-                int width, int height,
+                int width, int startRow, int stopRow,
                 const IntPoint& op1Origin,
                 const IntPoint& op2Origin,
                 const IntPoint& outOrigin,
@@ -44,7 +87,7 @@ namespace Kernels {
             if (operation == BitmapBinaryOperation::Operation::NONE)
                 return;
 
-            for (int y = tt.currentThread(); y < height; y += tt.numThreads()) {
+            for (int y = startRow; y < stopRow; ++y) {
                 op1.goTo(op1Origin.x, op1Origin.y + y);
                 op2.goTo(op2Origin.x, op2Origin.y + y);
                 out.goTo(outOrigin.x, outOrigin.y + y);
@@ -72,12 +115,12 @@ namespace Kernels {
 
 
         /**
-            Performs a binary operation on two binary masks
+            Performs a binary operation on a range of rows of two binary masks
         */
         static void processAlignedBinaryMask(
                 in_t op1, in_t op2, out_t out,
                 BitmapBinaryOperation::Operation operation,
-                int width, int height,
+                int width, int startRow, int stopRow,
                 const IntPoint &op1Origin,
                 const IntPoint &op2Origin,
                 const IntPoint &outOrigin,
@@ -90,7 +133,7 @@ namespace Kernels {
             BEATMUP_ASSERT_DEBUG(op2Origin.x % 8 == 0);
             BEATMUP_ASSERT_DEBUG(outOrigin.x % 8 == 0);
 
-            for (int y = tt.currentThread(); y < height; y += tt.numThreads()) {
+            for (int y = startRow; y < stopRow; ++y) {
                 int x = 0;
 
                 // running aligned part first
@@ -210,7 +253,7 @@ void BitmapBinaryOperation::resetCrop() {
 
 
 ThreadIndex BitmapBinaryOperation::getMaxThreads() const {
-    return AbstractTask::validThreadCount(cropHeight / MIN_PIXEL_COUNT_PER_THREAD);
+    return AbstractTask::validThreadCount(cropWidth * cropHeight / MIN_PIXEL_COUNT_PER_THREAD);
 }
 
 
@@ -238,10 +281,23 @@ void BitmapBinaryOperation::afterProcessing(ThreadIndex threadCount, GraphicPipe
 
 
 bool BitmapBinaryOperation::process(TaskThread& thread) {
+    const msize rowsPerChunk = std::max(1, PIXEL_COUNT_PER_CHUNK / std::max(1, cropWidth));
+    msize start, stop;
+    while (thread.nextChunk(cropHeight, rowsPerChunk, start, stop) && !thread.isTaskAborted())
+        processRows((int)start, (int)stop, thread);
+    return true;
+}
+
+
+void BitmapBinaryOperation::processRows(int startRow, int stopRow, TaskThread& thread) {
 #define PROCESS(IN_T, OUT_T) \
         Kernels::BinaryOpBody<IN_T, OUT_T>::process( \
             IN_T(*op1), IN_T(*op2), OUT_T(*output), \
-            operation, cropWidth, cropHeight, op1Origin, op2Origin, outputOrigin, thread);
+            operation, cropWidth, startRow, stopRow, op1Origin, op2Origin, outputOrigin, thread);
+
+    if (!output->isMask() &&
+        Kernels::processVectorized(*op1, *op2, *output, operation, cropWidth, startRow, stopRow, op1Origin, op2Origin, outputOrigin, thread))
+        return;
 
     switch (output->getPixelFormat()) {
         case SingleByte:
@@ -266,7 +322,7 @@ bool BitmapBinaryOperation::process(TaskThread& thread) {
             if (op1Origin.x % 8 == 0 && op2Origin.x % 8 == 0 && outputOrigin.x % 8 == 0)
                 Kernels::BinaryOpBody<BinaryMaskReader, BinaryMaskWriter>::processAlignedBinaryMask(
                         BinaryMaskReader(*op1), BinaryMaskReader(*op2), BinaryMaskWriter(*output),
-                        operation, cropWidth, cropHeight, op1Origin, op2Origin, outputOrigin,
+                        operation, cropWidth, startRow, stopRow, op1Origin, op2Origin, outputOrigin,
                         thread);
             else
                 PROCESS(BinaryMaskReader, BinaryMaskWriter);
@@ -278,5 +334,5 @@ bool BitmapBinaryOperation::process(TaskThread& thread) {
             PROCESS(HexMaskReader, HexMaskWriter);
             break;
     }
-    return true;
+#undef PROCESS
 }
@@ -16,6 +16,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#pragma once
 #include "abstract_bitmap.h"
 #include "../parallelism.h"
 #include "../geometry.h"
@@ -40,12 +41,15 @@ namespace Beatmup {
 
     private:
         const int MIN_PIXEL_COUNT_PER_THREAD = 1000;		//!< minimum number of pixels per worker
+        const int PIXEL_COUNT_PER_CHUNK = 16384;			//!< number of pixels processed at once by a worker
 
         AbstractBitmap *op1, *op2, *output;						//!< input and output bitmaps
         Operation operation;
         IntPoint op1Origin, op2Origin, outputOrigin;
         int cropWidth, cropHeight;
 
+        void processRows(int startRow, int stopRow, TaskThread& thread);
+
     protected:
         virtual bool process(TaskThread& thread);
         virtual void beforeProcessing(ThreadIndex, ProcessingTarget target, GraphicPipeline*);
@@ -0,0 +1,449 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pixel_pipeline.h"
+#include "processing.h"
+#include "../exception.h"
+#include "../utils/utils.hpp"
+#include "../platform.h"
+#include <algorithm>
+
+#ifdef BEATMUP_ARCH_X86_64
+#include <emmintrin.h>
+#endif
+
+using namespace Beatmup;
+
+
+namespace Kernels {
+    /*
+        The pipeline works on rows of floating point pixels. On x86-64, the row operations use SSE2 that is always available there.
+        The channels of pixfloat4 are stored in the same order as the ones of 4-channel integer bitmaps, so no shuffling is needed.
+    */
+
+#ifdef BEATMUP_ARCH_X86_64
+    inline __m128 load(const pixfloat4& pixel) { return _mm_loadu_ps(pixel.val); }
+    inline void store(pixfloat4& pixel, __m128 value) { _mm_storeu_ps(pixel.val, value); }
+#endif
+
+    static const float BYTE_TO_FLOAT = 1 / 255.0f;
+
+
+    /**
+        Reads a segment of a bitmap row into floating point pixels
+    */
+    template<class in_t> class ReadRow {
+    public:
+        static void process(AbstractBitmap& bitmap, int x, int y, int length, pixfloat4* pixels) {
+            in_t in(bitmap, x, y);
+            for (int i = 0; i < length; ++i, in++)
+                pixels[i] = in();
+        }
+    };
+
+
+    /**
+        Writes floating point pixels to a segment of a bitmap row
+    */
+    template<class out_t> class WriteRow {
+    public:
+        static void process(AbstractBitmap& bitmap, int x, int y, int length, const pixfloat4* pixels) {
+            out_t out(bitmap, x, y);
+            for (int i = 0; i < length; ++i, out++)
+                out = pixels[i];
+        }
+    };
+
+
+    /*
+        Specializations for the most common pixel formats, avoiding the per-pixel divisions of the generic readers
+    */
+
+    template<> class ReadRow<TripleByteBitmapReader> {
+    public:
+        static void process(AbstractBitmap& bitmap, int x, int y, int length, pixfloat4* pixels) {
+            const pixbyte* data = bitmap.getData(x, y);
+            for (int i = 0; i < length; ++i, data += 3)
+                pixels[i] = pixfloat4(
+                    data[CHANNELS_3.R] * BYTE_TO_FLOAT, data[CHANNELS_3.G] * BYTE_TO_FLOAT, data[CHANNELS_3.B] * BYTE_TO_FLOAT, 1.0f
+                );
+        }
+    };
+
+
+    template<> class ReadRow<QuadByteBitmapReader> {
+    public:
+        static void process(AbstractBitmap& bitmap, int x, int y, int length, pixfloat4* pixels) {
+            const pixbyte* data = bitmap.getData(x, y);
+            int i = 0;
+#ifdef BEATMUP_ARCH_X86_64
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 scale = _mm_set1_ps(BYTE_TO_FLOAT);
+            for (; i + 4 <= length; i += 4, data += 16) {
+                const __m128i bytes = _mm_loadu_si128((const __m128i*)data);
+                const __m128i lo = _mm_unpacklo_epi8(bytes, zero), hi = _mm_unpackhi_epi8(bytes, zero);
+                store(pixels[i    ], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+                store(pixels[i + 1], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+                store(pixels[i + 2], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+                store(pixels[i + 3], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+            }
+#endif
+            for (; i < length; ++i, data += 4)
+                pixels[i] = pixfloat4(
+                    data[CHANNELS_4.R] * BYTE_TO_FLOAT, data[CHANNELS_4.G] * BYTE_TO_FLOAT,
+                    data[CHANNELS_4.B] * BYTE_TO_FLOAT, data[CHANNELS_4.A] * BYTE_TO_FLOAT
+                );
+        }
+    };
+
+
+    template<> class WriteRow<QuadByteBitmapWriter> {
+    public:
+        static void process(AbstractBitmap& bitmap, int x, int y, int length, const pixfloat4* pixels) {
+            pixbyte* data = bitmap.getData(x, y);
+            int i = 0;
+#ifdef BEATMUP_ARCH_X86_64
+            // rounding half up as pixfloat2pixbyte() does below: the values are clamped to 0..1 first, so that truncating after adding 0.5
+            // is flooring
+            const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+            auto convert = [&](const pixfloat4& pixel) {
+                return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(load(pixel), zero), one), scale), half));
+            };
+            for (; i + 4 <= length; i += 4, data += 16) {
+                const __m128i
+                    lo = _mm_packs_epi32(convert(pixels[i]), convert(pixels[i + 1])),
+                    hi = _mm_packs_epi32(convert(pixels[i + 2]), convert(pixels[i + 3]));
+                _mm_storeu_si128((__m128i*)data, _mm_packus_epi16(lo, hi));
+            }
+#endif
+            for (; i < length; ++i, data += 4) {
+                data[CHANNELS_4.R] = pixfloat2pixbyte(pixels[i].r);
+                data[CHANNELS_4.G] = pixfloat2pixbyte(pixels[i].g);
+                data[CHANNELS_4.B] = pixfloat2pixbyte(pixels[i].b);
+                data[CHANNELS_4.A] = pixfloat2pixbyte(pixels[i].a);
+            }
+        }
+    };
+
+
+    /**
+        Multiplies pixels by a color matrix given by its columns and adds a bias
+    */
+    inline void applyColorMatrix(pixfloat4* pixels, int length, const pixfloat4* columns, const pixfloat4& bias) {
+#ifdef BEATMUP_ARCH_X86_64
+        const __m128 c0 = load(columns[0]), c1 = load(columns[1]), c2 = load(columns[2]), c3 = load(columns[3]), b = load(bias);
+        for (int i = 0; i < length; ++i) {
+            const __m128 p = load(pixels[i]);
+            store(pixels[i], _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p, p, 0x00), c0), _mm_mul_ps(_mm_shuffle_ps(p, p, 0x55), c1)),
+                _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p, p, 0xaa), c2), _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p, p, 0xff), c3), b))
+            ));
+        }
+#else
+        for (int i = 0; i < length; ++i) {
+            const pixfloat4 p = pixels[i];
+            pixels[i] = bias + columns[0] * p.val[0] + columns[1] * p.val[1] + columns[2] * p.val[2] + columns[3] * p.val[3];
+        }
+#endif
+    }
+
+
+    /**
+        Computes pixels = pixels + operand
+    */
+    inline void add(pixfloat4* pixels, const pixfloat4* operand, int length) {
+        for (int i = 0; i < length; ++i)
+#ifdef BEATMUP_ARCH_X86_64
+            store(pixels[i], _mm_add_ps(load(pixels[i]), load(operand[i])));
+#else
+            pixels[i] = pixels[i] + operand[i];
+#endif
+    }
+
+
+    /**
+        Computes pixels = pixels * operand
+    */
+    inline void multiply(pixfloat4* pixels, const pixfloat4* operand, int length) {
+        for (int i = 0; i < length; ++i)
+#ifdef BEATMUP_ARCH_X86_64
+            store(pixels[i], _mm_mul_ps(load(pixels[i]), load(operand[i])));
+#else
+            pixels[i] = pixels[i] * operand[i];
+#endif
+    }
+
+
+    /**
+        Computes output = input * weight, or output = output + input * weight if accumulating
+    */
+    inline void weight(pixfloat4* output, const pixfloat4* input, float weight, int length, bool accumulate) {
+#ifdef BEATMUP_ARCH_X86_64
+        const __m128 w = _mm_set1_ps(weight);
+        if (accumulate)
+            for (int i = 0; i < length; ++i)
+                store(output[i], _mm_add_ps(load(output[i]), _mm_mul_ps(load(input[i]), w)));
+        else
+            for (int i = 0; i < length; ++i)
+                store(output[i], _mm_mul_ps(load(input[i]), w));
+#else
+        if (accumulate)
+            for (int i = 0; i < length; ++i)
+                output[i] = output[i] + input[i] * weight;
+        else
+            for (int i = 0; i < length; ++i)
+                output[i] = input[i] * weight;
+#endif
+    }
+}
+
+
+PixelPipeline::PixelPipeline():
+    input(nullptr), output(nullptr), resampling(false), resamplingMode(BitmapResampler::Mode::LINEAR),
+    cubicParameter(BitmapResampler::DEFAULT_CUBIC_PARAMETER), ringSize(0), scratchSize(0)
+{}
+
+
+PixelPipeline& PixelPipeline::addColorMatrix(const Color::Matrix& matrix, const color4f& bias) {
+    Stage stage;
+    stage.type = Stage::Type::COLOR_MATRIX;
+    // getting the matrix columns in the channel order of pixfloat4 by transforming unit vectors
+    for (int i = 0; i < 4; ++i) {
+        pixfloat4 unit;
+        unit.val[i] = 1;
+        stage.columns[i] = pixfloat4(
+            unit.r * matrix.r().r + unit.g * matrix.r().g + unit.b * matrix.r().b + unit.a * matrix.r().a,
+            unit.r * matrix.g().r + unit.g * matrix.g().g + unit.b * matrix.g().b + unit.a * matrix.g().a,
+            unit.r * matrix.b().r + unit.g * matrix.b().g + unit.b * matrix.b().b + unit.a * matrix.b().a,
+            unit.r * matrix.a().r + unit.g * matrix.a().g + unit.b * matrix.a().b + unit.a * matrix.a().a
+        );
+    }
+    stage.bias = pixfloat4(bias);
+    stage.operation = BitmapBinaryOperation::Operation::NONE;
+    stage.operand = nullptr;
+    stages.push_back(stage);
+    return *this;
+}
+
+
+PixelPipeline& PixelPipeline::addBinaryOperation(BitmapBinaryOperation::Operation operation, AbstractBitmap* operand) {
+    NullTaskInput::check(operand, "operand bitmap");
+    Stage stage;
+    stage.type = Stage::Type::BINARY_OPERATION;
+    stage.operation = operation;
+    stage.operand = operand;
+    stages.push_back(stage);
+    return *this;
+}
+
+
+PixelPipeline& PixelPipeline::setResampling(BitmapResampler::Mode mode, float cubicParameter) {
+    if (mode == BitmapResampler::Mode::CONVNET)
+        throw ImplementationUnsupported("Neural network-based resampling cannot be fused into a pixel pipeline");
+    resampling = true;
+    resamplingMode = mode;
+    this->cubicParameter = cubicParameter;
+    return *this;
+}
+
+
+void PixelPipeline::clear() {
+    stages.clear();
+    resampling = false;
+}
+
+
+void PixelPipeline::processSegment(int x, int y, int length, pixfloat4* pixels, pixfloat4* operandPixels) const {
+    BitmapProcessing::read<Kernels::ReadRow>(*input, x, y, length, pixels);
+
+    for (const auto& stage : stages)
+        switch (stage.type) {
+            case Stage::Type::COLOR_MATRIX:
+                Kernels::applyColorMatrix(pixels, length, stage.columns, stage.bias);
+                break;
+
+            case Stage::Type::BINARY_OPERATION:
+                switch (stage.operation) {
+                    case BitmapBinaryOperation::Operation::ADD:
+                        BitmapProcessing::read<Kernels::ReadRow>(*stage.operand, x, y, length, operandPixels);
+                        Kernels::add(pixels, operandPixels, length);
+                        break;
+
+                    case BitmapBinaryOperation::Operation::MULTIPLY:
+                        BitmapProcessing::read<Kernels::ReadRow>(*stage.operand, x, y, length, operandPixels);
+                        Kernels::multiply(pixels, operandPixels, length);
+                        break;
+
+                    default:
+                        break;
+                }
+                break;
+        }
+}
+
+
+void PixelPipeline::processWithoutResampling(pixfloat4* buffer, TaskThread& thread) {
+    const int
+        width = output->getWidth(),
+        height = output->getHeight(),
+        segmentLength = std::min(SEGMENT_LENGTH, width);
+    pixfloat4
+        *pixels = buffer,
+        *operandPixels = buffer + segmentLength;
+
+    // output rows are processed by chunks handed out by the thread pool
+    msize start, stop;
+    while (thread.nextChunk(height, std::max(1, CHUNK_PIXEL_COUNT / width), start, stop)) {
+        for (int y = (int)start; y < (int)stop; ++y) {
+            for (int x = 0; x < width; x += segmentLength) {
+                const int length = std::min(segmentLength, width - x);
+                processSegment(x, y, length, pixels, operandPixels);
+                BitmapProcessing::write<Kernels::WriteRow>(*output, x, y, length, pixels);
+            }
+
+            if (thread.isTaskAborted())
+                return;
+        }
+    }
+}
+
+
+void PixelPipeline::processWithResampling(pixfloat4* buffer, TaskThread& thread) {
+    const int
+        srcWidth = input->getWidth(),
+        dstWidth = output->getWidth(),
+        dstHeight = output->getHeight();
+    pixfloat4
+        *ring = buffer,
+        *operandPixels = ring + ringSize * srcWidth,
+        *accumulator = operandPixels + srcWidth,
+        *outPixels = accumulator + srcWidth;
+
+    // The processed input rows are kept in a ring buffer. The rows contributing to an output row are consecutive and there are
+    // ringSize of them, so that they never compete for the same slot.
+    std::vector<int> ringRows(ringSize, -1);
+
+    // output rows are processed by chunks handed out by the thread pool
+    msize start, stop;
+    while (thread.nextChunk(dstHeight, std::max(1, CHUNK_PIXEL_COUNT / dstWidth), start, stop)) {
+        for (int y = (int)start; y < (int)stop; ++y) {
+            // getting the processed input rows and interpolating vertically
+            const pixfloat4* row = nullptr;
+            const int first = rowWeights.getFirst(y);
+            const float* weights = rowWeights.getWeights(y);
+            for (int k = 0; k < ringSize; ++k) {
+                const int index = first + k, slot = index % ringSize;
+                pixfloat4* slotPixels = ring + slot * srcWidth;
+                if (ringRows[slot] != index) {
+                    processSegment(0, index, srcWidth, slotPixels, operandPixels);
+                    ringRows[slot] = index;
+                }
+
+                if (ringSize == 1)
+                    row = slotPixels;
+                else
+                    Kernels::weight(accumulator, slotPixels, weights[k], srcWidth, k > 0);
+            }
+            if (!row)
+                row = accumulator;
+
+            // interpolating horizontally
+            const int columnTapCount = columnWeights.getTapCount();
+            for (int x = 0; x < dstWidth; ++x) {
+                const pixfloat4* pixel = row + columnWeights.getFirst(x);
+                const float* weight = columnWeights.getWeights(x);
+#ifdef BEATMUP_ARCH_X86_64
+                __m128 acc = _mm_mul_ps(Kernels::load(pixel[0]), _mm_set1_ps(weight[0]));
+                for (int k = 1; k < columnTapCount; ++k)
+                    acc = _mm_add_ps(acc, _mm_mul_ps(Kernels::load(pixel[k]), _mm_set1_ps(weight[k])));
+                Kernels::store(outPixels[x], acc);
+#else
+                pixfloat4 acc = pixel[0] * weight[0];
+                for (int k = 1; k < columnTapCount; ++k)
+                    acc = acc + pixel[k] * weight[k];
+                outPixels[x] = acc;
+#endif
+            }
+
+            BitmapProcessing::write<Kernels::WriteRow>(*output, 0, y, dstWidth, outPixels);
+
+            if (thread.isTaskAborted())
+                return;
+        }
+    }
+}
+
+
+void PixelPipeline::beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu) {
+    NullTaskInput::check(input, "input bitmap");
+    NullTaskInput::check(output, "output bitmap");
+    const int width = input->getWidth(), height = input->getHeight();
+    if (!resampling)
+        RuntimeError::check(width == output->getWidth() && height == output->getHeight(),
+            "Input and output bitmaps sizes do not match. Resampling needs to be enabled to change the size.");
+    for (const auto& stage : stages)
+        if (stage.type == Stage::Type::BINARY_OPERATION)
+            RuntimeError::check(stage.operand->getWidth() == width && stage.operand->getHeight() == height,
+                "Operand bitmap size does not match the input bitmap size");
+
+    // computing resampling filter weights and per-thread scratch buffer size
+    if (resampling) {
+        columnWeights.compute(resamplingMode, width, output->getWidth(), cubicParameter);
+        rowWeights.compute(resamplingMode, height, output->getHeight(), cubicParameter);
+        ringSize = rowWeights.getTapCount();
+        scratchSize = (ringSize + 2) * width + output->getWidth();
+    }
+    else
+        scratchSize = 2 * std::min(SEGMENT_LENGTH, width);
+
+    // keeping the buffers of different threads in different cache lines
+    static const msize PIXELS_PER_CACHE_LINE = 64 / sizeof(pixfloat4);
+    scratchSize = ceili(scratchSize, PIXELS_PER_CACHE_LINE) * PIXELS_PER_CACHE_LINE;
+    scratch = AlignedMemory(threadCount * scratchSize * sizeof(pixfloat4), input->getContext().getMemoryPool(), 64);
+
+    // locking the bitmaps
+    writeLock(gpu, output, ProcessingTarget::CPU);
+    readLock(gpu, input, ProcessingTarget::CPU);
+    for (const auto& stage : stages)
+        if (stage.type == Stage::Type::BINARY_OPERATION)
+            readLock(gpu, stage.operand, ProcessingTarget::CPU);
+}
+
+
+void PixelPipeline::afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted) {
+    unlockAll();
+    scratch.free();
+}
+
+
+bool PixelPipeline::process(TaskThread& thread) {
+    pixfloat4* buffer = scratch.ptr<pixfloat4>(thread.currentThread() * scratchSize);
+    if (resampling)
+        processWithResampling(buffer, thread);
+    else
+        processWithoutResampling(buffer, thread);
+    return true;
+}
+
+
+ThreadIndex PixelPipeline::getMaxThreads() const {
+    NullTaskInput::check(output, "output bitmap");
+    // if there are few pixels, do not use many threads
+    static const int MIN_PIXEL_COUNT_PER_THREAD = 4096;
+    return AbstractTask::validThreadCount(output->getWidth() * output->getHeight() / MIN_PIXEL_COUNT_PER_THREAD);
+}
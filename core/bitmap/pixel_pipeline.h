@@ -0,0 +1,127 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "abstract_bitmap.h"
+#include "operator.h"
+#include "pixel_arithmetic.h"
+#include "resampler.h"
+#include "separable_resampler.h"
+#include "../color/matrix.h"
+#include "../memory.h"
+#include "../parallelism.h"
+#include <vector>
+
+namespace Beatmup {
+
+    /**
+        Chain of pixelwise operations followed by an optional resampling, performed on CPU in a single pass over memory.
+        Running FormatConverter, Filters::ColorMatrix, BitmapBinaryOperation and BitmapResampler one after another produces a full-size
+        intermediate bitmap at every step, so that the pixel data goes through RAM once per step. PixelPipeline instead reads the input bitmap
+        row by row into small per-thread scratch buffers, applies all the stages there in floating point, resamples the result and writes it to
+        the output bitmap. The scratch buffers are small enough to stay in cache, so that every input and output pixel is only read or written
+        once.
+
+        The input and output bitmaps may have any pixel formats; the conversion between them is thus implicit. Unlike the staged
+        version, intermediate values are not clipped to the range of the input pixel format, nor rounded.
+        When downsampling, the stages are only applied to the input rows actually contributing to the output.
+    */
+    class PixelPipeline : public AbstractTask, private BitmapContentLock {
+    private:
+        /**
+            Pixelwise processing stage
+        */
+        struct Stage {
+            enum class Type {
+                COLOR_MATRIX,
+                BINARY_OPERATION
+            } type;
+            pixfloat4 columns[4];                   //!< color matrix columns
+            pixfloat4 bias;                         //!< color matrix bias
+            BitmapBinaryOperation::Operation operation;
+            AbstractBitmap* operand;                //!< second operand of the binary operation
+        };
+
+        static const int SEGMENT_LENGTH = 1024;             //!< max number of pixels processed at once when not resampling
+        static const int CHUNK_PIXEL_COUNT = 65536;         //!< number of output pixels processed at once by a thread
+
+        AbstractBitmap *input, *output;
+        std::vector<Stage> stages;
+        bool resampling;
+        BitmapResampler::Mode resamplingMode;
+        float cubicParameter;
+
+        SeparableResampler::Weights rowWeights, columnWeights;  //!< resampling filter weights per output row and column
+        int ringSize;                                       //!< number of processed input rows kept in the scratch buffer per thread
+        msize scratchSize;                                  //!< scratch buffer size per thread in pixels
+        AlignedMemory scratch;                              //!< scratch buffers of all threads
+
+        void processSegment(int x, int y, int length, pixfloat4* pixels, pixfloat4* operandPixels) const;
+        void processWithoutResampling(pixfloat4* buffer, TaskThread& thread);
+        void processWithResampling(pixfloat4* buffer, TaskThread& thread);
+
+    protected:
+        virtual bool process(TaskThread& thread);
+        virtual void beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu);
+        virtual void afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted);
+        virtual ThreadIndex getMaxThreads() const;
+
+    public:
+        PixelPipeline();
+
+        inline void setInput(AbstractBitmap* input) { this->input = input; }
+        inline void setOutput(AbstractBitmap* output) { this->output = output; }
+        inline AbstractBitmap* getInput() { return input; }
+        inline AbstractBitmap* getOutput() { return output; }
+
+        /**
+            Appends a color matrix stage: every pixel is multiplied by a matrix and a bias is added, as done by Filters::ColorMatrix.
+            \param[in] matrix       The color matrix
+            \param[in] bias         The bias
+            \return the pipeline itself.
+        */
+        PixelPipeline& addColorMatrix(const Color::Matrix& matrix, const color4f& bias);
+
+        /**
+            Appends a binary operation stage: every pixel is combined with the pixel of another bitmap at the same position, as done by
+            BitmapBinaryOperation. The operand bitmap must be of the input bitmap size.
+            \param[in] operation    The operation
+            \param[in] operand      The second operand bitmap
+            \return the pipeline itself.
+        */
+        PixelPipeline& addBinaryOperation(BitmapBinaryOperation::Operation operation, AbstractBitmap* operand);
+
+        /**
+            Enables resampling of the processed input to the output bitmap size.
+            Without resampling, the input and output bitmaps must be of the same size.
+            \param[in] mode             The resampling mode. The neural network-based mode is not supported.
+            \param[in] cubicParameter   Cubic interpolation parameter ("alpha") used in bicubic mode
+            \return the pipeline itself.
+        */
+        PixelPipeline& setResampling(BitmapResampler::Mode mode, float cubicParameter = BitmapResampler::DEFAULT_CUBIC_PARAMETER);
+
+        /**
+            Removes all the stages and disables resampling.
+        */
+        void clear();
+
+        inline size_t getStageCount() const { return stages.size(); }
+        inline bool isResampling() const { return resampling; }
+    };
+
+}
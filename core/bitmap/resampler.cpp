@@ -18,8 +18,12 @@
 
 #include "resampler.h"
 #include "resampling_kernels.h"
+#include "separable_resampler.h"
 #include "processing.h"
+#include "simd_kernels.h"
+#include "resampler_cnn_x2/cpu/cnn.h"
 #include "resampler_cnn_x2/gles20/cnn.h"
+#include "../context.h"
 #ifndef BEATMUP_OPENGLVERSION_GLES20
 #include "resampler_cnn_x2/gles31/cnn.h"
 #endif
@@ -31,14 +35,17 @@ const float BitmapResampler::DEFAULT_CUBIC_PARAMETER = -0.5f;
 
 BitmapResampler::BitmapResampler(Context& context) :
     context(context),
-    input(nullptr), output(nullptr), mode(Mode::CUBIC), cubicParameter(DEFAULT_CUBIC_PARAMETER), convnet(nullptr),
-    isUsingEs31IfAvailable(false)
+    input(nullptr), output(nullptr), mode(Mode::CUBIC), cubicParameter(DEFAULT_CUBIC_PARAMETER), convnet(nullptr), cpuConvnet(nullptr),
+    separable(new SeparableResampler()), isUsingEs31IfAvailable(false), isUsingGpuIfAvailable(true)
 {}
 
 
 BitmapResampler::~BitmapResampler() {
     if (convnet)
         delete convnet;
+    if (cpuConvnet)
+        delete cpuConvnet;
+    delete separable;
 }
 
 
@@ -78,12 +85,18 @@ void BitmapResampler::setOutputRect(const IntRectangle& rect) {
 
 ThreadIndex BitmapResampler::getMaxThreads() const {
     static const int MIN_PIXELS_PER_THREAD = 1000; //!< minimum number of pixels per worker
+    if (mode == Mode::CONVNET && input) {
+        // the network runs in a single thread on GPU
+        if (isUsingGpuIfAvailable && input->getContext().isGpuReady())
+            return 1;
+        return AbstractTask::validThreadCount(CpuX2UpsamplingNetwork::getTileCount(*input));
+    }
     return AbstractTask::validThreadCount(std::min(destRect.height() + 1, srcRect.getArea() / MIN_PIXELS_PER_THREAD));
 }
 
 
 AbstractTask::TaskDeviceRequirement BitmapResampler::getUsedDevices() const {
-    return mode == Mode::CONVNET ? TaskDeviceRequirement::GPU_ONLY : TaskDeviceRequirement::CPU_ONLY;
+    return mode == Mode::CONVNET && isUsingGpuIfAvailable ? TaskDeviceRequirement::GPU_OR_CPU : TaskDeviceRequirement::CPU_ONLY;
 }
 
 
@@ -101,7 +114,6 @@ void BitmapResampler::beforeProcessing(ThreadIndex threadCount, ProcessingTarget
     destRect.limit(IntRectangle(0, 0, output->getWidth(), output->getHeight()));
 
     if (mode == Mode::CONVNET) {
-        RuntimeError::check(gpu != nullptr, "convnet resampling requires GPU");
         RuntimeError::check(input->getContext() == context && output->getContext() == context,
             "input and/or output bitmaps contexts do not match the BitmapRecycler context");
         RuntimeError::check(
@@ -109,28 +121,51 @@ void BitmapResampler::beforeProcessing(ThreadIndex threadCount, ProcessingTarget
             "convnet resampling is only applicable for 2x upsampling"
         );
 
-#ifndef BEATMUP_OPENGLVERSION_GLES20
-        // check if the ES backend needed to be upgraded to 3.1
-        if (convnet && isUsingEs31IfAvailable && !convnet->usesEs31Backend()) {
-            delete convnet;
-            convnet = nullptr;
+        if (target == ProcessingTarget::CPU) {
+            // no GPU: run the network on CPU
+            if (!CpuX2UpsamplingNetwork::isApplicable(*input, *output))
+                throw ImplementationUnsupported("Convnet resampling of masks on CPU");
+            if (!cpuConvnet)
+                cpuConvnet = new CpuX2UpsamplingNetwork();
+            cpuConvnet->prepare(*input, threadCount);
         }
+        else {
+#ifndef BEATMUP_OPENGLVERSION_GLES20
+            // check if the ES backend needed to be upgraded to 3.1
+            if (convnet && isUsingEs31IfAvailable && !convnet->usesEs31Backend()) {
+                delete convnet;
+                convnet = nullptr;
+            }
 #endif
 
-        // init convnet instance if not yet
+            // init convnet instance if not yet
 #ifndef BEATMUP_OPENGLVERSION_GLES20
-        if (!convnet && isUsingEs31IfAvailable)
-            convnet = new GLES31X2UpsamplingNetwork(context, *gpu);
+            if (!convnet && isUsingEs31IfAvailable)
+                convnet = new GLES31X2UpsamplingNetwork(context, *gpu);
 #endif
-        if (!convnet)
-            convnet = new GLES20X2UpsamplingNetwork(*context.getGpuRecycleBin(), *gpu);
+            if (!convnet)
+                convnet = new GLES20X2UpsamplingNetwork(*context.getGpuRecycleBin(), *gpu);
+        }
     }
+    else if (mode == Mode::LINEAR || mode == Mode::CUBIC || mode == Mode::LANCZOS) {
+        if (SeparableResampler::isApplicable(*input, *output))
+            separable->prepare(mode, cubicParameter, *input, *output, srcRect, destRect, threadCount);
+        else {
+            separable->release();
+            if (mode == Mode::LANCZOS)
+                throw ImplementationUnsupported("Lanczos resampling of masks or bitmaps having different number of channels");
+        }
+    }
+
     lock(gpu, target, input, output);
 }
 
 
 void BitmapResampler::afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted) {
     unlock(input, output);
+    separable->release();
+    if (cpuConvnet)
+        cpuConvnet->release();
 }
 
 
@@ -144,6 +179,8 @@ bool BitmapResampler::process(TaskThread& thread) {
             break;
 
         case Mode::BOX:
+            if (SimdKernels::boxResampling(*input, *output, srcRect, destRect, thread))
+                break;
             BitmapProcessing::pipeline<Kernels::BoxResampling>(
                 *input, *output,
                 srcRect, destRect, thread
@@ -151,6 +188,10 @@ bool BitmapResampler::process(TaskThread& thread) {
             break;
 
         case Mode::LINEAR:
+            if (separable->isReady()) {
+                separable->process(*input, *output, thread);
+                break;
+            }
             BitmapProcessing::pipeline<Kernels::BilinearResampling>(
                 *input, *output,
                 srcRect, destRect, thread
@@ -158,13 +199,24 @@ bool BitmapResampler::process(TaskThread& thread) {
             break;
 
         case Mode::CUBIC:
+            if (separable->isReady()) {
+                separable->process(*input, *output, thread);
+                break;
+            }
             BitmapProcessing::pipeline<Kernels::BicubicResampling>(
                 *input, *output,
                 srcRect, destRect, cubicParameter, thread
             );
             break;
 
+        case Mode::LANCZOS:
+            separable->process(*input, *output, thread);
+            break;
+
         case Mode::CONVNET:
+            // when running on GPU, the network is only run by processOnGPU() in a single thread
+            if (cpuConvnet && cpuConvnet->isReady())
+                cpuConvnet->process(*input, *output, thread);
             break;
 
         default:
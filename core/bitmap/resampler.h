@@ -24,6 +24,8 @@
 namespace Beatmup {
 
     class X2UpsamplingNetwork;
+    class CpuX2UpsamplingNetwork;
+    class SeparableResampler;
 
     /**
         Resamples an image to a given resolution.
@@ -40,7 +42,8 @@ namespace Beatmup {
             BOX,                 //!< "0.5-order": anti-aliasing box filter; identical to nearest neighbor when upsampling
             LINEAR,              //!< first order: bilinear interpolation
             CUBIC,               //!< third order: bicubic interpolation
-            CONVNET              //!< upsampling x2 using a convolutional neural network
+            CONVNET,             //!< upsampling x2 using a convolutional neural network
+            LANCZOS              //!< Lanczos filter of order 3; antialiasing when downsampling
         };
     private:
         Context& context;                  //!< a context managing intermediate bitmaps
@@ -49,7 +52,10 @@ namespace Beatmup {
         Mode mode;
         float cubicParameter;
         X2UpsamplingNetwork* convnet;      //!< convnet instance
+        CpuX2UpsamplingNetwork* cpuConvnet;    //!< convnet instance running on CPU
+        SeparableResampler* separable;     //!< separable resampling implementation; used in bilinear, bicubic and Lanczos modes
         bool isUsingEs31IfAvailable;       //!< if `true`, uses OpenGL ES 3.1 backend when available instead ES 2.0
+        bool isUsingGpuIfAvailable;        //!< if `false`, the convnet runs on CPU even if GPU is available
 
     protected:
         virtual TaskDeviceRequirement getUsedDevices() const;
@@ -115,6 +121,13 @@ namespace Beatmup {
         */
         inline void setUsingEs31IfAvailable(bool useEs31) { isUsingEs31IfAvailable = useEs31; }
 
+        /**
+            Defines the device running the neural network-based resampling.
+            When GPU is not available or not used, the network is run on CPU. Its output then differs from the one obtained on GPU by rounding.
+            \param[in] useGpu    If `true`, GPU will be used when available, otherwise the network runs on CPU.
+        */
+        inline void setUsingGpuIfAvailable(bool useGpu) { isUsingGpuIfAvailable = useGpu; }
+
         /**
             Specifies a rectangular working area in the input bitmap.
             Pixels outside of this area are not used.
@@ -0,0 +1,463 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cnn.h"
+#include "../../simd_kernels.h"
+#include "../../../exception.h"
+#include "../../../utils/utils.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+using namespace Beatmup;
+
+
+namespace Kernels {
+    /**
+        Extracts numeric vec4 and mat4 constants following the main() function declaration in a shader source code, in order of appearance.
+        Constructors having non-numeric arguments are skipped.
+    */
+    static std::vector<float> parseShaderConstants(const char* code) {
+        std::vector<float> result, values;
+        const char* ptr = std::strstr(code, "main()");
+        RuntimeError::check(ptr != nullptr, "Cannot find main() in a network shader");
+        while (true) {
+            const char* vec = std::strstr(ptr, "vec4(");
+            const char* mat = std::strstr(ptr, "mat4(");
+            if (!vec && !mat)
+                break;
+            ptr = (vec && (!mat || vec < mat) ? vec : mat) + 5;
+            values.clear();
+            while (true) {
+                char* end;
+                const float value = std::strtof(ptr, &end);
+                if (end == ptr)
+                    break;
+                values.push_back(value);
+                for (ptr = end; *ptr == ' '; ++ptr);
+                if (*ptr == ')') {
+                    result.insert(result.end(), values.begin(), values.end());
+                    break;
+                }
+                if (*ptr != ',')
+                    break;
+                ++ptr;
+            }
+        }
+        return result;
+    }
+
+
+    /**
+        Convolution of planar feature maps; generic version of SimdKernels::convolve()
+    */
+    static void convolve(
+        const float* input, int inputStride, msize inputPlaneStride, int numInputs,
+        float* output, int outputStride, msize outputPlaneStride, int numOutputs,
+        int width, int height, int kernelSize, const float* weights, const float* bias
+    ) {
+        const int kernelStride = numInputs * kernelSize * kernelSize;
+        for (int o = 0; o < numOutputs; ++o)
+            for (int y = 0; y < height; ++y)
+                for (int x = 0; x < width; ++x) {
+                    const float* w = weights + o * kernelStride;
+                    float acc = bias[o];
+                    for (int i = 0; i < numInputs; ++i) {
+                        const float* in = input + i * inputPlaneStride + y * inputStride + x;
+                        for (int v = 0; v < kernelSize; ++v, in += inputStride)
+                            for (int u = 0; u < kernelSize; ++u, ++w)
+                                acc += in[u] * *w;
+                    }
+                    output[o * outputPlaneStride + y * outputStride + x] = acc;
+                }
+    }
+
+
+    /**
+        Clamps feature maps values to [0, 1] and rounds them to 8 bits, as done when storing them in textures on GPU
+    */
+    static void quantize(float* maps, int stride, msize planeSize, int numMaps, int width, int height) {
+        for (int m = 0; m < numMaps; ++m)
+            for (int y = 0; y < height; ++y) {
+                float* row = maps + m * planeSize + y * stride;
+                for (int x = 0; x < width; ++x)
+                    row[x] = roundf_fast(std::max(0.0f, std::min(row[x], 1.0f)) * 255) / 255.0f;
+            }
+    }
+
+
+    /**
+        Fills a frame around an area of feature maps by replicating the area boundary pixels
+        \param[in,out] maps         The feature maps starting at the frame top-left corner
+        \param[in] stride           Distance between consecutive rows of a feature map
+        \param[in] planeSize        Distance between consecutive feature maps
+        \param[in] numMaps          Number of feature maps
+        \param[in] frame            The frame to fill
+        \param[in] area             The area having computed values within the frame
+    */
+    static void clampToEdge(float* maps, int stride, msize planeSize, int numMaps, const IntRectangle& frame, const IntRectangle& area) {
+        const int
+            left = area.a.x - frame.a.x,
+            right = area.b.x - frame.a.x,
+            top = area.a.y - frame.a.y,
+            bottom = area.b.y - frame.a.y,
+            width = frame.width();
+        for (int m = 0; m < numMaps; ++m) {
+            float* plane = maps + m * planeSize;
+            for (int y = top; y < bottom; ++y) {
+                float* row = plane + y * stride;
+                std::fill(row, row + left, row[left]);
+                std::fill(row + right, row + width, row[right - 1]);
+            }
+            for (int y = 0; y < top; ++y)
+                memcpy(plane + y * stride, plane + top * stride, width * sizeof(float));
+            for (int y = bottom; y < frame.height(); ++y)
+                memcpy(plane + y * stride, plane + (bottom - 1) * stride, width * sizeof(float));
+        }
+    }
+
+
+    /**
+        Computes the luma of input pixels in an area, clamping coordinates to the bitmap boundaries
+    */
+    template<typename pixel> static void loadLuma(const AbstractBitmap& input, const IntRectangle& area, float* output, int stride) {
+        const float scale = std::is_same<pixel, pixbyte>::value ? 1.0f / 255 : 1.0f;
+        const int numChannels = input.getNumberOfChannels(), width = input.getWidth(), height = input.getHeight();
+        for (int y = area.a.y; y < area.b.y; ++y, output += stride) {
+            const pixel* row = (const pixel*)input.getData(0, std::max(0, std::min(y, height - 1)));
+            for (int x = area.a.x; x < area.b.x; ++x) {
+                const pixel* px = row + numChannels * std::max(0, std::min(x, width - 1));
+                output[x - area.a.x] = scale * (0.299f * px[0] + 0.587f * px[1] + 0.114f * px[2]);
+            }
+        }
+    }
+
+
+    /**
+        Computes the chroma components of input pixels in an area, clamping coordinates to the bitmap boundaries
+    */
+    template<typename pixel> static void loadChroma(const AbstractBitmap& input, const IntRectangle& area, float* cb, float* cr, int stride) {
+        const float scale = std::is_same<pixel, pixbyte>::value ? 1.0f / 255 : 1.0f;
+        const int numChannels = input.getNumberOfChannels(), width = input.getWidth(), height = input.getHeight();
+        for (int y = area.a.y; y < area.b.y; ++y, cb += stride, cr += stride) {
+            const pixel* row = (const pixel*)input.getData(0, std::max(0, std::min(y, height - 1)));
+            for (int x = area.a.x; x < area.b.x; ++x) {
+                const pixel* px = row + numChannels * std::max(0, std::min(x, width - 1));
+                cb[x - area.a.x] = scale * (-0.168736f * px[0] - 0.331264f * px[1] + 0.5f * px[2]);
+                cr[x - area.a.x] = scale * (0.5f * px[0] - 0.418688f * px[1] - 0.081312f * px[2]);
+            }
+        }
+    }
+
+
+    /**
+        Combines the upsampled luma with the bilinearly upsampled chroma and writes out the resulting pixels
+        \param[out] output      The output bitmap
+        \param[in] tile         The tile in input pixel coordinates
+        \param[in] luma         Four upsampled luma maps for the tile, one per output pixel position in a 2x2 block
+        \param[in] cb           Cb component of input pixels in the tile with a margin of 1 pixel
+        \param[in] cr           Cr component of input pixels in the tile with a margin of 1 pixel
+        \param[in] stride       Distance between consecutive rows of the maps
+        \param[in] planeSize    Distance between consecutive luma maps
+    */
+    template<typename pixel> static void demux(AbstractBitmap& output, const IntRectangle& tile,
+        const float* luma, const float* cb, const float* cr, int stride, msize planeSize)
+    {
+        const bool isFloat = std::is_same<pixel, pixfloat>::value;
+        const int numChannels = output.getNumberOfChannels();
+        auto store = [isFloat](float value) {
+            return isFloat ? (pixel)value : (pixel)roundf_fast(std::max(0.0f, std::min(value, 1.0f)) * 255);
+        };
+
+        for (int y = 0; y < tile.height(); ++y)
+            for (int dy = 0; dy < 2; ++dy) {
+                // the output pixel center is a quarter of input pixel away from the input pixel center
+                const float wy = dy ? 0.75f : 0.25f;
+                const int row0 = (y + dy) * stride, row1 = (y + dy + 1) * stride;
+                pixel* out = (pixel*)output.getData(2 * tile.a.x, 2 * (tile.a.y + y) + dy);
+                for (int x = 0; x < tile.width(); ++x)
+                    for (int dx = 0; dx < 2; ++dx, out += numChannels) {
+                        const float wx = dx ? 0.75f : 0.25f;
+                        const int col0 = x + dx, col1 = x + dx + 1;
+                        const float
+                            y_ = luma[(2 * dy + dx) * planeSize + y * stride + x],
+                            cb_ = wy * (wx * cb[row0 + col0] + (1 - wx) * cb[row0 + col1]) + (1 - wy) * (wx * cb[row1 + col0] + (1 - wx) * cb[row1 + col1]),
+                            cr_ = wy * (wx * cr[row0 + col0] + (1 - wx) * cr[row0 + col1]) + (1 - wy) * (wx * cr[row1 + col0] + (1 - wx) * cr[row1 + col1]);
+                        out[0] = store(y_ + 1.402f * cr_);
+                        out[1] = store(y_ - 0.344136f * cb_ - 0.714136f * cr_);
+                        out[2] = store(y_ + 1.772f * cb_);
+                        if (numChannels == 4)
+                            out[3] = store(1.0f);
+                    }
+            }
+    }
+}
+
+
+void CpuX2UpsamplingNetwork::Layer::setup(int numInputs, int numOutputs, int numGroups, int kernelSize, const char* const shaders[]) {
+    this->numInputs = numInputs;
+    this->numOutputs = numOutputs;
+    this->numGroups = numGroups;
+    this->kernelSize = kernelSize;
+    const int
+        taps = kernelSize * kernelSize,
+        inputsPerGroup = numInputs / numGroups,
+        outputsPerGroup = numOutputs / numGroups,
+        shadersPerGroup = outputsPerGroup / 4;
+    weights.resize(numOutputs * inputsPerGroup * taps);
+    bias.resize(numOutputs);
+
+    // every shader computes 4 consecutive output feature maps
+    for (int n = 0; n < numGroups * shadersPerGroup; ++n) {
+        const std::vector<float> values = Kernels::parseShaderConstants(shaders[n]);
+        const int firstOutput = 4 * n;
+        float* w = weights.data() + firstOutput * inputsPerGroup * taps;
+        for (int j = 0; j < 4; ++j)
+            bias[firstOutput + j] = values[j];
+
+        // vec4 * mat4 multiplication sums a column of the matrix multiplied by the vector
+        if (inputsPerGroup == 1) {
+            // single input: the vectors contain four consecutive taps, the remaining taps come as a vec4 multiplied by a scalar
+            const int numMatrices = taps / 4;
+            RuntimeError::check(values.size() == (size_t)(4 + 16 * numMatrices + 4 * (taps % 4)), "Unexpected network shader constants count");
+            for (int j = 0; j < 4; ++j) {
+                for (int t = 0; t < 4 * numMatrices; ++t)
+                    w[j * taps + t] = values[4 + 16 * (t / 4) + 4 * j + t % 4];
+                for (int t = 4 * numMatrices; t < taps; ++t)
+                    w[j * taps + t] = values[4 + 16 * numMatrices + 4 * (t - 4 * numMatrices) + j];
+            }
+        }
+        else {
+            // multiple inputs: the vectors contain four consecutive inputs, the matrices come per input texture and per tap
+            RuntimeError::check(values.size() == (size_t)(4 + 16 * (inputsPerGroup / 4) * taps), "Unexpected network shader constants count");
+            for (int j = 0; j < 4; ++j)
+                for (int i = 0; i < inputsPerGroup; ++i)
+                    for (int t = 0; t < taps; ++t)
+                        w[(j * inputsPerGroup + i) * taps + t] = values[4 + 16 * ((i / 4) * taps + t) + 4 * j + i % 4];
+        }
+    }
+}
+
+
+CpuX2UpsamplingNetwork::CpuX2UpsamplingNetwork(): bufferSize(0) {
+#define STRINGIFY(...) #__VA_ARGS__
+    static const char* const LAYER1[] = {
+#include "../gles20/l1__0.glsl"
+        ,
+#include "../gles20/l1__1.glsl"
+        ,
+#include "../gles20/l1__2.glsl"
+        ,
+#include "../gles20/l1__3.glsl"
+        ,
+#include "../gles20/l1__4.glsl"
+        ,
+#include "../gles20/l1__5.glsl"
+        ,
+#include "../gles20/l1__6.glsl"
+        ,
+#include "../gles20/l1__7.glsl"
+        ,
+#include "../gles20/l1__8.glsl"
+        ,
+#include "../gles20/l1__9.glsl"
+        ,
+#include "../gles20/l1__10.glsl"
+        ,
+#include "../gles20/l1__11.glsl"
+    };
+
+    static const char* const LAYER2[] = {
+#include "../gles20/l2-0__0.glsl"
+        ,
+#include "../gles20/l2-0__1.glsl"
+        ,
+#include "../gles20/l2-1__0.glsl"
+        ,
+#include "../gles20/l2-1__1.glsl"
+        ,
+#include "../gles20/l2-2__0.glsl"
+        ,
+#include "../gles20/l2-2__1.glsl"
+        ,
+#include "../gles20/l2-3__0.glsl"
+        ,
+#include "../gles20/l2-3__1.glsl"
+    };
+
+    static const char* const LAYER3[] = {
+#include "../gles20/l3__0.glsl"
+        ,
+#include "../gles20/l3__1.glsl"
+        ,
+#include "../gles20/l3__2.glsl"
+        ,
+#include "../gles20/l3__3.glsl"
+        ,
+#include "../gles20/l3__4.glsl"
+        ,
+#include "../gles20/l3__5.glsl"
+    };
+
+    static const char* const LAYER4[] = {
+#include "../gles20/l4-0__0.glsl"
+        ,
+#include "../gles20/l4-0__1.glsl"
+        ,
+#include "../gles20/l4-1__0.glsl"
+        ,
+#include "../gles20/l4-1__1.glsl"
+    };
+
+    static const char* const LAYER5[] = {
+#include "../gles20/l5.glsl"
+    };
+#undef STRINGIFY
+
+    layers[0].setup(1, 48, 1, 5, LAYER1);
+    layers[1].setup(48, 32, 4, 3, LAYER2);
+    layers[2].setup(32, 24, 1, 1, LAYER3);
+    layers[3].setup(24, 16, 2, 3, LAYER4);
+    layers[4].setup(16, 4, 1, 1, LAYER5);
+
+    // margins around the tile required by the following layers
+    margins[NUM_LAYERS] = 0;
+    for (int l = NUM_LAYERS - 1; l >= 0; --l)
+        margins[l] = margins[l + 1] + layers[l].kernelSize / 2;
+
+    // chroma is bilinearly interpolated: a margin of one pixel is needed
+    static const msize FLOATS_PER_CACHE_LINE = 64 / sizeof(float);
+    bufferStride = TILE_SIZE + 2 * std::max(1, margins[0]);
+    planeSize = ceili(bufferStride * bufferStride, FLOATS_PER_CACHE_LINE) * FLOATS_PER_CACHE_LINE;
+    numPlanes[0] = numPlanes[1] = 0;
+    for (int l = 0; l < NUM_LAYERS; ++l)
+        numPlanes[l % 2] = std::max(numPlanes[l % 2], layers[l].numOutputs);
+
+    // chroma is stored in the buffer not used by the last layer
+    numPlanes[NUM_LAYERS % 2] = std::max(numPlanes[NUM_LAYERS % 2], 2);
+}
+
+
+bool CpuX2UpsamplingNetwork::isApplicable(const AbstractBitmap& input, const AbstractBitmap& output) {
+    return !input.isMask() && !output.isMask() && input.getNumberOfChannels() >= 3 && output.getNumberOfChannels() >= 3;
+}
+
+
+int CpuX2UpsamplingNetwork::getTileCount(const AbstractBitmap& input) {
+    return ceili(input.getWidth(), TILE_SIZE) * ceili(input.getHeight(), TILE_SIZE);
+}
+
+
+void CpuX2UpsamplingNetwork::prepare(const AbstractBitmap& input, ThreadIndex threadCount) {
+    // input luma plane and two alternating feature maps buffers per thread
+    bufferSize = (1 + numPlanes[0] + numPlanes[1]) * planeSize;
+    buffers = AlignedMemory(threadCount * bufferSize * sizeof(float), input.getContext().getMemoryPool(), 64);
+}
+
+
+void CpuX2UpsamplingNetwork::processTile(const AbstractBitmap& input, AbstractBitmap& output, const IntRectangle& tile, float* buffer) const {
+    const IntRectangle image(0, 0, input.getWidth(), input.getHeight());
+    float* maps[2] = { buffer + planeSize, buffer + (1 + numPlanes[0]) * planeSize };
+
+    // position of a pixel in a buffer covering the tile with a given margin
+    auto offset = [&](int x, int y, int margin) {
+        return (y - tile.a.y + margin) * bufferStride + (x - tile.a.x + margin);
+    };
+
+    // compute input luma
+    IntRectangle frame(tile);
+    frame.grow(margins[0]);
+    if (input.isFloat())
+        Kernels::loadLuma<pixfloat>(input, frame, buffer, bufferStride);
+    else
+        Kernels::loadLuma<pixbyte>(input, frame, buffer, bufferStride);
+
+    // run layers
+    const float* layerInput = buffer;
+    for (int l = 0; l < NUM_LAYERS; ++l) {
+        const Layer& layer = layers[l];
+        float* layerOutput = maps[l % 2];
+        const int
+            halfKernel = layer.kernelSize / 2,
+            inputsPerGroup = layer.numInputs / layer.numGroups,
+            outputsPerGroup = layer.numOutputs / layer.numGroups;
+        const msize kernelsPerGroup = outputsPerGroup * inputsPerGroup * layer.kernelSize * layer.kernelSize;
+
+        // compute the output within the image
+        frame = tile;
+        frame.grow(margins[l + 1]);
+        IntRectangle area(frame);
+        area.limit(image);
+        for (int g = 0; g < layer.numGroups; ++g) {
+            const float* in = layerInput + g * inputsPerGroup * planeSize + offset(area.a.x - halfKernel, area.a.y - halfKernel, margins[l]);
+            float* out = layerOutput + g * outputsPerGroup * planeSize + offset(area.a.x, area.a.y, margins[l + 1]);
+            const float* weights = layer.weights.data() + g * kernelsPerGroup;
+            const float* bias = layer.bias.data() + g * outputsPerGroup;
+            if (!SimdKernels::convolve(in, bufferStride, planeSize, inputsPerGroup, out, bufferStride, planeSize, outputsPerGroup,
+                    area.width(), area.height(), layer.kernelSize, weights, bias))
+                Kernels::convolve(in, bufferStride, planeSize, inputsPerGroup, out, bufferStride, planeSize, outputsPerGroup,
+                    area.width(), area.height(), layer.kernelSize, weights, bias);
+        }
+        Kernels::quantize(layerOutput + offset(area.a.x, area.a.y, margins[l + 1]), bufferStride, planeSize, layer.numOutputs,
+            area.width(), area.height());
+
+        // replicate the boundary values outside of the image
+        if (area != frame)
+            Kernels::clampToEdge(layerOutput, bufferStride, planeSize, layer.numOutputs, frame, area);
+
+        layerInput = layerOutput;
+    }
+
+    // compute chroma in the buffer not used by the last layer
+    float* cb = maps[NUM_LAYERS % 2];
+    float* cr = cb + planeSize;
+    frame = tile;
+    frame.grow(1);
+    if (input.isFloat())
+        Kernels::loadChroma<pixfloat>(input, frame, cb, cr, bufferStride);
+    else
+        Kernels::loadChroma<pixbyte>(input, frame, cb, cr, bufferStride);
+
+    // write out
+    if (output.isFloat())
+        Kernels::demux<pixfloat>(output, tile, layerInput, cb, cr, bufferStride, planeSize);
+    else
+        Kernels::demux<pixbyte>(output, tile, layerInput, cb, cr, bufferStride, planeSize);
+}
+
+
+void CpuX2UpsamplingNetwork::process(const AbstractBitmap& input, AbstractBitmap& output, TaskThread& thread) {
+    float* buffer = buffers.ptr<float>(thread.currentThread() * bufferSize);
+    const int numTilesX = ceili(input.getWidth(), TILE_SIZE);
+    msize start, stop;
+    while (thread.nextChunk(getTileCount(input), 1, start, stop))
+        for (msize i = start; i < stop; ++i) {
+            if (thread.isTaskAborted())
+                return;
+            const int x = (int)(i % numTilesX) * TILE_SIZE, y = (int)(i / numTilesX) * TILE_SIZE;
+            IntRectangle tile(x, y, x + TILE_SIZE, y + TILE_SIZE);
+            tile.limit(IntRectangle(0, 0, input.getWidth(), input.getHeight()));
+            processTile(input, output, tile, buffer);
+        }
+}
+
+
+void CpuX2UpsamplingNetwork::release() {
+    buffers.free();
+}
@@ -0,0 +1,112 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "../../abstract_bitmap.h"
+#include "../../../geometry.h"
+#include "../../../memory.h"
+#include "../../../parallelism.h"
+#include <vector>
+
+namespace Beatmup {
+
+    /**
+        x2 image upsampler using a convolutional neural network on CPU.
+        Runs the network of GLES20X2UpsamplingNetwork with the same weights, parsed from its shaders. The intermediate feature maps are
+        clamped to [0, 1] and rounded to 8 bits, and the borders are handled by clamping to edge, as done on GPU, so that the output only
+        differs from the GPU one by rounding.
+        The image is split into square tiles distributed among threads. Every tile goes through the entire network at once: each layer is
+        computed in a margin around the tile as required by the following layers, so that the feature maps of a tile stay in cache.
+        Used by BitmapResampler. Only usable inside an AbstractTask, not intended to be directly used by the application.
+    */
+    class CpuX2UpsamplingNetwork {
+    private:
+        /**
+            Convolutional layer made of one or more groups of the same size
+        */
+        struct Layer {
+            int numInputs, numOutputs;          //!< total number of input and output feature maps
+            int numGroups;                      //!< number of groups; every group maps a slice of inputs to a slice of outputs
+            int kernelSize;                     //!< kernel size in pixels
+            std::vector<float> weights;         //!< kernels of all groups, in the order expected by SimdKernels::convolve()
+            std::vector<float> bias;            //!< biases of all output feature maps
+
+            /**
+                Sets up the layer taking the weights from GLES 2.0 shaders of the network.
+                \param[in] numInputs       Number of input feature maps
+                \param[in] numOutputs      Number of output feature maps
+                \param[in] numGroups       Number of groups
+                \param[in] kernelSize      Kernel size in pixels
+                \param[in] shaders         Source code of shaders computing the layer output, four feature maps per shader
+            */
+            void setup(int numInputs, int numOutputs, int numGroups, int kernelSize, const char* const shaders[]);
+        };
+
+        static const int NUM_LAYERS = 5;
+        static const int TILE_SIZE = 32;        //!< tile size in input pixels
+
+        Layer layers[NUM_LAYERS];
+        int margins[NUM_LAYERS + 1];            //!< margin around the tile in which the input luma and every layer output are computed
+        int bufferStride;                       //!< distance between consecutive rows of a feature map in scratch buffers, in floats
+        msize planeSize;                        //!< size of a feature map in scratch buffers, in floats
+        int numPlanes[2];                       //!< max number of feature maps in each of two buffers alternately used by layers
+        msize bufferSize;                       //!< scratch buffer size per thread in floats
+        AlignedMemory buffers;                  //!< scratch buffers of all threads
+
+        void processTile(const AbstractBitmap& input, AbstractBitmap& output, const IntRectangle& tile, float* buffer) const;
+
+    public:
+        /**
+            Sets up the network weights.
+        */
+        CpuX2UpsamplingNetwork();
+
+        /**
+            \return `true` if the upsampling can be applied to given bitmaps.
+        */
+        static bool isApplicable(const AbstractBitmap& input, const AbstractBitmap& output);
+
+        /**
+            \return the number of tiles to process for a given input bitmap.
+        */
+        static int getTileCount(const AbstractBitmap& input);
+
+        /**
+            Allocates scratch buffers. To be called before the processing.
+            \param[in] input            Input bitmap
+            \param[in] threadCount      Number of threads
+        */
+        void prepare(const AbstractBitmap& input, ThreadIndex threadCount);
+
+        /**
+            Upsamples the input bitmap to the output bitmap. Called by every thread running the task.
+        */
+        void process(const AbstractBitmap& input, AbstractBitmap& output, TaskThread& thread);
+
+        /**
+            Frees the scratch buffers.
+        */
+        void release();
+
+        /**
+            \return `true` if prepared and not released yet.
+        */
+        inline bool isReady() const { return (bool)buffers; }
+    };
+
+}
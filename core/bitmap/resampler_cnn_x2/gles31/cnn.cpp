@@ -17,6 +17,8 @@
 */
 
 #include "cnn.h"
+#include "../../../gpu/program_cache.h"
+#include "../../../gpu/recycle_bin.h"
 #include <algorithm>
 
 #ifdef ENABLE_PROFILING
@@ -56,7 +58,7 @@ void Beatmup::GLES31X2UpsamplingNetwork::Layer::prepare(GraphicPipeline& gpu, GL
 
         code +=  "layout(local_size_x = " + std::to_string(wgSize[0]) + ", local_size_y = " + std::to_string(wgSize[1]) + ", local_size_z = " + std::to_string(wgSize[2]) + ") in;\n";
 
-        program->make(gpu, code + sourceCodeTemplate);
+        program->make(gpu, code + sourceCodeTemplate, recycleBin.getContext().getProgramCache());
         prepared = true;
     }
 
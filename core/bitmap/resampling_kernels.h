@@ -25,13 +25,21 @@ using namespace Beatmup;
 
 namespace Kernels {
 
+    /**
+        Number of destination rows processed at once by a thread
+    */
+    inline msize getChunkHeight(int dstWidth) {
+        static const int CHUNK_PIXEL_COUNT = 8192;
+        return (msize)std::max(1, CHUNK_PIXEL_COUNT / std::max(1, dstWidth));
+    }
+
     template<class in_t, class out_t> class NearestNeighborResampling {
     public:
 
         /**
             Resamples a rectangle from an input bitmap to a rectangle in an output bitmap by nearest neighbor interpolation
         */
-        static void process(AbstractBitmap& input, AbstractBitmap& output, IntRectangle& src, IntRectangle& dst, const TaskThread& tt) {
+        static void process(AbstractBitmap& input, AbstractBitmap& output, IntRectangle& src, IntRectangle& dst, TaskThread& tt) {
             in_t in(input);
             out_t out(output);
 
@@ -41,24 +49,23 @@ namespace Kernels {
                 shiftX = srcW / 2,
                 shiftY = srcH / 2;
 
-            // dest image slice to process in the current thread
-            const int
-              sliceStart = tt.currentThread()       * dstH / tt.numThreads(),
-              sliceStop  = (tt.currentThread() + 1) * dstH / tt.numThreads();
-
-            for (int y = sliceStart; y < sliceStop; ++y) {
-                out.goTo(dst.a.x, dst.a.y + y);
-                const int sy = src.a.y + (y * srcH + shiftY) / dstH;
-
-                for (int x = 0; x < dstW; ++x) {
-                    const int sx = src.a.x + (x * srcW + shiftX) / dstW;
-                    in.goTo(sx, sy);
-                    out = in();
-                    out++;
-                }
+            // dest image rows are processed by chunks handed out by the thread pool
+            msize sliceStart, sliceStop;
+            while (tt.nextChunk(dstH, getChunkHeight(dstW), sliceStart, sliceStop)) {
+                for (int y = (int)sliceStart; y < (int)sliceStop; ++y) {
+                    out.goTo(dst.a.x, dst.a.y + y);
+                    const int sy = src.a.y + (y * srcH + shiftY) / dstH;
+
+                    for (int x = 0; x < dstW; ++x) {
+                        const int sx = src.a.x + (x * srcW + shiftX) / dstW;
+                        in.goTo(sx, sy);
+                        out = in();
+                        out++;
+                    }
 
-                if (tt.isTaskAborted())
-                    return;
+                    if (tt.isTaskAborted())
+                        return;
+                }
             }
         }
     };
@@ -70,7 +77,7 @@ namespace Kernels {
         /**
             Resamples a rectangle from an input bitmap to a rectangle in an output bitmap applying a box filter
         */
-        static void process(AbstractBitmap& input, AbstractBitmap& output, IntRectangle& src, IntRectangle& dst, const TaskThread& tt) {
+        static void process(AbstractBitmap& input, AbstractBitmap& output, IntRectangle& src, IntRectangle& dst, TaskThread& tt) {
             in_t in(input);
             out_t out(output);
 
@@ -78,42 +85,42 @@ namespace Kernels {
                 srcW = src.width(), srcH = src.height(),
                 dstW = dst.width(), dstH = dst.height();
 
-            // dest image slice to process in the current thread
-            const int
-              sliceStart = tt.currentThread()       * dstH / tt.numThreads(),
-              sliceStop  = (tt.currentThread() + 1) * dstH / tt.numThreads();
-
-            int x0, y0, x1, y1 = src.a.y + (sliceStart) * srcH / dstH;    // coordinates of source pixels box mapped to a given dest pixel
+            int x0, y0, x1, y1;     // coordinates of source pixels box mapped to a given dest pixel
 
             typename in_t::pixtype acc;
-            for (int y = sliceStart; y < sliceStop; ++y) {
-                out.goTo(dst.a.x, dst.a.y + y);
-                y0 = y1;
-                y1 = src.a.y + (y + 1) * srcH / dstH;
-                x1 = src.a.x;
-                for (int x = 0; x < dstW; ++x) {
-                    x0 = x1;
-                    x1 = src.a.x + (x + 1) * srcW / dstW;
-
-                    // loop over the source area
-                    acc.zero();
-                    int y = y0;
-                    do {
-                        in.goTo(x0, y);
-                        int x = x0;
+            // dest image rows are processed by chunks handed out by the thread pool
+            msize sliceStart, sliceStop;
+            while (tt.nextChunk(dstH, getChunkHeight(dstW), sliceStart, sliceStop)) {
+                y1 = src.a.y + (int)sliceStart * srcH / dstH;
+                for (int y = (int)sliceStart; y < (int)sliceStop; ++y) {
+                    out.goTo(dst.a.x, dst.a.y + y);
+                    y0 = y1;
+                    y1 = src.a.y + (y + 1) * srcH / dstH;
+                    x1 = src.a.x;
+                    for (int x = 0; x < dstW; ++x) {
+                        x0 = x1;
+                        x1 = src.a.x + (x + 1) * srcW / dstW;
+
+                        // loop over the source area
+                        acc.zero();
+                        int y = y0;
                         do {
-                            acc = acc + in();
-                            in++;
-                        } while (++x < x1);
-                    } while (++y < y1);
+                            in.goTo(x0, y);
+                            int x = x0;
+                            do {
+                                acc = acc + in();
+                                in++;
+                            } while (++x < x1);
+                        } while (++y < y1);
+
+                        // write out
+                        out = acc / std::max(1, (x1 - x0)*(y1 - y0));
+                        out++;
+                    }
 
-                    // write out
-                    out = acc / std::max(1, (x1 - x0)*(y1 - y0));
-                    out++;
+                    if (tt.isTaskAborted())
+                        return;
                 }
-
-                if (tt.isTaskAborted())
-                    return;
             }
         }
     };
@@ -125,7 +132,7 @@ namespace Kernels {
         /**
             Resamples a rectangle from an input bitmap to a rectangle in an output bitmap by bilinear interpolation
         */
-        static void process(AbstractBitmap& input, AbstractBitmap& output, IntRectangle& src, IntRectangle& dst, const TaskThread& tt) {
+        static void process(AbstractBitmap& input, AbstractBitmap& output, IntRectangle& src, IntRectangle& dst, TaskThread& tt) {
             in_t in(input);
             out_t out(output);
 
@@ -135,52 +142,51 @@ namespace Kernels {
                 shiftX = (srcW - dstW) / 2,
                 shiftY = (srcH - dstH) / 2;
 
-            // dest image slice to process in the current thread
-            const int
-              sliceStart = tt.currentThread()       * dstH / tt.numThreads(),
-              sliceStop  = (tt.currentThread() + 1) * dstH / tt.numThreads();
-
-            for (int y = sliceStart; y < sliceStop; ++y) {
-                out.goTo(dst.a.x, dst.a.y + y);
-                const float fsy = (float)(y * srcH + shiftY) / dstH;
-                const int   isy = (int)fsy;
-                const float fy = fsy - (float)isy, _fy = 1 - fy;
-                const int   sy = src.a.y + isy;
-
-                const int
-                    lineJump = sy < srcH - 1 ? srcW - 1 : -1,
-                    xBound = srcW - 1;
-
-                typename out_t::pixtype acc;
-                for (int x = 0; x < dstW; ++x) {
-
-                    const float fsx = (float)(x * srcW + shiftX) / dstW;
-                    const int   isx = (int)fsx;
-                    const float fx = fsx - (float)isx;
-                    const int   sx = src.a.x + isx;
-
-                    in.goTo(sx, sy);
-                    if (sx < xBound) {
-                        acc = in() * (1 - fx) * _fy;
-                        in++;
-                        acc = acc + in() * fx * _fy;
-                        in += lineJump;
-                        acc = acc + in() * (1 - fx) * fy;
-                        in++;
-                        acc = acc + in() * fx * fy;
-                    }
-                    else {
-                        acc = in() * _fy;
-                        in += lineJump + 1;
-                        acc = acc + in() * fy;
+            // dest image rows are processed by chunks handed out by the thread pool
+            msize sliceStart, sliceStop;
+            while (tt.nextChunk(dstH, getChunkHeight(dstW), sliceStart, sliceStop)) {
+                for (int y = (int)sliceStart; y < (int)sliceStop; ++y) {
+                    out.goTo(dst.a.x, dst.a.y + y);
+                    const float fsy = (float)(y * srcH + shiftY) / dstH;
+                    const int   isy = (int)fsy;
+                    const float fy = fsy - (float)isy, _fy = 1 - fy;
+                    const int   sy = src.a.y + isy;
+
+                    const int
+                        nextRow = sy < srcH - 1 ? sy + 1 : sy,
+                        xBound = srcW - 1;
+
+                    typename out_t::pixtype acc;
+                    for (int x = 0; x < dstW; ++x) {
+
+                        const float fsx = (float)(x * srcW + shiftX) / dstW;
+                        const int   isx = (int)fsx;
+                        const float fx = fsx - (float)isx;
+                        const int   sx = src.a.x + isx;
+
+                        in.goTo(sx, sy);
+                        if (sx < xBound) {
+                            acc = in() * (1 - fx) * _fy;
+                            in++;
+                            acc = acc + in() * fx * _fy;
+                            in.goTo(sx, nextRow);
+                            acc = acc + in() * (1 - fx) * fy;
+                            in++;
+                            acc = acc + in() * fx * fy;
+                        }
+                        else {
+                            acc = in() * _fy;
+                            in.goTo(sx, nextRow);
+                            acc = acc + in() * fy;
+                        }
+
+                        out = acc;
+                        out++;
                     }
 
-                    out = acc;
-                    out++;
+                    if (tt.isTaskAborted())
+                        return;
                 }
-
-                if (tt.isTaskAborted())
-                    return;
             }
         }
     };
@@ -229,7 +235,7 @@ namespace Kernels {
         /**
             Resamples a rectangle from an input bitmap to a rectangle in an output bitmap applying a bicubic kernel
         */
-        static void process(AbstractBitmap& input, AbstractBitmap& output, IntRectangle& src, IntRectangle& dst, const float alpha, const TaskThread& tt) {
+        static void process(AbstractBitmap& input, AbstractBitmap& output, IntRectangle& src, IntRectangle& dst, const float alpha, TaskThread& tt) {
             in_t in(input);
             out_t out(output);
 
@@ -239,60 +245,56 @@ namespace Kernels {
                 shiftX = (srcW - dstW) / 2,
                 shiftY = (srcH - dstH) / 2;
 
-            // dest image slice to process in the current thread
-            const int
-              sliceStart = tt.currentThread()       * dstH / tt.numThreads(),
-              sliceStop  = (tt.currentThread() + 1) * dstH / tt.numThreads();
-
             BicubicKernel kx(alpha), ky(alpha);
 
-            for (int y = sliceStart; y < sliceStop; ++y) {
-                out.goTo(dst.a.x, dst.a.y + y);
-                const float fsy = (float)(y * srcH + shiftY) / dstH;
-                const int   isy = (int)fsy;
-                const float fy = fsy - (float)isy;
-                const int   sy = src.a.y + isy;
-
-                const int lineJump[3] = {
-                    sy > 0 ? srcW : 0,
-                    sy < srcH - 1 ? srcW : 0,
-                    sy < srcH - 2 ? srcW : 0
-                };
-
-                // preparing kernel
-                ky(fy);
-
-                typename out_t::pixtype acc;
-                for (int x = 0; x < dstW; ++x) {
-
-                    const float fsx = (float)(x * srcW + shiftX) / dstW;
-                    const int   isx = (int)fsx;
-                    const float fx = fsx - (float)isx;
-                    const int   sx = src.a.x + isx;
-
-                    kx(fx);
-
-                    const int pixJump[3] = {
-                        sx > 0        ? -1 : 0,
-                        sx < srcW - 1 ? +1 : 0,
-                        sx < srcW - 2 ? +2 : 0
-                    };
-
-                    in.goTo(sx, sy > 0 ? sy - 1 : 0);
-                    acc =       in[pixJump[0]] * kx[0] * ky[0] + in() * kx[1] * ky[0] + in[pixJump[1]] * kx[2] * ky[0] + in[pixJump[2]] * kx[3] * ky[0];
-                    in += lineJump[0];
-                    acc = acc + in[pixJump[0]] * kx[0] * ky[1] + in() * kx[1] * ky[1] + in[pixJump[1]] * kx[2] * ky[1] + in[pixJump[2]] * kx[3] * ky[1];
-                    in += lineJump[1];
-                    acc = acc + in[pixJump[0]] * kx[0] * ky[2] + in() * kx[1] * ky[2] + in[pixJump[1]] * kx[2] * ky[2] + in[pixJump[2]] * kx[3] * ky[2];
-                    in += lineJump[2];
-                    acc = acc + in[pixJump[0]] * kx[0] * ky[3] + in() * kx[1] * ky[3] + in[pixJump[1]] * kx[2] * ky[3] + in[pixJump[2]] * kx[3] * ky[3];
-
-                    out = acc;
-                    out++;
-                }
+            // dest image rows are processed by chunks handed out by the thread pool
+            msize sliceStart, sliceStop;
+            while (tt.nextChunk(dstH, getChunkHeight(dstW), sliceStart, sliceStop)) {
+                for (int y = (int)sliceStart; y < (int)sliceStop; ++y) {
+                    out.goTo(dst.a.x, dst.a.y + y);
+                    const float fsy = (float)(y * srcH + shiftY) / dstH;
+                    const int   isy = (int)fsy;
+                    const float fy = fsy - (float)isy;
+                    const int   sy = src.a.y + isy;
+
+                    const int row0 = sy > 0 ? sy - 1 : 0, row2 = sy < srcH - 1 ? sy + 1 : sy;
+                    const int rows[4] = { row0, sy, row2, sy < srcH - 2 ? row2 + 1 : row2 };
+
+                    // preparing kernel
+                    ky(fy);
+
+                    typename out_t::pixtype acc;
+                    for (int x = 0; x < dstW; ++x) {
+
+                        const float fsx = (float)(x * srcW + shiftX) / dstW;
+                        const int   isx = (int)fsx;
+                        const float fx = fsx - (float)isx;
+                        const int   sx = src.a.x + isx;
+
+                        kx(fx);
+
+                        const int pixJump[3] = {
+                            sx > 0        ? -1 : 0,
+                            sx < srcW - 1 ? +1 : 0,
+                            sx < srcW - 2 ? +2 : 0
+                        };
+
+                        in.goTo(sx, rows[0]);
+                        acc =       in[pixJump[0]] * kx[0] * ky[0] + in() * kx[1] * ky[0] + in[pixJump[1]] * kx[2] * ky[0] + in[pixJump[2]] * kx[3] * ky[0];
+                        in.goTo(sx, rows[1]);
+                        acc = acc + in[pixJump[0]] * kx[0] * ky[1] + in() * kx[1] * ky[1] + in[pixJump[1]] * kx[2] * ky[1] + in[pixJump[2]] * kx[3] * ky[1];
+                        in.goTo(sx, rows[2]);
+                        acc = acc + in[pixJump[0]] * kx[0] * ky[2] + in() * kx[1] * ky[2] + in[pixJump[1]] * kx[2] * ky[2] + in[pixJump[2]] * kx[3] * ky[2];
+                        in.goTo(sx, rows[3]);
+                        acc = acc + in[pixJump[0]] * kx[0] * ky[3] + in() * kx[1] * ky[3] + in[pixJump[1]] * kx[2] * ky[3] + in[pixJump[2]] * kx[3] * ky[3];
+
+                        out = acc;
+                        out++;
+                    }
 
-                if (tt.isTaskAborted())
-                    return;
+                    if (tt.isTaskAborted())
+                        return;
+                }
             }
         }
     };
@@ -0,0 +1,384 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "separable_resampler.h"
+#include "../exception.h"
+#include "../platform.h"
+#include "../utils/utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef BEATMUP_ARCH_X86_64
+#include <emmintrin.h>
+#endif
+
+using namespace Beatmup;
+
+
+namespace Kernels {
+    /*
+        Row operations on floating point values. On x86-64, they use SSE2 that is always available there.
+    */
+
+    /**
+        Converts a row of byte values into floating point values
+    */
+    inline void loadRow(const pixbyte* input, float* output, int length) {
+        int i = 0;
+#ifdef BEATMUP_ARCH_X86_64
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= length; i += 16) {
+            const __m128i bytes = _mm_loadu_si128((const __m128i*)(input + i));
+            const __m128i lo = _mm_unpacklo_epi8(bytes, zero), hi = _mm_unpackhi_epi8(bytes, zero);
+            _mm_storeu_ps(output + i,      _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+            _mm_storeu_ps(output + i + 4,  _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+            _mm_storeu_ps(output + i + 8,  _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+            _mm_storeu_ps(output + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+        }
+#endif
+        for (; i < length; ++i)
+            output[i] = input[i];
+    }
+
+    inline void loadRow(const pixfloat* input, float* output, int length) {
+        memcpy(output, input, length * sizeof(float));
+    }
+
+
+    /**
+        Converts a row of floating point values multiplied by a scale factor into bytes
+    */
+    inline void storeRow(const float* input, pixbyte* output, float scale, int length) {
+        int i = 0;
+#ifdef BEATMUP_ARCH_X86_64
+        // rounding half up as roundf_fast() does below: adding 0.5 and truncating, which only differs from flooring for negative values
+        // that are clamped to zero anyway
+        const __m128 factor = _mm_set1_ps(scale), half = _mm_set1_ps(0.5f);
+        auto convert = [&](int i) { return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(input + i), factor), half)); };
+        for (; i + 16 <= length; i += 16) {
+            const __m128i
+                lo = _mm_packs_epi32(convert(i), convert(i + 4)),
+                hi = _mm_packs_epi32(convert(i + 8), convert(i + 12));
+            _mm_storeu_si128((__m128i*)(output + i), _mm_packus_epi16(lo, hi));
+        }
+#endif
+        for (; i < length; ++i) {
+            const int value = (int)roundf_fast(input[i] * scale);
+            output[i] = value > 0 ? (value < 255 ? value : 255) : 0;
+        }
+    }
+
+    inline void storeRow(const float* input, pixfloat* output, float scale, int length) {
+        for (int i = 0; i < length; ++i)
+            output[i] = input[i] * scale;
+    }
+
+
+    /**
+        Computes output = input * weight, or output = output + input * weight if accumulating
+    */
+    inline void weightRow(float* output, const float* input, float weight, int length, bool accumulate) {
+        int i = 0;
+#ifdef BEATMUP_ARCH_X86_64
+        const __m128 w = _mm_set1_ps(weight);
+        if (accumulate)
+            for (; i + 4 <= length; i += 4)
+                _mm_storeu_ps(output + i, _mm_add_ps(_mm_loadu_ps(output + i), _mm_mul_ps(_mm_loadu_ps(input + i), w)));
+        else
+            for (; i + 4 <= length; i += 4)
+                _mm_storeu_ps(output + i, _mm_mul_ps(_mm_loadu_ps(input + i), w));
+#endif
+        if (accumulate)
+            for (; i < length; ++i)
+                output[i] += input[i] * weight;
+        else
+            for (; i < length; ++i)
+                output[i] = input[i] * weight;
+    }
+
+
+    /**
+        Applies the horizontal filter to a row of floating point pixels
+    */
+    template<const int channels> inline void filterRow(const float* input, float* output, const SeparableResampler::Weights& weights, int width) {
+        const int tapCount = weights.getTapCount();
+        for (int x = 0; x < width; ++x, output += channels) {
+            const float* w = weights.getWeights(x);
+            const float* pixel = input + weights.getFirst(x) * channels;
+            float acc[channels] = { 0 };
+            for (int k = 0; k < tapCount; ++k, pixel += channels)
+                for (int c = 0; c < channels; ++c)
+                    acc[c] += w[k] * pixel[c];
+            for (int c = 0; c < channels; ++c)
+                output[c] = acc[c];
+        }
+    }
+
+#ifdef BEATMUP_ARCH_X86_64
+    template<> inline void filterRow<4>(const float* input, float* output, const SeparableResampler::Weights& weights, int width) {
+        const int tapCount = weights.getTapCount();
+        for (int x = 0; x < width; ++x, output += 4) {
+            const float* w = weights.getWeights(x);
+            const float* pixel = input + weights.getFirst(x) * 4;
+            __m128 acc = _mm_mul_ps(_mm_set1_ps(w[0]), _mm_loadu_ps(pixel));
+            for (int k = 1; k < tapCount; ++k)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(pixel + 4 * k)));
+            _mm_storeu_ps(output, acc);
+        }
+    }
+#endif
+
+
+    /**
+        Resamples a rectangle from an input bitmap to a band of rows of a rectangle in an output bitmap
+    */
+    template<typename in_t, typename out_t, const int channels> void separableResampling(
+        const AbstractBitmap& input, AbstractBitmap& output, const IntRectangle& src, const IntRectangle& dst,
+        const SeparableResampler::Weights& horizontal, const SeparableResampler::Weights& vertical,
+        int firstRow, int lastRow, float* buffer, TaskThread& thread
+    ) {
+        static const int CHUNK_PIXEL_COUNT = 65536;
+        const int
+            srcWidth = src.width(), srcHeight = src.height(),
+            dstWidth = dst.width(), dstHeight = dst.height(),
+            bandHeight = lastRow - firstRow,
+            rowLength = dstWidth * channels,
+            ringSize = vertical.getTapCount();
+
+        // the intermediate values are kept in the input scale; the output scale is applied when storing
+        const float scale =
+            (std::is_same<in_t, pixbyte>::value ? 1 / 255.0f : 1.0f) *
+            (std::is_same<out_t, pixbyte>::value ? 255.0f : 1.0f);
+
+        float
+            *ring = buffer,
+            *accumulator = ring + ringSize * rowLength,
+            *inputRow = accumulator + rowLength;
+
+        // The horizontally resampled rows are kept in a ring buffer. The rows contributing to an output row are consecutive and there are
+        // ringSize of them, so that they never compete for the same slot.
+        std::vector<int> ringRows(ringSize, -1);
+
+        // Output rows are processed by chunks handed out by the thread pool. The chunks are big enough to make the horizontally resampled
+        // rows reused as much as possible, but there should be enough of them to keep all the threads busy.
+        const msize chunkHeight = (msize)std::max(1, std::min(
+            std::max(CHUNK_PIXEL_COUNT / dstWidth, 4 * ringSize * dstHeight / srcHeight),
+            ceili(bandHeight, thread.numThreads())
+        ));
+
+        msize start, stop;
+        while (thread.nextChunk(bandHeight, chunkHeight, start, stop)) {
+            for (int y = firstRow + (int)start; y < firstRow + (int)stop; ++y) {
+                const int first = vertical.getFirst(y);
+                const float* weights = vertical.getWeights(y);
+                for (int k = 0; k < ringSize; ++k) {
+                    const int row = first + k, slot = row % ringSize;
+                    float* ringRow = ring + slot * rowLength;
+
+                    // horizontal pass
+                    if (ringRows[slot] != row) {
+                        loadRow((const in_t*)input.getData(src.a.x, src.a.y + row), inputRow, srcWidth * channels);
+                        filterRow<channels>(inputRow, ringRow, horizontal, dstWidth);
+                        ringRows[slot] = row;
+                    }
+
+                    // vertical pass
+                    weightRow(accumulator, ringRow, weights[k], rowLength, k > 0);
+                }
+
+                storeRow(accumulator, (out_t*)output.getData(dst.a.x, dst.a.y + y), scale, rowLength);
+
+                if (thread.isTaskAborted())
+                    return;
+            }
+        }
+    }
+}
+
+
+static inline float lanczos(float x) {
+    static const float PI = 3.14159265358979f;
+    static const int ORDER = SeparableResampler::Weights::LANCZOS_ORDER;
+    if (x == 0)
+        return 1;
+    if (x <= -ORDER || x >= ORDER)
+        return 0;
+    return ORDER * std::sin(PI * x) * std::sin(PI * x / ORDER) / (PI * PI * x * x);
+}
+
+
+void SeparableResampler::Weights::compute(BitmapResampler::Mode mode, int srcSize, int dstSize, float cubicParameter) {
+    // source pixels and weights per output pixel, before clamping to the image boundaries
+    std::vector<std::vector<std::pair<int, float>>> taps(dstSize);
+
+    // the source pixel positions follow the ones used by the 2D resampling kernels
+    for (int i = 0; i < dstSize; ++i) {
+        auto& _ = taps[i];
+        switch (mode) {
+            case BitmapResampler::Mode::NEAREST_NEIGHBOR:
+                _.emplace_back((i * srcSize + srcSize / 2) / dstSize, 1.0f);
+                break;
+
+            case BitmapResampler::Mode::BOX: {
+                const int
+                    first = i * srcSize / dstSize,
+                    count = std::max(1, (i + 1) * srcSize / dstSize - first);
+                for (int j = 0; j < count; ++j)
+                    _.emplace_back(first + j, 1.0f / count);
+                break;
+            }
+
+            case BitmapResampler::Mode::LINEAR: {
+                const float pos = (float)(i * srcSize + (srcSize - dstSize) / 2) / dstSize;
+                const int index = (int)pos;
+                const float frac = pos - index;
+                _.emplace_back(index, 1 - frac);
+                _.emplace_back(index + 1, frac);
+                break;
+            }
+
+            case BitmapResampler::Mode::CUBIC: {
+                const float pos = (float)(i * srcSize + (srcSize - dstSize) / 2) / dstSize;
+                const int index = (int)pos;
+                const float x = pos - index, xx = x * x, xxx = xx * x, alpha = cubicParameter;
+                const float
+                    c0 = alpha * (xxx + x) - 2 * alpha * xx,
+                    c1 = (alpha + 2) * xxx - (alpha + 3) * xx + 1,
+                    c2 = -(alpha + 2) * xxx + (2 * alpha + 3) * xx - alpha * x;
+                _.emplace_back(index - 1, c0);
+                _.emplace_back(index, c1);
+                _.emplace_back(index + 1, c2);
+                _.emplace_back(index + 2, 1 - c0 - c1 - c2);
+                break;
+            }
+
+            case BitmapResampler::Mode::LANCZOS: {
+                // the kernel is stretched when downsampling to avoid aliasing
+                const float
+                    scale = std::max(1.0f, (float)srcSize / dstSize),
+                    support = LANCZOS_ORDER * scale,
+                    center = (i + 0.5f) * srcSize / dstSize - 0.5f;
+                float sum = 0;
+                for (int j = (int)std::ceil(center - support); j <= (int)std::floor(center + support); ++j) {
+                    const float w = lanczos((j - center) / scale);
+                    if (w != 0) {
+                        _.emplace_back(j, w);
+                        sum += w;
+                    }
+                }
+                for (auto& tap : _)
+                    tap.second /= sum;
+                break;
+            }
+
+            default:
+                Insanity::insanity("Resampling mode not supported");
+        }
+    }
+
+    // clamping the source pixel positions, folding the weights onto the boundary pixels
+    std::vector<int> lo(dstSize);
+    tapCount = 1;
+    for (int i = 0; i < dstSize; ++i) {
+        int a = srcSize, b = 0;
+        for (auto& tap : taps[i]) {
+            tap.first = std::max(0, std::min(tap.first, srcSize - 1));
+            a = std::min(a, tap.first);
+            b = std::max(b, tap.first);
+        }
+        lo[i] = a;
+        tapCount = std::max(tapCount, b - a + 1);
+    }
+
+    // storing the weights of all output pixels with the same number of consecutive source pixels
+    first.resize(dstSize);
+    weights.assign(dstSize * tapCount, 0.0f);
+    for (int i = 0; i < dstSize; ++i) {
+        first[i] = std::min(lo[i], srcSize - tapCount);
+        for (const auto& tap : taps[i])
+            weights[i * tapCount + tap.first - first[i]] += tap.second;
+    }
+}
+
+
+bool SeparableResampler::isApplicable(const AbstractBitmap& input, const AbstractBitmap& output) {
+    return !input.isMask() && !output.isMask() && input.getNumberOfChannels() == output.getNumberOfChannels();
+}
+
+
+void SeparableResampler::prepare(BitmapResampler::Mode mode, float cubicParameter,
+    const AbstractBitmap& input, const AbstractBitmap& output, const IntRectangle& src, const IntRectangle& dst,
+    ThreadIndex threadCount)
+{
+    srcRect = src;
+    dstRect = dst;
+    horizontal.compute(mode, src.width(), dst.width(), cubicParameter);
+    vertical.compute(mode, src.height(), dst.height(), cubicParameter);
+
+    // ring buffer, accumulator and input row per thread, keeping the buffers of different threads in different cache lines
+    static const msize FLOATS_PER_CACHE_LINE = 64 / sizeof(float);
+    const int channels = input.getNumberOfChannels();
+    bufferSize = (vertical.getTapCount() + 1) * dst.width() * channels + src.width() * channels;
+    bufferSize = ceili(bufferSize, FLOATS_PER_CACHE_LINE) * FLOATS_PER_CACHE_LINE;
+    buffers = AlignedMemory(threadCount * bufferSize * sizeof(float), input.getContext().getMemoryPool(), 64);
+}
+
+
+void SeparableResampler::process(const AbstractBitmap& input, AbstractBitmap& output, TaskThread& thread) {
+    process(input, output, 0, dstRect.height(), thread);
+}
+
+
+void SeparableResampler::process(const AbstractBitmap& input, AbstractBitmap& output, int firstRow, int lastRow, TaskThread& thread) {
+    float* buffer = buffers.ptr<float>(thread.currentThread() * bufferSize);
+
+#define RESAMPLE(IN_T, OUT_T) \
+    switch (input.getNumberOfChannels()) { \
+        case 1: Kernels::separableResampling<IN_T, OUT_T, 1>(input, output, srcRect, dstRect, horizontal, vertical, firstRow, lastRow, buffer, thread); break; \
+        case 3: Kernels::separableResampling<IN_T, OUT_T, 3>(input, output, srcRect, dstRect, horizontal, vertical, firstRow, lastRow, buffer, thread); break; \
+        case 4: Kernels::separableResampling<IN_T, OUT_T, 4>(input, output, srcRect, dstRect, horizontal, vertical, firstRow, lastRow, buffer, thread); break; \
+        default: Insanity::insanity("Unexpected number of channels"); \
+    }
+
+    if (input.isFloat()) {
+        if (output.isFloat())
+            RESAMPLE(pixfloat, pixfloat)
+        else
+            RESAMPLE(pixfloat, pixbyte)
+    }
+    else {
+        if (output.isFloat())
+            RESAMPLE(pixbyte, pixfloat)
+        else
+            RESAMPLE(pixbyte, pixbyte)
+    }
+#undef RESAMPLE
+}
+
+
+void SeparableResampler::getSourceRows(int firstRow, int lastRow, int& firstSourceRow, int& lastSourceRow) const {
+    // the source pixel ranges do not go backwards when moving forward in the output
+    firstSourceRow = vertical.getFirst(firstRow);
+    lastSourceRow = vertical.getFirst(lastRow - 1) + vertical.getTapCount();
+}
+
+
+void SeparableResampler::release() {
+    buffers.free();
+}
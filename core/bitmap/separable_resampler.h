@@ -0,0 +1,131 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "abstract_bitmap.h"
+#include "resampler.h"
+#include "../geometry.h"
+#include "../memory.h"
+#include "../parallelism.h"
+#include <vector>
+
+namespace Beatmup {
+
+    /**
+        \internal
+        Separable resampling on CPU.
+        The resampling filter is applied horizontally to every input row first, then vertically to the horizontally resampled rows kept in a
+        per-thread ring buffer. The filter weights and the source pixel positions are computed once per run for every output column and row.
+        Works with bitmaps of the same number of channels, excluding masks.
+    */
+    class SeparableResampler {
+    public:
+        /**
+            Resampling filter weights along one dimension: for every output pixel, a range of consecutive source pixels and their weights.
+            Pixels beyond the source image boundaries are replaced by the boundary ones.
+        */
+        class Weights {
+        private:
+            std::vector<int> first;             //!< index of the first source pixel contributing to every output pixel
+            std::vector<float> weights;         //!< weights of source pixels, tapCount per output pixel
+            int tapCount;                       //!< number of source pixels contributing to every output pixel
+
+        public:
+            static const int LANCZOS_ORDER = 3;
+
+            Weights(): tapCount(0) {}
+
+            /**
+                Computes the weights.
+                \param[in] mode             Resampling mode; the neural network-based mode is not supported.
+                \param[in] srcSize          Source size in pixels
+                \param[in] dstSize          Destination size in pixels
+                \param[in] cubicParameter   Cubic interpolation parameter
+            */
+            void compute(BitmapResampler::Mode mode, int srcSize, int dstSize, float cubicParameter);
+
+            inline int getTapCount() const { return tapCount; }
+            inline int getFirst(int i) const { return first[i]; }
+            inline const float* getWeights(int i) const { return weights.data() + i * tapCount; }
+        };
+
+    private:
+        Weights horizontal, vertical;
+        IntRectangle srcRect, dstRect;
+        msize bufferSize;                       //!< scratch buffer size per thread in floats
+        AlignedMemory buffers;                  //!< scratch buffers of all threads
+
+    public:
+        SeparableResampler(): bufferSize(0) {}
+
+        /**
+            \return `true` if the separable resampling can be applied to given bitmaps.
+        */
+        static bool isApplicable(const AbstractBitmap& input, const AbstractBitmap& output);
+
+        /**
+            Computes the weights and allocates scratch buffers. To be called before the processing.
+            \param[in] mode             Resampling mode
+            \param[in] cubicParameter   Cubic interpolation parameter
+            \param[in] input            Input bitmap
+            \param[in] output           Output bitmap
+            \param[in] src              Area of the input bitmap to resample
+            \param[in] dst              Area of the output bitmap to fill
+            \param[in] threadCount      Number of threads
+        */
+        void prepare(BitmapResampler::Mode mode, float cubicParameter,
+            const AbstractBitmap& input, const AbstractBitmap& output, const IntRectangle& src, const IntRectangle& dst,
+            ThreadIndex threadCount);
+
+        /**
+            Resamples the input area to the output area. Called by every thread running the task.
+        */
+        void process(const AbstractBitmap& input, AbstractBitmap& output, TaskThread& thread);
+
+        /**
+            Resamples the input area to a band of rows of the output area. Called by every thread running the task.
+            The band is computed with the weights of the whole area, so that the result does not depend on how the area is split in bands.
+            \param[in] input            Input bitmap
+            \param[out] output          Output bitmap
+            \param[in] firstRow         First row of the band, relative to the output area
+            \param[in] lastRow          The row following the last row of the band
+            \param[in] thread           The calling thread
+        */
+        void process(const AbstractBitmap& input, AbstractBitmap& output, int firstRow, int lastRow, TaskThread& thread);
+
+        /**
+            Retrieves the rows of the input area contributing to a band of rows of the output area.
+            \param[in] firstRow         First row of the band, relative to the output area
+            \param[in] lastRow          The row following the last row of the band
+            \param[out] firstSourceRow  First contributing row, relative to the input area
+            \param[out] lastSourceRow   The row following the last contributing row
+        */
+        void getSourceRows(int firstRow, int lastRow, int& firstSourceRow, int& lastSourceRow) const;
+
+        /**
+            Frees the scratch buffers.
+        */
+        void release();
+
+        /**
+            \return `true` if prepared and not released yet.
+        */
+        inline bool isReady() const { return (bool)buffers; }
+    };
+
+}
@@ -0,0 +1,902 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2019, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "simd_kernels.h"
+#include "bitmap_access.h"
+#include "resampling_kernels.h"
+#include "../platform.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef BEATMUP_ARCH_X86_64
+    #include <immintrin.h>
+    // The instruction set is enabled per function, so that no specific compiler flags are needed to build this file
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define BEATMUP_TARGET_SSE41
+        #define BEATMUP_TARGET_AVX2
+    #else
+        #define BEATMUP_TARGET_SSE41 __attribute__((target("sse4.1")))
+        #define BEATMUP_TARGET_AVX2  __attribute__((target("avx2")))
+    #endif
+#endif
+
+using namespace Beatmup;
+using namespace SimdKernels;
+
+
+#ifdef BEATMUP_ARCH_X86_64
+
+namespace Sse41 {
+
+    BEATMUP_TARGET_SSE41 inline __m128i load4Bytes(const pixbyte* ptr) {
+        int val;
+        memcpy(&val, ptr, 4);
+        return _mm_cvtsi32_si128(val);
+    }
+
+    BEATMUP_TARGET_SSE41 inline void store4Bytes(pixbyte* ptr, __m128i val) {
+        const int i = _mm_cvtsi128_si32(val);
+        memcpy(ptr, &i, 4);
+    }
+
+    /**
+        Computes floor(x / 255) in 16-bit unsigned lanes. Exact for any product of two 8-bit values.
+    */
+    BEATMUP_TARGET_SSE41 inline __m128i div255(__m128i x) {
+        return _mm_srli_epi16(_mm_mulhi_epu16(x, _mm_set1_epi16((short)0x8081)), 7);
+    }
+
+    /**
+        Clips floating point values to 0..1 range, NaN going to 0 as in clipPixfloat()
+    */
+    BEATMUP_TARGET_SSE41 inline __m128 clip(__m128 x) {
+        return _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    }
+
+    /**
+        Converts floating point pixel values to integers as roundf_fast(x * 255) does. The result is not clipped.
+    */
+    BEATMUP_TARGET_SSE41 inline __m128i quantize(__m128 x) {
+        return _mm_cvtps_epi32(_mm_floor_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f))));
+    }
+
+    /**
+        Packs four 32-bit integer pixels into a 32-bit value, clipping every channel to 0..255
+    */
+    BEATMUP_TARGET_SSE41 inline __m128i packPixel(__m128i x) {
+        return _mm_packus_epi16(_mm_packs_epi32(x, x), x);
+    }
+
+    /**
+        Builds a byte shuffling mask from an index table
+    */
+    BEATMUP_TARGET_SSE41 inline __m128i mask(const char* index) {
+        return _mm_loadu_si128((const __m128i*)index);
+    }
+
+
+    BEATMUP_TARGET_SSE41 void addBytes(const pixbyte* op1, const pixbyte* op2, pixbyte* out, msize n) {
+        msize i = 0;
+        for (; i + 16 <= n; i += 16)
+            _mm_storeu_si128((__m128i*)(out + i), _mm_adds_epu8(
+                _mm_loadu_si128((const __m128i*)(op1 + i)),
+                _mm_loadu_si128((const __m128i*)(op2 + i))
+            ));
+        for (; i < n; ++i)
+            out[i] = clipPixint(op1[i] + op2[i]);
+    }
+
+
+    BEATMUP_TARGET_SSE41 void multiplyBytes(const pixbyte* op1, const pixbyte* op2, pixbyte* out, msize n) {
+        const __m128i zero = _mm_setzero_si128();
+        msize i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m128i
+                a = _mm_loadu_si128((const __m128i*)(op1 + i)),
+                b = _mm_loadu_si128((const __m128i*)(op2 + i)),
+                lo = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero))),
+                hi = div255(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(lo, hi));
+        }
+        for (; i < n; ++i)
+            out[i] = op1[i] * op2[i] / 255;
+    }
+
+
+    BEATMUP_TARGET_SSE41 void addFloats(const pixfloat* op1, const pixfloat* op2, pixfloat* out, msize n) {
+        msize i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(out + i, clip(_mm_add_ps(_mm_loadu_ps(op1 + i), _mm_loadu_ps(op2 + i))));
+        for (; i < n; ++i)
+            out[i] = clipPixfloat(op1[i] + op2[i]);
+    }
+
+
+    BEATMUP_TARGET_SSE41 void multiplyFloats(const pixfloat* op1, const pixfloat* op2, pixfloat* out, msize n) {
+        msize i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(out + i, clip(_mm_mul_ps(_mm_loadu_ps(op1 + i), _mm_loadu_ps(op2 + i))));
+        for (; i < n; ++i)
+            out[i] = clipPixfloat(op1[i] * op2[i]);
+    }
+
+
+    BEATMUP_TARGET_SSE41 void bytesToFloats(const pixbyte* in, pixfloat* out, msize n) {
+        const __m128 scale = _mm_set1_ps(255.0f);
+        msize i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+            for (int k = 0; k < 4; ++k) {
+                _mm_storeu_ps(out + i + 4 * k, _mm_div_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(v)), scale));
+                v = _mm_srli_si128(v, 4);
+            }
+        }
+        for (; i < n; ++i)
+            out[i] = int2pixfloat(in[i]);
+    }
+
+
+    BEATMUP_TARGET_SSE41 void floatsToBytes(const pixfloat* in, pixbyte* out, msize n) {
+        msize i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m128i
+                q0 = quantize(_mm_loadu_ps(in + i)),
+                q1 = quantize(_mm_loadu_ps(in + i + 4)),
+                q2 = quantize(_mm_loadu_ps(in + i + 8)),
+                q3 = quantize(_mm_loadu_ps(in + i + 12));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q3)));
+        }
+        for (; i < n; ++i)
+            out[i] = pixfloat2pixbyte(in[i]);
+    }
+
+
+    BEATMUP_TARGET_SSE41 void singleToTripleBytes(const pixbyte* in, pixbyte* out, msize n) {
+        char index[48];
+        for (int i = 0; i < 48; ++i)
+            index[i] = i / 3;
+        const __m128i m0 = mask(index), m1 = mask(index + 16), m2 = mask(index + 32);
+
+        msize i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+            pixbyte* p = out + 3 * i;
+            _mm_storeu_si128((__m128i*)(p),      _mm_shuffle_epi8(v, m0));
+            _mm_storeu_si128((__m128i*)(p + 16), _mm_shuffle_epi8(v, m1));
+            _mm_storeu_si128((__m128i*)(p + 32), _mm_shuffle_epi8(v, m2));
+        }
+        for (; i < n; ++i)
+            out[3 * i] = out[3 * i + 1] = out[3 * i + 2] = in[i];
+    }
+
+
+    BEATMUP_TARGET_SSE41 void singleToQuadBytes(const pixbyte* in, pixbyte* out, msize n) {
+        char index[64], alpha[16];
+        for (int i = 0; i < 64; ++i)
+            index[i] = i % 4 == CHANNELS_4.A ? (char)0x80 : i / 4;
+        for (int i = 0; i < 16; ++i)
+            alpha[i] = i % 4 == CHANNELS_4.A ? (char)0xff : 0;
+        const __m128i
+            m0 = mask(index), m1 = mask(index + 16), m2 = mask(index + 32), m3 = mask(index + 48),
+            a = mask(alpha);
+
+        msize i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+            pixbyte* p = out + 4 * i;
+            _mm_storeu_si128((__m128i*)(p),      _mm_or_si128(_mm_shuffle_epi8(v, m0), a));
+            _mm_storeu_si128((__m128i*)(p + 16), _mm_or_si128(_mm_shuffle_epi8(v, m1), a));
+            _mm_storeu_si128((__m128i*)(p + 32), _mm_or_si128(_mm_shuffle_epi8(v, m2), a));
+            _mm_storeu_si128((__m128i*)(p + 48), _mm_or_si128(_mm_shuffle_epi8(v, m3), a));
+        }
+        for (; i < n; ++i) {
+            pixbyte* p = out + 4 * i;
+            p[CHANNELS_4.R] = p[CHANNELS_4.G] = p[CHANNELS_4.B] = in[i];
+            p[CHANNELS_4.A] = 255;
+        }
+    }
+
+
+    BEATMUP_TARGET_SSE41 void tripleToQuadBytes(const pixbyte* in, pixbyte* out, msize n) {
+        char index[16], alpha[16];
+        for (int i = 0; i < 16; ++i) {
+            const int p = i / 4, c = i % 4;
+            index[i] =
+                c == CHANNELS_4.R ? 3 * p + CHANNELS_3.R :
+                c == CHANNELS_4.G ? 3 * p + CHANNELS_3.G :
+                c == CHANNELS_4.B ? 3 * p + CHANNELS_3.B : (char)0x80;
+            alpha[i] = c == CHANNELS_4.A ? (char)0xff : 0;
+        }
+        const __m128i m = mask(index), a = mask(alpha);
+
+        // 16 bytes are read to get 4 pixels, so stopping early enough not to read beyond the run
+        msize i = 0;
+        for (; i + 6 <= n; i += 4)
+            _mm_storeu_si128((__m128i*)(out + 4 * i),
+                _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 3 * i)), m), a));
+        for (; i < n; ++i) {
+            const pixbyte* p = in + 3 * i;
+            pixbyte* q = out + 4 * i;
+            q[CHANNELS_4.R] = p[CHANNELS_3.R];
+            q[CHANNELS_4.G] = p[CHANNELS_3.G];
+            q[CHANNELS_4.B] = p[CHANNELS_3.B];
+            q[CHANNELS_4.A] = 255;
+        }
+    }
+
+
+    BEATMUP_TARGET_SSE41 void quadToTripleBytes(const pixbyte* in, pixbyte* out, msize n) {
+        char index[16];
+        for (int i = 0; i < 16; ++i) {
+            const int p = i / 3, c = i % 3;
+            index[i] = i >= 12 ? (char)0x80 :
+                c == CHANNELS_3.R ? 4 * p + CHANNELS_4.R :
+                c == CHANNELS_3.G ? 4 * p + CHANNELS_4.G : 4 * p + CHANNELS_4.B;
+        }
+        const __m128i m = mask(index);
+
+        // 16 bytes are written per 4 pixels; the 4 extra bytes are overwritten at the next step
+        msize i = 0;
+        for (; i + 8 <= n; i += 4)
+            _mm_storeu_si128((__m128i*)(out + 3 * i), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 4 * i)), m));
+        for (; i < n; ++i) {
+            const pixbyte* p = in + 4 * i;
+            pixbyte* q = out + 3 * i;
+            q[CHANNELS_3.R] = p[CHANNELS_4.R];
+            q[CHANNELS_3.G] = p[CHANNELS_4.G];
+            q[CHANNELS_3.B] = p[CHANNELS_4.B];
+        }
+    }
+
+
+    BEATMUP_TARGET_SSE41 void quadToSingleBytes(const pixbyte* in, pixbyte* out, msize n) {
+        const __m128i
+            shiftR = _mm_cvtsi32_si128(8 * CHANNELS_4.R),
+            shiftG = _mm_cvtsi32_si128(8 * CHANNELS_4.G),
+            shiftB = _mm_cvtsi32_si128(8 * CHANNELS_4.B),
+            lsb = _mm_set1_epi32(0xff),
+            third = _mm_set1_epi32(0xAAAB);     // floor(x * 0xAAAB / 2^17) = floor(x / 3) for x <= 765
+
+        msize i = 0;
+        __m128i q[4];
+        for (; i + 16 <= n; i += 16) {
+            for (int k = 0; k < 4; ++k) {
+                const __m128i v = _mm_loadu_si128((const __m128i*)(in + 4 * (i + 4 * k)));
+                const __m128i sum = _mm_add_epi32(_mm_add_epi32(
+                    _mm_and_si128(_mm_srl_epi32(v, shiftR), lsb),
+                    _mm_and_si128(_mm_srl_epi32(v, shiftG), lsb)),
+                    _mm_and_si128(_mm_srl_epi32(v, shiftB), lsb));
+                q[k] = _mm_srli_epi32(_mm_mullo_epi32(sum, third), 17);
+            }
+            _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(_mm_packus_epi32(q[0], q[1]), _mm_packus_epi32(q[2], q[3])));
+        }
+        for (; i < n; ++i) {
+            const pixbyte* p = in + 4 * i;
+            out[i] = (p[CHANNELS_4.R] + p[CHANNELS_4.G] + p[CHANNELS_4.B]) / 3;
+        }
+    }
+
+
+    /**
+        Color matrix coefficients laid out for vectorized processing
+    */
+    struct ColorMatrixCoefficients {
+        __m128 matrixF[4][4];       //!< matrixF[i][j] contains the coefficient of input channel j to output channel i, i and j being memory indices
+        __m128 biasF[4];
+        __m128i matrixI[4][4];      //!< integer approximation of matrixF
+        __m128i biasI[4];
+        int order[4];               //!< memory indices of channels in the summation order
+    };
+
+
+    /**
+        Applies a color matrix to 4 pixels.
+        Channels of 4 pixels are arranged in registers per channel, so that every lane follows exactly the scalar computation order.
+    */
+    template<bool floatInput, bool floatOutput, bool intApprox>
+    BEATMUP_TARGET_SSE41 inline void applyColorMatrix(const pixbyte* in, pixbyte* out, const ColorMatrixCoefficients& coefs) {
+        __m128 channels[4];
+        __m128i channelsI[4];
+        if (floatInput) {
+            const pixfloat* ptr = (const pixfloat*)in;
+            channels[0] = _mm_loadu_ps(ptr);
+            channels[1] = _mm_loadu_ps(ptr + 4);
+            channels[2] = _mm_loadu_ps(ptr + 8);
+            channels[3] = _mm_loadu_ps(ptr + 12);
+            _MM_TRANSPOSE4_PS(channels[0], channels[1], channels[2], channels[3]);
+        }
+        else {
+            const __m128i v = _mm_loadu_si128((const __m128i*)in), lsb = _mm_set1_epi32(0xff);
+            channelsI[0] = _mm_and_si128(v, lsb);
+            channelsI[1] = _mm_and_si128(_mm_srli_epi32(v, 8), lsb);
+            channelsI[2] = _mm_and_si128(_mm_srli_epi32(v, 16), lsb);
+            channelsI[3] = _mm_srli_epi32(v, 24);
+            for (int c = 0; c < 4; ++c)
+                channels[c] = _mm_cvtepi32_ps(channelsI[c]);
+        }
+
+        const __m128 scale = _mm_set1_ps(255.0f);
+        if (intApprox) {
+            __m128i result = _mm_setzero_si128();
+            for (int i = 0; i < 4; ++i) {
+                // truncated division by 255 through floating point is exact in the range of values allowed for the coefficients
+                __m128i acc = coefs.biasI[i];
+                for (int j = 0; j < 4; ++j)
+                    acc = _mm_add_epi32(acc, _mm_cvttps_epi32(_mm_div_ps(
+                        _mm_cvtepi32_ps(_mm_mullo_epi32(channelsI[j], coefs.matrixI[i][j])), scale)));
+                acc = _mm_min_epi32(_mm_max_epi32(acc, _mm_setzero_si128()), _mm_set1_epi32(255));
+                result = _mm_or_si128(result, _mm_sll_epi32(acc, _mm_cvtsi32_si128(8 * i)));
+            }
+            _mm_storeu_si128((__m128i*)out, result);
+            return;
+        }
+
+        __m128 acc[4];
+        for (int i = 0; i < 4; ++i) {
+            __m128 terms[4];
+            for (int j = 0; j < 4; ++j) {
+                const int c = coefs.order[j];
+                terms[j] = _mm_mul_ps(channels[c], coefs.matrixF[i][c]);
+                if (!floatInput)
+                    terms[j] = _mm_div_ps(terms[j], scale);
+            }
+            acc[i] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(terms[0], terms[1]), terms[2]), terms[3]), coefs.biasF[i]);
+        }
+
+        if (floatOutput) {
+            for (int i = 0; i < 4; ++i)
+                acc[i] = clip(acc[i]);
+            _MM_TRANSPOSE4_PS(acc[0], acc[1], acc[2], acc[3]);
+            pixfloat* ptr = (pixfloat*)out;
+            _mm_storeu_ps(ptr, acc[0]);
+            _mm_storeu_ps(ptr + 4, acc[1]);
+            _mm_storeu_ps(ptr + 8, acc[2]);
+            _mm_storeu_ps(ptr + 12, acc[3]);
+        }
+        else {
+            __m128i result = _mm_setzero_si128();
+            for (int i = 0; i < 4; ++i) {
+                const __m128i q = _mm_min_epi32(_mm_max_epi32(quantize(acc[i]), _mm_setzero_si128()), _mm_set1_epi32(255));
+                result = _mm_or_si128(result, _mm_sll_epi32(q, _mm_cvtsi32_si128(8 * i)));
+            }
+            _mm_storeu_si128((__m128i*)out, result);
+        }
+    }
+
+
+    template<bool floatInput, bool floatOutput, bool intApprox>
+    BEATMUP_TARGET_SSE41 void applyColorMatrix(const pixbyte* in, pixbyte* out, msize n, const ColorMatrixCoefficients& coefs) {
+        const int
+            inStep  = 4 * (floatInput  ? sizeof(pixfloat) : sizeof(pixbyte)),
+            outStep = 4 * (floatOutput ? sizeof(pixfloat) : sizeof(pixbyte));
+        msize i = 0;
+        for (; i + 4 <= n; i += 4)
+            applyColorMatrix<floatInput, floatOutput, intApprox>(in + inStep * i, out + outStep * i, coefs);
+
+        // remaining pixels are processed through a temporary buffer
+        if (i < n) {
+            pixfloat inBuf[16] = { 0 }, outBuf[16];
+            memcpy(inBuf, in + inStep * i, inStep * (n - i));
+            applyColorMatrix<floatInput, floatOutput, intApprox>((const pixbyte*)inBuf, (pixbyte*)outBuf, coefs);
+            memcpy(out + outStep * i, outBuf, outStep * (n - i));
+        }
+    }
+
+
+    BEATMUP_TARGET_SSE41 void boxResampling(
+        const pixbyte* inData, int inStride, pixbyte* outData, int outStride,
+        const IntRectangle& src, const IntRectangle& dst, TaskThread& tt
+    ) {
+        const int
+            srcW = src.width(), srcH = src.height(),
+            dstW = dst.width(), dstH = dst.height();
+
+        int x0, y0, x1, y1;
+
+        msize sliceStart, sliceStop;
+        while (tt.nextChunk(dstH, Kernels::getChunkHeight(dstW), sliceStart, sliceStop)) {
+            y1 = src.a.y + (int)sliceStart * srcH / dstH;
+            for (int y = (int)sliceStart; y < (int)sliceStop; ++y) {
+                pixbyte* out = outData + (msize)outStride * (dst.a.y + y) + 4 * dst.a.x;
+                y0 = y1;
+                y1 = src.a.y + (y + 1) * srcH / dstH;
+                x1 = src.a.x;
+                for (int x = 0; x < dstW; ++x, out += 4) {
+                    x0 = x1;
+                    x1 = src.a.x + (x + 1) * srcW / dstW;
+
+                    // loop over the source area
+                    __m128i acc = _mm_setzero_si128();
+                    int yy = y0;
+                    do {
+                        const pixbyte* in = inData + (msize)inStride * yy + 4 * x0;
+                        int xx = x0;
+                        do {
+                            acc = _mm_add_epi32(acc, _mm_cvtepu8_epi32(load4Bytes(in)));
+                            in += 4;
+                        } while (++xx < x1);
+                    } while (++yy < y1);
+
+                    // truncated division through floating point is exact for the area sizes allowed
+                    const __m128 area = _mm_set1_ps((float)std::max(1, (x1 - x0) * (y1 - y0)));
+                    store4Bytes(out, packPixel(_mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(acc), area))));
+                }
+
+                if (tt.isTaskAborted())
+                    return;
+            }
+        }
+    }
+
+
+    /**
+        Convolution of planar feature maps. Four output maps and four pixels are processed at once.
+        Products are not fused with additions to get the same result as the generic code.
+    */
+    BEATMUP_TARGET_SSE41 void convolve(
+        const float* input, int inputStride, msize inputPlaneStride, int numInputs,
+        float* output, int outputStride, msize outputPlaneStride, int numOutputs,
+        int width, int height, int kernelSize, const float* weights, const float* bias
+    ) {
+        const int taps = kernelSize * kernelSize, kernelStride = numInputs * taps;
+        const int vectorWidth = width - width % 4;
+        for (int o = 0; o < numOutputs; o += 4) {
+            const int numMaps = std::min(4, numOutputs - o);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < vectorWidth; x += 4) {
+                    __m128 acc[4];
+                    for (int j = 0; j < numMaps; ++j)
+                        acc[j] = _mm_set1_ps(bias[o + j]);
+                    const float* w = weights + o * kernelStride;
+                    for (int i = 0; i < numInputs; ++i) {
+                        const float* in = input + i * inputPlaneStride + y * inputStride + x;
+                        for (int v = 0; v < kernelSize; ++v, in += inputStride)
+                            for (int u = 0; u < kernelSize; ++u, ++w) {
+                                const __m128 val = _mm_loadu_ps(in + u);
+                                if (numMaps == 4) {
+                                    acc[0] = _mm_add_ps(acc[0], _mm_mul_ps(val, _mm_set1_ps(w[0])));
+                                    acc[1] = _mm_add_ps(acc[1], _mm_mul_ps(val, _mm_set1_ps(w[kernelStride])));
+                                    acc[2] = _mm_add_ps(acc[2], _mm_mul_ps(val, _mm_set1_ps(w[2 * kernelStride])));
+                                    acc[3] = _mm_add_ps(acc[3], _mm_mul_ps(val, _mm_set1_ps(w[3 * kernelStride])));
+                                }
+                                else
+                                    for (int j = 0; j < numMaps; ++j)
+                                        acc[j] = _mm_add_ps(acc[j], _mm_mul_ps(val, _mm_set1_ps(w[j * kernelStride])));
+                            }
+                    }
+                    for (int j = 0; j < numMaps; ++j)
+                        _mm_storeu_ps(output + (o + j) * outputPlaneStride + y * outputStride + x, acc[j]);
+                }
+
+                // remaining pixels
+                for (int x = vectorWidth; x < width; ++x)
+                    for (int j = 0; j < numMaps; ++j) {
+                        const float* w = weights + (o + j) * kernelStride;
+                        float acc = bias[o + j];
+                        for (int i = 0; i < numInputs; ++i) {
+                            const float* in = input + i * inputPlaneStride + y * inputStride + x;
+                            for (int v = 0; v < kernelSize; ++v, in += inputStride)
+                                for (int u = 0; u < kernelSize; ++u, ++w)
+                                    acc += in[u] * *w;
+                        }
+                        output[(o + j) * outputPlaneStride + y * outputStride + x] = acc;
+                    }
+            }
+        }
+    }
+}
+
+
+namespace Avx2 {
+
+    BEATMUP_TARGET_AVX2 inline __m256 clip(__m256 x) {
+        return _mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+    }
+
+    BEATMUP_TARGET_AVX2 inline __m256i quantize(__m256 x) {
+        return _mm256_cvtps_epi32(_mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f))));
+    }
+
+
+    BEATMUP_TARGET_AVX2 void addBytes(const pixbyte* op1, const pixbyte* op2, pixbyte* out, msize n) {
+        msize i = 0;
+        for (; i + 32 <= n; i += 32)
+            _mm256_storeu_si256((__m256i*)(out + i), _mm256_adds_epu8(
+                _mm256_loadu_si256((const __m256i*)(op1 + i)),
+                _mm256_loadu_si256((const __m256i*)(op2 + i))
+            ));
+        for (; i < n; ++i)
+            out[i] = clipPixint(op1[i] + op2[i]);
+    }
+
+
+    BEATMUP_TARGET_AVX2 void multiplyBytes(const pixbyte* op1, const pixbyte* op2, pixbyte* out, msize n) {
+        const __m256i div255 = _mm256_set1_epi16((short)0x8081);
+        msize i = 0;
+        for (; i + 32 <= n; i += 32) {
+            const __m256i
+                a0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(op1 + i))),
+                a1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(op1 + i + 16))),
+                b0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(op2 + i))),
+                b1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(op2 + i + 16))),
+                p0 = _mm256_srli_epi16(_mm256_mulhi_epu16(_mm256_mullo_epi16(a0, b0), div255), 7),
+                p1 = _mm256_srli_epi16(_mm256_mulhi_epu16(_mm256_mullo_epi16(a1, b1), div255), 7);
+            // packing works within 128-bit lanes, so the 64-bit blocks are reordered afterwards
+            _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(p0, p1), 0xD8));
+        }
+        for (; i < n; ++i)
+            out[i] = op1[i] * op2[i] / 255;
+    }
+
+
+    BEATMUP_TARGET_AVX2 void addFloats(const pixfloat* op1, const pixfloat* op2, pixfloat* out, msize n) {
+        msize i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(out + i, clip(_mm256_add_ps(_mm256_loadu_ps(op1 + i), _mm256_loadu_ps(op2 + i))));
+        for (; i < n; ++i)
+            out[i] = clipPixfloat(op1[i] + op2[i]);
+    }
+
+
+    BEATMUP_TARGET_AVX2 void multiplyFloats(const pixfloat* op1, const pixfloat* op2, pixfloat* out, msize n) {
+        msize i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(out + i, clip(_mm256_mul_ps(_mm256_loadu_ps(op1 + i), _mm256_loadu_ps(op2 + i))));
+        for (; i < n; ++i)
+            out[i] = clipPixfloat(op1[i] * op2[i]);
+    }
+
+
+    BEATMUP_TARGET_AVX2 void bytesToFloats(const pixbyte* in, pixfloat* out, msize n) {
+        const __m256 scale = _mm256_set1_ps(255.0f);
+        msize i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(out + i, _mm256_div_ps(
+                _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i)))), scale));
+        for (; i < n; ++i)
+            out[i] = int2pixfloat(in[i]);
+    }
+
+
+    BEATMUP_TARGET_AVX2 void floatsToBytes(const pixfloat* in, pixbyte* out, msize n) {
+        msize i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m256i
+                q0 = quantize(_mm256_loadu_ps(in + i)),
+                q1 = quantize(_mm256_loadu_ps(in + i + 8)),
+                w = _mm256_permute4x64_epi64(_mm256_packs_epi32(q0, q1), 0xD8),
+                b = _mm256_permute4x64_epi64(_mm256_packus_epi16(w, w), 0x08);
+            _mm_storeu_si128((__m128i*)(out + i), _mm256_castsi256_si128(b));
+        }
+        for (; i < n; ++i)
+            out[i] = pixfloat2pixbyte(in[i]);
+    }
+
+
+    /**
+        Convolution of planar feature maps, as in Sse41::convolve(), processing eight pixels at once
+    */
+    BEATMUP_TARGET_AVX2 void convolve(
+        const float* input, int inputStride, msize inputPlaneStride, int numInputs,
+        float* output, int outputStride, msize outputPlaneStride, int numOutputs,
+        int width, int height, int kernelSize, const float* weights, const float* bias
+    ) {
+        const int taps = kernelSize * kernelSize, kernelStride = numInputs * taps;
+        const int vectorWidth = width - width % 8;
+        for (int o = 0; o < numOutputs; o += 4) {
+            const int numMaps = std::min(4, numOutputs - o);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < vectorWidth; x += 8) {
+                    __m256 acc[4];
+                    for (int j = 0; j < numMaps; ++j)
+                        acc[j] = _mm256_set1_ps(bias[o + j]);
+                    const float* w = weights + o * kernelStride;
+                    for (int i = 0; i < numInputs; ++i) {
+                        const float* in = input + i * inputPlaneStride + y * inputStride + x;
+                        for (int v = 0; v < kernelSize; ++v, in += inputStride)
+                            for (int u = 0; u < kernelSize; ++u, ++w) {
+                                const __m256 val = _mm256_loadu_ps(in + u);
+                                if (numMaps == 4) {
+                                    acc[0] = _mm256_add_ps(acc[0], _mm256_mul_ps(val, _mm256_set1_ps(w[0])));
+                                    acc[1] = _mm256_add_ps(acc[1], _mm256_mul_ps(val, _mm256_set1_ps(w[kernelStride])));
+                                    acc[2] = _mm256_add_ps(acc[2], _mm256_mul_ps(val, _mm256_set1_ps(w[2 * kernelStride])));
+                                    acc[3] = _mm256_add_ps(acc[3], _mm256_mul_ps(val, _mm256_set1_ps(w[3 * kernelStride])));
+                                }
+                                else
+                                    for (int j = 0; j < numMaps; ++j)
+                                        acc[j] = _mm256_add_ps(acc[j], _mm256_mul_ps(val, _mm256_set1_ps(w[j * kernelStride])));
+                            }
+                    }
+                    for (int j = 0; j < numMaps; ++j)
+                        _mm256_storeu_ps(output + (o + j) * outputPlaneStride + y * outputStride + x, acc[j]);
+                }
+            }
+        }
+
+        // remaining columns
+        if (vectorWidth < width)
+            Sse41::convolve(
+                input + vectorWidth, inputStride, inputPlaneStride, numInputs,
+                output + vectorWidth, outputStride, outputPlaneStride, numOutputs,
+                width - vectorWidth, height, kernelSize, weights, bias
+            );
+    }
+}
+
+
+static InstructionSet detectInstructionSet() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool
+        sse41 = (info[2] & (1 << 19)) != 0,
+        osxsave = (info[2] & (1 << 27)) != 0,
+        avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    const bool
+        sse41 = __builtin_cpu_supports("sse4.1") != 0,
+        avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+    if (sse41 && avx2)
+        return InstructionSet::AVX2;
+    if (sse41)
+        return InstructionSet::SSE41;
+    return InstructionSet::NONE;
+}
+
+#else
+
+static InstructionSet detectInstructionSet() {
+    return InstructionSet::NONE;
+}
+
+#endif
+
+
+static std::atomic<int> instructionSetLimit((int)InstructionSet::AVX2);
+
+
+InstructionSet SimdKernels::getSupportedInstructionSet() {
+    static const InstructionSet supported = detectInstructionSet();
+    return supported;
+}
+
+
+InstructionSet SimdKernels::getInstructionSet() {
+    return (InstructionSet)std::min((int)getSupportedInstructionSet(), instructionSetLimit.load());
+}
+
+
+void SimdKernels::limitInstructionSet(InstructionSet limit) {
+    instructionSetLimit.store((int)limit);
+}
+
+
+bool SimdKernels::convert(const AbstractBitmap& input, AbstractBitmap& output, int x, int y, msize numPixels) {
+#ifdef BEATMUP_ARCH_X86_64
+    const InstructionSet instructionSet = getInstructionSet();
+    if (instructionSet == InstructionSet::NONE)
+        return false;
+    const bool avx2 = instructionSet == InstructionSet::AVX2;
+
+    const PixelFormat inFormat = input.getPixelFormat(), outFormat = output.getPixelFormat();
+    const pixbyte* in = input.getData(x, y);
+    pixbyte* out = output.getData(x, y);
+
+    // same number of channels: integer to floating point and back
+    if (AbstractBitmap::CHANNELS_PER_PIXEL[inFormat] == AbstractBitmap::CHANNELS_PER_PIXEL[outFormat]) {
+        const msize n = numPixels * AbstractBitmap::CHANNELS_PER_PIXEL[inFormat];
+        if (AbstractBitmap::isInteger(inFormat) && AbstractBitmap::isFloat(outFormat)) {
+            if (avx2)
+                Avx2::bytesToFloats(in, (pixfloat*)out, n);
+            else
+                Sse41::bytesToFloats(in, (pixfloat*)out, n);
+            return true;
+        }
+        if (AbstractBitmap::isFloat(inFormat) && AbstractBitmap::isInteger(outFormat)) {
+            if (avx2)
+                Avx2::floatsToBytes((const pixfloat*)in, out, n);
+            else
+                Sse41::floatsToBytes((const pixfloat*)in, out, n);
+            return true;
+        }
+        return false;
+    }
+
+    // channel shuffling
+    if (inFormat == SingleByte && outFormat == TripleByte)
+        Sse41::singleToTripleBytes(in, out, numPixels);
+    else if (inFormat == SingleByte && outFormat == QuadByte)
+        Sse41::singleToQuadBytes(in, out, numPixels);
+    else if (inFormat == TripleByte && outFormat == QuadByte)
+        Sse41::tripleToQuadBytes(in, out, numPixels);
+    else if (inFormat == QuadByte && outFormat == TripleByte)
+        Sse41::quadToTripleBytes(in, out, numPixels);
+    else if (inFormat == QuadByte && outFormat == SingleByte)
+        Sse41::quadToSingleBytes(in, out, numPixels);
+    else
+        return false;
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+bool SimdKernels::add(PixelFormat format, const void* op1, const void* op2, void* output, int numPixels) {
+#ifdef BEATMUP_ARCH_X86_64
+    const InstructionSet instructionSet = getInstructionSet();
+    if (instructionSet == InstructionSet::NONE || AbstractBitmap::isMask(format))
+        return false;
+    const bool avx2 = instructionSet == InstructionSet::AVX2;
+    const msize n = numPixels * AbstractBitmap::CHANNELS_PER_PIXEL[format];
+
+    if (AbstractBitmap::isInteger(format)) {
+        if (avx2)
+            Avx2::addBytes((const pixbyte*)op1, (const pixbyte*)op2, (pixbyte*)output, n);
+        else
+            Sse41::addBytes((const pixbyte*)op1, (const pixbyte*)op2, (pixbyte*)output, n);
+    }
+    else {
+        if (avx2)
+            Avx2::addFloats((const pixfloat*)op1, (const pixfloat*)op2, (pixfloat*)output, n);
+        else
+            Sse41::addFloats((const pixfloat*)op1, (const pixfloat*)op2, (pixfloat*)output, n);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+bool SimdKernels::multiply(PixelFormat format, const void* op1, const void* op2, void* output, int numPixels) {
+#ifdef BEATMUP_ARCH_X86_64
+    const InstructionSet instructionSet = getInstructionSet();
+    // single channel integer product is not normalized in the generic code, so it is left to it
+    if (instructionSet == InstructionSet::NONE || AbstractBitmap::isMask(format) || format == SingleByte)
+        return false;
+    const bool avx2 = instructionSet == InstructionSet::AVX2;
+    const msize n = numPixels * AbstractBitmap::CHANNELS_PER_PIXEL[format];
+
+    if (AbstractBitmap::isInteger(format)) {
+        if (avx2)
+            Avx2::multiplyBytes((const pixbyte*)op1, (const pixbyte*)op2, (pixbyte*)output, n);
+        else
+            Sse41::multiplyBytes((const pixbyte*)op1, (const pixbyte*)op2, (pixbyte*)output, n);
+    }
+    else {
+        if (avx2)
+            Avx2::multiplyFloats((const pixfloat*)op1, (const pixfloat*)op2, (pixfloat*)output, n);
+        else
+            Sse41::multiplyFloats((const pixfloat*)op1, (const pixfloat*)op2, (pixfloat*)output, n);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+bool SimdKernels::applyColorMatrix(const AbstractBitmap& input, AbstractBitmap& output, int x, int y, msize numPixels,
+    const Color::Matrix& matrix, const pixfloat4& bias, bool useIntApprox)
+{
+#ifdef BEATMUP_ARCH_X86_64
+    const PixelFormat inFormat = input.getPixelFormat(), outFormat = output.getPixelFormat();
+    if (getInstructionSet() == InstructionSet::NONE
+        || (inFormat != QuadByte && inFormat != QuadFloat)
+        || (outFormat != QuadByte && outFormat != QuadFloat))
+        return false;
+
+    // setting up coefficients the same way the generic code does
+    Sse41::ColorMatrixCoefficients coefs;
+    coefs.order[0] = CHANNELS_4.R;
+    coefs.order[1] = CHANNELS_4.G;
+    coefs.order[2] = CHANNELS_4.B;
+    coefs.order[3] = CHANNELS_4.A;
+    if (useIntApprox) {
+        pixint4 row, biasI;
+        biasI = bias;
+        for (int i = 0; i < 4; ++i) {
+            row = pixfloat4(matrix[i]);
+            for (int j = 0; j < 4; ++j) {
+                // larger coefficients make the truncated division through floating point inexact
+                if (std::abs(row.val[j]) > 8192)
+                    return false;
+                coefs.matrixI[i][j] = _mm_set1_epi32(row.val[j]);
+            }
+            coefs.biasI[i] = _mm_set1_epi32(biasI.val[i]);
+        }
+    }
+    else
+        for (int i = 0; i < 4; ++i) {
+            const pixfloat4 row(matrix[i]);
+            for (int j = 0; j < 4; ++j)
+                coefs.matrixF[i][j] = _mm_set1_ps(row.val[j]);
+            coefs.biasF[i] = _mm_set1_ps(bias.val[i]);
+        }
+
+    const pixbyte* in = input.getData(x, y);
+    pixbyte* out = output.getData(x, y);
+    if (useIntApprox)
+        Sse41::applyColorMatrix<false, false, true>(in, out, numPixels, coefs);
+    else if (inFormat == QuadByte)
+        if (outFormat == QuadByte)
+            Sse41::applyColorMatrix<false, false, false>(in, out, numPixels, coefs);
+        else
+            Sse41::applyColorMatrix<false, true, false>(in, out, numPixels, coefs);
+    else
+        if (outFormat == QuadByte)
+            Sse41::applyColorMatrix<true, false, false>(in, out, numPixels, coefs);
+        else
+            Sse41::applyColorMatrix<true, true, false>(in, out, numPixels, coefs);
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+bool SimdKernels::boxResampling(const AbstractBitmap& input, AbstractBitmap& output, const IntRectangle& src, const IntRectangle& dst, TaskThread& thread) {
+#ifdef BEATMUP_ARCH_X86_64
+    if (getInstructionSet() == InstructionSet::NONE || input.getPixelFormat() != QuadByte || output.getPixelFormat() != QuadByte)
+        return false;
+
+    // the box area is limited to keep the division through floating point exact
+    if (dst.width() <= 0 || dst.height() <= 0 || (src.width() / dst.width() + 1) * (src.height() / dst.height() + 1) > 0xffff)
+        return false;
+
+    Sse41::boxResampling(input.getData(0, 0), input.getStride(), output.getData(0, 0), output.getStride(), src, dst, thread);
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+bool SimdKernels::convolve(
+    const float* input, int inputStride, msize inputPlaneStride, int numInputs,
+    float* output, int outputStride, msize outputPlaneStride, int numOutputs,
+    int width, int height, int kernelSize, const float* weights, const float* bias
+) {
+#ifdef BEATMUP_ARCH_X86_64
+    const InstructionSet instructionSet = getInstructionSet();
+    if (instructionSet == InstructionSet::AVX2)
+        Avx2::convolve(input, inputStride, inputPlaneStride, numInputs, output, outputStride, outputPlaneStride, numOutputs,
+            width, height, kernelSize, weights, bias);
+    else if (instructionSet == InstructionSet::SSE41)
+        Sse41::convolve(input, inputStride, inputPlaneStride, numInputs, output, outputStride, outputPlaneStride, numOutputs,
+            width, height, kernelSize, weights, bias);
+    else
+        return false;
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,151 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2019, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "abstract_bitmap.h"
+#include "pixel_arithmetic.h"
+#include "../color/matrix.h"
+#include "../parallelism.h"
+#include "../geometry.h"
+
+namespace Beatmup {
+
+    /**
+        Vectorized implementations of elementary bitmap processing routines on CPU.
+        The instruction set is selected at runtime according to the CPU capabilities, so that the same binary runs on any CPU of a given
+        architecture. So far SSE4.1 and AVX2 are used on x86-64.
+        Every routine returns `false` if there is no vectorized implementation for given arguments on the current CPU, in which case the
+        caller falls back to the generic code. When a routine returns `true`, its result is exactly the same as the one of the generic code.
+    */
+    namespace SimdKernels {
+
+        /**
+            Instruction set used by the vectorized routines
+        */
+        enum class InstructionSet {
+            NONE,       //!< no vectorized implementation, the generic code is used
+            SSE41,      //!< SSE up to 4.1
+            AVX2        //!< AVX2 (implies SSE4.1)
+        };
+
+        /**
+            \return the richest instruction set supported by the CPU among the ones having a vectorized implementation.
+        */
+        InstructionSet getSupportedInstructionSet();
+
+        /**
+            \return the instruction set currently used by the vectorized routines.
+        */
+        InstructionSet getInstructionSet();
+
+        /**
+            Limits the instruction set used by the vectorized routines.
+            Allows to compare the performance and the output of different implementations. Passing InstructionSet::NONE disables the
+            vectorized routines entirely.
+            \param[in] limit        The richest instruction set allowed to use
+        */
+        void limitInstructionSet(InstructionSet limit);
+
+        /**
+            Converts a run of pixels from one bitmap into another bitmap of a different pixel format.
+            The run starts at the same position in both bitmaps and may span several rows.
+            \param[in] input        The input bitmap
+            \param[out] output      The output bitmap of the same size
+            \param[in] x            Horizontal position of the first pixel
+            \param[in] y            Vertical position of the first pixel
+            \param[in] numPixels    Number of pixels to convert
+            \return `true` if the conversion is done.
+        */
+        bool convert(const AbstractBitmap& input, AbstractBitmap& output, int x, int y, msize numPixels);
+
+        /**
+            Computes a pixelwise sum of two runs of pixels of the same format.
+            \param[in] format       Pixel format of both operands and the output
+            \param[in] op1          Pointer to the first pixel of the first operand
+            \param[in] op2          Pointer to the first pixel of the second operand
+            \param[out] output      Pointer to the first pixel of the output
+            \param[in] numPixels    Number of pixels to process
+            \return `true` if the operation is done.
+        */
+        bool add(PixelFormat format, const void* op1, const void* op2, void* output, int numPixels);
+
+        /**
+            Computes a pixelwise product of two runs of pixels of the same format.
+            \param[in] format       Pixel format of both operands and the output
+            \param[in] op1          Pointer to the first pixel of the first operand
+            \param[in] op2          Pointer to the first pixel of the second operand
+            \param[out] output      Pointer to the first pixel of the output
+            \param[in] numPixels    Number of pixels to process
+            \return `true` if the operation is done.
+        */
+        bool multiply(PixelFormat format, const void* op1, const void* op2, void* output, int numPixels);
+
+        /**
+            Applies a color matrix to a run of pixels. Only 4-channel bitmaps are handled.
+            \param[in] input        The input bitmap
+            \param[out] output      The output bitmap
+            \param[in] x            Horizontal position of the first pixel
+            \param[in] y            Vertical position of the first pixel
+            \param[in] numPixels    Number of pixels to process
+            \param[in] matrix       The color matrix
+            \param[in] bias         The bias added to the matrix product
+            \param[in] useIntApprox If `true`, the matrix product is computed using integer arithmetic
+            \return `true` if the operation is done.
+        */
+        bool applyColorMatrix(const AbstractBitmap& input, AbstractBitmap& output, int x, int y, msize numPixels,
+            const Color::Matrix& matrix, const pixfloat4& bias, bool useIntApprox);
+
+        /**
+            Resamples a rectangle from an input bitmap to a rectangle in an output bitmap applying a box filter.
+            Only QuadByte bitmaps are handled.
+            \param[in] input        The input bitmap
+            \param[out] output      The output bitmap
+            \param[in] src          The source rectangle in the input bitmap
+            \param[in] dst          The destination rectangle in the output bitmap
+            \param[in] thread       Calling thread; hands out chunks of output rows to process
+            \return `true` if the resampling is done.
+        */
+        bool boxResampling(const AbstractBitmap& input, AbstractBitmap& output, const IntRectangle& src, const IntRectangle& dst, TaskThread& thread);
+
+        /**
+            Convolves a stack of single-channel floating point feature maps with square kernels, producing another stack of feature maps.
+            The maps are stored plane by plane. The value of the output map `o` at (x, y) is `bias[o]` plus the sum over input maps `i` and
+            kernel taps (u, v) of `input[i](x + u, y + v) * weights[((o * numInputs + i) * kernelSize + v) * kernelSize + u]`, accumulated in
+            this order. The input maps are thus expected to be larger than the output area by `kernelSize - 1` pixels along both axes.
+            \param[in] input               Pointer to the first pixel of the first input map
+            \param[in] inputStride         Distance between two consecutive rows of an input map, in floats
+            \param[in] inputPlaneStride    Distance between two consecutive input maps, in floats
+            \param[in] numInputs           Number of input maps
+            \param[out] output             Pointer to the first pixel of the first output map
+            \param[in] outputStride        Distance between two consecutive rows of an output map, in floats
+            \param[in] outputPlaneStride   Distance between two consecutive output maps, in floats
+            \param[in] numOutputs          Number of output maps
+            \param[in] width               Width of the output area in pixels
+            \param[in] height              Height of the output area in pixels
+            \param[in] kernelSize          Kernel size in pixels
+            \param[in] weights             Kernels weights
+            \param[in] bias                Output maps biases
+            \return `true` if the convolution is done.
+        */
+        bool convolve(
+            const float* input, int inputStride, msize inputPlaneStride, int numInputs,
+            float* output, int outputStride, msize outputPlaneStride, int numOutputs,
+            int width, int height, int kernelSize, const float* weights, const float* bias
+        );
+    }
+}
@@ -0,0 +1,253 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tiled_executor.h"
+#include "bitmap_view.h"
+#include "internal_bitmap.h"
+#include "content_lock.h"
+#include "separable_resampler.h"
+#include "../utils/utils.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace Beatmup;
+
+
+/**
+    Greatest common divisor
+*/
+static int gcd(int a, int b) {
+    while (b != 0) {
+        const int r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+
+namespace Internal {
+    /**
+        Resamples a bitmap band by band in a single run using the separable resampling.
+        Once all the threads are done with a band, its output rows and the input rows not needed by the next bands are unloaded.
+    */
+    class BandResampling : public AbstractTask, private BitmapContentLock {
+    private:
+        const BitmapResampler& resampler;
+        AbstractBitmap &input, &output;
+        SeparableResampler separable;
+        const int bandHeight;
+
+    public:
+        BandResampling(const BitmapResampler& resampler, AbstractBitmap& input, AbstractBitmap& output, int bandHeight):
+            resampler(resampler), input(input), output(output), bandHeight(bandHeight)
+        {}
+
+
+        ThreadIndex getMaxThreads() const {
+            return MAX_THREAD_INDEX;
+        }
+
+
+        void beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu) {
+            separable.prepare(resampler.getMode(), resampler.getCubicParameter(), input, output,
+                IntRectangle(0, 0, input.getWidth(), input.getHeight()), IntRectangle(0, 0, output.getWidth(), output.getHeight()),
+                threadCount);
+            lock(gpu, ProcessingTarget::CPU, &input, &output);
+        }
+
+
+        void afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted) {
+            unlock(&input, &output);
+            separable.release();
+        }
+
+
+        bool process(TaskThread& thread) {
+            const int height = output.getHeight();
+            int unloadedInputRows = 0;
+            for (int y = 0; y < height; y += bandHeight) {
+                const int stop = std::min(y + bandHeight, height);
+                separable.process(input, output, y, stop, thread);
+                thread.synchronize();
+
+                // the other threads may already be processing the next band
+                if (thread.isManaging()) {
+                    output.unloadRows(y, stop);
+                    int nextInputRow = input.getHeight(), lastInputRow;
+                    if (stop < height)
+                        separable.getSourceRows(stop, std::min(stop + bandHeight, height), nextInputRow, lastInputRow);
+                    input.unloadRows(unloadedInputRows, nextInputRow);
+                    unloadedInputRows = nextInputRow;
+                }
+            }
+            return true;
+        }
+    };
+}
+
+
+TiledExecutor::TiledExecutor(Context& context, int bandHeight): context(context) {
+    setBandHeight(bandHeight);
+}
+
+
+void TiledExecutor::setBandHeight(int bandHeight) {
+    InvalidArgument::check(bandHeight > 0, "Band height must be positive");
+    this->bandHeight = bandHeight;
+}
+
+
+void TiledExecutor::convert(AbstractBitmap& input, AbstractBitmap& output) {
+    InvalidArgument::check(input.getSize() == output.getSize(), "Input and output bitmaps must be of the same size");
+    FormatConverter converter;
+    for (int y = 0; y < input.getHeight(); y += bandHeight) {
+        const IntRectangle band(0, y, input.getWidth(), std::min(y + bandHeight, input.getHeight()));
+        BitmapView inputBand(input, band), outputBand(output, band);
+        converter.setBitmaps(&inputBand, &outputBand);
+        context.performTask(converter);
+        input.unloadRows(band.a.y, band.b.y);
+        output.unloadRows(band.a.y, band.b.y);
+    }
+}
+
+
+void TiledExecutor::apply(Filters::PixelwiseFilter& filter, AbstractBitmap& input, AbstractBitmap& output) {
+    InvalidArgument::check(input.getSize() == output.getSize(), "Input and output bitmaps must be of the same size");
+    try {
+        for (int y = 0; y < input.getHeight(); y += bandHeight) {
+            const IntRectangle band(0, y, input.getWidth(), std::min(y + bandHeight, input.getHeight()));
+            BitmapView inputBand(input, band), outputBand(output, band);
+            filter.setInput(&inputBand);
+            filter.setOutput(&outputBand);
+            context.performTask(filter);
+            input.unloadRows(band.a.y, band.b.y);
+            output.unloadRows(band.a.y, band.b.y);
+        }
+    }
+    catch (...) {
+        filter.setInput(&input);
+        filter.setOutput(&output);
+        throw;
+    }
+    filter.setInput(&input);
+    filter.setOutput(&output);
+}
+
+
+void TiledExecutor::apply(BitmapBinaryOperation& operation, AbstractBitmap& operand1, AbstractBitmap& operand2, AbstractBitmap& output) {
+    InvalidArgument::check(operand1.getSize() == output.getSize() && operand2.getSize() == output.getSize(),
+        "Operands and output bitmaps must be of the same size");
+    try {
+        for (int y = 0; y < output.getHeight(); y += bandHeight) {
+            const IntRectangle band(0, y, output.getWidth(), std::min(y + bandHeight, output.getHeight()));
+            BitmapView operand1Band(operand1, band), operand2Band(operand2, band), outputBand(output, band);
+            operation.setOperand1(&operand1Band);
+            operation.setOperand2(&operand2Band);
+            operation.setOutput(&outputBand);
+            operation.resetCrop();
+            context.performTask(operation);
+            operand1.unloadRows(band.a.y, band.b.y);
+            operand2.unloadRows(band.a.y, band.b.y);
+            output.unloadRows(band.a.y, band.b.y);
+        }
+    }
+    catch (...) {
+        operation.setOperand1(&operand1);
+        operation.setOperand2(&operand2);
+        operation.setOutput(&output);
+        operation.resetCrop();
+        throw;
+    }
+    operation.setOperand1(&operand1);
+    operation.setOperand2(&operand2);
+    operation.setOutput(&output);
+    operation.resetCrop();
+}
+
+
+void TiledExecutor::resample(BitmapResampler& resampler, AbstractBitmap& input, AbstractBitmap& output) {
+    if (resampler.getMode() == BitmapResampler::Mode::CONVNET)
+        throw ImplementationUnsupported("Neural network-based resampling cannot be run band by band");
+
+    // bands of any height are computed exactly from the source rows they depend on by the separable resampling
+    if (SeparableResampler::isApplicable(input, output)) {
+        Internal::BandResampling task(resampler, input, output, bandHeight);
+        resampler.setInput(&input);
+        resampler.setOutput(&output);
+        context.performTask(task);
+        return;
+    }
+
+    // The bitmaps heights are split into units of p input rows and q output rows, p/q being the irreducible ratio of the heights. Bands
+    // made of whole units map the input rows to the output rows exactly as the whole bitmaps do.
+    const int
+        inputHeight = input.getHeight(),
+        outputHeight = output.getHeight(),
+        unitCount = gcd(inputHeight, outputHeight),
+        p = inputHeight / unitCount,
+        q = outputHeight / unitCount;
+    // The resampling kernels shift the source positions by a half of the size difference rounded down, so that bands of an odd number of
+    // units are shifted differently if the difference between p and q is odd. Bands are kept of an even number of units in this case.
+    const int unitStep = (p - q) % 2 == 0 ? 1 : 2;
+    const int bandUnits = std::max(1, bandHeight / q / unitStep) * unitStep;
+
+    // The halo covers the widest filter support, i.e., the one of Lanczos filter, spread when downsampling.
+    const float scale = std::max(1.0f, (float)inputHeight / outputHeight);
+    const int haloRows = (int)std::ceil(SeparableResampler::Weights::LANCZOS_ORDER * scale) + 1;
+    const int haloUnits = ceili(haloRows, p * unitStep) * unitStep;
+
+    // output bands extended with halos are computed in a scratch bitmap, and their central parts are copied to the output
+    InternalBitmap scratch(context, output.getPixelFormat(), output.getWidth(), std::min(bandUnits + 2 * haloUnits, unitCount) * q);
+    int unloadedInputRows = 0;
+
+    try {
+        for (int unit = 0; unit < unitCount; unit += bandUnits) {
+            const int
+                stop = std::min(unit + bandUnits, unitCount),
+                haloStart = std::max(unit - haloUnits, 0),
+                haloStop = std::min(stop + haloUnits, unitCount);
+
+            BitmapView
+                inputBand(input, IntRectangle(0, haloStart * p, input.getWidth(), haloStop * p)),
+                scratchBand(scratch, IntRectangle(0, 0, output.getWidth(), (haloStop - haloStart) * q));
+            resampler.setInput(&inputBand);
+            resampler.setOutput(&scratchBand);
+            context.performTask(resampler);
+
+            BitmapView
+                result(scratch, IntRectangle(0, (unit - haloStart) * q, output.getWidth(), (stop - haloStart) * q)),
+                outputBand(output, IntRectangle(0, unit * q, output.getWidth(), stop * q));
+            FormatConverter::convert(result, outputBand);
+            output.unloadRows(unit * q, stop * q);
+
+            // unloading input rows not used by the next band
+            const int nextInputRow = std::max(stop - haloUnits, 0) * p;
+            input.unloadRows(unloadedInputRows, nextInputRow);
+            unloadedInputRows = std::max(unloadedInputRows, nextInputRow);
+        }
+    }
+    catch (...) {
+        resampler.setInput(&input);
+        resampler.setOutput(&output);
+        throw;
+    }
+    input.unloadRows(unloadedInputRows, inputHeight);
+    resampler.setInput(&input);
+    resampler.setOutput(&output);
+}
@@ -0,0 +1,103 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "abstract_bitmap.h"
+#include "converter.h"
+#include "operator.h"
+#include "resampler.h"
+#include "../context.h"
+#include "../filters/pixelwise_filter.h"
+
+namespace Beatmup {
+
+    /**
+        Runs CPU tasks on big bitmaps band by band.
+        A task locks its input and output bitmaps entirely, which requires the whole pixel data to be in memory during the processing. The
+        executor instead runs the task on consecutive horizontal bands of the bitmaps, accessed through BitmapView instances, and unloads the
+        processed rows (see AbstractBitmap::unloadRows()) once a band is done. Used with MappedBitmap, this allows to process images bigger
+        than the available RAM: the memory use then depends on the bitmaps width and the band height, not on the bitmaps height.
+
+        When resampling, every band of output rows is computed from the input rows the resampling filter maps to it, using the filter
+        weights of the whole bitmap, so that the result is the same as the one obtained by resampling the whole bitmap at once. The nearest
+        neighbor and box modes are then computed in floating point and may differ from BitmapResampler by one level because of rounding.
+        Masks and bitmaps having different number of channels are resampled by BitmapResampler on bands aligned so that their input and
+        output heights are in the exact ratio of the full bitmaps heights, extended by a margin (halo) of rows covering the filter support.
+        The bands height then depends on the ratio, and may reach the whole output height if the bitmaps heights are coprime.
+    */
+    class TiledExecutor {
+    private:
+        Context& context;
+        int bandHeight;                     //!< maximum number of output rows computed at once
+
+    public:
+        static const int DEFAULT_BAND_HEIGHT = 256;
+
+        /**
+            Creates an executor.
+            \param[in] context      A context instance the tasks are run in
+            \param[in] bandHeight   Maximum number of output rows processed at once
+        */
+        TiledExecutor(Context& context, int bandHeight = DEFAULT_BAND_HEIGHT);
+
+        /**
+            Sets the maximum number of output rows processed at once.
+            When resampling masks or bitmaps having different number of channels, the actual band height may be greater in order to keep
+            the input and output bands heights in the ratio of the full bitmaps heights.
+        */
+        void setBandHeight(int bandHeight);
+        inline int getBandHeight() const { return bandHeight; }
+
+        /**
+            Converts a bitmap to another pixel format, as done by FormatConverter.
+            \param[in] input        The input bitmap
+            \param[out] output      The output bitmap of the same size
+        */
+        void convert(AbstractBitmap& input, AbstractBitmap& output);
+
+        /**
+            Applies a pixelwise filter (e.g., Filters::ColorMatrix) on CPU.
+            Once done, the filter input and output are reset to the given bitmaps.
+            \param[in] filter       The filter
+            \param[in] input        The input bitmap
+            \param[out] output      The output bitmap of the same size
+        */
+        void apply(Filters::PixelwiseFilter& filter, AbstractBitmap& input, AbstractBitmap& output);
+
+        /**
+            Applies a binary operation to two bitmaps.
+            The operation is applied to the whole bitmaps. Once done, its operands and output are reset to the given bitmaps.
+            \param[in] operation    The operation
+            \param[in] operand1     The first operand
+            \param[in] operand2     The second operand of the same size
+            \param[out] output      The output bitmap of the same size
+        */
+        void apply(BitmapBinaryOperation& operation, AbstractBitmap& operand1, AbstractBitmap& operand2, AbstractBitmap& output);
+
+        /**
+            Resamples a bitmap using the mode and parameters set in a given resampler.
+            The neural network-based mode running on GPU is not supported. Once done, the resampler input and output are reset to the given
+            bitmaps.
+            \param[in] resampler    The resampler
+            \param[in] input        The input bitmap
+            \param[out] output      The output bitmap
+        */
+        void resample(BitmapResampler& resampler, AbstractBitmap& input, AbstractBitmap& output);
+    };
+
+}
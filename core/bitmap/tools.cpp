@@ -20,6 +20,7 @@
 #include "bitmap_access.h"
 #include "converter.h"
 #include "processing.h"
+#include "../utils/utils.hpp"
 #include <cstdlib>
 
 
@@ -44,11 +45,13 @@ namespace Kernels {
                     return;
                 }
                 x++;
+                in++;
                 if (x >= W) {
                     x = 0;
                     y++;
+                    if (y < H)
+                        in.goTo(x, y);
                 }
-                in++;
             } while (y < H);
             result.x = result.y = -1;
         }
@@ -162,8 +165,23 @@ void BitmapTools::invert(AbstractBitmap& input, AbstractBitmap& output) {
     AbstractBitmap::ReadLock* readLock = (&input == &output) ? nullptr : new AbstractBitmap::ReadLock(input);
 
 
-    const size_t NPIX = input.getSize().numPixels();
-    if (input.isFloat()) {
+    if (!input.isDense() || !output.isDense()) {
+        // process row by row
+        const msize rowSize = ceili(input.getWidth() * input.getBitsPerPixel(), 8);
+        for (int y = 0; y < input.getHeight(); ++y) {
+            const pixbyte* pi = input.getData(0, y);
+            pixbyte* po = output.getData(0, y);
+            if (input.isFloat())
+                for (msize i = 0; i < rowSize / sizeof(pixfloat); ++i)
+                    ((pixfloat*)po)[i] = 1 - ((const pixfloat*)pi)[i];
+            else
+                for (msize i = 0; i < rowSize; ++i)
+                    po[i] = ~pi[i];
+        }
+    }
+
+    else if (input.isFloat()) {
+        const size_t NPIX = input.getSize().numPixels();
         pixfloat
             *pi = (pixfloat*)input.getData(0, 0),
             *po = (pixfloat*)output.getData(0, 0);
@@ -172,7 +190,7 @@ void BitmapTools::invert(AbstractBitmap& input, AbstractBitmap& output) {
             *(po++) = 1 - *(pi++);
     }
     else {
-        const size_t N = NPIX * AbstractBitmap::BITS_PER_PIXEL[input.getPixelFormat()] / 8;
+        const size_t N = input.getSize().numPixels() * AbstractBitmap::BITS_PER_PIXEL[input.getPixelFormat()] / 8;
         // fast integer inverse
         pixint_platform
             *pi = (pixint_platform*)input.getData(0, 0),
@@ -19,9 +19,12 @@
 #include "context.h"
 #include "parallelism.h"
 #include "gpu/pipeline.h"
+#include "gpu/program_cache.h"
 #include "gpu/recycle_bin.h"
+#include "gpu/texture_pool.h"
 #include "gpu/gpu_task.h"
 #include "exception.h"
+#include "memory.h"
 #include "bitmap/abstract_bitmap.h"
 #include "thread_pool.hpp"
 #include <algorithm>
@@ -198,6 +201,11 @@ public:
     }
 
 
+    PoolIndex getPoolCount() const {
+        return numThreadPools;
+    }
+
+
     void limitWorkerCount(const PoolIndex pool, ThreadIndex maxValue) {
         BEATMUP_ASSERT_DEBUG(pool < numThreadPools);
         threadPools[pool]->resize(maxValue);
@@ -227,14 +235,21 @@ Context::Context() : Context(1) {}
 Context::Context(const PoolIndex numThreadPools) {
     impl = new Impl(numThreadPools);
     recycleBin = new GL::RecycleBin(*this);
+    texturePool = new GL::TexturePool(*recycleBin);
+    memoryPool = new MemoryPool();
+    programCache = new GL::ProgramCache();
 }
 
 
 Context::~Context() {
+    texturePool->trim();
     if (recycleBin)
         recycleBin->emptyBin();
+    delete texturePool;
     delete recycleBin;
     delete impl;
+    delete memoryPool;
+    delete programCache;
 }
 
 float Context::performTask(AbstractTask& task, const PoolIndex pool) {
@@ -277,6 +292,10 @@ const ThreadIndex Context::maxAllowedWorkerCount(const PoolIndex pool) const {
     return impl->maxAllowedWorkerCount(pool);
 }
 
+PoolIndex Context::numThreadPools() const {
+    return impl->getPoolCount();
+}
+
 void Context::limitWorkerCount(ThreadIndex maxValue, const PoolIndex pool) {
     impl->limitWorkerCount(pool, maxValue);
 }
@@ -340,3 +359,15 @@ bool Context::isManagingThread() const {
 GL::RecycleBin* Context::getGpuRecycleBin() const {
     return recycleBin;
 }
+
+GL::TexturePool& Context::getGpuTexturePool() const {
+    return *texturePool;
+}
+
+MemoryPool& Context::getMemoryPool() const {
+    return *memoryPool;
+}
+
+GL::ProgramCache& Context::getProgramCache() const {
+    return *programCache;
+}
@@ -49,9 +49,12 @@ namespace Beatmup {
 
     namespace GL {
         class RecycleBin;
+        class TexturePool;
+        class ProgramCache;
     }
 
     class AbstractBitmap;
+    class MemoryPool;
 
     /**
         Basic class: task and memory management, any kind of static data
@@ -62,6 +65,9 @@ namespace Beatmup {
         class Impl;
         Impl* impl;
         GL::RecycleBin* recycleBin;                  //!< stores GPU garbage: resources managed by GPU and might be freed in the managing thread only
+        GL::TexturePool* texturePool;                //!< keeps textures of released bitmaps and tensors for reuse
+        MemoryPool* memoryPool;                      //!< keeps memory blocks of released bitmaps and tensors for reuse
+        GL::ProgramCache* programCache;              //!< stores linked GLSL program binaries on disk
 
     public:
         static const PoolIndex DEFAULT_POOL = 0;
@@ -182,6 +188,11 @@ namespace Beatmup {
         */
         const ThreadIndex maxAllowedWorkerCount(const PoolIndex pool = DEFAULT_POOL) const;
 
+        /**
+            \returns the number of thread pools in the context.
+        */
+        PoolIndex numThreadPools() const;
+
         /**
             Limits maximum number of threads (workers) when performing tasks in a given pool
             \param maxValue		Number limiting the worker count
@@ -236,6 +247,24 @@ namespace Beatmup {
         */
         GL::RecycleBin* getGpuRecycleBin() const;
 
+        /**
+            \return GPU texture pool the bitmaps and tensors take their textures from. Can be used to adjust the pool capacity and to query
+            the pool usage statistics.
+        */
+        GL::TexturePool& getGpuTexturePool() const;
+
+        /**
+            \return memory pool the bitmaps and tensors take their pixel data storage from. Can be used to adjust the pool capacity
+            and to query the pool usage statistics.
+        */
+        MemoryPool& getMemoryPool() const;
+
+        /**
+            \return on-disk cache of GLSL program binaries used when building shaders, disabled by default. Setting its directory reduces
+            the time taken to build the shaders when the application starts next time, e.g. the neural networks shaders.
+        */
+        GL::ProgramCache& getProgramCache() const;
+
         /**
             Context comparaison operator
             Two different instances of contexts are basically never identical; returning `true` only if the two point
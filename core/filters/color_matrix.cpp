@@ -19,6 +19,7 @@
 #include "color_matrix.h"
 #include "../bitmap/bitmap_access.h"
 #include "../bitmap/processing.h"
+#include "../bitmap/simd_kernels.h"
 #include "../color/color_spaces.h"
 #include "../color/constants.h"
 
@@ -72,9 +73,12 @@ namespace Kernels {
 
 
 void Filters::ColorMatrix::apply(int x, int y, msize nPix, TaskThread& thread) {
+    const bool useIntApprox = allowIntApprox && inputBitmap->isInteger() && outputBitmap->isInteger();
+    if (SimdKernels::applyColorMatrix(*inputBitmap, *outputBitmap, x, y, nPix, matrix, bias, useIntApprox))
+        return;
     BitmapProcessing::pipeline<Kernels::ApplyColorMatrix>(
         *inputBitmap, *outputBitmap, x, y,
-        bias, matrix, allowIntApprox && inputBitmap->isInteger() && outputBitmap->isInteger(),
+        bias, matrix, useIntApprox,
         nPix
     );
 }
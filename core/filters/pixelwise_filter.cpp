@@ -18,6 +18,7 @@
 
 #include "pixelwise_filter.h"
 #include "../exception.h"
+#include <algorithm>
 
 using namespace Beatmup;
 
@@ -90,14 +91,23 @@ void Filters::PixelwiseFilter::afterProcessing(ThreadIndex threadCount, GraphicP
 
 
 bool Filters::PixelwiseFilter::process(TaskThread& thread) {
-    // each thread receives a single part of bitmap to deal with
+    // threads take chunks of pixels one by one
+    static const int PIXEL_COUNT_PER_CHUNK = 16384;
     const int w = inputBitmap->getWidth();
-    const msize
-        nPix = w * inputBitmap->getHeight(),
-        start = nPix * thread.currentThread() / thread.numThreads(),
-        stop  = nPix * (1 + thread.currentThread()) / thread.numThreads();
-
-    apply((int)(start % w), (int)(start / w), stop - start, thread);
+    const msize nPix = (msize)w * inputBitmap->getHeight();
+    const bool dense = inputBitmap->isDense() && outputBitmap->isDense();
+    msize start, stop;
+    while (thread.nextChunk(nPix, PIXEL_COUNT_PER_CHUNK, start, stop) && !thread.isTaskAborted())
+        if (dense)
+            apply((int)(start % w), (int)(start / w), stop - start, thread);
+        else
+            // rows are not contiguous in memory: processing them one by one
+            for (msize i = start; i < stop; ) {
+                const int x = (int)(i % w);
+                const msize n = std::min(stop - i, (msize)(w - x));
+                apply(x, (int)(i / w), n, thread);
+                i += n;
+            }
     return true;
 }
 
@@ -17,6 +17,7 @@
 */
 
 #include "compute_program.h"
+#include "program_cache.h"
 #include "bgl.h"
 
 #ifndef BEATMUP_OPENGLVERSION_GLES20
@@ -50,6 +51,15 @@ void ComputeProgram::make(const GraphicPipeline& gpu, const std::string& source)
 }
 
 
+void ComputeProgram::make(const GraphicPipeline& gpu, const std::string& source, ProgramCache& cache) {
+    const std::string key = ProgramCache::getComputeProgramKey(source);
+    if (!cache.load(gpu, *this, key)) {
+        make(gpu, source.c_str());
+        cache.store(gpu, *this, key);
+    }
+}
+
+
 void ComputeProgram::dispatch(const GraphicPipeline& gpu, msize w, msize h, msize d) const {
     glDispatchCompute(w, h, d);
 #ifdef BEATMUP_DEBUG
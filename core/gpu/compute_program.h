@@ -45,6 +45,14 @@ namespace Beatmup {
 
             void make(const GraphicPipeline& gpu, const char* source);
             void make(const GraphicPipeline& gpu, const std::string& source);
+
+            /**
+                Compiles and links the program, or takes its binary from a cache if available.
+                \param[in] gpu          A graphic pipeline instance
+                \param[in] source       The compute shader source code
+                \param[in] cache        The program binaries cache
+            */
+            void make(const GraphicPipeline& gpu, const std::string& source, ProgramCache& cache);
             void dispatch(const GraphicPipeline& gpu, msize w, msize h, msize d) const;
         };
     }
@@ -476,6 +476,18 @@ Vector::Vector(Context& context, GraphicPipeline& gpu, const int size, const For
 }
 
 
+Vector::Vector(Context& context, const int size) :
+    context(context),
+    texFormat(TextureHandler::TextureFormat::RGBAx32f),
+    format(Format::FLOAT),
+    size(size),
+    mapScale(1), mapOffset(0),
+    data(size, 0.0f)
+{
+    RuntimeError::check(size % 4 == 0, "Vector size must be a multiple of four.");
+}
+
+
 Vector::~Vector() {
     invalidate(*context.getGpuRecycleBin());
 }
@@ -487,6 +499,11 @@ void Vector::prepare(GraphicPipeline& gpu) {
 
 
 void Vector::fetch(GraphicPipeline& gpu, std::vector<float>& output) const {
+    if (isInRam()) {
+        fetch(output);
+        return;
+    }
+
     output.resize(size);
     gpu.bindOutput(textureHandle);
 
@@ -533,6 +550,12 @@ void Vector::fetch(GraphicPipeline& gpu, std::vector<float>& output) const {
 }
 
 
+void Vector::fetch(std::vector<float>& output) const {
+    RuntimeError::check(isInRam(), "The vector is not allocated in RAM");
+    output = data;
+}
+
+
 size_t Vector::getMemorySize() const {
     switch (format) {
         case Format::FLOAT:
@@ -24,7 +24,8 @@
 namespace Beatmup {
     namespace GL {
         /**
-            Real-valued vector usable by GPU
+            Real-valued vector usable by GPU.
+            A vector may also be allocated in RAM to be used in computations on CPU. In this case it has no texture.
         */
         class Vector : public GL::TextureHandler {
         public:
@@ -42,6 +43,7 @@ namespace Beatmup {
             const Format format;            //!< data format
             const int size;                 //!< number of samples in the vector
             float mapScale, mapOffset;
+            std::vector<float> data;        //!< vector values, if the vector is allocated in RAM
 
             void prepare(GraphicPipeline& gpu);
         public:
@@ -60,6 +62,14 @@ namespace Beatmup {
             */
             Vector(Context& context, GraphicPipeline& gpu, const int size, const Format format, const float* values, const bool remap = false);
 
+            /**
+               Creates a vector in RAM to be used on CPU.
+               The vector has floating point format and is initialized with zeros.
+               \param[in] context       A context
+               \param[in] size          Size of the vector (number of scalar dimensions)
+            */
+            Vector(Context& context, const int size);
+
             ~Vector();
 
             /**
@@ -69,6 +79,23 @@ namespace Beatmup {
             */
             void fetch(GraphicPipeline& gpu, std::vector<float>& output) const;
 
+            /**
+                Copies values of a vector allocated in RAM to user memory.
+                \param[in] output        The output vector
+            */
+            void fetch(std::vector<float>& output) const;
+
+            /**
+                Returns `true` if the vector is allocated in RAM, `false` if it is stored in GPU memory.
+            */
+            inline bool isInRam() const { return !data.empty(); }
+
+            /**
+                Returns pointer to the vector values if the vector is allocated in RAM, null otherwise.
+            */
+            inline float* getData() { return data.empty() ? nullptr : data.data(); }
+            inline const float* getData() const { return data.empty() ? nullptr : data.data(); }
+
             inline Format getDataFormat() const { return format; }
 
             /**
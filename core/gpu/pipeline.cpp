@@ -24,6 +24,7 @@
 
 #include <algorithm>
 #include <map>
+#include <cstring>
 #include <vector>
 #include <deque>
 #include <mutex>
@@ -102,6 +103,25 @@ private:
     GLXPbuffer glxPbuffer;
 #endif
 
+#ifndef BEATMUP_OPENGLVERSION_GLES20
+    /**
+        Staging buffer receiving pixels read from a texture asynchronously
+    */
+    struct PixelPackBuffer {
+        GLuint handle;                      //!< pixel buffer object
+        msize capacity;                     //!< buffer size in bytes
+        GLsync fence;                       //!< fence signaled when the pixels are in the buffer; null if no pixels are pending
+        const AbstractBitmap* bitmap;       //!< bitmap the pending pixels belong to
+        GL::handle_t texture;               //!< texture the pending pixels are read from
+        msize size;                         //!< size of the pending pixel data in bytes
+    };
+
+    static const int NUM_PIXEL_PACK_BUFFERS = 3;
+    PixelPackBuffer pixelPackBuffers[NUM_PIXEL_PACK_BUFFERS];
+    int nextPixelPackBuffer;                //!< index of the staging buffer to use for the next asynchronous readback
+#endif
+    InternalBitmap* readbackBitmap;         //!< staging bitmap used when the pixels cannot be read in the bitmap format directly
+
     struct {
         int maxTextureImageUnits;
         int maxFragmentUniformVectors;
@@ -112,7 +132,12 @@ private:
     } glLimits;
 
 public:
-    Impl(GraphicPipeline& front) : front(front), glslVersion(0) {
+    Impl(GraphicPipeline& front) : front(front), glslVersion(0), readbackBitmap(nullptr) {
+#ifndef BEATMUP_OPENGLVERSION_GLES20
+        for (auto& buffer : pixelPackBuffers)
+            buffer = PixelPackBuffer{ 0, 0, nullptr, nullptr, 0, 0 };
+        nextPixelPackBuffer = 0;
+#endif
 
 #ifdef BEATMUP_OPENGLVERSION_GLES
         // Step 1 - Get the default display.
@@ -452,6 +477,14 @@ public:
 
 
     ~Impl() {
+#ifndef BEATMUP_OPENGLVERSION_GLES20
+        for (auto& buffer : pixelPackBuffers) {
+            releasePixelPackBuffer(buffer);
+            if (buffer.handle)
+                glDeleteBuffers(1, &buffer.handle);
+        }
+#endif
+        delete readbackBitmap;
         glDeleteFramebuffers(1, &hFrameBuffer);
 
 #ifdef BEATMUP_OPENGLVERSION_GLES
@@ -543,6 +576,8 @@ public:
 #else
 
         texture.prepare(front);
+        if (write)
+            cancelPendingReadback(texture.textureHandle);
 
         // if the following is not set, black images are out when writing with imageStore()
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -633,6 +668,7 @@ public:
 
 
     void bindOutput(GL::handle_t texture) {
+        cancelPendingReadback(texture);
         // setting up a texture
         glBindFramebuffer(GL_FRAMEBUFFER, hFrameBuffer);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
@@ -655,14 +691,155 @@ public:
         return displayResolution;
     }
 
+#ifndef BEATMUP_OPENGLVERSION_GLES20
+    /**
+        Frees a staging buffer from pending pixels, if any.
+    */
+    void releasePixelPackBuffer(PixelPackBuffer& buffer) {
+        if (buffer.fence)
+            glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+        buffer.bitmap = nullptr;
+        buffer.texture = 0;
+    }
+
+
+    /**
+        Finds a staging buffer containing pending pixels of a given bitmap.
+        \return pointer to the buffer, or null if there are no pending pixels for the bitmap.
+    */
+    PixelPackBuffer* findPendingReadback(const AbstractBitmap& bitmap) {
+        for (auto& buffer : pixelPackBuffers)
+            if (buffer.fence && buffer.bitmap == &bitmap && buffer.texture == bitmap.textureHandle && buffer.size == bitmap.getMemorySize())
+                return &buffer;
+        return nullptr;
+    }
+#endif
+
+
+    /**
+        Drops pixels being read asynchronously from a given texture, e.g. when the texture content is about to change.
+    */
+    void cancelPendingReadback(GL::handle_t texture) {
+#ifndef BEATMUP_OPENGLVERSION_GLES20
+        for (auto& buffer : pixelPackBuffers)
+            if (buffer.fence && buffer.texture == texture)
+                releasePixelPackBuffer(buffer);
+#endif
+    }
+
+
+    /**
+        Starts transferring texture data from GPU to CPU. The pixels are read into a staging buffer with no wait.
+        \return `false` if the asynchronous transfer is not possible.
+    */
+    bool pullPixelsAsync(AbstractBitmap& bitmap) {
+#ifdef BEATMUP_OPENGLVERSION_GLES20
+        return false;
+#else
+        if (bitmap.isMask() || !bitmap.hasValidHandle() || !bitmap.isUpToDate(ProcessingTarget::GPU))
+            return false;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, hFrameBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bitmap.textureHandle, 0);
+
+        // only RGBA and the implementation-defined format/type pair are guaranteed to be readable to a pixel buffer
+        if (bitmap.getPixelFormat() != QuadByte && bitmap.getPixelFormat() != QuadFloat) {
+            GLint format, type;
+            glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_FORMAT, &format);
+            glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_TYPE, &type);
+            if (GL::BITMAP_PIXELFORMATS[bitmap.getPixelFormat()] != (GLuint)format || GL::BITMAP_PIXELTYPES[bitmap.getPixelFormat()] != (GLuint)type)
+                return false;
+        }
+
+        // pick a staging buffer: the one already used for this bitmap, or the next one in the ring
+        PixelPackBuffer* buffer = findPendingReadback(bitmap);
+        if (!buffer) {
+            buffer = &pixelPackBuffers[nextPixelPackBuffer];
+            nextPixelPackBuffer = (nextPixelPackBuffer + 1) % NUM_PIXEL_PACK_BUFFERS;
+        }
+        releasePixelPackBuffer(*buffer);
+
+        const msize size = bitmap.getMemorySize();
+        if (!buffer->handle)
+            glGenBuffers(1, &buffer->handle);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer->handle);
+        if (buffer->capacity < size) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+            buffer->capacity = size;
+        }
+
+        // read pixels in the buffer
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, bitmap.getWidth(), bitmap.getHeight(),
+            GL::BITMAP_PIXELFORMATS[bitmap.getPixelFormat()],
+            GL::BITMAP_PIXELTYPES[bitmap.getPixelFormat()],
+            nullptr
+        );
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        GL::GLException::check("reading pixel data to pixel buffer");
+
+        buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        buffer->bitmap = &bitmap;
+        buffer->texture = bitmap.textureHandle;
+        buffer->size = size;
+        glFlush();      // make sure the readback is submitted to the GPU
+        return true;
+#endif
+    }
+
+
+    /**
+        Completes an asynchronous transfer of texture data from GPU to CPU, if any. The bitmap is assumed locked.
+        \return `true` if the bitmap pixels are got from a staging buffer.
+    */
+    bool completePendingReadback(AbstractBitmap& bitmap) {
+#ifdef BEATMUP_OPENGLVERSION_GLES20
+        return false;
+#else
+        PixelPackBuffer* buffer = findPendingReadback(bitmap);
+        if (!buffer)
+            return false;
+
+        // wait for the pixels, typically already there
+        GLenum status;
+        do {
+            status = glClientWaitSync(buffer->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while (status == GL_TIMEOUT_EXPIRED);
+        if (status == GL_WAIT_FAILED) {
+            releasePixelPackBuffer(*buffer);
+            throw GL::GLException("waiting for pixel data");
+        }
+
+        // copy them to the bitmap
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer->handle);
+        const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer->size, GL_MAP_READ_BIT);
+        if (data)
+            memcpy(bitmap.getData(0, 0), data, buffer->size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        releasePixelPackBuffer(*buffer);
+        if (!data)
+            throw GL::GLException("mapping pixel buffer");
+        return true;
+#endif
+    }
+
+
     /**
         Transfers texture data from GPU to CPU. The bitmap is assumed locked.
+        If the pixels are being transferred asynchronously, the transfer is completed.
     */
     void pullPixels(AbstractBitmap& bitmap) {
 #ifdef BEATMUP_DEBUG
         DebugAssertion::check(bitmap.getData(0, 0) != nullptr, "Cannot pull pixels: the bitmap is not locked");
 #endif
 
+        if (completePendingReadback(bitmap)) {
+            bitmap.upToDate[ProcessingTarget::CPU] = true;
+            return;
+        }
+
 #ifdef BEATMUP_OPENGLVERSION_GLES20
         if (bitmap.isFloat())
             throw GL::Unsupported("Floating point valued bitmaps are not updatable from GPU memory");
@@ -688,11 +865,17 @@ public:
         }
 #endif
 
-        // copy data with a buffer
+        // copy data with a buffer, reused across calls
         if (buffered) {
-            InternalBitmap buffer(bitmap.getContext(),
-                bitmap.isFloat() ? PixelFormat::QuadFloat : PixelFormat::QuadByte,
-                bitmap.getWidth(), bitmap.getHeight());
+            const PixelFormat bufferFormat = bitmap.isFloat() ? PixelFormat::QuadFloat : PixelFormat::QuadByte;
+            if (!readbackBitmap || &readbackBitmap->getContext() != &bitmap.getContext() || readbackBitmap->getPixelFormat() != bufferFormat
+                || readbackBitmap->getWidth() != bitmap.getWidth() || readbackBitmap->getHeight() != bitmap.getHeight())
+            {
+                delete readbackBitmap;
+                readbackBitmap = nullptr;
+                readbackBitmap = new InternalBitmap(bitmap.getContext(), bufferFormat, bitmap.getWidth(), bitmap.getHeight());
+            }
+            InternalBitmap& buffer = *readbackBitmap;
 
             {
                 AbstractBitmap::WriteLock<ProcessingTarget::CPU> lock(buffer);
@@ -728,6 +911,7 @@ public:
     */
     void pushPixels(AbstractBitmap& bitmap) {
         bitmap.prepare(front);
+        cancelPendingReadback(bitmap.textureHandle);
 
         // pushing data if any
         if (bitmap.getTextureFormat() != GL::TextureHandler::TextureFormat::OES_Ext) {
@@ -923,6 +1107,11 @@ void GraphicPipeline::pullPixels(AbstractBitmap& bitmap) {
 }
 
 
+bool GraphicPipeline::pullPixelsAsync(AbstractBitmap& bitmap) {
+    return impl->pullPixelsAsync(bitmap);
+}
+
+
 void GraphicPipeline::pushPixels(AbstractBitmap& bitmap) {
     impl->pushPixels(bitmap);
 }
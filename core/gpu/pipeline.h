@@ -102,9 +102,20 @@ namespace Beatmup {
 
         /**
             Transfers bitmap pixels from GPU to CPU. The bitmap is assumed locked.
+            If the pixels are being transferred by pullPixelsAsync(), the transfer is completed.
         */
         void pullPixels(AbstractBitmap& bitmap);
 
+        /**
+            Starts transferring bitmap pixels from GPU to CPU without waiting for the GPU.
+            The pixels are read into one of few staging pixel buffers reused across calls, so that the GPU keeps processing the commands
+            submitted afterwards. The transfer is completed by pullPixels(), typically called when the bitmap is locked for reading on
+            CPU; the pixels are then only copied from the staging buffer. The transfer is dropped if the bitmap content changes on GPU in
+            the meantime, or if the staging buffer is needed for other bitmaps. The bitmap CPU memory is not accessed.
+            \return `false` if not supported (GL ES 2.0 or mask bitmaps), in which case pullPixels() reads the pixels synchronously.
+        */
+        bool pullPixelsAsync(AbstractBitmap& bitmap);
+
         /**
             Transfers bitmap pixels from CPU to GPU. The bitmap is assumed locked.
         */
@@ -18,6 +18,7 @@
 
 #include "program.h"
 #include "pipeline.h"
+#include "program_cache.h"
 #include "bgl.h"
 
 using namespace Beatmup;
@@ -271,6 +272,8 @@ void AbstractProgram::loadBinary(const Chunk& binary) {
     // convention: first sizeof(GLenum) bytes store the binary format
     glProgramBinary(handle, binary.at<GLenum>(0), binary.ptr<GLenum>(1), binary.size() - sizeof(GLenum));
     GL::GLException::check("loading program binary");
+    assertLinked();
+    clearCaches();
 }
 #endif
 
@@ -540,11 +543,35 @@ RenderingProgram::RenderingProgram(const GraphicPipeline& gpu, const VertexShade
 }
 
 
+RenderingProgram::RenderingProgram(const GraphicPipeline& gpu, const std::string& fragmentShaderCode, Extensions extensions, ProgramCache& cache):
+    Program(gpu)
+{
+    glBindAttribLocation(getHandle(), GraphicPipeline::ATTRIB_TEXTURE_COORD, RenderingPrograms::TEXTURE_COORD_ATTRIB_NAME);
+    glBindAttribLocation(getHandle(), GraphicPipeline::ATTRIB_VERTEX_COORD,  RenderingPrograms::VERTEX_COORD_ATTRIB_NAME);
+    make(gpu, fragmentShaderCode, extensions, cache);
+}
+
+
 void RenderingProgram::link(const GraphicPipeline& gpu, const FragmentShader& fragmentShader) {
     Program::link(gpu.getDefaultVertexShader(), fragmentShader);
 }
 
 
+void RenderingProgram::make(const GraphicPipeline& gpu, const std::string& fragmentShaderCode, Extensions extensions, ProgramCache& cache) {
+    const std::string key = ProgramCache::getRenderingProgramKey(fragmentShaderCode, extensions);
+    if (!cache.load(gpu, *this, key)) {
+        FragmentShader fragmentShader(gpu, fragmentShaderCode, extensions);
+        link(gpu, fragmentShader);
+        cache.store(gpu, *this, key);
+    }
+
+    // setting common stuff
+    enable(gpu);
+    setMatrix3(RenderingPrograms::MODELVIEW_MATRIX_ID, AffineMapping::IDENTITY);
+    setInteger(RenderingPrograms::VERTICAL_FLIP_ID, 1);
+}
+
+
 void RenderingProgram::blend(bool onScreen) {
     setInteger(RenderingPrograms::VERTICAL_FLIP_ID, onScreen ? 0 : 1);
     blend();
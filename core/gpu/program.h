@@ -28,6 +28,7 @@
 namespace Beatmup {
     namespace GL {
        class Program;
+       class ProgramCache;
 
         /** \page BeatmupGLSLDialect %Beatmup GLSL dialect
          * %Beatmup tries to take advantage of OpenGL acceleration on a large spectrum of hardware, from low-end inexpensive GPUs to high-end ones.
@@ -150,6 +151,11 @@ namespace Beatmup {
 
 #ifndef BEATMUP_OPENGLVERSION_GLES20
             Chunk* getBinary() const;
+
+            /**
+                Loads a program binary got with getBinary(), possibly in another process, and checks the program is linked.
+                Throws GLException if the binary is rejected by the driver.
+            */
             void loadBinary(const Chunk& binary);
 #endif
 
@@ -241,7 +247,27 @@ namespace Beatmup {
         public:
             RenderingProgram(const GraphicPipeline& gpu, const FragmentShader&);
             RenderingProgram(const GraphicPipeline& gpu, const VertexShader&, const FragmentShader&);
+
+            /**
+                Creates a program using the default vertex shader from a fragment shader source code.
+                The program binary is taken from a cache if available, otherwise the program is compiled and stored in the cache.
+                \param[in] gpu                  A graphic pipeline instance
+                \param[in] fragmentShaderCode   The fragment shader source code
+                \param[in] extensions           Extensions to compile the fragment shader with
+                \param[in] cache                The program binaries cache
+            */
+            RenderingProgram(const GraphicPipeline& gpu, const std::string& fragmentShaderCode, Extensions extensions, ProgramCache& cache);
+
             void link(const GraphicPipeline& gpu, const FragmentShader&);
+
+            /**
+                Relinks the program with a new fragment shader, taking the program binary from a cache if available.
+                \param[in] gpu                  A graphic pipeline instance
+                \param[in] fragmentShaderCode   The fragment shader source code
+                \param[in] extensions           Extensions to compile the fragment shader with
+                \param[in] cache                The program binaries cache
+            */
+            void make(const GraphicPipeline& gpu, const std::string& fragmentShaderCode, Extensions extensions, ProgramCache& cache);
             void blend(bool onScreen);
             void blend();
         };
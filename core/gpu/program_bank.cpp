@@ -17,6 +17,7 @@
 */
 
 #include "program_bank.h"
+#include "../gpu/program_cache.h"
 #include "../gpu/recycle_bin.h"
 #include <vector>
 
@@ -42,8 +43,7 @@ GL::RenderingProgram* GL::ProgramBank::operator()(GraphicPipeline& gpu, const st
 
     // not found; create
     GL::Extensions ext = enableExternalTextures ? GL::Extensions::EXTERNAL_TEXTURE : GL::Extensions::NONE;
-    GL::FragmentShader fragmentShader(gpu, code, Extensions::BEATMUP_DIALECT + ext);
-    GL::RenderingProgram* program = new GL::RenderingProgram(gpu, fragmentShader);
+    GL::RenderingProgram* program = new GL::RenderingProgram(gpu, code, Extensions::BEATMUP_DIALECT + ext, context.getProgramCache());
     cache.emplace(std::make_pair(code, ProgramHolder{ program, 1 }));
     return program;
 }
@@ -27,6 +27,7 @@ namespace Beatmup {
     namespace GL {
         /**
             Stores linked GLSL programs and their associated fragment shader codes.
+            New programs are taken from the context program cache when possible (see Context::getProgramCache()).
         */
         class ProgramBank : public Object {
         private:
@@ -49,6 +50,7 @@ namespace Beatmup {
             /**
                 Provides a program given a fragment shader source code.
                 Creates a new program or returns an available one increasing its user count (do not call this too often).
+                A new program binary is loaded from the context program cache if available; otherwise the program is compiled and stored in the cache.
                 \param[in] gpu                      A graphic pipeline instance
                 \param[in] code                     The fragment shader code of the program
                 \param[in] enableExternalTextures   If `true`, external texture extension is enabled in the program, for example, to access camera image in Android
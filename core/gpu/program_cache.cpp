@@ -0,0 +1,222 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "program_cache.h"
+#include "pipeline.h"
+#include "rendering_programs.h"
+#include "bgl.h"
+#include "../utils/chunkfile.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <thread>
+
+using namespace Beatmup;
+using namespace GL;
+
+
+static const char* CACHE_VERSION = "Beatmup program cache 1";     // to change when the cache files become incompatible
+
+#ifndef BEATMUP_OPENGLVERSION_GLES20
+static const char
+    *CHUNK_DRIVER = "driver",           // GPU and driver identification strings
+    *CHUNK_KEY = "key",                 // program source code
+    *CHUNK_BINARY = "binary";           // binary format followed by the binary itself, as returned by AbstractProgram::getBinary()
+#endif
+
+
+/**
+    64-bit FNV-1a hash
+*/
+static uint64_t hashString(const std::string& str) {
+    uint64_t result = 14695981039346656037ULL;
+    for (const char c : str) {
+        result ^= (unsigned char)c;
+        result *= 1099511628211ULL;
+    }
+    return result;
+}
+
+
+ProgramCache::ProgramCache() : stats{ 0, 0, 0, 0 } {}
+
+
+static std::string makeFilename(const std::string& directory, const std::string& key) {
+    static const char* HEX_DIGITS = "0123456789abcdef";
+    uint64_t hash = hashString(key);
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; --i, hash >>= 4)
+        name[i] = HEX_DIGITS[hash & 15];
+    return directory + "/" + name + ".bin";
+}
+
+
+std::string ProgramCache::getFilename(const std::string& key) {
+    std::lock_guard<std::mutex> lock(access);
+    return directory.empty() ? std::string() : makeFilename(directory, key);
+}
+
+
+std::string ProgramCache::getDriverId(const GraphicPipeline& gpu) {
+    std::string id = std::string(CACHE_VERSION) + "\n" + gpu.getGpuVendorString() + "\n" + gpu.getGpuRendererString() + "\n" + (const char*)glGetString(GL_VERSION);
+    id += "\nGLSL " + std::to_string(gpu.getGlslVersion()) + (gpu.isGlEsCompliant() ? " es" : "");
+    return id;
+}
+
+
+bool ProgramCache::isSupported(const GraphicPipeline& gpu) {
+#ifdef BEATMUP_OPENGLVERSION_GLES20
+    return false;
+#else
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    return numFormats > 0;
+#endif
+}
+
+
+void ProgramCache::setDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(access);
+    this->directory = directory;
+    while (this->directory.size() > 1 && (this->directory.back() == '/' || this->directory.back() == '\\'))
+        this->directory.pop_back();
+}
+
+
+std::string ProgramCache::getDirectory() {
+    std::lock_guard<std::mutex> lock(access);
+    return directory;
+}
+
+
+bool ProgramCache::isEnabled() {
+    std::lock_guard<std::mutex> lock(access);
+    return !directory.empty();
+}
+
+
+bool ProgramCache::load(const GraphicPipeline& gpu, AbstractProgram& program, const std::string& key) {
+#ifdef BEATMUP_OPENGLVERSION_GLES20
+    return false;
+#else
+    std::string filename;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        if (directory.empty())
+            return false;
+        filename = makeFilename(directory, key);
+    }
+
+    // check the file is there and is built for the same program by the same driver
+    bool valid = isSupported(gpu) && ChunkFile::readable(filename);
+    Chunk binary;
+    if (valid) {
+        ChunkFile file(filename);
+        valid = file.chunkExists(CHUNK_BINARY) && file.chunkSize(CHUNK_BINARY) > sizeof(GLenum)
+            && file.read<std::string>(CHUNK_DRIVER) == getDriverId(gpu)
+            && file.read<std::string>(CHUNK_KEY) == key;
+        if (valid)
+            binary = Chunk(file, CHUNK_BINARY);
+    }
+
+    if (!valid) {
+        std::lock_guard<std::mutex> lock(access);
+        stats.misses++;
+        return false;
+    }
+
+    // load the binary; the driver may still reject it
+    try {
+        program.loadBinary(binary);
+    }
+    catch (const GL::GLException&) {
+        std::lock_guard<std::mutex> lock(access);
+        stats.rejections++;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(access);
+    stats.hits++;
+    return true;
+#endif
+}
+
+
+void ProgramCache::store(const GraphicPipeline& gpu, const AbstractProgram& program, const std::string& key) {
+#ifndef BEATMUP_OPENGLVERSION_GLES20
+    std::string filename;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        if (directory.empty())
+            return;
+        filename = makeFilename(directory, key);
+    }
+
+    if (!isSupported(gpu))
+        return;
+
+    // write to a temporary file first, so that a concurrent reader never sees an incomplete file
+    const std::string tempFilename = filename + "." + std::to_string(
+        std::hash<std::thread::id>()(std::this_thread::get_id()) ^ (size_t)std::chrono::steady_clock::now().time_since_epoch().count()
+    );
+    try {
+        std::unique_ptr<Chunk> binary(program.getBinary());
+        if (binary->size() <= sizeof(GLenum))
+            return;
+        const std::string driverId = getDriverId(gpu);
+        ChunkFileWriter file(tempFilename);
+        file(CHUNK_DRIVER, driverId.data(), driverId.size());
+        file(CHUNK_KEY, key.data(), key.size());
+        binary->writeTo(file, CHUNK_BINARY);
+    }
+    catch (const Exception&) {
+        std::remove(tempFilename.c_str());
+        return;
+    }
+
+    // replace the existing file, if any
+    if (std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+        std::remove(filename.c_str());
+        if (std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+            std::remove(tempFilename.c_str());
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(access);
+    stats.stores++;
+#endif
+}
+
+
+ProgramCache::Statistics ProgramCache::getStatistics() {
+    std::lock_guard<std::mutex> lock(access);
+    return stats;
+}
+
+
+std::string ProgramCache::getRenderingProgramKey(const std::string& fragmentShaderCode, Extensions extensions) {
+    return "rendering " + std::to_string(extensions) + "\n" + RenderingPrograms::getDefaultVertexShaderCode() + "\n" + fragmentShaderCode;
+}
+
+
+std::string ProgramCache::getComputeProgramKey(const std::string& computeShaderCode) {
+    return "compute\n" + computeShaderCode;
+}
@@ -0,0 +1,128 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "../basic_types.h"
+#include "../exception.h"
+#include "program.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace Beatmup {
+    class GraphicPipeline;
+
+    namespace GL {
+        /**
+            On-disk cache of linked GLSL program binaries.
+            Compiling and linking a program from source may take from few to hundreds of milliseconds depending on the driver, which adds up
+            when many programs are built at once, e.g. when preparing a neural network. The cache stores the program binaries got from the
+            driver in a directory, one file per program named after a hash of the program source code, and loads them back instead of
+            compiling the source code again.
+            Every file keeps the cache format version, the strings identifying the GPU and the driver version the binary is built by, and the
+            program source code, including the default vertex shader of rendering programs. Binaries built by a different GPU or driver version,
+            for a different source code or in an older cache format, corrupted or rejected by the driver are ignored: the program is then compiled
+            from source and the cache file is rewritten.
+            The cache is disabled until a directory is set. Binaries are not available with OpenGL ES 2.0, so the cache has no effect there.
+            Used by ProgramBank, ImageShader and the neural network-based x2 upsampler; accessible through Context::getProgramCache().
+        */
+        class ProgramCache : public Object {
+        public:
+            /**
+                Cache usage statistics
+            */
+            struct Statistics {
+                uint64_t hits;              //!< number of programs loaded from binaries
+                uint64_t misses;            //!< number of programs having no valid binary in the cache
+                uint64_t rejections;        //!< number of binaries found in the cache but rejected by the driver
+                uint64_t stores;            //!< number of binaries written to the cache
+            };
+
+        private:
+            std::mutex access;
+            std::string directory;          //!< directory containing the binaries; the cache is disabled if empty
+            Statistics stats;
+
+            ProgramCache(const ProgramCache&) = delete;
+
+            static std::string getDriverId(const GraphicPipeline& gpu);
+            static bool isSupported(const GraphicPipeline& gpu);
+
+        public:
+            ProgramCache();
+
+            /**
+                Sets the directory to store the program binaries in. The directory is expected to exist.
+                \param[in] directory    The directory path. If empty, the cache is disabled.
+            */
+            void setDirectory(const std::string& directory);
+
+            /**
+                \return the directory storing the program binaries, empty if the cache is disabled.
+            */
+            std::string getDirectory();
+
+            /**
+                \return `true` if a cache directory is set.
+            */
+            bool isEnabled();
+
+            /**
+                Loads a program binary from the cache.
+                \param[in] gpu          A graphic pipeline instance
+                \param[in] program      A program to load the binary in. Expected not linked.
+                \param[in] key          The program source code, as returned by getRenderingProgramKey() or getComputeProgramKey()
+                \return `true` if the program is loaded and linked, `false` if it needs to be compiled from source.
+            */
+            bool load(const GraphicPipeline& gpu, AbstractProgram& program, const std::string& key);
+
+            /**
+                Stores a program binary in the cache. Does nothing if the cache is disabled. Failing to write the binary is not an error.
+                \param[in] gpu          A graphic pipeline instance
+                \param[in] program      A linked program
+                \param[in] key          The program source code, as returned by getRenderingProgramKey() or getComputeProgramKey()
+            */
+            void store(const GraphicPipeline& gpu, const AbstractProgram& program, const std::string& key);
+
+            /**
+                \return path to the file storing the binary of a program in the cache, empty if the cache is disabled.
+                \param[in] key          The program source code, as returned by getRenderingProgramKey() or getComputeProgramKey()
+            */
+            std::string getFilename(const std::string& key);
+
+            /**
+                \return cache usage statistics.
+            */
+            Statistics getStatistics();
+
+            /**
+                Builds a cache key of a RenderingProgram using the default vertex shader.
+                \param[in] fragmentShaderCode   The fragment shader source code
+                \param[in] extensions           Extensions the fragment shader is compiled with
+            */
+            static std::string getRenderingProgramKey(const std::string& fragmentShaderCode, Extensions extensions);
+
+            /**
+                Builds a cache key of a ComputeProgram.
+                \param[in] computeShaderCode     The compute shader source code
+            */
+            static std::string getComputeProgramKey(const std::string& computeShaderCode);
+        };
+    }
+}
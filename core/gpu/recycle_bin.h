@@ -67,6 +67,11 @@ namespace Beatmup {
                 Empty the bin destroying all the items in a GPU-aware thread
             */
             void emptyBin();
+
+            /**
+                \return the context the bin belongs to.
+            */
+            inline Context& getContext() const { return ctx; }
         };
     }
 }
@@ -392,3 +392,8 @@ void RenderingPrograms::paveBackground(GraphicPipeline* gpu, TextureHandler& con
 const VertexShader& RenderingPrograms::getDefaultVertexShader(const GraphicPipeline* gpu) const {
     return defaultVertexShader;
 }
+
+
+const char* RenderingPrograms::getDefaultVertexShaderCode() {
+    return VERTEX_SHADER_BLEND;
+}
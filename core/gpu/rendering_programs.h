@@ -102,6 +102,11 @@ namespace Beatmup {
             */
             const VertexShader& getDefaultVertexShader(const GraphicPipeline* gpu) const;
 
+            /**
+                \return source code of the default blending vertex shader.
+            */
+            static const char* getDefaultVertexShaderCode();
+
             RenderingPrograms(GraphicPipeline* gpu);
             ~RenderingPrograms();
 
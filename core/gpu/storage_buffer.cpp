@@ -109,12 +109,12 @@ void Beatmup::GL::StorageBuffer::fetchToBitmap(GraphicPipeline& gpu, size_t offs
     const pixbyte* buffer = (const pixbyte*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, offset, limit - offset, GL_MAP_READ_BIT);
     const bool okay = buffer != nullptr;
     if (okay) {
-        pixbyte* ptr = bitmap.getData(0, 0);
-        const int
-            nPix = bitmap.getSize().numPixels(),
-            step = bitmap.getBitsPerPixel() / 8;
-        for (int i = 0; i < nPix; ++i, ptr += step, buffer += stride)
-            memcpy(ptr, buffer, step);
+        const int step = bitmap.getBitsPerPixel() / 8;
+        for (int y = 0; y < bitmap.getHeight(); ++y) {
+            pixbyte* ptr = bitmap.getData(0, y);
+            for (int x = 0; x < bitmap.getWidth(); ++x, ptr += step, buffer += stride)
+                memcpy(ptr, buffer, step);
+        }
     }
     glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
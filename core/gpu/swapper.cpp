@@ -24,6 +24,14 @@ using namespace Beatmup;
 
 bool Swapper::processOnGPU(GraphicPipeline& gpu, TaskThread&) {
     BitmapContentLock lock;
+    if (async && fromGpuToCpu) {
+        lock.readLock(&gpu, bitmap, ProcessingTarget::GPU);
+        const bool started = gpu.pullPixelsAsync(*bitmap);
+        lock.unlockAll();
+        if (started)
+            return true;
+    }
+
     lock.writeLock(&gpu, bitmap, ProcessingTarget::CPU);
     lock.writeLock(&gpu, bitmap, ProcessingTarget::GPU);
 
@@ -36,7 +44,7 @@ bool Swapper::processOnGPU(GraphicPipeline& gpu, TaskThread&) {
     return true;
 }
 
-Swapper::Swapper(bool fromGpuToCpu) : bitmap(nullptr), fromGpuToCpu(fromGpuToCpu)
+Swapper::Swapper(bool fromGpuToCpu, bool async) : bitmap(nullptr), fromGpuToCpu(fromGpuToCpu), async(async)
 {}
 
 
@@ -54,6 +62,15 @@ void Swapper::pullPixels(AbstractBitmap& bitmap) {
 }
 
 
+void Swapper::pullPixelsAsync(AbstractBitmap& bitmap) {
+    if (!bitmap.isUpToDate(ProcessingTarget::CPU) && bitmap.isUpToDate(ProcessingTarget::GPU)) {
+        Swapper me(true, true);
+        me.setBitmap(bitmap);
+        bitmap.getContext().performTask(me);
+    }
+}
+
+
 void Swapper::pushPixels(AbstractBitmap& bitmap) {
     if (!bitmap.isUpToDate(ProcessingTarget::GPU) && bitmap.isUpToDate(ProcessingTarget::CPU)) {
         Swapper me(false);
@@ -26,10 +26,11 @@ namespace Beatmup {
     private:
         AbstractBitmap* bitmap;
         bool fromGpuToCpu;
+        bool async;
         bool processOnGPU(GraphicPipeline& gpu, TaskThread&);
 
     public:
-        Swapper(bool fromGpuToCpu);
+        Swapper(bool fromGpuToCpu, bool async = false);
         void setBitmap(AbstractBitmap&);
 
         /**
@@ -37,6 +38,13 @@ namespace Beatmup {
         */
         static void pullPixels(AbstractBitmap& bitmap);
 
+        /**
+            Starts copying bitmap from GPU memory to RAM with no wait for the pixels.
+            The copy is completed when the bitmap is locked for reading on CPU next time.
+            Falls back to a synchronous copy if not supported by the GPU.
+        */
+        static void pullPixelsAsync(AbstractBitmap& bitmap);
+
         /**
             Copies bitmap from RAM to GPU memory
         */
@@ -0,0 +1,156 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "texture_pool.h"
+#include "bgl.h"
+#include <cstring>
+
+using namespace Beatmup;
+using namespace GL;
+
+
+const size_t TexturePool::DEFAULT_CAPACITY = 64 * 1024 * 1024;
+
+
+TexturePool::TexturePool(RecycleBin& recycleBin, size_t capacity):
+    capacity(capacity), recycleBin(recycleBin)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+TexturePool::~TexturePool() {
+    trim();
+}
+
+
+size_t TexturePool::getTextureSize(int width, int height, TextureHandler::TextureFormat format) {
+    return (size_t)width * height * TextureHandler::TEXTURE_FORMAT_BYTES_PER_PIXEL[format];
+}
+
+
+void TexturePool::evictOldest(std::vector<handle_t>& victims) {
+    const Texture& texture = cache.front();
+    auto bucket = buckets.find(texture.key);
+    bucket->second.pop_front();
+    if (bucket->second.empty())
+        buckets.erase(bucket);
+    victims.push_back(texture.handle);
+    stats.cachedTextures--;
+    stats.cachedBytes -= texture.size;
+    stats.evictions++;
+    cache.pop_front();
+}
+
+
+void TexturePool::dispose(const std::vector<handle_t>& victims) {
+    class Deleter : public RecycleBin::Item {
+        std::vector<handle_t> handles;
+    public:
+        Deleter(const std::vector<handle_t>& handles) : handles(handles) {}
+        ~Deleter() {
+            glDeleteTextures((GLsizei)handles.size(), handles.data());
+        }
+    };
+
+    if (!victims.empty())
+        recycleBin.put(new Deleter(victims));
+}
+
+
+bool TexturePool::acquire(int width, int height, TextureHandler::TextureFormat format, handle_t& handle) {
+    if (format == TextureHandler::TextureFormat::OES_Ext)
+        return false;
+
+    std::lock_guard<std::mutex> lock(access);
+    if (capacity == 0)
+        return false;
+
+    // taking the most recently released texture of the same size and format, if any
+    auto bucket = buckets.find(Key{ width, height, format });
+    if (bucket == buckets.end()) {
+        stats.misses++;
+        return false;
+    }
+
+    auto it = bucket->second.back();
+    bucket->second.pop_back();
+    if (bucket->second.empty())
+        buckets.erase(bucket);
+    handle = it->handle;
+    stats.cachedTextures--;
+    stats.cachedBytes -= it->size;
+    stats.hits++;
+    cache.erase(it);
+    return true;
+}
+
+
+void TexturePool::release(handle_t handle, int width, int height, TextureHandler::TextureFormat format) {
+    std::vector<handle_t> victims;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        const size_t size = getTextureSize(width, height, format);
+        if (format == TextureHandler::TextureFormat::OES_Ext || size > capacity)
+            victims.push_back(handle);
+        else {
+            const Key key{ width, height, format };
+            cache.push_back(Texture{ handle, key, size });
+            buckets[key].push_back(--cache.end());
+            stats.cachedTextures++;
+            stats.cachedBytes += size;
+            while (stats.cachedBytes > capacity)
+                evictOldest(victims);
+        }
+    }
+
+    dispose(victims);
+}
+
+
+void TexturePool::trim(size_t bytesToKeep) {
+    std::vector<handle_t> victims;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        while (stats.cachedBytes > bytesToKeep)
+            evictOldest(victims);
+    }
+
+    dispose(victims);
+}
+
+
+void TexturePool::setCapacity(size_t capacity) {
+    {
+        std::lock_guard<std::mutex> lock(access);
+        this->capacity = capacity;
+    }
+    trim(capacity);
+}
+
+
+size_t TexturePool::getCapacity() {
+    std::lock_guard<std::mutex> lock(access);
+    return capacity;
+}
+
+
+TexturePool::Statistics TexturePool::getStatistics() {
+    std::lock_guard<std::mutex> lock(access);
+    return stats;
+}
@@ -0,0 +1,142 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "texture_handler.h"
+#include "recycle_bin.h"
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+
+namespace Beatmup {
+    namespace GL {
+
+        /**
+            Pool of GPU textures reused by texture handlers.
+            Frame-by-frame processing tends to destroy and create many same-sized bitmaps and tensors. Instead of deleting their textures, the
+            pool keeps the textures of destroyed bitmaps and tensors and hands them out again to new ones of the same size and format. This
+            avoids allocating texture storage on GPU for every frame.
+            The amount of GPU memory kept in the pool is capped; least recently released textures are evicted first when the cap is reached.
+            The evicted textures are put into the recycle bin and deleted when it is emptied.
+            Masks and external images are not pooled. The pool is thread-safe.
+        */
+        class TexturePool {
+        public:
+            static const size_t DEFAULT_CAPACITY;      //!< default max total size of textures kept in the pool, in bytes
+
+            /**
+                Pool usage statistics
+            */
+            struct Statistics {
+                uint64_t hits;              //!< number of textures served from the pool
+                uint64_t misses;            //!< number of textures requiring a new allocation
+                uint64_t evictions;         //!< number of textures deleted to keep the pool within its capacity
+                size_t cachedTextures;      //!< number of free textures kept in the pool
+                size_t cachedBytes;         //!< total size of free textures kept in the pool
+            };
+
+        private:
+            struct Key {
+                int width, height;
+                TextureHandler::TextureFormat format;
+
+                inline bool operator<(const Key& another) const {
+                    return width < another.width || (width == another.width &&
+                        (height < another.height || (height == another.height && format < another.format)));
+                }
+            };
+
+            struct Texture {
+                handle_t handle;
+                Key key;
+                size_t size;                //!< texture size in bytes
+            };
+
+            std::mutex access;
+            std::list<Texture> cache;                                           //!< free textures, least recently released first
+            std::map<Key, std::deque<std::list<Texture>::iterator>> buckets;    //!< free textures per size and format, least recently released first
+            size_t capacity;                                                    //!< max total size of free textures in the pool
+            RecycleBin& recycleBin;                                             //!< the bin receiving evicted textures
+            Statistics stats;
+
+            TexturePool(const TexturePool&) = delete;
+
+            void evictOldest(std::vector<handle_t>& victims);
+            void dispose(const std::vector<handle_t>& victims);
+
+        public:
+            /**
+                Creates a texture pool.
+                \param[in] recycleBin   The recycle bin to put evicted textures into
+                \param[in] capacity     Maximum size in bytes of free textures kept in the pool
+            */
+            TexturePool(RecycleBin& recycleBin, size_t capacity = DEFAULT_CAPACITY);
+            ~TexturePool();
+
+            /**
+                Computes the GPU memory size taken by a texture.
+                \param[in] width        Texture width in pixels
+                \param[in] height       Texture height in pixels
+                \param[in] format       Texture format
+                \return the size in bytes.
+            */
+            static size_t getTextureSize(int width, int height, TextureHandler::TextureFormat format);
+
+            /**
+                Takes a texture of a given size and format from the pool, if any.
+                The texture storage is allocated; its content is undefined.
+                \param[in] width        Texture width in pixels
+                \param[in] height       Texture height in pixels
+                \param[in] format       Texture format
+                \param[out] handle      The texture handle, if found
+                \return `true` if a texture is found, `false` otherwise (the texture is to be created and allocated by the caller).
+            */
+            bool acquire(int width, int height, TextureHandler::TextureFormat format, handle_t& handle);
+
+            /**
+                Returns a texture to the pool. The texture storage must be allocated for the given size and format.
+                If the pool is disabled or the texture is an external image, the texture is put into the recycle bin.
+                \param[in] handle       The texture handle
+                \param[in] width        Texture width in pixels
+                \param[in] height       Texture height in pixels
+                \param[in] format       Texture format
+            */
+            void release(handle_t handle, int width, int height, TextureHandler::TextureFormat format);
+
+            /**
+                Evicts least recently released textures until the total size of free textures in the pool does not exceed a given value.
+                \param[in] bytesToKeep  Size in bytes of free textures allowed to be kept in the pool
+            */
+            void trim(size_t bytesToKeep = 0);
+
+            /**
+                Sets the maximum total size of free textures kept in the pool. If exceeded, least recently released textures are evicted.
+                \param[in] capacity     The size in bytes; 0 disables pooling
+            */
+            void setCapacity(size_t capacity);
+
+            size_t getCapacity();
+
+            /**
+                \return pool usage statistics.
+            */
+            Statistics getStatistics();
+        };
+    }
+}
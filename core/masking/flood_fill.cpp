@@ -20,13 +20,92 @@
 #include "region_filling.h"
 #include "../bitmap/processing.h"
 #include "../bitmap/internal_bitmap.h"
+#include <algorithm>
+#include <climits>
 #include <cstring>
 
 using namespace Beatmup;
 
 
+static const int
+    MIN_PARALLEL_AREA = 1 << 20,            //!< minimum mask size in pixels to process a single seed by multiple threads
+    MIN_PIXELS_PER_THREAD = 1 << 18,        //!< minimum mask size in pixels per thread when processing a single seed
+    BAND_HEIGHT = 64,                       //!< height of bands of rows processed in parallel; multiple of 8 to not to share mask bytes
+    SEQUENTIAL_FILL_FRACTION = 16;          //!< a single thread is first tried to discover up to this fraction of the area
+
+
+/**
+    Reorders border points of a region in the order they are reached by a breadth-first search starting from the seed.
+    Contours are traced from border points in their order, so that the order is made independent from the way the region is discovered.
+    \param[in] spans        The region spans
+    \param[in] seed         The seed position in the input bitmap
+    \param[in] maskPos      The mask position in the input bitmap
+    \param[in,out] border   The border points in mask coordinates
+    \param[in] start        Index of the first border point of the region
+*/
+static void orderBreadthFirst(const std::vector<FloodFill::Span>& spans, IntPoint seed, IntPoint maskPos, std::vector<IntPoint>& border, size_t start) {
+    if (border.size() <= start)
+        return;
+
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+    for (const auto& span : spans) {
+        x0 = std::min(x0, span.x0);
+        x1 = std::max(x1, span.x1);
+        y0 = std::min(y0, span.y);
+        y1 = std::max(y1, span.y);
+    }
+
+    // marking the region and its border
+    static const unsigned char REGION = 1, BORDER = 2, VISITED = 4;
+    const int width = x1 - x0 + 1, height = y1 - y0 + 1;
+    std::vector<unsigned char> map((size_t)width * height, 0);
+    for (const auto& span : spans)
+        std::memset(map.data() + (size_t)(span.y - y0) * width + span.x0 - x0, REGION, span.x1 - span.x0 + 1);
+    for (size_t i = start; i < border.size(); ++i)
+        map[(size_t)(border[i].y + maskPos.y - y0) * width + border[i].x + maskPos.x - x0] |= BORDER;
+
+    // going through the region
+    std::vector<IntPoint> ordered;
+    ordered.reserve(border.size() - start);
+    std::vector<size_t> queue;
+    size_t head = 0;
+    auto visit = [&](size_t i) {
+        if ((map[i] & (REGION | VISITED)) == REGION) {
+            map[i] |= VISITED;
+            queue.push_back(i);
+        }
+    };
+    visit((size_t)(seed.y - y0) * width + seed.x - x0);
+
+    while (head < queue.size()) {
+        const size_t i = queue[head++];
+        const int x = (int)(i % width), y = (int)(i / width);
+        if (map[i] & BORDER)
+            ordered.push_back(IntPoint(x + x0 - maskPos.x, y + y0 - maskPos.y));
+        if (x > 0)
+            visit(i - 1);
+        if (y > 0)
+            visit(i - width);
+        if (x < width - 1)
+            visit(i + 1);
+        if (y < height - 1)
+            visit(i + width);
+
+        // dropping the processed part of the queue from time to time
+        if (head >= 65536 && 2 * head >= queue.size()) {
+            queue.erase(queue.begin(), queue.begin() + head);
+            head = 0;
+        }
+    }
+
+    border.resize(start);
+    border.insert(border.end(), ordered.begin(), ordered.end());
+}
+
+
 FloodFill::FloodFill():
-    input(nullptr), output(nullptr), maskPos(0, 0), bounds(0,0,0,0), borderMorphology(NONE), tolerance(0), borderHold(0), borderRelease(0), computeContours(false)
+    input(nullptr), output(nullptr), maskPos(0, 0), bounds(0,0,0,0), borderMorphology(NONE), tolerance(0), borderHold(0), borderRelease(0), computeContours(false),
+    inParallel(false), filledSequentially(false), seedAlone(false), firstBand(0), bandCount(0), seedRoot(0)
 {}
 
 
@@ -73,25 +152,196 @@ void FloodFill::setComputeContours(bool compute) {
 
 
 ThreadIndex FloodFill::getMaxThreads() const {
+    // a single seed in a big mask is processed by multiple threads
+    if (seeds.size() == 1 && output) {
+        const int maskSize = output->getWidth() * output->getHeight();
+        if (maskSize >= MIN_PARALLEL_AREA)
+            return validThreadCount(maskSize / MIN_PIXELS_PER_THREAD);
+    }
     return validThreadCount((int)seeds.size());
 }
 
 
+int FloodFill::findRoot(int run) const {
+    while (runParent[run] != run)
+        run = runParent[run];
+    return run;
+}
+
+
+void FloodFill::unite(int run1, int run2) {
+    // finding roots halving the paths
+    while (runParent[run1] != run1)
+        run1 = runParent[run1] = runParent[runParent[run1]];
+    while (runParent[run2] != run2)
+        run2 = runParent[run2] = runParent[runParent[run2]];
+    // the lowest index becomes the root
+    if (run1 < run2)
+        runParent[run2] = run1;
+    else
+        runParent[run1] = run2;
+}
+
+
+void FloodFill::connectRows(int row) {
+    const std::vector<Span>& upper = rowRuns[row - 1], &lower = rowRuns[row];
+    size_t i = 0, j = 0;
+    while (i < upper.size() && j < lower.size()) {
+        if (upper[i].x1 >= lower[j].x0 && lower[j].x1 >= upper[i].x0)
+            unite(rowRunsOffset[row - 1] + (int)i, rowRunsOffset[row] + (int)j);
+        if (upper[i].x1 < lower[j].x1)
+            ++i;
+        else
+            ++j;
+    }
+}
+
+
+void FloodFill::getBandRows(int band, int& start, int& stop) const {
+    start = std::max(area.a.y, maskPos.y + band * BAND_HEIGHT);
+    stop = std::min(area.b.y + 1, maskPos.y + (band + 1) * BAND_HEIGHT);
+}
+
+
+void FloodFill::fillInParallel(TaskThread& thread, std::vector<IntPoint>& border, IntRectangle& bounds) {
+    const IntPoint seed = seeds[0];
+
+    // Trying to discover the area by a single thread first: a small area in a big mask does not need the entire input bitmap to be
+    // scanned. If the area turns out to be big, the mask is restored and the area is discovered in parallel.
+    if (thread.isManaging()) {
+        std::vector<Span> stack;
+        const msize maxPixels = std::max<msize>(1, (msize)(area.width() + 1) * (area.height() + 1) / SEQUENTIAL_FILL_FRACTION);
+        spans.clear();
+        BitmapProcessing::pipelineWithMaskOutput<Kernels::FillRegion>(*input, *output, maskPos, area, seed, tolerance, spans, stack, maxPixels, filledSequentially);
+        if (filledSequentially) {
+            BitmapProcessing::read<Kernels::FindBorder>(*input, maskPos, area, seed, tolerance, spans.data(), spans.data() + spans.size(), border, bounds);
+            if (computeContours)
+                orderBreadthFirst(spans, seed, maskPos, border, 0);
+        }
+    }
+    thread.synchronize();
+    if (filledSequentially)
+        return;
+
+    // finding runs of pixels close enough to the seed in every row
+    msize start, stop;
+    while (thread.nextChunk(bandCount, 1, start, stop))
+        for (int band = (int)start; band < (int)stop; ++band) {
+            int startRow, stopRow;
+            getBandRows(firstBand + band, startRow, stopRow);
+            BitmapProcessing::pipelineWithMaskOutput<Kernels::FindRuns>(*input, *output, maskPos, area, seed, tolerance, startRow, stopRow, rowRuns.data());
+        }
+    thread.synchronize();
+
+    // numbering the runs
+    if (thread.isManaging()) {
+        rowRunsOffset.resize(rowRuns.size() + 1);
+        rowRunsOffset[0] = 0;
+        for (size_t row = 0; row < rowRuns.size(); ++row)
+            rowRunsOffset[row + 1] = rowRunsOffset[row] + (int)rowRuns[row].size();
+        runParent.resize(rowRunsOffset.back());
+        for (int run = 0; run < (int)runParent.size(); ++run)
+            runParent[run] = run;
+    }
+    thread.synchronize();
+
+    // connecting runs within every band
+    while (thread.nextChunk(bandCount, 1, start, stop))
+        for (int band = (int)start; band < (int)stop; ++band) {
+            int startRow, stopRow;
+            getBandRows(firstBand + band, startRow, stopRow);
+            for (int row = startRow + 1; row < stopRow; ++row)
+                connectRows(row - area.a.y);
+        }
+    thread.synchronize();
+
+    // connecting bands and finding the seed run
+    if (thread.isManaging()) {
+        for (int band = 1; band < bandCount; ++band) {
+            int startRow, stopRow;
+            getBandRows(firstBand + band, startRow, stopRow);
+            connectRows(startRow - area.a.y);
+        }
+
+        const int seedRow = seed.y - area.a.y;
+        const std::vector<Span>& runs = rowRuns[seedRow];
+        int run = 0;
+        while (runs[run].x1 < seed.x)
+            ++run;
+        seedRoot = findRoot(rowRunsOffset[seedRow] + run);
+
+        // checking if any neighbor of the seed is to fill
+        seedAlone = runs[run].x0 == runs[run].x1;
+        for (int row = seedRow - 1; row <= seedRow + 1 && seedAlone; row += 2)
+            if (row >= 0 && row < (int)rowRuns.size())
+                for (const auto& neighbor : rowRuns[row])
+                    if (neighbor.x0 <= seed.x && seed.x <= neighbor.x1)
+                        seedAlone = false;
+    }
+    thread.synchronize();
+
+    // filling the runs connected to the seed and finding border points
+    while (thread.nextChunk(bandCount, 1, start, stop))
+        for (int band = (int)start; band < (int)stop; ++band) {
+            int startRow, stopRow;
+            getBandRows(firstBand + band, startRow, stopRow);
+            std::vector<Span>& myspans = bandSpans[band];
+            myspans.clear();
+            for (int row = startRow - area.a.y; row < stopRow - area.a.y; ++row)
+                for (size_t run = 0; run < rowRuns[row].size(); ++run)
+                    if (findRoot(rowRunsOffset[row] + (int)run) == seedRoot)
+                        myspans.push_back(rowRuns[row][run]);
+            if (!seedAlone)
+                BitmapProcessing::pipelineWithMaskOutput<Kernels::FillRuns>(*input, *output, maskPos, seed, tolerance, myspans);
+            bandBorder[band].clear();
+            BitmapProcessing::read<Kernels::FindBorder>(*input, maskPos, area, seed, tolerance, myspans.data(), myspans.data() + myspans.size(), bandBorder[band], bounds);
+        }
+    thread.synchronize();
+
+    // collecting border points in a single thread
+    if (thread.isManaging()) {
+        for (const auto& points : bandBorder)
+            border.insert(border.end(), points.begin(), points.end());
+        if (computeContours) {
+            spans.clear();
+            for (const auto& runs : bandSpans)
+                spans.insert(spans.end(), runs.begin(), runs.end());
+            orderBreadthFirst(spans, seed, maskPos, border, 0);
+        }
+    }
+}
+
+
 bool FloodFill::process(TaskThread& thread) {
     std::vector<IntPoint> border;
     border.reserve((output->getWidth() + output->getHeight()) * 2);
 
     std::vector<IntegerContour2D*> myContours;
     IntRectangle bounds;
-    bounds.a = bounds.b = seeds[thread.currentThread()];
 
-    for (int n = thread.currentThread(); n < seeds.size(); n += thread.numThreads())
-        if (!thread.isTaskAborted()) {
-            IntPoint seed = seeds[n];
-            if (seed.x >= maskPos.x && seed.y >= maskPos.y && seed.x < maskPos.x + output->getWidth() && seed.y < maskPos.x + output->getHeight()) {
-                BitmapProcessing::pipelineWithMaskOutput<Kernels::FillRegion>(*input, *output, maskPos, seed, tolerance, border, bounds);
+    if (inParallel) {
+        bounds.a = bounds.b = seeds[0];
+        fillInParallel(thread, border, bounds);
+    }
+
+    else {
+        bounds.a = bounds.b = seeds[thread.currentThread()];
+        std::vector<Span> regionSpans, stack;
+        for (int n = thread.currentThread(); n < (int)seeds.size(); n += thread.numThreads())
+            if (!thread.isTaskAborted()) {
+                IntPoint seed = seeds[n];
+                if (area.isInside(seed)) {
+                    const size_t firstBorderPoint = border.size();
+                    bool completed;
+                    regionSpans.clear();
+                    BitmapProcessing::pipelineWithMaskOutput<Kernels::FillRegion>(*input, *output, maskPos, area, seed, tolerance, regionSpans, stack, (msize)0, completed);
+                    BitmapProcessing::read<Kernels::FindBorder>(*input, maskPos, area, seed, tolerance,
+                        regionSpans.data(), regionSpans.data() + regionSpans.size(), border, bounds);
+                    if (computeContours)
+                        orderBreadthFirst(regionSpans, seed, maskPos, border, firstBorderPoint);
+                }
             }
-        }
+    }
 
     // compute contours
     if (!thread.isTaskAborted())
@@ -146,11 +396,36 @@ void FloodFill::beforeProcessing(ThreadIndex threadCount, ProcessingTarget targe
         std::memset(ignoredSeeds->getData(0, 0), 0, ignoredSeeds->getMemorySize());
     }
     bounds.a = bounds.b = seeds[0];
+
+    // the part of the input bitmap covered by the mask
+    area = IntRectangle(
+        std::max(0, maskPos.x),
+        std::max(0, maskPos.y),
+        std::min(input->getWidth(), maskPos.x + output->getWidth()) - 1,
+        std::min(input->getHeight(), maskPos.y + output->getHeight()) - 1
+    );
+
+    // setting up processing of a single seed by multiple threads
+    inParallel = seeds.size() == 1 && threadCount > 1 && area.isInside(seeds[0]);
+    if (inParallel) {
+        filledSequentially = false;
+        firstBand = (area.a.y - maskPos.y) / BAND_HEIGHT;
+        bandCount = (area.b.y - maskPos.y) / BAND_HEIGHT - firstBand + 1;
+        rowRuns.resize(area.height() + 1);
+        bandBorder.resize(bandCount);
+        bandSpans.resize(bandCount);
+    }
 }
 
 
 void FloodFill::afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted) {
     unlock(input, output);
+    spans.clear();
+    rowRuns.clear();
+    rowRunsOffset.clear();
+    runParent.clear();
+    bandBorder.clear();
+    bandSpans.clear();
     if (computeContours) {
         unlock(ignoredSeeds);
         delete ignoredSeeds;
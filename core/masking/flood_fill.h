@@ -32,6 +32,9 @@ namespace Beatmup {
         corresponding pixels are set to `1`. The rest of the output image remains unchanged.
         Optionally, computes contours around the discovered areas and stores the contour positions.
         Also optionally, applies post-processing by dilating or eroding the discovered regions in the output image.
+        The areas are discovered span by span (horizontal runs of pixels). When several seeds are given, they are distributed among threads.
+        A single seed in a large image is processed by all the threads together: if the area turns out to be big, the image is split into
+        bands of rows, runs of pixels close enough to the seed are found in every band in parallel and then connected to each other.
     */
     class FloodFill : public AbstractTask, private BitmapContentLock {
     public:
@@ -44,6 +47,14 @@ namespace Beatmup {
             ERODE				//!< apply an erosion
         };
 
+        /**
+            \internal
+            Horizontal run of pixels from x0 to x1 inclusive in row y, in input bitmap coordinates
+        */
+        struct Span {
+            int y, x0, x1;
+        };
+
     protected:
         AbstractBitmap
             *input,									//!< input bitmap
@@ -63,6 +74,26 @@ namespace Beatmup {
             borderRelease;
         bool computeContours;					//!< if `true`, border contours will be computed per each seed
 
+        // single seed processed by multiple threads
+        bool inParallel;                            //!< if `true`, the single seed is processed by all the threads
+        bool filledSequentially;                    //!< if `true`, the area is discovered by a single thread and there is no need in other threads
+        bool seedAlone;                             //!< if `true`, the seed has no neighbors to fill
+        IntRectangle area;                          //!< part of the input bitmap covered by the mask (closed rectangle)
+        int firstBand, bandCount;                   //!< bands of rows processed in parallel
+        int seedRoot;                               //!< union-find root of the run containing the seed
+        std::vector<Span> spans;                    //!< spans of the discovered area
+        std::vector<std::vector<Span>> rowRuns;     //!< runs of pixels close enough to the seed in every row of the area
+        std::vector<int> rowRunsOffset;             //!< index of the first run of every row in the union-find forest
+        std::vector<int> runParent;                 //!< union-find forest of connected runs
+        std::vector<std::vector<IntPoint>> bandBorder;      //!< border points found in every band of rows
+        std::vector<std::vector<Span>> bandSpans;           //!< spans of the discovered area in every band of rows
+
+        int findRoot(int run) const;
+        void unite(int run1, int run2);
+        void connectRows(int row);
+        void getBandRows(int band, int& start, int& stop) const;
+        void fillInParallel(TaskThread& thread, std::vector<IntPoint>& border, IntRectangle& bounds);
+
     public:
         FloodFill();
         ~FloodFill();
@@ -17,124 +17,314 @@
 */
 
 #pragma once
+#include "flood_fill.h"
 #include "../bitmap/abstract_bitmap.h"
 #include "../geometry.h"
-#include <queue>
-#include <mutex>
+#include <vector>
 
 using namespace Beatmup;
 
 namespace Kernels {
     /**
-        Region filling kernel implementing flood fill starting from a given seed
+        Flood fill criterion: tells whether a pixel is close enough to the seed and computes its mask value
+    */
+    template<typename in_t> class FillCriterion {
+    public:
+        typedef typename in_t::pixtype::operating_type inpixvaltype;
+
+    private:
+        in_t in;
+        const typename in_t::pixtype ref;   // reference input value
+        const inpixvaltype tolerance;
+        const int range;
+
+    public:
+        FillCriterion(AbstractBitmap& input, IntPoint seed, inpixvaltype tolerance, int range):
+            in(input), ref(in(seed.x, seed.y)), tolerance(tolerance), range(range)
+        {}
+
+        /**
+            Tests a pixel
+            \param x, y         The pixel position in the input bitmap
+            \param value        Mask value of the pixel if it is close enough to the seed
+            \return `true` if the pixel is close enough to the seed.
+        */
+        inline bool test(int x, int y, unsigned char& value) {
+            const inpixvaltype diff = (in(x, y) - ref).abs().max();
+            if (diff > tolerance)
+                return false;
+            value = (tolerance > 0 && diff > 0) ? (range * (tolerance - diff) / tolerance + 1) : range;
+            return true;
+        }
+
+        inline bool test(int x, int y) {
+            return (in(x, y) - ref).abs().max() <= tolerance;
+        }
+    };
+
+
+    /**
+        Region filling kernel implementing flood fill starting from a given seed.
+        A pixel is filled if it is connected to the seed through pixels close enough to the seed and if its current mask value is lower than
+        the one to be set. The area is discovered span by span: a span is extended to the left and to the right as far as possible, then the
+        rows above and below it are scanned for new spans.
     */
     template<typename in_t, typename out_t> class FillRegion {
     public:
         typedef typename in_t::pixtype::operating_type inpixvaltype;
+
         /**
             Fills a region in an output bitmap starting from a given position in an input bitmap
-            \param input        Input bitmap reader
-            \param output       Output mask writer
+            \param input        Input bitmap
+            \param output       Output mask
             \param maskOffset   Mask position in the bitmap
+            \param area         Part of the input bitmap covered by the mask (closed rectangle)
             \param seed         Entry point
             \param tolerance    Tolerance level: how much a pixel has to be different from seed to not to be filled
-            \param border       A vector to put border points to for further processing
-            \param bounds       Bounding box of the filled region; the input value is updated but not reset
+            \param spans        A vector to put the spans of the filled region to
+            \param stack        Spans to scan around; passed from outside to reuse the memory
+            \param maxPixels    If not zero, the filling is abandoned and the mask is restored once this number of pixels is exceeded
+            \param completed    Set to `false` if abandoned, `true` otherwise
         */
         static void process(
             AbstractBitmap& input,
             AbstractBitmap& output,
             IntPoint maskOffset,
+            IntRectangle area,
             IntPoint seed,
             inpixvaltype tolerance,
-            std::vector<IntPoint>& border,
-            IntRectangle& bounds
+            std::vector<FloodFill::Span>& spans,
+            std::vector<FloodFill::Span>& stack,
+            msize maxPixels,
+            bool& completed
         ) {
-            in_t in(input);
             out_t out(output);
+            FillCriterion<in_t> criterion(input, seed, tolerance, out.MAX_UNNORM_VALUE);
 
-            const int
-                W = in.getWidth() - 1, H = in.getHeight() - 1,
-                MW = out.getWidth() - 1, MH = out.getHeight() - 1;
+            // changes made to the mask, kept to be able to abandon
+            struct Change {
+                IntPoint pos;
+                unsigned char value;
+            };
+            std::vector<Change> changes;
 
-            std::queue<IntPoint> queue;
-            queue.push(IntPoint(seed.x, seed.y));
-            in.goTo(seed.x, seed.y);
+            // fills a pixel if needed, returns `true` if filled
+            auto fill = [&](int x, int y) -> bool {
+                unsigned char newval;
+                if (!criterion.test(x, y, newval))
+                    return false;
+                out.goTo(x - maskOffset.x, y - maskOffset.y);
+                const unsigned char oldval = out.getValue();
+                if (oldval >= newval)
+                    return false;
+                if (maxPixels > 0)
+                    changes.push_back(Change{ IntPoint(x, y), oldval });
+                out.putValue(newval);
+                return true;
+            };
 
-            const typename in_t::pixtype ref = in();	// reference input value
-            const int range = out.MAX_UNNORM_VALUE;
+            // The seed is always part of the region, whatever its mask value is. It is marked right away to not to be filled twice, but
+            // it keeps its original mask value if none of its neighbors is filled.
+            out.goTo(seed.x - maskOffset.x, seed.y - maskOffset.y);
+            const unsigned char seedValue = out.getValue();
+            if (seedValue < out.MAX_UNNORM_VALUE)
+                out.putValue(out.MAX_UNNORM_VALUE);
 
-            inpixvaltype diff;
-            unsigned char newval, oldval;
+            const size_t firstSpan = spans.size();
+            msize numPixels = 0;
+            stack.clear();
 
-            // performance critical cycle
-            while (!queue.empty()) {
-                // popping from queue front
-                IntPoint p = queue.front();
-                queue.pop();
-                int
-                    mx = p.x - maskOffset.x,
-                    my = p.y - maskOffset.y;
+            // finds a span containing a given pixel that is already filled
+            auto addSpan = [&](int x, int y) {
+                int x0 = x, x1 = x;
+                while (x0 > area.a.x && fill(x0 - 1, y))
+                    --x0;
+                while (x1 < area.b.x && fill(x1 + 1, y))
+                    ++x1;
+                const FloodFill::Span span{ y, x0, x1 };
+                spans.push_back(span);
+                stack.push_back(span);
+                numPixels += x1 - x0 + 1;
+                return x1;
+            };
 
-                // checking neighbor pixels
-                bool onBorder = false;
+            addSpan(seed.x, seed.y);
 
-                if (p.x > 0 && mx > 0 && (diff = (in(p.x - 1, p.y) - ref).abs().max()) <= tolerance) {
-                    newval = (tolerance > 0 && diff > 0) ? (range * (tolerance - diff) / tolerance + 1) : out.MAX_UNNORM_VALUE;
-                    out.goTo(mx - 1, my);
-                    oldval = out.getValue();
-                    if (oldval < newval) {
-                        out.putValue(newval);
-                        queue.push(IntPoint(p.x - 1, p.y));
+            while (!stack.empty()) {
+                if (maxPixels > 0 && numPixels > maxPixels) {
+                    // abandoning: restoring the mask
+                    for (auto it = changes.rbegin(); it != changes.rend(); ++it) {
+                        out.goTo(it->pos.x - maskOffset.x, it->pos.y - maskOffset.y);
+                        out.putValue(it->value);
                     }
+                    out.goTo(seed.x - maskOffset.x, seed.y - maskOffset.y);
+                    out.putValue(seedValue);
+                    spans.resize(firstSpan);
+                    completed = false;
+                    return;
                 }
-                else onBorder = true;
 
-                if (p.y > 0 && my > 0 && (diff = (in(p.x, p.y - 1) - ref).abs().max()) <= tolerance) {
-                    newval = (tolerance > 0 && diff > 0) ? (range * (tolerance - diff) / tolerance + 1) : out.MAX_UNNORM_VALUE;
-                    out.goTo(mx, my - 1);
-                    oldval = out.getValue();
-                    if (oldval < newval) {
-                        out.putValue(newval);
-                        queue.push(IntPoint(p.x, p.y - 1));
+                const FloodFill::Span span = stack.back();
+                stack.pop_back();
+
+                // scanning the rows above and below
+                for (int y = span.y - 1; y <= span.y + 1; y += 2)
+                    if (y >= area.a.y && y <= area.b.y)
+                        for (int x = span.x0; x <= span.x1; ++x)
+                            if (fill(x, y))
+                                x = addSpan(x, y) + 1;
+            }
+
+            // restoring the seed value if the seed is alone
+            if (numPixels == 1) {
+                out.goTo(seed.x - maskOffset.x, seed.y - maskOffset.y);
+                out.putValue(seedValue);
+            }
+
+            completed = true;
+        }
+    };
+
+
+    /**
+        Finds runs of pixels to fill in rows of an input bitmap without changing the mask
+    */
+    template<typename in_t, typename out_t> class FindRuns {
+    public:
+        typedef typename in_t::pixtype::operating_type inpixvaltype;
+
+        /**
+            Finds runs of pixels to fill
+            \param input        Input bitmap
+            \param output       Output mask
+            \param maskOffset   Mask position in the bitmap
+            \param area         Part of the input bitmap covered by the mask (closed rectangle)
+            \param seed         Entry point; always included in a run
+            \param tolerance    Tolerance level: how much a pixel has to be different from seed to not to be filled
+            \param start        First row to process
+            \param stop         Row to stop processing at
+            \param runs         Vectors to put the runs to, per row of the area
+        */
+        static void process(
+            AbstractBitmap& input,
+            AbstractBitmap& output,
+            IntPoint maskOffset,
+            IntRectangle area,
+            IntPoint seed,
+            inpixvaltype tolerance,
+            int start, int stop,
+            std::vector<FloodFill::Span>* runs
+        ) {
+            out_t out(output);
+            FillCriterion<in_t> criterion(input, seed, tolerance, out.MAX_UNNORM_VALUE);
+
+            for (int y = start; y < stop; ++y) {
+                std::vector<FloodFill::Span>& row = runs[y - area.a.y];
+                row.clear();
+                out.goTo(area.a.x - maskOffset.x, y - maskOffset.y);
+                int runStart = -1;
+                for (int x = area.a.x; x <= area.b.x; ++x, out++) {
+                    unsigned char newval;
+                    const bool inside = (criterion.test(x, y, newval) && out.getValue() < newval) || (x == seed.x && y == seed.y);
+                    if (inside) {
+                        if (runStart < 0)
+                            runStart = x;
+                    }
+                    else if (runStart >= 0) {
+                        row.push_back(FloodFill::Span{ y, runStart, x - 1 });
+                        runStart = -1;
                     }
                 }
-                else onBorder = true;
+                if (runStart >= 0)
+                    row.push_back(FloodFill::Span{ y, runStart, area.b.x });
+            }
+        }
+    };
+
+
+    /**
+        Fills given runs of pixels in a mask
+    */
+    template<typename in_t, typename out_t> class FillRuns {
+    public:
+        typedef typename in_t::pixtype::operating_type inpixvaltype;
 
-                if (p.x < W && mx < MW && (diff = (in(p.x + 1, p.y) - ref).abs().max()) <= tolerance) {
-                    newval = (tolerance > 0 && diff > 0) ? (range * (tolerance - diff) / tolerance + 1) : out.MAX_UNNORM_VALUE;
-                    out.goTo(mx + 1, my);
-                    oldval = out.getValue();
-                    if (oldval < newval) {
+        static void process(
+            AbstractBitmap& input,
+            AbstractBitmap& output,
+            IntPoint maskOffset,
+            IntPoint seed,
+            inpixvaltype tolerance,
+            const std::vector<FloodFill::Span>& runs
+        ) {
+            out_t out(output);
+            FillCriterion<in_t> criterion(input, seed, tolerance, out.MAX_UNNORM_VALUE);
+            for (const auto& run : runs) {
+                out.goTo(run.x0 - maskOffset.x, run.y - maskOffset.y);
+                for (int x = run.x0; x <= run.x1; ++x, out++) {
+                    unsigned char newval;
+                    if (criterion.test(x, run.y, newval) && out.getValue() < newval)
                         out.putValue(newval);
-                        queue.push(IntPoint(p.x + 1, p.y));
-                    }
                 }
-                else onBorder = true;
+            }
+        }
+    };
 
-                if (p.y < H && my < MH && (diff = (in(p.x, p.y + 1) - ref).abs().max()) <= tolerance) {
-                    newval = (tolerance > 0 && diff > 0) ? (range * (tolerance - diff) / tolerance + 1) : out.MAX_UNNORM_VALUE;
-                    out.goTo(mx, my + 1);
-                    oldval = out.getValue();
-                    if (oldval < newval) {
-                        out.putValue(newval);
-                        queue.push(IntPoint(p.x, p.y + 1));
+
+    /**
+        Finds border points of a filled region: filled pixels having a neighbor not close enough to the seed or outside of the area
+    */
+    template<typename in_t> class FindBorder {
+    public:
+        typedef typename in_t::pixtype::operating_type inpixvaltype;
+
+        /**
+            Finds border points
+            \param input        Input bitmap
+            \param maskOffset   Mask position in the bitmap
+            \param area         Part of the input bitmap covered by the mask (closed rectangle)
+            \param seed         Entry point
+            \param tolerance    Tolerance level: how much a pixel has to be different from seed to not to be filled
+            \param begin, end   Spans of the filled region
+            \param border       A vector to put border points to (in mask coordinates)
+            \param bounds       Bounding box of the border points; the input value is updated but not reset
+        */
+        static void process(
+            AbstractBitmap& input,
+            IntPoint maskOffset,
+            IntRectangle area,
+            IntPoint seed,
+            inpixvaltype tolerance,
+            const FloodFill::Span* begin,
+            const FloodFill::Span* end,
+            std::vector<IntPoint>& border,
+            IntRectangle& bounds
+        ) {
+            FillCriterion<in_t> criterion(input, seed, tolerance, 1);
+            for (const FloodFill::Span* span = begin; span < end; ++span) {
+                const int y = span->y;
+                for (int x = span->x0; x <= span->x1; ++x) {
+                    // pixels within a span are close enough to the seed
+                    const bool onBorder =
+                        (x == span->x0 && (x <= area.a.x || !criterion.test(x - 1, y))) ||
+                        y <= area.a.y || !criterion.test(x, y - 1) ||
+                        (x == span->x1 && (x >= area.b.x || !criterion.test(x + 1, y))) ||
+                        y >= area.b.y || !criterion.test(x, y + 1);
+
+                    if (onBorder) {
+                        const int mx = x - maskOffset.x, my = y - maskOffset.y;
+                        border.push_back(IntPoint(mx, my));
+
+                        if (mx < bounds.a.x)
+                            bounds.a.x = mx;
+                        if (mx > bounds.b.x)
+                            bounds.b.x = mx;
+                        if (my < bounds.a.y)
+                            bounds.a.y = my;
+                        if (my > bounds.b.y)
+                            bounds.b.y = my;
                     }
                 }
-                else onBorder = true;
-
-                if (onBorder) {
-                    border.push_back(IntPoint(mx, my));
-
-                    if (mx < bounds.a.x)
-                        bounds.a.x = mx;
-                    if (mx > bounds.b.x)
-                        bounds.b.x = mx;
-                    if (my < bounds.a.y)
-                        bounds.a.y = my;
-                    if (my > bounds.b.y)
-                        bounds.b.y = my;
-                }
             }
         }
     };
@@ -22,14 +22,18 @@
 #include <cstdlib>
 #include <cstdint>
 #include <cstring>
+#include <string>
+#include <vector>
 
 
 #if BEATMUP_PLATFORM_WINDOWS
     #include <windows.h>
+    #include <malloc.h>
     #undef min
     #undef max
 #else
     #include <unistd.h>
+    #include <sys/mman.h>
     #include <sys/statfs.h>
     #include <sys/sysinfo.h>
 #endif
@@ -67,7 +71,7 @@ uint64_t AlignedMemory::total() {
 }
 
 
-AlignedMemory::AlignedMemory(size_t size, size_t align) {
+AlignedMemory::AlignedMemory(size_t size, size_t align) : blockSize(0) {
 #ifdef BEATMUP_DEBUG
     DebugAssertion::check(size > 0, "Trying to allocate zero memory");
     BEATMUP_DEBUG_I("Allocating %lu Kbytes (%lu MB free)...", (unsigned long)(size / 1024), (unsigned long)(available() / 1048576));
@@ -84,27 +88,243 @@ AlignedMemory::AlignedMemory(size_t size, int value, size_t align): AlignedMemor
 }
 
 
+AlignedMemory::AlignedMemory(size_t size, MemoryPool& pool, size_t align): AlignedMemory() {
+    // small buffers, unusual alignment or disabled pooling: falling back to the system allocator
+    if (size < MemoryPool::MIN_BLOCK_SIZE || MemoryPool::MIN_ALIGNMENT % align != 0 || pool.getCapacity() == 0) {
+        *this = AlignedMemory(size, align);
+        return;
+    }
+    blockSize = MemoryPool::getBlockSize(size);
+    rawAddr = alignAddr = pool.acquire(blockSize);
+    link = pool.link;
+}
+
+
 AlignedMemory::~AlignedMemory() {
-    if (rawAddr)
-        std::free(rawAddr);
+    free();
 }
 
 
 AlignedMemory& AlignedMemory::operator=(AlignedMemory&& other) {
-    if (rawAddr)
-        std::free(rawAddr);
+    free();
     rawAddr = other.rawAddr;
     alignAddr = other.alignAddr;
+    link = std::move(other.link);
+    blockSize = other.blockSize;
     other.rawAddr = nullptr;
     other.alignAddr = nullptr;
+    other.blockSize = 0;
     return *this;
 }
 
 
 void AlignedMemory::free() {
     if (rawAddr) {
-        std::free(rawAddr);
+        if (link) {
+            std::lock_guard<std::mutex> lock(link->access);
+            if (link->pool)
+                link->pool->release(rawAddr, blockSize);
+            else
+                MemoryPool::freeBlock(rawAddr);     // the pool is gone
+        }
+        else
+            std::free(rawAddr);
         rawAddr = nullptr;
         alignAddr = nullptr;
+        link.reset();
+        blockSize = 0;
     }
 }
+
+
+const size_t
+    MemoryPool::MIN_BLOCK_SIZE = 4096,
+    MemoryPool::MIN_ALIGNMENT = 4096,
+    MemoryPool::HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+
+void* MemoryPool::allocateBlock(size_t size) {
+    const size_t align = size >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : MIN_ALIGNMENT;
+#if BEATMUP_PLATFORM_WINDOWS
+    return _aligned_malloc(size, align);
+#else
+    void* addr;
+    if (posix_memalign(&addr, align, size) != 0)
+        return nullptr;
+#ifdef MADV_HUGEPAGE
+    // letting the kernel back the block with transparent huge pages to reduce page faults and TLB misses
+    if (size >= HUGE_PAGE_SIZE)
+        madvise(addr, size, MADV_HUGEPAGE);
+#endif
+    return addr;
+#endif
+}
+
+
+void MemoryPool::freeBlock(void* addr) {
+#if BEATMUP_PLATFORM_WINDOWS
+    _aligned_free(addr);
+#else
+    std::free(addr);
+#endif
+}
+
+
+MemoryPool::MemoryPool(size_t capacity):
+    capacity(capacity > 0 ? capacity : (size_t)(AlignedMemory::total() / 16)),
+    lowMemoryThreshold(AlignedMemory::total() / 64),
+    link(new AlignedMemory::PoolLink())
+{
+    memset(&stats, 0, sizeof(stats));
+    link->pool = this;
+}
+
+
+MemoryPool::~MemoryPool() {
+    {
+        std::lock_guard<std::mutex> lock(link->access);
+        link->pool = nullptr;
+    }
+    for (auto& block : cache)
+        freeBlock(block.addr);
+}
+
+
+size_t MemoryPool::getBlockSize(size_t size) {
+    if (size <= MIN_BLOCK_SIZE)
+        return MIN_BLOCK_SIZE;
+    // finding the power of two below the size and rounding the size up to a quarter of it
+    size_t pow = MIN_BLOCK_SIZE;
+    while (2 * pow < size)
+        pow *= 2;
+    const size_t step = pow / 4;
+    size = (size + step - 1) / step * step;
+    return (size + MIN_ALIGNMENT - 1) / MIN_ALIGNMENT * MIN_ALIGNMENT;
+}
+
+
+void MemoryPool::evictOldest() {
+    const Block& block = cache.front();
+    auto bucket = buckets.find(block.size);
+    BEATMUP_ASSERT_DEBUG(bucket != buckets.end() && bucket->second.front() == cache.begin());
+    bucket->second.pop_front();
+    if (bucket->second.empty())
+        buckets.erase(bucket);
+    stats.cachedBlocks--;
+    stats.cachedBytes -= block.size;
+    stats.evictions++;
+    cache.pop_front();
+}
+
+
+void* MemoryPool::acquire(size_t size) {
+    std::vector<Block> victims;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        stats.usedBytes += size;
+        if (stats.usedBytes > stats.peakUsedBytes)
+            stats.peakUsedBytes = stats.usedBytes;
+
+        // taking the most recently released block of the same size class, if any
+        auto bucket = buckets.find(size);
+        if (bucket != buckets.end()) {
+            auto it = bucket->second.back();
+            bucket->second.pop_back();
+            if (bucket->second.empty())
+                buckets.erase(bucket);
+            void* addr = it->addr;
+            cache.erase(it);
+            stats.cachedBlocks--;
+            stats.cachedBytes -= size;
+            stats.hits++;
+            return addr;
+        }
+
+        // no luck; emptying the pool if running out of memory
+        stats.misses++;
+        if (!cache.empty() && AlignedMemory::available() < lowMemoryThreshold) {
+            stats.trims++;
+            victims.reserve(cache.size());
+            while (!cache.empty()) {
+                victims.push_back(cache.front());
+                evictOldest();
+            }
+        }
+    }
+
+    for (auto& block : victims)
+        freeBlock(block.addr);
+
+    void* addr = allocateBlock(size);
+    if (!addr) {
+        // freeing everything and retrying
+        trim();
+        addr = allocateBlock(size);
+        if (!addr) {
+            std::lock_guard<std::mutex> lock(access);
+            stats.usedBytes -= size;
+            throw RuntimeError("Cannot allocate " + std::to_string(size) + " bytes");
+        }
+    }
+    return addr;
+}
+
+
+void MemoryPool::release(void* addr, size_t size) {
+    std::vector<Block> victims;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        stats.usedBytes -= size;
+        if (size > capacity)
+            victims.push_back(Block{ addr, size });
+        else {
+            cache.push_back(Block{ addr, size });
+            buckets[size].push_back(--cache.end());
+            stats.cachedBlocks++;
+            stats.cachedBytes += size;
+            while (stats.cachedBytes > capacity) {
+                victims.push_back(cache.front());
+                evictOldest();
+            }
+        }
+    }
+
+    for (auto& block : victims)
+        freeBlock(block.addr);
+}
+
+
+void MemoryPool::trim(size_t bytesToKeep) {
+    std::vector<Block> victims;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        while (stats.cachedBytes > bytesToKeep) {
+            victims.push_back(cache.front());
+            evictOldest();
+        }
+    }
+
+    for (auto& block : victims)
+        freeBlock(block.addr);
+}
+
+
+void MemoryPool::setCapacity(size_t capacity) {
+    {
+        std::lock_guard<std::mutex> lock(access);
+        this->capacity = capacity;
+    }
+    trim(capacity);
+}
+
+
+void MemoryPool::setLowMemoryThreshold(uint64_t threshold) {
+    std::lock_guard<std::mutex> lock(access);
+    lowMemoryThreshold = threshold;
+}
+
+
+MemoryPool::Statistics MemoryPool::getStatistics() {
+    std::lock_guard<std::mutex> lock(access);
+    return stats;
+}
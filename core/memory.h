@@ -17,24 +17,53 @@
 */
 
 #pragma once
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 
 namespace Beatmup {
+    class MemoryPool;
+
     /**
         Aligned memory buffer
     */
     class AlignedMemory {
+        friend class MemoryPool;
     private:
+        /**
+            Link to a memory pool shared by the pool and the buffers taken from it.
+            The pool unsets it when destroyed, so that the buffers outliving the pool free their blocks directly.
+        */
+        struct PoolLink {
+            std::mutex access;
+            MemoryPool* pool;
+        };
+
         void* rawAddr;
         void* alignAddr;
+        std::shared_ptr<PoolLink> link;     //!< link to the pool the memory is taken from, or null if allocated with the system allocator
+        size_t blockSize;                   //!< size of the block taken from the pool in bytes
         AlignedMemory(const AlignedMemory&) = delete;
     public:
         static const size_t DEFAULT_ALIGNMENT;      //!< default number of bytes to align the address
 
-        AlignedMemory() : rawAddr(nullptr), alignAddr(nullptr) {}
+        AlignedMemory() : rawAddr(nullptr), alignAddr(nullptr), blockSize(0) {}
         AlignedMemory(size_t size, size_t align = DEFAULT_ALIGNMENT);
         AlignedMemory(size_t size, int value, size_t align = DEFAULT_ALIGNMENT);
+
+        /**
+            Allocates a buffer from a memory pool.
+            Small buffers are not pooled and taken from the system allocator as usual.
+            \param[in] size     Buffer size in bytes
+            \param[in] pool     The pool
+            \param[in] align    Number of bytes to align the address; cannot exceed MemoryPool::MIN_ALIGNMENT
+        */
+        AlignedMemory(size_t size, MemoryPool& pool, size_t align = DEFAULT_ALIGNMENT);
         ~AlignedMemory();
 
         AlignedMemory& operator=(AlignedMemory&&);
@@ -78,4 +107,113 @@ namespace Beatmup {
         */
         static uint64_t total();
     };
+
+
+    /**
+        Pool of memory blocks reused by AlignedMemory buffers.
+        Frame-by-frame processing tends to allocate and free many same-sized buffers (bitmaps, tensors). Instead of returning them
+        to the system allocator, the pool keeps the released blocks in buckets of size classes and hands them out again when a
+        buffer of a matching size is requested.
+        Size classes are spaced by a quarter of a power of two, so that at most 25% of a block is wasted. Blocks are page-aligned,
+        and large blocks are aligned to huge page boundaries and advised to be backed by huge pages where supported.
+        The amount of memory kept in the pool is capped; least recently released blocks are freed first when the cap is reached.
+        The pool is also emptied when the operating memory runs low.
+        The pool is thread-safe. Buffers may outlive the pool they are taken from; their blocks are then freed directly.
+    */
+    class MemoryPool {
+        friend class AlignedMemory;
+    public:
+        static const size_t MIN_BLOCK_SIZE;         //!< smaller buffers are not pooled
+        static const size_t MIN_ALIGNMENT;          //!< alignment of all the blocks in bytes
+        static const size_t HUGE_PAGE_SIZE;         //!< alignment of blocks larger than this size
+
+        /**
+            Pool usage statistics
+        */
+        struct Statistics {
+            uint64_t hits;              //!< number of allocations served from the pool
+            uint64_t misses;            //!< number of allocations requiring a new block
+            uint64_t evictions;         //!< number of blocks freed to keep the pool within its capacity or due to low memory
+            uint64_t trims;             //!< number of times the pool was emptied due to low memory
+            size_t cachedBlocks;        //!< number of free blocks kept in the pool
+            size_t cachedBytes;         //!< total size of free blocks kept in the pool
+            size_t usedBytes;           //!< total size of blocks currently in use
+            size_t peakUsedBytes;       //!< maximum total size of blocks in use at the same time
+        };
+
+    private:
+        struct Block {
+            void* addr;
+            size_t size;
+        };
+
+        std::mutex access;
+        std::list<Block> cache;                                         //!< free blocks, least recently released first
+        std::map<size_t, std::deque<std::list<Block>::iterator>> buckets;  //!< free blocks per size class, least recently released first
+        std::atomic<size_t> capacity;                                   //!< max total size of free blocks in the pool
+        uint64_t lowMemoryThreshold;                                    //!< available memory size below which the pool is emptied
+        Statistics stats;
+        std::shared_ptr<AlignedMemory::PoolLink> link;                  //!< link to this pool shared with the buffers taken from it
+
+        MemoryPool(const MemoryPool&) = delete;
+
+        static void* allocateBlock(size_t size);
+        static void freeBlock(void* addr);
+
+        void evictOldest();
+
+    public:
+        /**
+            Creates a memory pool.
+            \param[in] capacity     Maximum size in bytes of free blocks kept in the pool. By default, 1/16 of total operating memory.
+        */
+        MemoryPool(size_t capacity = 0);
+        ~MemoryPool();
+
+        /**
+            Computes the size of the block allocated for a buffer of a given size.
+            \param[in] size         Requested buffer size in bytes
+            \return the block size in bytes.
+        */
+        static size_t getBlockSize(size_t size);
+
+        /**
+            Takes a block from the pool or allocates a new one.
+            \param[in] size         Block size in bytes, as returned by getBlockSize()
+            \return pointer to the block.
+        */
+        void* acquire(size_t size);
+
+        /**
+            Returns a block to the pool.
+            \param[in] addr         Pointer to the block
+            \param[in] size         Block size in bytes
+        */
+        void release(void* addr, size_t size);
+
+        /**
+            Frees least recently released blocks until the total size of free blocks in the pool does not exceed a given value.
+            \param[in] bytesToKeep  Size in bytes of free blocks allowed to be kept in the pool
+        */
+        void trim(size_t bytesToKeep = 0);
+
+        /**
+            Sets the maximum total size of free blocks kept in the pool. If exceeded, least recently released blocks are freed.
+            \param[in] capacity     The size in bytes; 0 disables pooling
+        */
+        void setCapacity(size_t capacity);
+
+        /**
+            Sets the size of available operating memory below which the pool is emptied when allocating a new block.
+            \param[in] threshold    The size in bytes
+        */
+        void setLowMemoryThreshold(uint64_t threshold);
+
+        inline size_t getCapacity() const { return capacity; }
+
+        /**
+            \return pool usage statistics.
+        */
+        Statistics getStatistics();
+    };
 }
@@ -50,4 +50,23 @@ const std::vector<float>& Classifier::operator()(AbstractBitmap& input) {
 Job Classifier::start(AbstractBitmap& input) {
     connect(input, *ops[0], 0);
     return context.submitTask(*this);
-}
\ No newline at end of file
+}
+
+const std::vector<std::vector<float>>& Classifier::operator()(const std::vector<AbstractBitmap*>& inputs) {
+    connect(inputs, *ops[0], 0);
+    context.performTask(*this);
+    return batchProbabilities;
+}
+
+
+Job Classifier::start(const std::vector<AbstractBitmap*>& inputs) {
+    connect(inputs, *ops[0], 0);
+    return context.submitTask(*this);
+}
+
+
+void Classifier::afterInference(size_t batchIndex) {
+    if (batchProbabilities.size() != getBatchSize())
+        batchProbabilities.resize(getBatchSize());
+    batchProbabilities[batchIndex] = getProbabilities();
+}
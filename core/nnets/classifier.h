@@ -33,9 +33,14 @@ namespace Beatmup {
             Combines a runnable InferenceTask with a Model assuming Conv2D and Softmax are its first and last operations respectively.
         */
         class Classifier : public Model, public InferenceTask {
+        private:
+            std::vector<std::vector<float>> batchProbabilities;     //!< probabilities per class for every image of the last batch
+
         protected:
             Context& context;
 
+            void afterInference(size_t batchIndex) override;
+
         public:
             /**
                 Creates a Classifier instance.
@@ -62,6 +67,23 @@ namespace Beatmup {
             */
             Job start(AbstractBitmap& input);
 
+            /**
+                Classifies a batch of images (blocking).
+                The inference is run for all the images within a single task run, which saves the per-run overhead compared to classifying the
+                images one by one.
+                \param[in] inputs   The input images
+                \return a vector of probabilities per class for every input image.
+            */
+            const std::vector<std::vector<float>>& operator()(const std::vector<AbstractBitmap*>& inputs);
+
+            /**
+                Initiates the classification of a batch of images.
+                The call is non-blocking. Once the job is done, the results are available with getBatchProbabilities().
+                \param[in] inputs   The input images
+                \return a job corresponding to the submitted task.
+            */
+            Job start(const std::vector<AbstractBitmap*>& inputs);
+
             /**
                 Returns the last classification results.
                 \return a vector of probabilities per class.
@@ -69,6 +91,12 @@ namespace Beatmup {
             inline const std::vector<float>& getProbabilities() const {
                 return static_cast<const Softmax&>(getLastOperation()).getProbabilities();
             }
+
+            /**
+                Returns the last classification results of every image in the batch.
+                \return a vector of probabilities per class for every image.
+            */
+            inline const std::vector<std::vector<float>>& getBatchProbabilities() const { return batchProbabilities; }
         };
     }
 }
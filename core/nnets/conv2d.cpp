@@ -374,6 +374,137 @@ void Conv2D::execute(TaskThread& thread, GraphicPipeline& gpu) {
 }
 
 
+void Conv2D::prepare(ChunkCollection& data) {
+    RuntimeError::check((useInputImage && inputImage) || (!useInputImage && input), "Input is not provided to Conv2D operation " + getName());
+    RuntimeError::check(output, "Output is not provided to Conv2D operation " + getName());
+    if (useInputImage)
+        RuntimeError::check(inputImage->getPixelFormat() == PixelFormat::TripleByte || inputImage->getPixelFormat() == PixelFormat::QuadByte,
+            "Conv2D operation " + getName() + " only accepts 3- or 4-channel 8-bit images on input when run on CPU");
+
+    // get coefficients
+    const Chunk kernel(data, getName() + FILTERS_CHUNK_SUFFIX);
+    if (kernel.size() != kernelSize.volume() * numOutputChannels * sizeof(float))
+        throw InconsistentModelData(this, "Weights size mismatch");
+
+    // reorder the filters so that the coefficients applied to a given output channel are contiguous
+    const int depth = kernelSize.getDepth();
+    cpuKernel.resize(kernelSize.volume() * numOutputChannels);
+    float* w = cpuKernel.data();
+    for (int outputChannel = 0; outputChannel < numOutputChannels; ++outputChannel)
+        for (int y = 0; y < kernelSize[1]; ++y)
+        for (int x = 0; x < kernelSize[0]; ++x)
+        for (int inputChannel = 0; inputChannel < depth; ++inputChannel)
+            *w++ = kernel.at<float>(getIdx(outputChannel, inputChannel, x, y));
+
+    // get bias
+    cpuBias.assign(numOutputChannels, 0.0f);
+    if (useBias) {
+        const Chunk biases(data, getName() + BIAS_CHUNK_SUFFIX);
+        if (biases.size() != numOutputChannels * sizeof(float))
+            throw InconsistentModelData(this, "Biases size mismatch");
+        std::copy(biases.ptr<float>(), biases.ptr<float>(numOutputChannels), cpuBias.begin());
+    }
+
+    ready = true;
+}
+
+
+int Conv2D::getAmountOfWork() const {
+    // a unit of work is a row of output pixels in a group (or in a quad of channels for depthwise convolutions)
+    return output.getHeight() * (isDepthwise ? numOutputChannels / 4 : numGroups);
+}
+
+
+void Conv2D::execute(const int sliceStart, const int sliceStop, const int threadIdx, const int threadCount) {
+    if (!ready)
+        throw NotReady(this);
+    if (residualInput && residualInput.getSize() != output.getSize())
+        throw RuntimeError("Residual input size does not match the output size");
+
+    const int
+        unitsPerRow = isDepthwise ? numOutputChannels / 4 : numGroups,
+        groupInputChannels = isDepthwise ? 4 : kernelSize.getDepth(),
+        groupOutputChannels = isDepthwise ? 4 : numOutputChannels / numGroups,
+        kernelArea = kernelSize[0] * kernelSize[1],
+        patchSize = kernelArea * groupInputChannels,
+        halfKernel = (kernelSize[0] - 1) / 2;
+    const float scale = 1.0f / 255;
+
+    // get kernel center positions in the input
+    const IntPoint inputSize = useInputImage ? IntPoint(inputImage->getWidth(), inputImage->getHeight()) : input.getSpatialSize();
+    const IntRectangle area = getSamplingArea(inputSize, IntPoint(stride, stride), padding);
+    const int inputPixelSize = useInputImage ? AbstractBitmap::CHANNELS_PER_PIXEL[inputImage->getPixelFormat()] : 4;
+
+    std::vector<float> patch(patchSize);   // input samples in (H, W, I) layout
+
+    for (int unit = sliceStart; unit < sliceStop; ++unit) {
+        const int
+            y = unit / unitsPerRow,
+            groupIdx = unit % unitsPerRow,
+            firstInputChannel = groupIdx * groupInputChannels,
+            firstOutputChannel = groupIdx * groupOutputChannels,
+            top = area.a.y + y * stride - halfKernel;
+
+        for (int x = 0; x < output.getWidth(); ++x) {
+            const int left = area.a.x + x * stride - halfKernel;
+
+            // sample the input
+            if (useInputImage)
+                for (int ky = 0; ky < kernelSize[1]; ++ky) {
+                    const pixbyte* ptr = inputImage->getData(left, top + ky);
+                    float* p = patch.data() + ky * kernelSize[0] * 3;
+                    for (int kx = 0; kx < kernelSize[0]; ++kx, ptr += inputPixelSize, p += 3) {
+                        p[0] = scale * ptr[0];
+                        p[1] = scale * ptr[1];
+                        p[2] = scale * ptr[2];
+                    }
+                }
+            else
+                for (int c = 0; c < groupInputChannels; c += 4)
+                    for (int ky = 0; ky < kernelSize[1]; ++ky) {
+                        const uint8_t* ptr = input.getData(firstInputChannel + c, left, top + ky);
+                        float* p = patch.data() + ky * kernelSize[0] * groupInputChannels + c;
+                        for (int kx = 0; kx < kernelSize[0]; ++kx, ptr += 4, p += groupInputChannels) {
+                            p[0] = scale * ptr[0];
+                            p[1] = scale * ptr[1];
+                            p[2] = scale * ptr[2];
+                            p[3] = scale * ptr[3];
+                        }
+                    }
+
+            // compute output channels
+            for (int c = 0; c < groupOutputChannels; c += 4) {
+                const int outputChannel = firstOutputChannel + c;
+                float sum[4];
+                for (int i = 0; i < 4; ++i) {
+                    const float* w = cpuKernel.data() + (outputChannel + i) * (isDepthwise ? kernelArea : patchSize);
+                    float acc = cpuBias[outputChannel + i];
+                    if (isDepthwise)
+                        for (int k = 0; k < kernelArea; ++k)
+                            acc += w[k] * patch[4 * k + i];
+                    else
+                        for (int k = 0; k < patchSize; ++k)
+                            acc += w[k] * patch[k];
+                    sum[i] = acc;
+                }
+
+                // add residual input
+                if (residualInput) {
+                    const uint8_t* res = residualInput.getData(outputChannel, x, y);
+                    for (int i = 0; i < 4; ++i)
+                        sum[i] += scale * res[i];
+                }
+
+                // apply activation and store
+                uint8_t* out = output.getData(outputChannel, x, y);
+                for (int i = 0; i < 4; ++i)
+                    out[i] = ActivationFunctionMixin::apply(sum[i]);
+            }
+        }
+    }
+}
+
+
 int Conv2D::getInputPadding(int index) const {
     return (index == 0 && padding == Size::Padding::SAME) ? std::max(kernelSize[0], kernelSize[1]) / 2 : 0;
 }
@@ -515,7 +646,7 @@ void Conv2D::setOutput(Storage::View&& storage, int outputIndex) {
 }
 
 
-void Conv2D::setInput(GL::TextureHandler& image, int inputIndex) {
+void Conv2D::setInput(AbstractBitmap& image, int inputIndex) {
     if (inputIndex == 0) {
         RuntimeError::check(useInputImage, "Cannot use image as Conv2D input");
         this->inputImage = &image;
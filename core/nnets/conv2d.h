@@ -29,7 +29,7 @@ namespace Beatmup {
     namespace NNets {
 
         /**
-            2D convolution operation computed on GPU.
+            2D convolution operation computed on GPU or CPU.
             Has 2 inputs: main and residual (detailed below), and a single output.
             Constraints:
                 - Input and output contain values in [0, 1] range sampled over 8 bits.
@@ -75,11 +75,13 @@ namespace Beatmup {
 
             Storage::View input, output;
             Storage::View residualInput;                    //!< optional tensor to be added to the output before activation
-            GL::TextureHandler *inputImage;                 //!< input texture handler to be used instead input view
+            AbstractBitmap *inputImage;                     //!< input image to be used instead input view
             std::vector<GL::RenderingProgram*> programs;    //!< pointers to GLSL program, one per quad of output channels
             std::vector<std::array<float, 4>> coeffs;       //!< model data to pass to uniform variables, if used
             std::vector<int> execOrder;                     //!< execution order of GLSL programs
             std::vector<Storage::View> groupViews;          //!< views per convolution group
+            std::vector<float> cpuKernel;                   //!< convolution filters used on CPU in (O, H, W, I) layout
+            std::vector<float> cpuBias;                     //!< bias used on CPU
 
             /**
                 Maps an (inputChannel, outputChannel, x, y) position to a linear coefficient index in the chunkfile.
@@ -90,6 +92,9 @@ namespace Beatmup {
 
             void prepare(GraphicPipeline& gpu, ChunkCollection& data, GL::ProgramBank& bank);
             void execute(TaskThread& thread, GraphicPipeline& gpu);
+            void prepare(ChunkCollection& data);
+            int getAmountOfWork() const;
+            void execute(const int sliceStart, const int sliceStop, const int threadIdx, const int threadCount);
             int getInputPadding(int index = 0) const;
             void getSampledChannels(int index, int& min, int& max) const;
 
@@ -135,7 +140,7 @@ namespace Beatmup {
             inline Storage::View getOutput(int index = 0) { return output; }
 
             void setInput(Storage::View&& storage, int inputIndex = 0);
-            void setInput(GL::TextureHandler& image, int inputIndex = 0);
+            void setInput(AbstractBitmap& image, int inputIndex = 0);
             void setOutput(Storage::View&& storage, int outputIndex = 0);
 
             std::map<std::string, std::string> serialize() const;
@@ -47,8 +47,7 @@ void Dense::setInput(Storage::View&& view, int index) {
     OutOfRange::check(index, 0, 1, "Input index out of range: %d");
     if (view) {
         RuntimeError::check(view.getStorage().getPadding() == 0, "Storages with padding are not supported");
-        const auto& storage = view.getStorage();
-        RuntimeError::check(view.getNumberOfTextures() == 1 && storage.getTextureWidth() == 1, "Input size mismatch: a column-like view is expected");
+        RuntimeError::check(view.getWidth() == 1 && view.getHeight() == 1, "Input size mismatch: a column-like view is expected");
     }
     inputStorage = std::move(view);
     inputVector = nullptr;
@@ -145,6 +144,10 @@ void Dense::prepare(GraphicPipeline& gpu, ChunkCollection& data, GL::ProgramBank
     RuntimeError::check(inputVector || inputStorage, "Input is not provided to Dense operation " + getName());
     RuntimeError::check(outputVector, "Output is not provided to Dense operation " + getName());
 
+    if (inputStorage)
+        RuntimeError::check(inputStorage.getNumberOfTextures() == 1 && inputStorage.getTextureWidth() == 1,
+            "Input size mismatch: a column-like view is expected");
+
     const int numInputDims = inputVector ? inputVector->getSize() : inputStorage.getSize().volume();
 
     // set matrix
@@ -183,6 +186,62 @@ void Dense::execute(TaskThread& thread, GraphicPipeline& gpu) {
 }
 
 
+void Dense::prepare(ChunkCollection& data) {
+    RuntimeError::check(inputVector || inputStorage, "Input is not provided to Dense operation " + getName());
+    RuntimeError::check(outputVector, "Output is not provided to Dense operation " + getName());
+    RuntimeError::check(outputVector->isInRam(), "Output vector of Dense operation " + getName() + " is expected in RAM");
+
+    const int numInputDims = inputVector ? inputVector->getSize() : inputStorage.getSize().volume();
+
+    // get matrix
+    const Chunk matrix(data, getName() + MATRIX_CHUNK_SUFFIX);
+    if (matrix.size() != numInputDims * numOutputDims * sizeof(float))
+        throw InconsistentModelData(this, "Matrix size mismatch");
+    cpuMatrix.assign(matrix.ptr<float>(), matrix.ptr<float>(numInputDims * numOutputDims));
+
+    // get bias
+    cpuBias.assign(numOutputDims, 0.0f);
+    if (useBias) {
+        const Chunk bias(data, getName() + BIAS_CHUNK_SUFFIX);
+        if (bias.size() != numOutputDims * sizeof(float))
+            throw InconsistentModelData(this, "Bias size mismatch");
+        std::copy(bias.ptr<float>(), bias.ptr<float>(numOutputDims), cpuBias.begin());
+    }
+}
+
+
+int Dense::getAmountOfWork() const {
+    return numOutputDims;
+}
+
+
+void Dense::beforeExecute(GraphicPipeline* gpu, const int threadCount) {
+    // fetch the input vector
+    if (inputVector)
+        inputVector->fetch(cpuInput);
+    else {
+        cpuInput.resize(inputStorage.getSize().volume());
+        Storage::Scanner scanner(inputStorage);
+        scanner.move(0, 0);
+        scanner.fill(cpuInput.begin(), cpuInput.end());
+    }
+    RuntimeError::check(cpuInput.size() * numOutputDims == cpuMatrix.size(), "Input size mismatch in Dense operation " + getName());
+}
+
+
+void Dense::execute(const int sliceStart, const int sliceStop, const int threadIdx, const int threadCount) {
+    const int numInputDims = (int)cpuInput.size();
+    float* output = outputVector->getData();
+    for (int i = sliceStart; i < sliceStop; ++i) {
+        const float* row = cpuMatrix.data() + i * numInputDims;
+        float sum = cpuBias[i];
+        for (int j = 0; j < numInputDims; ++j)
+            sum += row[j] * cpuInput[j];
+        output[i] = sum;
+    }
+}
+
+
 void Dense::getSampledChannels(int index, int& min, int& max) const {
     min = max = (index == 0 ? 4 : 0);
 }
\ No newline at end of file
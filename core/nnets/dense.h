@@ -29,6 +29,7 @@ namespace Beatmup {
             Dense (linear) layer.
             Computes `A*x + b` for input feature vector `x`, a matrix `A` and an optional bias vector `b`.
             Accepts a GL::Vector or a flat Storage view on input, amd only a GL::Vector on output.
+            When executed on CPU, the output vector is allocated in RAM (see GL::Vector::isInRam()).
 
             Constraints:
                 - Number of input channels must be a multiple of 8.
@@ -46,9 +47,16 @@ namespace Beatmup {
             GL::Vector* inputVector;        //!< if not null, points the input vector `x`; otherwise the input is a storage view
             GL::Vector* outputVector;       //!< pointer to the output vector
             Storage::View inputStorage;     //!< if not empty, contains the input features; otherwise the input is a GL vector
+            std::vector<float> cpuMatrix;   //!< the matrix `A` used on CPU, row-major
+            std::vector<float> cpuBias;     //!< the bias vector `b` used on CPU
+            std::vector<float> cpuInput;    //!< the input vector `x` fetched to be processed on CPU
 
             void prepare(GraphicPipeline& gpu, ChunkCollection& data, GL::ProgramBank& bank);
             void execute(TaskThread& thread, GraphicPipeline& gpu);
+            void prepare(ChunkCollection& data);
+            int getAmountOfWork() const;
+            void beforeExecute(GraphicPipeline* gpu, const int threadCount);
+            void execute(const int sliceStart, const int sliceStop, const int threadIdx, const int threadCount);
             void getSampledChannels(int index, int& min, int& max) const;
 
         public:
@@ -25,6 +25,38 @@ using namespace NNets;
 
 static const char *UNIFORM_INPUT = "img";
 
+
+/**
+    Applies a clockwise rotation by a given number of quarter turns to the corners of a sampling area
+*/
+static void rotateCorners(int rotation, Point& topLeft, Point& topRight, Point& bottomLeft, Point& bottomRight) {
+    Point tmp;
+    switch (rotation % 4) {
+        case 1:
+            tmp = bottomLeft;
+            bottomLeft = bottomRight;
+            bottomRight = topRight;
+            topRight = topLeft;
+            topLeft = tmp;
+            break;
+        case 2:
+            tmp = topLeft;
+            topLeft = bottomRight;
+            bottomRight = tmp;
+            tmp = topRight;
+            topRight = bottomLeft;
+            bottomLeft = tmp;
+            break;
+        case 3:
+            tmp = topLeft;
+            topLeft = topRight;
+            topRight = bottomRight;
+            bottomRight = bottomLeft;
+            bottomLeft = tmp;
+            break;
+    }
+}
+
 ImageSampler::ImageSampler(
     const std::string& name,
     const IntPoint& size,
@@ -38,23 +70,23 @@ ImageSampler::ImageSampler(
 {}
 
 
-void ImageSampler::getOutput(GL::TextureHandler*& texture, int index) {
+void ImageSampler::getOutput(AbstractBitmap*& image, int index) {
     InvalidArgument::check(index == 0, "Invalid output index of ImageSampler operation: " + std::to_string(index));
-    texture = this->output;
+    image = this->output;
 }
 
 
-void ImageSampler::setInput(GL::TextureHandler& texture, int inputIndex) {
+void ImageSampler::setInput(AbstractBitmap& image, int inputIndex) {
     InvalidArgument::check(inputIndex == 0, "Invalid input index of ImageSampler operation: " + std::to_string(inputIndex));
-    this->input = &texture;
+    this->input = &image;
 }
 
 
-void ImageSampler::setOutput(GL::TextureHandler& texture, int outputIndex) {
+void ImageSampler::setOutput(AbstractBitmap& image, int outputIndex) {
     InvalidArgument::check(outputIndex == 0, "Invalid output index of ImageSampler operation: " + std::to_string(outputIndex));
-    InvalidArgument::check(texture.getWidth() == size.x && texture.getHeight() == size.y,
+    InvalidArgument::check(image.getWidth() == size.x && image.getHeight() == size.y,
         "ImageSampler output size mismatch");
-    this->output = &texture;
+    this->output = &image;
 }
 
 
@@ -153,7 +185,24 @@ void ImageSampler::execute(TaskThread& thread, GraphicPipeline& gpu) {
 
     // setup texture coordinates
     const IntPoint inputSize(input->getWidth(), input->getHeight());
-    Rectangle texCoords;
+    Rectangle texCoords = gpu.getTextureCoordinates(getInputArea(), inputSize, size);
+
+    // apply rotation
+    if (rotation % 4 != 0) {
+        Point topLeft(texCoords.a), topRight(texCoords.b.x, texCoords.a.y), bottomLeft(texCoords.a.x, texCoords.b.y), bottomRight(texCoords.b);
+        rotateCorners(rotation, topLeft, topRight, bottomLeft, bottomRight);
+        gpu.setTextureCoordinates(topLeft, topRight, bottomLeft, bottomRight);
+    }
+    else {
+        gpu.setTextureCoordinates(texCoords);
+    }
+
+    // blend
+    program->blend();
+}
+
+
+Rectangle ImageSampler::getInputArea() const {
     if (centerCrop) {
         float hMargin = 0, vMargin = 0;
         if (input->getWidth() * output->getHeight() > input->getHeight() * output->getWidth()) {
@@ -164,45 +213,85 @@ void ImageSampler::execute(TaskThread& thread, GraphicPipeline& gpu) {
             // input is cut horizontally
             vMargin = 0.5f * (input->getHeight() - (float)input->getWidth() * output->getHeight() / output->getWidth());
         }
-        texCoords = gpu.getTextureCoordinates(Rectangle(hMargin, vMargin, input->getWidth() - 1 - hMargin, input->getHeight() - 1 - vMargin), inputSize, size);
-    }
-    else {
-        texCoords = gpu.getTextureCoordinates(Rectangle(0, 0, input->getWidth() - 1, input->getHeight() - 1), inputSize, size);
+        return Rectangle(hMargin, vMargin, input->getWidth() - 1 - hMargin, input->getHeight() - 1 - vMargin);
     }
+    return Rectangle(0, 0, input->getWidth() - 1, input->getHeight() - 1);
+}
 
-    // apply rotation
-    if (rotation % 4 != 0) {
-        Point topLeft(texCoords.a), topRight(texCoords.b.x, texCoords.a.y), bottomLeft(texCoords.a.x, texCoords.b.y), bottomRight(texCoords.b), tmp;
-        switch (rotation % 4) {
-            case 1:
-                tmp = bottomLeft;
-                bottomLeft = bottomRight;
-                bottomRight = topRight;
-                topRight = topLeft;
-                topLeft = tmp;
-                break;
-            case 2:
-                tmp = topLeft;
-                topLeft = bottomRight;
-                bottomRight = tmp;
-                tmp = topRight;
-                topRight = bottomLeft;
-                bottomLeft = tmp;
-                break;
-            case 3:
-                tmp = topLeft;
-                topLeft = topRight;
-                topRight = bottomRight;
-                bottomRight = bottomLeft;
-                bottomLeft = tmp;
-                break;
+
+void ImageSampler::prepare(ChunkCollection& data) {
+    RuntimeError::check(input, "Input is not provided to a ImageSampler operation.");
+    RuntimeError::check(input->getPixelFormat() == PixelFormat::TripleByte || input->getPixelFormat() == PixelFormat::QuadByte,
+        "ImageSampler operation " + getName() + " only accepts 3- or 4-channel 8-bit images on input when run on CPU");
+}
+
+
+void ImageSampler::beforeExecute(GraphicPipeline* gpu, const int threadCount) {
+    RuntimeError::check(input, "Input is not provided to a ImageSampler operation.");
+    RuntimeError::check(output, "Output is not provided to a ImageSampler operation.");
+    RuntimeError::check(output->getPixelFormat() == PixelFormat::TripleByte, "ImageSampler output is expected to be a 3-channel 8-bit image");
+    writeLock(gpu, output, ProcessingTarget::CPU);
+}
+
+
+void ImageSampler::afterExecute(const int threadCount) {
+    unlock(output);
+}
+
+
+void ImageSampler::execute(const int sliceStart, const int sliceStop, const int threadIdx, const int threadCount) {
+    // get the sampling area corners in pixels
+    const Rectangle area = getInputArea();
+    Point topLeft(area.a), topRight(area.b.x, area.a.y), bottomLeft(area.a.x, area.b.y), bottomRight(area.b);
+    rotateCorners(rotation, topLeft, topRight, bottomLeft, bottomRight);
+
+    // output pixels centers are mapped onto the area corners
+    const Point
+        dx = size.x > 1 ? (topRight - topLeft) / (float)(size.x - 1) : Point::ZERO,
+        dy = size.y > 1 ? (bottomLeft - topLeft) / (float)(size.y - 1) : Point::ZERO,
+        origin = topLeft + (size.x > 1 ? Point::ZERO : 0.5f * (topRight - topLeft)) + (size.y > 1 ? Point::ZERO : 0.5f * (bottomLeft - topLeft));
+
+    const int
+        inWidth = input->getWidth(),
+        inHeight = input->getHeight();
+
+    for (int y = sliceStart; y < sliceStop; ++y) {
+        pixbyte* out = output->getData(0, y);
+        for (int x = 0; x < size.x; ++x, out += 3) {
+            const Point pos = origin + (float)x * dx + (float)y * dy;
+
+            if (linearInterpolation) {
+                // bilinear interpolation with clamping to edges
+                const int
+                    x0 = floorf_fast(pos.x),
+                    y0 = floorf_fast(pos.y);
+                const float
+                    fx = pos.x - x0,
+                    fy = pos.y - y0;
+                const int
+                    xa = std::min(std::max(x0, 0), inWidth - 1),
+                    xb = std::min(std::max(x0 + 1, 0), inWidth - 1),
+                    ya = std::min(std::max(y0, 0), inHeight - 1),
+                    yb = std::min(std::max(y0 + 1, 0), inHeight - 1);
+                const pixbyte
+                    *p00 = input->getData(xa, ya), *p10 = input->getData(xb, ya),
+                    *p01 = input->getData(xa, yb), *p11 = input->getData(xb, yb);
+                for (int c = 0; c < 3; ++c)
+                    out[c] = (pixbyte)roundf_fast(
+                        (1 - fy) * ((1 - fx) * p00[c] + fx * p10[c]) +
+                        fy * ((1 - fx) * p01[c] + fx * p11[c])
+                    );
+            }
+
+            else {
+                const pixbyte* p = input->getData(
+                    std::min(std::max((int)roundf_fast(pos.x), 0), inWidth - 1),
+                    std::min(std::max((int)roundf_fast(pos.y), 0), inHeight - 1)
+                );
+                out[0] = p[0];
+                out[1] = p[1];
+                out[2] = p[2];
+            }
         }
-        gpu.setTextureCoordinates(topLeft, topRight, bottomLeft, bottomRight);
     }
-    else {
-        gpu.setTextureCoordinates(texCoords);
-    }
-
-    // blend
-    program->blend();
 }
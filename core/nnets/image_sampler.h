@@ -18,6 +18,7 @@
 
 #pragma once
 #include "operation.h"
+#include "../bitmap/content_lock.h"
 
 namespace Beatmup {
     namespace NNets {
@@ -29,10 +30,10 @@ namespace Beatmup {
              * If enabled, uses linear interpolation when possible to reduce aliasing (otherwise nearest neighbor sampling is used).
              * Brings support of OES textures. This allows for example to read data directly from camera in Android.
         */
-        class ImageSampler : public AbstractOperation {
+        class ImageSampler : public AbstractOperation, private BitmapContentLock {
         private:
             const IntPoint size;
-            GL::TextureHandler *input, *output;
+            AbstractBitmap *input, *output;
             GL::RenderingProgram* program;
             bool linearInterpolation;       //!< if `true`, the input image is linearly interpolated when possible
             bool centerCrop;                /**< if `true`, a center crop is performed to sample the output image from the input;
@@ -40,8 +41,19 @@ namespace Beatmup {
 
             int rotation;                   //!< clockwise rotation to apply to the input image; 1 unit = 90 degrees
 
+            /**
+                Computes the area in the input image to sample, taking into account the center crop setting.
+                \return the area in pixels.
+            */
+            Rectangle getInputArea() const;
+
             void prepare(GraphicPipeline& gpu, ChunkCollection& data, GL::ProgramBank& bank);
             void execute(TaskThread& thread, GraphicPipeline& gpu);
+            void prepare(ChunkCollection& data);
+            inline int getAmountOfWork() const { return size.y; }
+            void beforeExecute(GraphicPipeline* gpu, const int threadCount);
+            void afterExecute(const int threadCount);
+            void execute(const int sliceStart, const int sliceStop, const int threadIdx, const int threadCount);
             inline int getInputPadding(int index = 0) const { return 0; }
             inline void getSampledChannels(int index, int& min, int& max) const { min = max = 0; }
 
@@ -92,10 +104,10 @@ namespace Beatmup {
 
             inline Size getOutputSize(int outputIndex = 0) const { return Size(size.x, size.y, 3); }
 
-            void getOutput(GL::TextureHandler*& texture, int index = 0);
+            void getOutput(AbstractBitmap*& image, int index = 0);
 
-            void setInput(GL::TextureHandler& texture, int inputIndex = 0);
-            void setOutput(GL::TextureHandler& texture, int outputIndex = 0);
+            void setInput(AbstractBitmap& image, int inputIndex = 0);
+            void setOutput(AbstractBitmap& image, int outputIndex = 0);
 
             std::map<std::string, std::string> serialize() const;
 
@@ -17,21 +17,76 @@
 */
 
 #include "inference_task.h"
+#include <algorithm>
 
 using namespace Beatmup;
 using namespace NNets;
 
 
 void InferenceTask::connect(AbstractBitmap& image, AbstractOperation& operation, int inputIndex) {
-    inputImages[std::make_pair(&operation, inputIndex)] = &image;
-    operation.setInput(image, inputIndex);
+    connect(std::vector<AbstractBitmap*>{ &image }, operation, inputIndex);
+}
+
+
+void InferenceTask::connect(const std::vector<AbstractBitmap*>& images, AbstractOperation& operation, int inputIndex) {
+    InvalidArgument::check(!images.empty(), "Empty batch connected to " + operation.getName());
+    for (auto image : images)
+        InvalidArgument::check(image != nullptr, "Null image in a batch connected to " + operation.getName());
+    const auto key = std::make_pair(&operation, inputIndex);
+
+    // check the batch size consistency with other inputs
+    for (auto& it : inputImages)
+        if (it.first != key)
+            InvalidArgument::check(it.second.size() == 1 || images.size() == 1 || it.second.size() == images.size(),
+                "Batch size mismatch: " + std::to_string(images.size()) + " images connected to " + operation.getName() + ", " +
+                std::to_string(it.second.size()) + " images connected to " + it.first.first->getName());
+
+    inputImages[key] = images;
+    operation.setInput(*images.front(), inputIndex);
+
+    batchSize = 1;
+    for (auto& it : inputImages)
+        batchSize = std::max(batchSize, it.second.size());
+}
+
+
+void InferenceTask::connectBatchItem(size_t index) {
+    for (auto& it : inputImages) {
+        auto& images = it.second;
+        it.first.first->setInput(*images[images.size() > 1 ? index : 0], it.first.second);
+    }
+}
+
+
+void InferenceTask::runBatch(TaskThread& thread, GraphicPipeline* gpu) {
+    for (size_t i = 0; i < batchSize; ++i) {
+        if (i > 0) {
+            // the inputs are switched while the other threads are waiting
+            if (thread.isManaging())
+                connectBatchItem(i);
+            thread.synchronize();
+        }
+        model.execute(thread, gpu);
+        if (thread.isManaging())
+            afterInference(i);
+    }
+}
+
+
+AbstractTask::TaskDeviceRequirement InferenceTask::getUsedDevices() const {
+    return useGpu ? TaskDeviceRequirement::GPU_OR_CPU : TaskDeviceRequirement::CPU_ONLY;
 }
 
 
 void InferenceTask::beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu) {
-    for (auto it : inputImages)
-        readLock(gpu, it.second, ProcessingTarget::GPU);
-    model.prepare(*gpu, data);
+    for (auto& it : inputImages)
+        for (auto image : it.second)
+            readLock(gpu, image, target);
+    connectBatchItem(0);
+    if (target == ProcessingTarget::GPU)
+        model.prepare(*gpu, data);
+    else
+        model.prepare(data);
 }
 
 
@@ -43,12 +98,12 @@ void InferenceTask::afterProcessing(ThreadIndex threadCount, GraphicPipeline* gp
 
 
 bool InferenceTask::processOnGPU(GraphicPipeline& gpu, TaskThread& thread) {
-    model.execute(thread, &gpu);
+    runBatch(thread, &gpu);
     return true;
 }
 
 
 bool InferenceTask::process(TaskThread& thread) {
-    model.execute(thread, nullptr);
+    runBatch(thread, nullptr);
     return true;
 }
@@ -19,8 +19,10 @@
 #pragma once
 
 #include "model.h"
-#include "../gpu/gpu_task.h"
+#include "../parallelism.h"
+#include "../bitmap/content_lock.h"
 #include <map>
+#include <vector>
 
 namespace Beatmup {
     namespace NNets {
@@ -29,23 +31,47 @@ namespace Beatmup {
             Task running inference of a Model.
             During the firs run of this task with a given model the shader programs are built and the memory is allocated.
             The subsequent runs are much faster.
+            The inference is run on GPU if available. Otherwise, or if GPU use is disabled with enableGpu(), it is run on CPU.
+            A batch of images may be connected to an input. The inference is then run for every image of the batch within a single run of the
+            task, so that the model preparation check, the input locking, the task scheduling and the final GPU synchronization are done once per
+            batch. The model outputs of every image are available in afterInference().
         */
-        class InferenceTask : public GpuTask, private BitmapContentLock {
+        class InferenceTask : public AbstractTask, private BitmapContentLock {
         private:
-            std::map<std::pair<AbstractOperation*, int>, AbstractBitmap*> inputImages;
+            std::map<std::pair<AbstractOperation*, int>, std::vector<AbstractBitmap*>> inputImages;     //!< (operation, input index) => batch
+            size_t batchSize;       //!< number of images processed per run
+            bool useGpu;            //!< if `false`, the inference is run on CPU even if GPU is available
+
+            /**
+                Connects images of a given index in the batch to the operations inputs.
+            */
+            void connectBatchItem(size_t index);
+
+            /**
+                Runs the inference for every image of the batch.
+            */
+            void runBatch(TaskThread& thread, GraphicPipeline* gpu);
 
             void beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu) override;
             void afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted) override;
             bool processOnGPU(GraphicPipeline& gpu, TaskThread& thread) override;
             bool process(TaskThread& thread) override;
             ThreadIndex getMaxThreads() const override { return MAX_THREAD_INDEX; }
+            TaskDeviceRequirement getUsedDevices() const override;
 
         protected:
             ChunkCollection& data;
             Model& model;
 
+            /**
+                Called in the managing thread once the inference is run for an image of the batch.
+                The model outputs (e.g., Model::getOutputData()) contain the results for this image until the inference of the next image starts.
+                \param[in] batchIndex       Index of the image in the batch
+            */
+            virtual void afterInference(size_t batchIndex) {}
+
         public:
-            inline InferenceTask(Model& model, ChunkCollection& data): model(model), data(data) {}
+            inline InferenceTask(Model& model, ChunkCollection& data): batchSize(1), useGpu(true), data(data), model(model) {}
 
             /**
                 Connects an image to a specific operation input.
@@ -58,6 +84,36 @@ namespace Beatmup {
             inline void connect(AbstractBitmap& image, const std::string& operation, int inputIndex = 0) {
                 connect(image, model.getOperation(operation), inputIndex);
             }
+
+            /**
+                Connects a batch of images to a specific operation input.
+                The inference is run for every image of the batch in the order they are given. If several inputs are connected, they all need to
+                receive batches of the same size, or single images used for every item of the batch.
+                \param[in] images           The images. Their content is ensured up-to-date in GPU memory by the time the inference is run.
+                \param[in] operation        The operation
+                \param[in] inputIndex       The input index of the operation
+            */
+            void connect(const std::vector<AbstractBitmap*>& images, AbstractOperation& operation, int inputIndex = 0);
+            inline void connect(const std::vector<AbstractBitmap*>& images, const std::string& operation, int inputIndex = 0) {
+                connect(images, model.getOperation(operation), inputIndex);
+            }
+
+            /**
+                \return the number of images the inference is run for in every run of the task.
+            */
+            inline size_t getBatchSize() const { return batchSize; }
+
+            /**
+                Enables or disables GPU use for the inference.
+                When disabled, the model is prepared and run on CPU.
+                \param[in] enable          If `false`, the inference is run on CPU
+            */
+            inline void enableGpu(bool enable) { useGpu = enable; }
+
+            /**
+                \return `true` if the inference is allowed to run on GPU.
+            */
+            inline bool isGpuEnabled() const { return useGpu; }
         };
 
     }
@@ -19,6 +19,7 @@
 #include "model.h"
 #include "../utils/bitset.h"
 #include <sstream>
+#include <limits>
 
 using namespace Beatmup;
 using namespace NNets;
@@ -26,8 +27,8 @@ using namespace NNets;
 
 Model::Model(Context& context, std::initializer_list<AbstractOperation*> ops):
     ProgramBank(context),
-    profiler(nullptr), ready(false),
-    ops(ops.begin(), ops.end())
+    arenaSize(0), profiler(nullptr), preparedFor(ProcessingTarget::GPU),
+    ops(ops.begin(), ops.end()), ready(false)
 {
     // establish feedforward connections
     for (size_t i = 1; i < this->ops.size(); ++i)
@@ -53,7 +54,7 @@ void Model::append(AbstractOperation* newOp, bool connect) {
                 throw RuntimeError("Cannot add operation " + newOp->getName() + " to the model: an operation with the same exists in the model");
     }
     ops.push_back(newOp);
-    if (connect)
+    if (connect && ops.size() > 1)
         addConnection(*ops[ops.size() - 2], *ops.back(), 0, 0, 0);
     ready = false;
 }
@@ -140,9 +141,22 @@ const float* Model::getOutputData(size_t& numSamples, const AbstractOperation& o
 }
 
 
-void Model::prepare(GraphicPipeline& gpu,  ChunkCollection& data) {
-    if (ready)
+void Model::prepare(GraphicPipeline& gpu, ChunkCollection& data) {
+    if (ready && preparedFor == ProcessingTarget::GPU)
         return;
+    doPrepare(&gpu, data);
+}
+
+
+void Model::prepare(ChunkCollection& data) {
+    if (ready && preparedFor == ProcessingTarget::CPU)
+        return;
+    doPrepare(nullptr, data);
+}
+
+
+void Model::doPrepare(GraphicPipeline* gpu, ChunkCollection& data) {
+    ready = false;
     freeMemory();
 
     std::map<Storage*, std::vector<AbstractOperation*>> refs;
@@ -151,7 +165,10 @@ void Model::prepare(GraphicPipeline& gpu,  ChunkCollection& data) {
 
     // find input depth capping
     // If too many channels are sampled by an op having multiple inputs, its input storages will have reserved channels.
-    const int sampledChannelsLimit = 4 * gpu.getLimit(GraphicPipeline::Limit::TEXTURE_IMAGE_UNITS);
+    // There is no such limit on CPU.
+    const int sampledChannelsLimit = gpu ?
+        4 * gpu->getLimit(GraphicPipeline::Limit::TEXTURE_IMAGE_UNITS) :
+        std::numeric_limits<int>::max();
     std::map<AbstractOperation*, int> sampledChannels;   // op => number of sampled channels
     for (auto conn : connections) {
         auto* op = conn.second.dest;
@@ -164,6 +181,20 @@ void Model::prepare(GraphicPipeline& gpu,  ChunkCollection& data) {
         sampledChannels[op] += max;
     }
 
+    // find the last use of every operation output
+    std::map<const AbstractOperation*, int> opIndex;
+    for (size_t i = 0; i < ops.size(); ++i)
+        opIndex[ops[i]] = (int)i;
+    std::map<std::pair<const AbstractOperation*, int>, int> lastUse;      // (op, output index) => index of the last op using the output
+    for (auto conn : connections) {
+        int& idx = lastUse[std::make_pair(conn.first, conn.second.output)];
+        idx = std::max(idx, opIndex[conn.second.dest]);
+    }
+
+    // on CPU, storages are placed in the memory arena once all the ops are prepared
+    std::vector<StorageLifetime> lifetimes;
+    size_t naiveMemorySize = 0;     // memory size needed if nothing is reused
+
     // loop through connected ops
     data.open();
     preparingProgress.reset(ops.size());
@@ -216,40 +247,51 @@ void Model::prepare(GraphicPipeline& gpu,  ChunkCollection& data) {
                         }
                     }
 
-                    // try to recycle an existing storage first
-                    for (auto& i : refs) {
-                        auto candidate = i.first;
-                        auto& users = i.second;
-                        const int reservedDepth = sampledChannelsLimit - 4 * candidate->getNumberOfTextures();
-                        // check if (1) size matches, (2) padding is sufficient, (3) reserved depth matches the number of channels to cap or no capping
-                        if (candidate->getSize() == size && candidate->getPadding() >= dst->getInputPadding(conn.input) && (reservedDepth == depthCapping || depthCapping == 0)
-                            && users.empty())
-                        {
-                            // found!
-                            storage = candidate;
-                            users.push_back(dst);
-                            break;
-                        }
-                        if (storage)
-                            break;
+                    // on CPU, create a storage to place in the arena later (no padding for 1x1 outputs, as for flat storages)
+                    if (!gpu) {
+                        storage = new Storage(context, size, (size[0] == 1 && size[1] == 1) ? 0 : paddings[conn.output]);
+                        arenaStorages.push_back(storage);
+                        lifetimes.push_back(StorageLifetime{
+                            storage, opIndex[src], lastUse[std::make_pair(src, conn.output)], 0
+                        });
                     }
+                    else {
+                        // on GPU, try to recycle an existing storage first
+                        for (auto& i : refs) {
+                            auto candidate = i.first;
+                            auto& users = i.second;
+                            const int reservedDepth = sampledChannelsLimit - 4 * candidate->getNumberOfTextures();
+                            // check if (1) size matches, (2) padding is sufficient, (3) reserved depth matches the number of channels to cap or no capping
+                            if (candidate->getSize() == size && candidate->getPadding() >= dst->getInputPadding(conn.input) && (reservedDepth == depthCapping || depthCapping == 0)
+                                && users.empty())
+                            {
+                                // found!
+                                storage = candidate;
+                                users.push_back(dst);
+                                break;
+                            }
+                            if (storage)
+                                break;
+                        }
 
-                    // no matching storage found, allocate a new one
-                    if (!storage) {
-                        storage = (size[0] == 1 && size[1] == 1) ?
-                            // allocate flat storage if the output size is of 1x1 pixels
-                            &allocateFlatStorage(gpu, size[2]) :
-                            &allocateStorage(gpu,
-                                size,
-                                src->usesGpu(), !src->usesGpu(),
-                                paddings[conn.output],
-                                depthCapping
-                            );
-                        refs.emplace(storage, std::vector<AbstractOperation*>{ dst });
+                        // no matching storage found, allocate a new one
+                        if (!storage) {
+                            storage = (size[0] == 1 && size[1] == 1) ?
+                                // allocate flat storage if the output size is of 1x1 pixels
+                                &allocateFlatStorage(gpu, size[2]) :
+                                &allocateStorage(gpu,
+                                    size,
+                                    src->usesGpu(), !src->usesGpu(),
+                                    paddings[conn.output],
+                                    depthCapping
+                                );
+                            refs.emplace(storage, std::vector<AbstractOperation*>{ dst });
+                        }
                     }
 
                     // mark output as allocated
                     outputs[conn.output] = storage;
+                    naiveMemorySize += storage->getMemorySize();
                 }
 
                 // connect
@@ -271,6 +313,7 @@ void Model::prepare(GraphicPipeline& gpu,  ChunkCollection& data) {
                 else {
                     vector = &allocateVector(gpu, src->getOutputSize(conn.output).volume());
                     outputs[conn.output] = vector;
+                    naiveMemorySize += vector->getMemorySize();
                 }
 
                 // connect
@@ -286,8 +329,10 @@ void Model::prepare(GraphicPipeline& gpu,  ChunkCollection& data) {
                 // check if the output storage is already allocated
                 if (outputs[conn.output])
                     texture = static_cast<InternalBitmap*>(outputs[conn.output]);
-                else
-                    outputs[conn.output] = texture = &allocateTexture(gpu, src->getOutputSize(conn.output));
+                else {
+                    outputs[conn.output] = texture = &allocateTexture(src->getOutputSize(conn.output));
+                    naiveMemorySize += texture->getMemorySize();
+                }
 
                 // connect
                 src->setOutput(*texture, conn.output);
@@ -307,15 +352,22 @@ void Model::prepare(GraphicPipeline& gpu,  ChunkCollection& data) {
                 throw InvalidArgument("Operation " + src->getName() + " does not have output #" + std::to_string(idx));
             if (!connectedOutputs[idx])
                 if (src->acceptsStorageOutput(idx)) {
-                    src->setOutput(allocateStorage(gpu, src->getOutputSize(idx), src->usesGpu(), !src->usesGpu()), idx);
+                    Storage& storage = allocateStorage(gpu, src->getOutputSize(idx), src->usesGpu(), !src->usesGpu());
+                    src->setOutput(storage, idx);
+                    naiveMemorySize += storage.getMemorySize();
                 }
                 else if (src->acceptsVectorOutput(idx)) {
-                    src->setOutput(allocateVector(gpu, src->getOutputSize(idx).volume()), idx);
+                    GL::Vector& vector = allocateVector(gpu, src->getOutputSize(idx).volume());
+                    src->setOutput(vector, idx);
+                    naiveMemorySize += vector.getMemorySize();
                 }
         }
 
         // prepare operation
-        src->prepare(gpu, data, *this);
+        if (gpu)
+            src->prepare(*gpu, data, *this);
+        else
+            src->prepare(data);
 
         // remove references to storages used by the current operation. This allows their reuse in other connections.
         for (auto& i : refs) {
@@ -332,11 +384,42 @@ void Model::prepare(GraphicPipeline& gpu,  ChunkCollection& data) {
     }
 
     data.close();
+
+    // place CPU storages in the arena
+    if (!lifetimes.empty()) {
+        arenaSize = planArena(lifetimes);
+        arena = AlignedMemory(arenaSize, context.getMemoryPool());
+        for (const auto& lifetime : lifetimes) {
+            Storage* storage = lifetime.storage;
+            storage->allocate(arena, lifetime.offset);
+
+            // if the storage shares its memory with other storages, its padding may be overwritten, so it needs to be cleared
+            if (storage->getPadding() > 0)
+                for (const auto& other : lifetimes)
+                    if (other.storage != storage
+                        && other.offset < lifetime.offset + storage->getMemorySize()
+                        && lifetime.offset < other.offset + other.storage->getMemorySize())
+                    {
+                        paddedArenaOutputs.emplace(ops[lifetime.firstUse], storage);
+                        break;
+                    }
+        }
+    }
+
+    if (profiler) {
+        profiler->count("memory: naive, bytes", naiveMemorySize);
+        profiler->count("memory: planned, bytes", getMemorySize());
+    }
+
+    preparedFor = gpu ? ProcessingTarget::GPU : ProcessingTarget::CPU;
     ready = true;
 }
 
 
 void Model::execute(TaskThread& thread, GraphicPipeline* gpu) {
+    const bool onCpu = preparedFor == ProcessingTarget::CPU;
+    if (onCpu)
+        gpu = nullptr;
     if (gpu)
         gpu->switchMode(GraphicPipeline::Mode::INFERENCE);
 
@@ -352,9 +435,18 @@ void Model::execute(TaskThread& thread, GraphicPipeline* gpu) {
         if (thread.isManaging() && profiler)
             (*profiler)(op->getName());
 
+        // clear padding of output storages sharing memory with other storages
+        if (onCpu && thread.isManaging()) {
+            auto paddedOutputs = paddedArenaOutputs.equal_range(op);
+            for (auto it = paddedOutputs.first; it != paddedOutputs.second; ++it)
+                it->second->clearPadding();
+        }
+
         // run operation
         try {
-            if (gpu)
+            if (onCpu)
+                op->executeOnCpu(thread);
+            else if (gpu)
                 op->execute(thread, *gpu);
             else
                 op->execute(thread);
@@ -367,33 +459,41 @@ void Model::execute(TaskThread& thread, GraphicPipeline* gpu) {
         for (auto it = userOutputs.first; it != userOutputs.second; ++it) {
             int idx = it->second.index;
             auto& data = it->second.data;
-            if (gpu)
+            if (gpu || (onCpu && thread.isManaging())) {
                 if (op->acceptsStorageOutput(idx)) {
                     // get data pointer from storage
                     auto view = op->getOutput(idx);
                     if (!view.getStorage().isUpToDate(ProcessingTarget::CPU))
                         view.getStorage().pull(*gpu);
 
-                    // copy to the vector
+                    // copy to the vector row by row, skipping the storage padding
                     Storage::Scanner scan(view);
-                    scan.move(0, 0);
                     data.resize(view.getSize().volume());
-                    for (auto it = data.begin(); it != data.end(); it += view.getDepth()) {
-                        scan.fill(it, data.end());
-                        ++scan;
+                    auto it = data.begin();
+                    for (int y = 0; y < view.getHeight(); ++y) {
+                        scan.move(0, y);
+                        for (int x = 0; x < view.getWidth(); ++x, it += view.getDepth()) {
+                            scan.fill(it, data.end());
+                            ++scan;
+                        }
                     }
                 }
                 else if (op->acceptsVectorOutput(idx)) {
                     GL::Vector* vector;
                     op->getOutput(vector, idx);
-                    vector->fetch(*gpu, data);
+                    if (gpu)
+                        vector->fetch(*gpu, data);
+                    else
+                        vector->fetch(data);
                 }
+            }
         }
 
         if (thread.isManaging()) {
             // stop profiler
             if (profiler) {
-                gpu->flush();   // wait till GPU is done
+                if (gpu)
+                    gpu->flush();   // wait till GPU is done
                 profiler->lap();
             }
 
@@ -422,42 +522,106 @@ void Model::freeMemory() {
     for (auto texture : textures)
         delete texture;
     textures.clear();
+    for (auto storage : arenaStorages)
+        delete storage;
+    arenaStorages.clear();
+    paddedArenaOutputs.clear();
+    arena.free();
+    arenaSize = 0;
 }
 
 
-Storage& Model::allocateStorage(GraphicPipeline& gpu, const Size size, bool forGpu, bool forCpu, const int pad, const int reservedDepth) {
-    Storage* storage = new Storage(context, gpu, size, pad, reservedDepth);
-    if (forGpu)
-        storage->allocate(gpu);
-    if (forCpu)
+size_t Model::planArena(std::vector<StorageLifetime>& lifetimes) {
+    static const size_t ALIGNMENT = 64;     // storage offsets alignment in bytes
+
+    // sort by size in descending order
+    std::vector<StorageLifetime*> order;
+    order.reserve(lifetimes.size());
+    for (auto& lifetime : lifetimes)
+        order.push_back(&lifetime);
+    std::stable_sort(order.begin(), order.end(), [](const StorageLifetime* a, const StorageLifetime* b) {
+        return a->storage->getMemorySize() > b->storage->getMemorySize();
+    });
+
+    size_t arenaSize = 0;
+    std::vector<const StorageLifetime*> placed, conflicts;
+    for (auto lifetime : order) {
+        const size_t size = ceili(lifetime->storage->getMemorySize(), ALIGNMENT) * ALIGNMENT;
+
+        // find already placed storages used at the same time
+        conflicts.clear();
+        for (auto other : placed)
+            if (other->firstUse <= lifetime->lastUse && lifetime->firstUse <= other->lastUse)
+                conflicts.push_back(other);
+        std::sort(conflicts.begin(), conflicts.end(), [](const StorageLifetime* a, const StorageLifetime* b) {
+            return a->offset < b->offset;
+        });
+
+        // find the lowest gap between them large enough
+        size_t offset = 0;
+        for (auto other : conflicts) {
+            if (offset + size <= other->offset)
+                break;
+            offset = std::max(offset, other->offset + ceili(other->storage->getMemorySize(), ALIGNMENT) * ALIGNMENT);
+        }
+
+        lifetime->offset = offset;
+        arenaSize = std::max(arenaSize, offset + size);
+        placed.push_back(lifetime);
+    }
+
+    return arenaSize;
+}
+
+
+Storage& Model::allocateStorage(GraphicPipeline* gpu, const Size size, bool forGpu, bool forCpu, const int pad, const int reservedDepth) {
+    Storage* storage;
+    if (gpu) {
+        storage = new Storage(context, *gpu, size, pad, reservedDepth);
+        if (forGpu)
+            storage->allocate(*gpu);
+        if (forCpu)
+            storage->allocate();
+    }
+    else {
+        storage = new Storage(context, size, pad);
         storage->allocate();
+    }
     storages.push_back(storage);
     return *storage;
 }
 
 
-Storage& Model::allocateFlatStorage(GraphicPipeline& gpu, int size) {
-    Storage* storage = new Storage(context, gpu, Size(1, 1, size));
-    storage->allocate(gpu);
+Storage& Model::allocateFlatStorage(GraphicPipeline* gpu, int size) {
+    if (!gpu)
+        // no flat storages on CPU
+        return allocateStorage(nullptr, Size(1, 1, size));
+    Storage* storage = new Storage(context, *gpu, Size(1, 1, size));
+    storage->allocate(*gpu);
     storages.push_back(storage);
     return *storage;
 }
 
 
-GL::Vector& Model::allocateVector(GraphicPipeline& gpu, const int size) {
-    GL::Vector::Format format;
+GL::Vector& Model::allocateVector(GraphicPipeline* gpu, const int size) {
+    GL::Vector* vector;
+    if (gpu) {
+        GL::Vector::Format format;
 #ifdef BEATMUP_OPENGLVERSION_GLES20
-    format = GL::Vector::Format::FIXED16;
+        format = GL::Vector::Format::FIXED16;
 #else
-    format = GL::Vector::Format::FLOAT;
+        format = GL::Vector::Format::FLOAT;
 #endif
-    GL::Vector* vector = new GL::Vector(context, gpu, size, format);
+        vector = new GL::Vector(context, *gpu, size, format);
+    }
+    else
+        vector = new GL::Vector(context, size);
     vectors.push_back(vector);
     return *vector;
 }
 
 
-InternalBitmap& Model::allocateTexture(GraphicPipeline& gpu, const Size size) {
+InternalBitmap& Model::allocateTexture(const Size size) {
     PixelFormat pixelFormat(PixelFormat::TripleByte);
     switch (size.getDepth()) {
     case 1:
@@ -529,7 +693,7 @@ size_t Model::getMemorySize() const {
         size += entry->getMemorySize();
     for (auto& entry : textures)
         size += entry->getMemorySize();
-    return size;
+    return size + arenaSize;
 }
 
 
@@ -35,7 +35,7 @@
 namespace Beatmup {
     /**
         \page NNetsModuleOverview NNets module overview
-        %Beatmup provides a way to run inference of user-defined neural networks on GPU using OpenGL.
+        %Beatmup provides a way to run inference of user-defined neural networks on GPU using OpenGL, or on CPU if no GPU is available.
 
         The neural network (a NNets::Model instance) can be built in one of two ways:
          - layer-by-layer in the user code, by adding instances of NNets::AbstractOperation,
@@ -48,6 +48,8 @@ namespace Beatmup {
 
         Under the hood, the network is converted into a set of OpenGL ES 2.0-compliant GLSL shaders. The data is stored in textures in GPU memory.
         %Beatmup takes care of building and executing shader programs.
+        When the inference is run on CPU, the same storages are kept in RAM and the operations are executed in the thread pool reproducing the GPU
+        arithmetics, including the activations quantization. The CPU inference is meant as a fallback and a reference rather than a fast path.
 
         With this %Beatmup enables hardware-accelerated inference on any decent GPU, keeping the CPU available for other tasks. It allows to deploy
         easily the same model on various hardware, including inexpensive single-board computers, %Android GPUs, integrated and discrete desktop GPUs
@@ -74,11 +76,13 @@ namespace Beatmup {
              group convolutions and \ref NNetsShufflingExplained "channel shuffling" are suggested. The latter allows to shuffle channels between
              layers literally for free, which helps to increase the connectivity across the width of the network for group convolutions in
              particular.
-         - The batch size is fundamentally and unconditionally equal to 1, i.e., the inference is run for one given input image at a time.
+         - The batch size is fundamentally equal to 1 within the model, i.e., the operations process one given input image at a time. A batch of
+           images can be connected to NNets::InferenceTask, which then runs the inference for every image in a single task run. This saves the
+           per-run overhead, but not the per-operation one.
     */
 
     /**
-        Neural nets inference on GPU using OpenGL.
+        Neural nets inference on GPU using OpenGL, or on CPU.
     */
     namespace NNets {
 
@@ -87,6 +91,9 @@ namespace Beatmup {
             Contains a list of operations and programmatically defined interconnections between them using addConnection().
             Enables access to the model memory at any point in the model through addOutput() and getOutputData().
             The memory needed to store internal data during the inference is allocated automatically; storages are reused when possible.
+            When running on CPU, the storages are packed into a single memory arena according to their lifetime: storages never used at the same
+            time may share the same memory area. The planned memory size and the one needed without any reuse are reported to the attached
+            Profiler as counters.
             The inference of a Model is performed by InferenceTask.
         */
         class Model : public GL::ProgramBank {
@@ -116,7 +123,37 @@ namespace Beatmup {
             std::vector<Storage*> storages;         //!< allocated storages used during the inference
             std::vector<GL::Vector*> vectors;       //!< allocated vectors used during the inference
             std::vector<InternalBitmap*> textures;  //!< allocated images used during the inference
+            std::vector<Storage*> arenaStorages;    //!< storages allocated in the memory arena
+            std::multimap<const AbstractOperation*, Storage*> paddedArenaOutputs;   //!< operation => output storage in the arena which padding is to be cleared before the operation is run
+            AlignedMemory arena;                    //!< memory shared by storages used during the inference on CPU
+            size_t arenaSize;                       //!< arena size in bytes
             Profiler* profiler;                     //!< pointer to a Profiler attached to the model
+            ProcessingTarget preparedFor;           //!< target device the model is prepared for
+
+            /**
+                Prepares all operations for a given target device.
+                \param[in,out] gpu              A graphic pipeline instance or null if the inference is run on CPU
+                \param[in] data                 ChunkCollection containing the model data
+            */
+            void doPrepare(GraphicPipeline* gpu, ChunkCollection& data);
+
+            /**
+                Storage lifetime in terms of operation indices
+            */
+            typedef struct {
+                Storage* storage;
+                int firstUse;               //!< index of the operation writing to the storage
+                int lastUse;                //!< index of the last operation reading from the storage
+                size_t offset;              //!< offset in bytes in the memory arena
+            } StorageLifetime;
+
+            /**
+                Assigns offsets in the memory arena to storages of given lifetimes.
+                Storages are placed in descending size order at the lowest offset not overlapping storages placed before and used at the same time.
+                \param[in,out] lifetimes     The storage lifetimes. Offsets are filled in.
+                \return arena size in bytes.
+            */
+            static size_t planArena(std::vector<StorageLifetime>& lifetimes);
 
         protected:
             std::vector<AbstractOperation*> ops;    //!< model operations
@@ -132,7 +169,7 @@ namespace Beatmup {
             /**
                 Allocates a new storage. Its views might be used as operations inputs and outputs.
                 The storage is destroyed together with the model.
-                \param[in,out] gpu              A graphic pipeline instance
+                \param[in,out] gpu              A graphic pipeline instance or null to allocate the storage on CPU only
                 \param[in] size                 The storage size (width, height, number of channels)
                 \param[in] forGpu               Allocate for the use on GPU
                 \param[in] forCpu               Allocate for the use on CPU
@@ -143,33 +180,32 @@ namespace Beatmup {
                                                 if the addDepth is greater or equal to the total depth.
                 \return newly allocated storage.
             */
-            Storage& allocateStorage(GraphicPipeline& gpu, const Size size, bool forGpu = true, bool forCpu = false, const int pad = 0, const int reservedChannels = 0);
+            Storage& allocateStorage(GraphicPipeline* gpu, const Size size, bool forGpu = true, bool forCpu = false, const int pad = 0, const int reservedChannels = 0);
 
             /**
                 Allocates a new flat storage. Its views are be used as operations inputs and outputs.
                 Flat storages can be inputs of Dense layers.
                 The storage is destroyed together with the model.
-                \param[in,out] gpu          A graphic pipeline instance
+                \param[in,out] gpu          A graphic pipeline instance or null to allocate a regular storage in RAM
                 \param[in] size             Number of samples in the storage
                 \return newly allocated storage.
             */
-            Storage& allocateFlatStorage(GraphicPipeline& gpu, const int size);
+            Storage& allocateFlatStorage(GraphicPipeline* gpu, const int size);
 
             /**
                 Allocates a vector that can be used as operation input or output.
                 Differently to flat storages, vectors store floating point data (GL ES 3.1 and higher) or 16-bit signed fixed point values with 8 bits
-                fractional part (GL ES 2.0).
-                \param[in,out] gpu          A graphic pipeline instance
+                fractional part (GL ES 2.0). When allocated on CPU, vectors store floating point data in RAM.
+                \param[in,out] gpu          A graphic pipeline instance or null to allocate the vector in RAM
                 \param[in] size             Number of samples in the vector
             */
-            GL::Vector& allocateVector(GraphicPipeline& gpu, const int size);
+            GL::Vector& allocateVector(GraphicPipeline* gpu, const int size);
 
             /**
                 Allocates a texture that can be used as operation input or output.
-                \param[in,out] gpu          A graphic pipeline instance
                 \param[in] size             Image size. The depth can be 1, 3 or 4 channels.
             */
-            InternalBitmap& allocateTexture(GraphicPipeline& gpu, const Size size);
+            InternalBitmap& allocateTexture(const Size size);
 
             /**
                 Checks whether an operation goes before another operation in the model according the ops execution order.
@@ -272,15 +308,28 @@ namespace Beatmup {
             */
             virtual void prepare(GraphicPipeline& gpu, ChunkCollection& data);
 
+            /**
+                Prepares all operations to run the inference on CPU: reads the model data from chunks and allocates the storages in RAM.
+                All the operations of the model need to support CPU execution, otherwise an exception is thrown.
+                \param[in] data                 ChunkCollection containing the model data
+            */
+            virtual void prepare(ChunkCollection& data);
+
             /**
                 \return `true` if the model is ready to be used for inference (prepare() has been called).
             */
             inline bool isReady() const { return ready; }
 
+            /**
+                \return the target device the model is prepared for, if it is ready.
+            */
+            inline ProcessingTarget getPreparedTarget() const { return preparedFor; }
+
             /**
                 Runs the inference.
+                If the model is prepared for CPU, the inference is run by all the threads of the task.
                 \param[in,out] thread       Task thread instance
-                \param[in,out] gpu          A graphic pipeline
+                \param[in,out] gpu          A graphic pipeline, or null if the model is run on CPU or the current thread is not managing
             */
             void execute(TaskThread& thread, GraphicPipeline* gpu);
 
@@ -328,6 +377,7 @@ namespace Beatmup {
             /**
                 Returns the amount of texture memory in bytes currently allocated by the model to run the inference.
                 When the model is ready to run, this represents the size of the memory needed to store internal data during the inference.
+                Storages packed in the memory arena on CPU are accounted by the arena size.
                 The resulting value does not include the size of GLSL shaders binaries stored in GPU memory which can be significant.
             */
             size_t getMemorySize() const;
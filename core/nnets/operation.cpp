@@ -44,8 +44,8 @@ void AbstractOperation::getOutput(GL::Vector*&, int index) {
 }
 
 
-void AbstractOperation::getOutput(GL::TextureHandler*&, int index) {
-    throw RuntimeError("Operation " + name + " does not take TextureHandler on output #" + std::to_string(index));
+void AbstractOperation::getOutput(AbstractBitmap*&, int index) {
+    throw RuntimeError("Operation " + name + " does not take AbstractBitmap on output #" + std::to_string(index));
 }
 
 
@@ -69,13 +69,40 @@ void AbstractOperation::setOutput(GL::Vector&, int index) {
 }
 
 
-void AbstractOperation::setInput(GL::TextureHandler& image, int index) {
-    throw RuntimeError("Operation " + name + " does not take TextureHandler on input #" + std::to_string(index));
+void AbstractOperation::setInput(AbstractBitmap& image, int index) {
+    throw RuntimeError("Operation " + name + " does not take AbstractBitmap on input #" + std::to_string(index));
 }
 
 
-void AbstractOperation::setOutput(GL::TextureHandler&, int index) {
-    throw RuntimeError("Operation " + name + " does not take TextureHandler on output #" + std::to_string(index));
+void AbstractOperation::setOutput(AbstractBitmap&, int index) {
+    throw RuntimeError("Operation " + name + " does not take AbstractBitmap on output #" + std::to_string(index));
+}
+
+
+void AbstractOperation::prepare(ChunkCollection& data) {
+    throw RuntimeError("Operation " + name + " cannot be executed on CPU");
+}
+
+
+void AbstractOperation::executeOnCpu(TaskThread& thread) {
+    const int
+        idx = thread.currentThread(),
+        num = thread.numThreads();
+    if (thread.isManaging())
+        beforeExecute(nullptr, num);
+    thread.synchronize();
+
+    const int amount = getAmountOfWork();
+    if (!thread.isTaskAborted())
+        execute(
+             idx      * amount / num,
+            (idx + 1) * amount / num,
+            idx, num
+        );
+
+    thread.synchronize();
+    if (thread.isManaging())
+        afterExecute(num);
 }
 
 
@@ -297,7 +324,7 @@ void ActivationFunctionMixin::apply(StringBuilder& code, const char* inputVariab
 
 void CpuOperation::execute(TaskThread& thread, GraphicPipeline& gpu) {
     const int num = thread.numThreads();
-    beforeExecute(gpu, num);
+    beforeExecute(&gpu, num);
     const int amount = getAmountOfWork();
     thread.synchronize();
 
@@ -27,6 +27,7 @@
 #include "../utils/string_builder.h"
 #include "../utils/listing.h"
 #include <string>
+#include <algorithm>
 
 namespace Beatmup {
     namespace NNets {
@@ -38,10 +39,12 @@ namespace Beatmup {
             in single precision floating point format, where the chunks are searched by operation name.
             Operations have several inputs and outputs numbered starting from zero. Different operations accept different kinds of input and output
             data.
-             - Inputs may be Storage, GL::TextureHandler or GL::Vector.
-             - Outputs may be Storage or GL::Vector.
+             - Inputs may be Storage, AbstractBitmap or GL::Vector.
+             - Outputs may be Storage, AbstractBitmap or GL::Vector.
             The operations are built in a deferred fashion during the first inference run, which makes the first run much slower than the subsequent
             runs.
+            Operations are executed on GPU. An operation may also implement a CPU code path used when the inference is run with no GPU. In this case
+            its work is split in slices processed by different threads (see getAmountOfWork() and execute(int, int, int, int)).
         */
         class AbstractOperation {
             friend class Model;
@@ -71,10 +74,54 @@ namespace Beatmup {
 
             /**
                 Executes the operation within a specific CPU thread.
+                Called in worker threads when the inference is run on GPU.
                 \param[in,out] thread       Calling CPU thread descriptor
             */
             virtual void execute(TaskThread& thread) {}
 
+            /**
+                Reads the operation data to execute the operation on CPU.
+                Raises an exception if the operation has no CPU implementation.
+                \param[in,out] data     Chunkfile containing operation data (e.g. weights and biases)
+            */
+            virtual void prepare(ChunkCollection& data);
+
+            /**
+                Executes the operation on CPU.
+                Called by every thread running the inference when no GPU is used. beforeExecute() is called in the managing thread, then the amount
+                of work returned by getAmountOfWork() is split among threads, and afterExecute() is called in the managing thread.
+                \param[in,out] thread       Calling CPU thread descriptor
+            */
+            void executeOnCpu(TaskThread& thread);
+
+            /**
+                Returns amount of work in arbitrary units to be splitted among threads when executing the operation on CPU.
+            */
+            virtual int getAmountOfWork() const { return 0; }
+
+            /**
+                Called in a single thread right before the operation is executed on CPU.
+                \param[in,out] gpu          A graphic pipeline instance, if available. Null if the inference is run on CPU.
+                \param[in] threadCount      Number of threads executing the operation
+            */
+            virtual void beforeExecute(GraphicPipeline* gpu, const int threadCount) {}
+
+            /**
+                Called in a single thread right after the operation is executed on CPU.
+                \param[in] threadCount      Number of threads executed the operation
+            */
+            virtual void afterExecute(const int threadCount) {}
+
+            /**
+                Executes the operation body on CPU within a specific thread.
+                The threads can process different slices according to a given amount of work (see getAmountOfWork()).
+                \param[in] sliceStart       Current slice starting point (included in the slice)
+                \param[in] sliceStop        Current slice end point (excluded from the slice)
+                \param[in] threadIdx        Zero-based calling thread number
+                \param[in] threadCount      Total number of threads executing the operation
+            */
+            virtual void execute(const int sliceStart, const int sliceStop, const int threadIdx, const int threadCount) {}
+
             /**
                 Retrieves minimum required size of zero padding for a given input.
                 Operations that sample a neighborhood of a pixel may need the input to be padded with zeros, if some of the neighboring samples fall
@@ -151,7 +198,7 @@ namespace Beatmup {
             virtual bool acceptsVectorInput(int index = 0) const { return false; }
 
             /**
-                Returns `true` if the operation can take a GL::TextureHandler at a specific input.
+                Returns `true` if the operation can take an AbstractBitmap at a specific input.
                 Neural network operations may accept different kinds of data containers on inputs and outputs, namely Storage::View, GL::Vector
                 and textures. This function is used to check whether a given operation accepts a texture on input.
                 \param[in] index        The input index. Expected to fall in the valid range, i.e. from zero to getInputCount() - 1 inclusive.
@@ -175,7 +222,7 @@ namespace Beatmup {
             virtual bool acceptsVectorOutput(int index = 0) const { return false; }
 
             /**
-                Returns `true` if the operation can take a GL::TextureHandler at a specific output.
+                Returns `true` if the operation can take an AbstractBitmap at a specific output.
                 Neural network operations may accept different kinds of data containers on outputs and outputs, namely Storage::View, GL::Vector
                 and textures. This function is used to check whether a given operation accepts a texture on output.
                 \param[in] index        The output index. Expected to fall in the valid range, i.e. from zero to getOutputCount() - 1 inclusive.
@@ -202,18 +249,18 @@ namespace Beatmup {
             virtual void getOutput(GL::Vector*& vector, int index = 0);
 
             /**
-                Returns a GL::TextureHandler bound to a specific operation output.
-                \param[out] vector      Pointer to the GL::TextureHandler. If no texture is bound, becomes null.
+                Returns an AbstractBitmap bound to a specific operation output.
+                \param[out] image       Pointer to the bitmap. If no bitmap is bound, becomes null.
                 \param[in] index        The output index. Expected to fall in the valid range, i.e. from zero to getOutputCount() - 1 inclusive.
             */
-            virtual void getOutput(GL::TextureHandler*& vector, int index = 0);
+            virtual void getOutput(AbstractBitmap*& image, int index = 0);
 
             virtual void setInput(Storage::View&& storage, int index = 0);
             virtual void setOutput(Storage::View&& storage, int index = 0);
             virtual void setInput(GL::Vector& vector, int index = 0);
             virtual void setOutput(GL::Vector& vector, int index = 0);
-            virtual void setInput(GL::TextureHandler& image, int index = 0);
-            virtual void setOutput(GL::TextureHandler& image, int index = 0);
+            virtual void setInput(AbstractBitmap& image, int index = 0);
+            virtual void setOutput(AbstractBitmap& image, int index = 0);
 
             /**
                 Returns a serialized representation of th operation;
@@ -425,6 +472,26 @@ namespace Beatmup {
                 \param[in] inputVariable        Name of the variable to apply the activation function to
             */
             void apply(StringBuilder& code, const char* inputVariable);
+
+            /**
+                Applies the activation function to a value computed on CPU and quantizes the result to 8 bits the same way as it is stored in
+                a texture on GPU.
+                \param[in] value      The value to apply the activation function to
+                \return the activation function value sampled over 8 bits.
+            */
+            inline uint8_t apply(float value) const {
+                switch (activationFunc) {
+                    case ActivationFunction::BRELU6:
+                        value *= 0.167f;
+                        break;
+                    case ActivationFunction::SIGMOID_LIKE:
+                        value = std::min(std::max(0.1f * value, -0.05f), 0.05f) + std::min(std::max(0.05f * value, -0.125f), 0.125f) + 0.05f * value + 0.5f;
+                        break;
+                    default:
+                        break;
+                }
+                return value <= 0.0f ? 0 : value >= 1.0f ? 255 : (uint8_t)roundf_fast(255 * value);
+            }
         };
 
 
@@ -436,35 +503,14 @@ namespace Beatmup {
             CpuOperation(const std::string& name) : AbstractOperation(name) {}
 
             inline void prepare(GraphicPipeline& gpu, ChunkCollection& data, GL::ProgramBank& bank) {}
+            inline void prepare(ChunkCollection& data) {}
 
             inline void getSampledChannels(int index, int& min, int& max) const { min = max = 0; }
 
-            /**
-                Returns amount of work in arbitrary units to be splitted among threads.
-            */
             virtual int getAmountOfWork() const = 0;
 
-            /**
-                Called right before the operation is executed
-            */
-            virtual void beforeExecute(GraphicPipeline& gpu, const int threadCount) {}
-
-            /**
-                Called right after the operation is executed
-            */
-            virtual void afterExecute(const int threadCount) {}
-
             void execute(TaskThread& thread, GraphicPipeline& gpu);
             void execute(TaskThread& thread);
-
-            /**
-                Executes the operation body within a specific CPU thread.
-                The threads can process different slices according to a given amount of work (see getAmountOfWork()).
-                \param[in] sliceStart       Current slice starting point (included in the slice)
-                \param[in] sliceStop        Current slice end point (excluded from the slice)
-                \param[in] threadIdx        Zero-based calling thread number
-                \param[in] threadCount      Total number of threads executing the operation
-            */
             virtual void execute(const int sliceStart, const int sliceStop, const int threadIdx, const int threadCount) = 0;
         public:
             bool usesGpu() const { return false; }
@@ -140,6 +140,65 @@ void Pooling2D::execute(TaskThread& thread, GraphicPipeline& gpu) {
 }
 
 
+void Pooling2D::prepare(ChunkCollection& data) {
+    ready = true;
+}
+
+
+int Pooling2D::getAmountOfWork() const {
+    // a unit of work is a row of output pixels in a quad of channels
+    return output.getHeight() * output.getDepth() / 4;
+}
+
+
+void Pooling2D::execute(const int sliceStart, const int sliceStop, const int threadIdx, const int threadCount) {
+    if (!ready)
+        throw NotReady(this);
+    RuntimeError::check(input.getDepth() == output.getDepth(), "Input / output depth mismatch.");
+
+    const IntRectangle area = getSamplingArea(input.getSpatialSize(), IntPoint(stride[0], stride[1]), padding);
+    const int halfKernel = (size[0] - 1) / 2;
+    const int rowLength = 4 * input.getTextureWidth();
+    const float norm = 1.0f / size.volume();
+    const int numQuads = output.getDepth() / 4;
+
+    for (int unit = sliceStart; unit < sliceStop; ++unit) {
+        const int
+            y = unit / numQuads,
+            channel = 4 * (unit % numQuads),
+            top = area.a.y + y * stride[1] - halfKernel;
+
+        uint8_t* out = output.getData(channel, 0, y);
+        for (int x = 0; x < output.getWidth(); ++x, out += 4) {
+            const uint8_t* ptr = input.getData(channel, area.a.x + x * stride[0] - halfKernel, top);
+            switch (op) {
+                case Operator::MAX: {
+                    uint8_t r[4] = { 0, 0, 0, 0 };
+                    for (int ky = 0; ky < size[1]; ++ky, ptr += rowLength)
+                        for (int kx = 0; kx < size[0]; ++kx)
+                            for (int i = 0; i < 4; ++i)
+                                r[i] = std::max(r[i], ptr[4 * kx + i]);
+                    for (int i = 0; i < 4; ++i)
+                        out[i] = r[i];
+                    break;
+                }
+
+                case Operator::AVERAGE: {
+                    int r[4] = { 0, 0, 0, 0 };
+                    for (int ky = 0; ky < size[1]; ++ky, ptr += rowLength)
+                        for (int kx = 0; kx < size[0]; ++kx)
+                            for (int i = 0; i < 4; ++i)
+                                r[i] += ptr[4 * kx + i];
+                    for (int i = 0; i < 4; ++i)
+                        out[i] = (uint8_t)roundf_fast(norm * r[i]);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
 int Pooling2D::getInputPadding(int index) const {
     return (padding == Size::Padding::SAME) ? std::max(size[0], size[1]) / 2 : 0;
 }
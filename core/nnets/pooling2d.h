@@ -23,7 +23,7 @@ namespace Beatmup {
     namespace NNets {
 
         /**
-            2D pooling operation computed on GPU.
+            2D pooling operation computed on GPU or CPU.
             Has a single input and a single output.
             Constraints:
                 - Input and output are 3D tensors with values in [0, 1] range sampled over 8 bits.
@@ -57,6 +57,9 @@ namespace Beatmup {
 
             void prepare(GraphicPipeline& gpu, ChunkCollection& data, GL::ProgramBank& bank);
             void execute(TaskThread& thread, GraphicPipeline& gpu);
+            void prepare(ChunkCollection& data);
+            int getAmountOfWork() const;
+            void execute(const int sliceStart, const int sliceStop, const int threadIdx, const int threadCount);
             int getInputPadding(int index = 0) const;
             void getSampledChannels(int index, int& min, int& max) const;
 
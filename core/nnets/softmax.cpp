@@ -31,12 +31,17 @@ int Softmax::getAmountOfWork() const {
 }
 
 
-void Softmax::beforeExecute(GraphicPipeline& gpu, const int threadCount) {
+void Softmax::beforeExecute(GraphicPipeline* gpu, const int threadCount) {
     partialSums.resize(threadCount);
-    if (inputVector)
-        inputVector->fetch(gpu, output);
+    if (inputVector) {
+        if (gpu)
+            inputVector->fetch(*gpu, output);
+        else
+            inputVector->fetch(output);
+    }
     else {
-        inputView.getStorage().pull(gpu);
+        if (!inputView.getStorage().isUpToDate(ProcessingTarget::CPU))
+            inputView.getStorage().pull(*gpu);
         output.resize(inputView.getSize().volume());
         Storage::Scanner scanner(inputView);
         scanner.move(0, 0);
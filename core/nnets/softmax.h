@@ -37,7 +37,7 @@ namespace Beatmup {
             GL::Vector* inputVector;
 
             int getAmountOfWork() const;
-            void beforeExecute(GraphicPipeline& gpu, const int threadCount);
+            void beforeExecute(GraphicPipeline* gpu, const int threadCount);
             void execute(const int sliceStart, const int sliceStop, const int threadIdx, const int threadCount);
             void afterExecute(const int threadCount);
 
@@ -19,6 +19,7 @@
 #include "storage.h"
 #include "../gpu/bgl.h"
 #include "../gpu/texture_handler.h"
+#include "../gpu/texture_pool.h"
 #include "../utils/string_builder.h"
 #include "../utils/bitset.h"
 #include "../exception.h"
@@ -92,18 +93,20 @@ void Storage::push(GraphicPipeline& gpu, const void* data) {
     for (int i = 0; i < getNumberOfTextures(); ++i) {
         glBindTexture(GL_TEXTURE_2D, textures[i].handle);
 #ifdef BEATMUP_OPENGLVERSION_GLES20
-        glTexImage2D(GL_TEXTURE_2D,
-            0,
-            GL::BITMAP_INTERNALFORMATS[format],
-            getTextureWidth(), getTextureHeight(),
-            0,
-            GL_RGBA,
-            GL::BITMAP_PIXELTYPES[format],
-            data ? ptr : nullptr);
+        if (data || !textures[i].allocated)
+            glTexImage2D(GL_TEXTURE_2D,
+                0,
+                GL::BITMAP_INTERNALFORMATS[format],
+                getTextureWidth(), getTextureHeight(),
+                0,
+                GL_RGBA,
+                GL::BITMAP_PIXELTYPES[format],
+                data ? ptr : nullptr);
         if (data)
              ptr += textureSizeBytes;
 #else
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL::BITMAP_INTERNALFORMATS[format], getTextureWidth(), getTextureHeight());
+        if (!textures[i].allocated)
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL::BITMAP_INTERNALFORMATS[format], getTextureWidth(), getTextureHeight());
         if (data) {
             glTexSubImage2D(GL_TEXTURE_2D,
                 0, 0, 0, getTextureWidth(), getTextureHeight(),
@@ -118,6 +121,7 @@ void Storage::push(GraphicPipeline& gpu, const void* data) {
         // set dirty flag if no data (the texture needs to be cleared before being used)
         textures[i].dirty = (data == nullptr);
         GL::GLException::check("allocating storage");
+        textures[i].allocated = true;
     }
 
     upToDate[ProcessingTarget::GPU] = true;
@@ -126,7 +130,7 @@ void Storage::push(GraphicPipeline& gpu, const void* data) {
 
 Storage::Storage(Context& ctx, GraphicPipeline& gpu, const Size size, const int pad, const int reservedChannels):
     context(ctx),
-    textures(nullptr), size(size), pad(pad),
+    textures(nullptr), ramAddr(nullptr), size(size), pad(pad),
     upToDate{false, false}
 {
     const int depth = size.getDepth() + reservedChannels;
@@ -150,7 +154,7 @@ Storage::Storage(Context& ctx, GraphicPipeline& gpu, const Size size, const int
 
 Storage::Storage(Context& ctx, GraphicPipeline& gpu, const Size size):
     context(ctx),
-    textures(nullptr), size(size), pad(0),
+    textures(nullptr), ramAddr(nullptr), size(size), pad(0),
     upToDate{false, false}
 {
     checkChannelNumber(size.getDepth());
@@ -159,6 +163,16 @@ Storage::Storage(Context& ctx, GraphicPipeline& gpu, const Size size):
 }
 
 
+Storage::Storage(Context& ctx, const Size size, const int pad):
+    context(ctx),
+    textures(nullptr), ramAddr(nullptr), size(size), pad(pad),
+    packX(1), packY(1),
+    upToDate{false, false}
+{
+    checkChannelNumber(size.getDepth());
+}
+
+
 Storage::~Storage() {
     free();
 }
@@ -168,62 +182,108 @@ void Storage::allocate(GraphicPipeline& gpu) {
     if (textures)
         return;
 
-    // setting up textures
+    createTextures();
+    push(gpu, nullptr);
+}
+
+
+void Storage::createTextures() {
+    GL::TexturePool& pool = context.getGpuTexturePool();
     const int count = getNumberOfTextures();
     textures = new Texture[count];
-    for (int i = 0; i < count; ++i)
-        glGenTextures(1, &textures[i].handle);
+    for (int i = 0; i < count; ++i) {
+        textures[i].allocated = pool.acquire(getTextureWidth(), getTextureHeight(), GL::TextureHandler::TextureFormat::RGBAx8, textures[i].handle);
+        if (!textures[i].allocated)
+            glGenTextures(1, &textures[i].handle);
+        textures[i].dirty = true;
+    }
+}
 
-    push(gpu, nullptr);
+
+std::vector<GL::handle_t> Storage::releaseTextures() {
+    GL::TexturePool& pool = context.getGpuTexturePool();
+    std::vector<GL::handle_t> unallocated;
+    for (int i = 0; i < getNumberOfTextures(); ++i)
+        if (textures[i].allocated)
+            pool.release(textures[i].handle, getTextureWidth(), getTextureHeight(), GL::TextureHandler::TextureFormat::RGBAx8);
+        else
+            unallocated.push_back(textures[i].handle);
+    delete[] textures;
+    textures = nullptr;
+    return unallocated;
 }
 
 
 void Storage::allocate() {
-    if (memory)
+    if (ramAddr)
         return;
 
-    memory = AlignedMemory(getMemorySize());
+    memory = AlignedMemory(getMemorySize(), context.getMemoryPool());
+    ramAddr = memory.ptr<uint8_t>();
+    memset(ramAddr, 0, getMemorySize());
     upToDate[ProcessingTarget::CPU] = true;
 }
 
 
+void Storage::allocate(AlignedMemory& arena, size_t offset) {
+    RuntimeError::check(!ramAddr, "Storage is already allocated in RAM");
+    ramAddr = arena.ptr<uint8_t>() + offset;
+    memset(ramAddr, 0, getMemorySize());
+    upToDate[ProcessingTarget::CPU] = true;
+}
+
+
+void Storage::clearPadding() {
+    if (!ramAddr || pad == 0)
+        return;
+    const int width = getTextureWidth(), height = getTextureHeight();
+    const size_t rowSize = 4 * width, padSize = 4 * pad;
+    for (int i = 0; i < getNumberOfTextures(); ++i) {
+        uint8_t* ptr = ramAddr + i * rowSize * height;
+        memset(ptr, 0, rowSize * pad);
+        for (int y = pad; y < height - pad; ++y) {
+            memset(ptr + y * rowSize, 0, padSize);
+            memset(ptr + (y + 1) * rowSize - padSize, 0, padSize);
+        }
+        memset(ptr + (height - pad) * rowSize, 0, rowSize * pad);
+    }
+}
+
+
 void Storage::free(GraphicPipeline& gpu) {
     // feeing GPU storage
     if (textures != nullptr) {
-        for (int i = 0; i < getNumberOfTextures(); ++i)
-            glGenTextures(1, &textures[i].handle);
-        delete[] textures;
-        textures = nullptr;
+        const auto unallocated = releaseTextures();
+        if (!unallocated.empty())
+            glDeleteTextures((GLsizei)unallocated.size(), unallocated.data());
     }
 
     // freeing CPU storage
     memory.free();
+    ramAddr = nullptr;
 }
 
 
 void Storage::free() {
     class Deleter : public GL::RecycleBin::Item {
-        GL::handle_t* handles;
-        int count;
+        std::vector<GL::handle_t> handles;
     public:
-        Deleter(const Texture* textures, int count) : handles(new GL::handle_t[count]), count(count) {
-            for (int i = 0; i < count; ++i)
-                handles[i] = textures[i].handle;
-        }
+        Deleter(const std::vector<GL::handle_t>& handles) : handles(handles) {}
         ~Deleter() {
-            glDeleteTextures(count, handles);
-            delete[] handles;
+            glDeleteTextures((GLsizei)handles.size(), handles.data());
         }
     };
 
     // freeing GPU storage
     if (textures != nullptr) {
-        context.getGpuRecycleBin()->put(new Deleter(textures, getNumberOfTextures()));
-        textures = nullptr;
+        const auto unallocated = releaseTextures();
+        if (!unallocated.empty())
+            context.getGpuRecycleBin()->put(new Deleter(unallocated));
     }
 
     // freeing CPU storage
     memory.free();
+    ramAddr = nullptr;
 
     upToDate[ProcessingTarget::CPU] = false;
     upToDate[ProcessingTarget::GPU] = false;
@@ -237,9 +297,11 @@ void Storage::pull(GraphicPipeline& gpu) {
     const int textureSizeBytes = getTextureWidth() * getTextureHeight() * 4;
 
     // allocate / acquire CPU storage
-    if (!memory)
-        memory = AlignedMemory(textureSizeBytes * getNumberOfTextures());
-    uint8_t* ptr = memory.ptr<uint8_t>(0);
+    if (!ramAddr) {
+        memory = AlignedMemory(textureSizeBytes * getNumberOfTextures(), context.getMemoryPool());
+        ramAddr = memory.ptr<uint8_t>();
+    }
+    uint8_t* ptr = ramAddr;
 
     glPixelStorei(GL_PACK_ALIGNMENT, 1);
     for (int i = 0; i < getNumberOfTextures(); ++i) {
@@ -261,16 +323,10 @@ void Storage::push(GraphicPipeline& gpu) {
         throw InconsistentStorageState("No data to push in the storage");
 
     // allocate on GPU if not yet
-    if (!textures) {
-        const int count = getNumberOfTextures();
-        textures = new Texture[count];
-        for (int i = 0; i < count; ++i) {
-            glGenTextures(1, &textures[i].handle);
-            textures[i].dirty = true;
-        }
-    }
+    if (!textures)
+        createTextures();
 
-    push(gpu, memory());
+    push(gpu, ramAddr);
 }
 
 
@@ -278,10 +334,8 @@ void Storage::push(GraphicPipeline& gpu, const float* hwcData, const size_t numS
     RuntimeError::check(numSamples == getSize().volume(), "Data size does not match storage capacity");
 
     // allocate the CPU storage if not yet
-    if (!memory) {
+    if (!ramAddr)
         allocate();
-        memset(memory(), 0, getMemorySize());
-    }
 
 #ifdef BEATMUP_DEBUG
     // check the input data range
@@ -295,7 +349,7 @@ void Storage::push(GraphicPipeline& gpu, const float* hwcData, const size_t numS
     const int paddedHeight = height + 2 * pad;
     for (int c = 0; c < depth; c+=4)
         for (int y = 0, i = 0; y < height; ++y) {
-            color4i* dst = memory.ptr<color4i>(paddedWidth * paddedHeight * c / 4 + paddedWidth * (y + pad) + pad);
+            color4i* dst = (color4i*)ramAddr + (paddedWidth * paddedHeight * c / 4 + paddedWidth * (y + pad) + pad);
             for (int x = 0; x < width; ++x, ++dst, ++i) {
                 dst->r = (uint8_t)(hwcData[i * depth + c + 0] * 255);
                 dst->g = (uint8_t)(hwcData[i * depth + c + 1] * 255);
@@ -516,6 +570,26 @@ IntPoint Storage::View::getChannelOrigin(int channel) const {
 }
 
 
+uint8_t* Storage::View::getData(int channel, int x, int y) {
+#ifdef BEATMUP_DEBUG
+    DebugAssertion::check(storage->ramAddr, "Storage is not allocated in RAM");
+#endif
+    const IntPoint pos = getChannelOrigin(channel) + IntPoint(x, y);
+    const int texture = textures[getChannelTextureNumber(channel)];
+    return storage->ramAddr + (4 * ((texture * storage->getTextureHeight() + pos.y) * storage->getTextureWidth() + pos.x));
+}
+
+
+const uint8_t* Storage::View::getData(int channel, int x, int y) const {
+#ifdef BEATMUP_DEBUG
+    DebugAssertion::check(storage->ramAddr, "Storage is not allocated in RAM");
+#endif
+    const IntPoint pos = getChannelOrigin(channel) + IntPoint(x, y);
+    const int texture = textures[getChannelTextureNumber(channel)];
+    return storage->ramAddr + (4 * ((texture * storage->getTextureHeight() + pos.y) * storage->getTextureWidth() + pos.x));
+}
+
+
 Storage::TextureHandler::TextureHandler(const View& view, int channel):
     width(view.getStorage().getTextureWidth()), height(view.getStorage().getTextureHeight())
 {
@@ -638,7 +712,7 @@ Storage::Scanner::~Scanner() {
 void Storage::Scanner::bind(Storage::View& view) {
 #ifdef BEATMUP_DEBUG
     DebugAssertion::check(!this->view, "A view is already bound");
-    DebugAssertion::check(view.storage->memory, "Storage is not allocated in RAM");
+    DebugAssertion::check(view.storage->ramAddr, "Storage is not allocated in RAM");
 #endif
     // set internal state
     this->view = &view;
@@ -650,7 +724,7 @@ void Storage::Scanner::bind(Storage::View& view) {
     }
 
     // acquire memory
-    data = view.storage->memory.ptr<sample_t>();
+    data = (sample_t*)view.storage->ramAddr;
 }
 
 
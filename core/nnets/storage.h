@@ -138,11 +138,13 @@ namespace Beatmup {
             typedef struct {
                 GL::handle_t handle;
                 bool dirty;         //!< if `true`, the texture needs to be cleared before use
+                bool allocated;     //!< if `true`, the texture storage is allocated
             } Texture;
 
             Context& context;
             Texture* textures;
             AlignedMemory memory;   //!< data storage in RAM
+            uint8_t* ramAddr;       //!< address of the data in RAM: either in `memory` or in an external memory arena
             const Size size;
             const int pad;          //!< padding in pixels added along width and height dimensions
             int packX, packY;       //!< number of blocks of 4 channels per texture (spatial packing)
@@ -150,6 +152,17 @@ namespace Beatmup {
 
             void push(GraphicPipeline& gpu, const void* data);
 
+            /**
+                Sets up the textures, reusing those of the context texture pool if available.
+            */
+            void createTextures();
+
+            /**
+                Returns the allocated textures to the context texture pool.
+                \return handles of textures having no storage allocated, to be deleted by the caller.
+            */
+            std::vector<GL::handle_t> releaseTextures();
+
         public:
             /**
                 Creates a storage.
@@ -170,6 +183,15 @@ namespace Beatmup {
             */
             Storage(Context& ctx, GraphicPipeline& gpu, const Size size);
 
+            /**
+                Creates a storage to be used on CPU.
+                Every texture contains exactly four channels, no spatial packing is applied.
+                \param[in] ctx          A context
+                \param[in] size         Storage size
+                \param[in] pad          Additional padding to add to the texture dimensions
+            */
+            Storage(Context& ctx, const Size size, const int pad);
+
             ~Storage();
 
             /**
@@ -180,9 +202,24 @@ namespace Beatmup {
 
             /**
                 Allocates the storage in RAM.
+                The allocated memory is filled with zeros.
             */
             void allocate();
 
+            /**
+                Places the storage in RAM within an external memory arena shared with other storages.
+                The arena memory is not owned by the storage and must outlive it. The storage area is filled with zeros.
+                \param[in] arena     The arena
+                \param[in] offset    Offset in bytes of the storage data within the arena
+            */
+            void allocate(AlignedMemory& arena, size_t offset);
+
+            /**
+                Fills the padding area of the storage allocated in RAM with zeros.
+                Required when the storage shares its memory with other storages, as they may write over the padding.
+            */
+            void clearPadding();
+
             /**
                 Frees the allocated memory immediately.
                 \param[in] gpu    A graphic pipeline instance
@@ -190,7 +227,8 @@ namespace Beatmup {
             void free(GraphicPipeline& gpu);
 
             /**
-                Deferred storage disposal: the textures are put into the GPU recycle bin associated with the context.
+                Deferred storage disposal: the textures are returned to the texture pool of the context and put into its GPU recycle bin when
+                evicted.
             */
             void free();
 
@@ -226,7 +264,7 @@ namespace Beatmup {
             /**
                 Returns `true` if the storage is allocated
             */
-            inline bool isAllocated() const { return textures != nullptr || memory; }
+            inline bool isAllocated() const { return textures != nullptr || ramAddr != nullptr; }
 
             /**
                 Converts a feature channel into a bitmap for debugging purposes.
@@ -279,7 +317,7 @@ namespace Beatmup {
             inline size_t getMemorySize() const { return (size_t)getTextureWidth() * getTextureHeight() * getNumberOfTextures() * 4; }
 
             /**
-                Returns the storage memory, if allocated in RAM (for CPU).
+                Returns the storage memory, if allocated in RAM (for CPU) by the storage itself, i.e., not within a memory arena.
             */
             inline AlignedMemory& getMemory() { return memory; }
             inline const AlignedMemory& getMemory() const { return memory; }
@@ -394,6 +432,16 @@ namespace Beatmup {
                 inline int getWidth()  const { return storage->size[0]; }
                 inline int getHeight() const { return storage->size[1]; }
                 inline int getDepth()  const { return 4 * (int)channels.size(); }
+
+                /**
+                    Returns a pointer to the storage data in RAM at a specific position in a given channel.
+                    The pointed data contains 4 channels per pixel. A row of the texture containing the channel is getTextureWidth() pixels long.
+                    \param[in] channel      The channel number, a multiple of 4
+                    \param[in] x            Horizontal position in pixels with respect to the channel origin; may be negative to access the padding
+                    \param[in] y            Vertical position in pixels with respect to the channel origin; may be negative to access the padding
+                */
+                uint8_t* getData(int channel, int x, int y);
+                const uint8_t* getData(int channel, int x, int y) const;
             };
 
             /**
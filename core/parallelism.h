@@ -55,6 +55,13 @@ namespace Beatmup {
         If the asynchronous behavior is not needed, a task can be run in a blocking call to Context::performTask(). This hides the mechanics of jobs
         from the user and just runs a given task.
 
+        Jobs submitted to the same thread pool start in the order of submission, but do not necessarily wait for each other to finish: a job
+        starts as soon as the pool has enough idle workers to run it. Several jobs having small thread counts (see AbstractTask::getMaxThreads())
+        thus run concurrently. If a job depends on the result of another one, the application needs to wait for the latter to finish before
+        submitting the former. In the main pool, jobs using GPU and all the jobs submitted once the GPU is set up are started in the managing
+        worker thread, which is the only thread having access to the GPU.
+        TaskGraph orders jobs automatically from the bitmaps their tasks read and write.
+
         \subsection ssecPersistent Persistent tasks
         Usually, once a task is completed, it is dropped from the thread pool queue. This is referred to as the "normal mode", differently to
         the "persistent mode" in which the task is getting repeated until it decides to quit itself. This is convenient for rendering and playback
@@ -167,7 +174,7 @@ namespace Beatmup {
         }
 
         /**
-            \return `true` if this thread is the managing thread
+            \return `true` if this thread is the first one of the threads running the current task (number 0).
         */
         inline bool isManaging() const {
             return index == 0;
@@ -190,6 +197,21 @@ namespace Beatmup {
             an exception the thread pool takes care of. This ensures a valid thread pool state and avoids dead locks when a task fails to proceed.
         */
         virtual void synchronize() = 0;
+
+        /**
+            Hands out a chunk of work items to the calling thread.
+            The work items are numbered from 0 to `numItems - 1` and grouped in chunks of `chunkSize` consecutive items. Every thread first
+            takes chunks one by one from its own contiguous share. Once the share is exhausted, the thread steals chunks from the thread having
+            the most work left. This keeps all the threads busy till the end of the task even if some of them run slower than the others.
+            The work items are shared by all the threads running the task between two consecutive synchronization points (see synchronize()).
+            Within this interval, every thread calling this function must pass the same arguments.
+            \param[in] numItems        Total number of work items
+            \param[in] chunkSize       Number of work items in a chunk
+            \param[out] start          Index of the first work item of the chunk
+            \param[out] stop           Index of the work item following the last one of the chunk
+            \return `true` if a chunk is given, `false` if all the work items are already handed out.
+        */
+        virtual bool nextChunk(msize numItems, msize chunkSize, msize& start, msize& stop) = 0;
     };
 
 }
@@ -19,12 +19,113 @@
 #include "../exception.h"
 #include "custom_pipeline.h"
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 
 using namespace Beatmup;
 
 class CustomPipeline::Impl : public TaskRouter {
 private:
+    /**
+        Task run in pipelined mode by a subset of threads running the pipeline
+    */
+    class Stage {
+    private:
+        std::mutex access;
+        std::condition_variable cvar;
+        ThreadIndex participants;           //!< number of threads still running the task
+        ThreadIndex waiting;                //!< number of threads waiting at the barrier
+        int round;                          //!< number of times the barrier is released
+        bool failed;                        //!< if `true`, one of threads running the task failed
+        std::atomic<msize> nextItem;        //!< next work item to hand out in the current synchronization round
+
+        void release() {
+            waiting = 0;
+            round++;
+            nextItem.store(0);
+            cvar.notify_all();
+        }
+
+    public:
+        TaskHolder* holder;
+        ThreadIndex firstThread;            //!< index of the first pipeline thread running the task
+        ThreadIndex threadCount;            //!< number of threads running the task
+        bool onGpu;
+
+        Stage(TaskHolder* holder): participants(0), waiting(0), round(0), failed(false), nextItem(0),
+            holder(holder), firstThread(0), threadCount(1), onGpu(false)
+        {}
+
+        void reset() {
+            participants = threadCount;
+            waiting = 0;
+            failed = false;
+            nextItem.store(0);
+        }
+
+        void synchronize() {
+            std::unique_lock<std::mutex> lock(access);
+            RuntimeError::check(!failed, "Another thread running the task failed");
+            if (++waiting >= participants) {
+                release();
+                return;
+            }
+            const int current = round;
+            cvar.wait(lock, [&]() { return round != current || failed; });
+            RuntimeError::check(!failed, "Another thread running the task failed");
+        }
+
+        /**
+            Excludes the calling thread from the barrier
+        */
+        void leave(bool failure) {
+            std::lock_guard<std::mutex> lock(access);
+            participants--;
+            if (failure) {
+                failed = true;
+                cvar.notify_all();
+            }
+            else if (waiting > 0 && waiting >= participants)
+                release();
+        }
+
+        /**
+            \return `true` if a given pipeline thread runs the task.
+        */
+        inline bool isRunBy(const TaskThread& thread) const {
+            return firstThread <= thread.currentThread() && thread.currentThread() < firstThread + threadCount;
+        }
+
+        bool nextChunk(msize numItems, msize chunkSize, msize& start, msize& stop) {
+            start = nextItem.fetch_add(chunkSize);
+            if (start >= numItems)
+                return false;
+            stop = std::min(start + chunkSize, numItems);
+            return true;
+        }
+    };
+
+    /**
+        Thread running a task in pipelined mode: one of the threads running the stage
+    */
+    class StageThread : public TaskThread {
+    private:
+        TaskThread& thread;
+        Stage& stage;
+    public:
+        StageThread(TaskThread& thread, Stage& stage):
+            TaskThread(thread.currentThread() - stage.firstThread), thread(thread), stage(stage)
+        {}
+
+        ThreadIndex numThreads() const { return stage.threadCount; }
+        bool isTaskAborted() const { return thread.isTaskAborted(); }
+        void synchronize() { stage.synchronize(); }
+        bool nextChunk(msize numItems, msize chunkSize, msize& start, msize& stop) {
+            return stage.nextChunk(numItems, chunkSize, start, stop);
+        }
+    };
+
     std::vector<TaskHolder*>::iterator currentTask;
     std::vector<TaskHolder*> tasks;	    	//!< the list of tasks
     std::mutex tasksAccess;					//!< task list access control
@@ -33,17 +134,22 @@ private:
     AbstractTask::TaskDeviceRequirement executionMode;
     ThreadIndex maxThreadCount;
     bool measured;                          //!< if `true`, the execution mode and the thread count are determined
-    bool abort;                             //!< if `true`, one of threads executing the current task caused its aborting
+    std::atomic<bool> abort;                //!< if `true`, one of threads executing the current task caused its aborting
+    FrameBinder* frameBinder;               //!< binds tasks to frames in pipelined mode; null if the mode is disabled
+    unsigned long step;                     //!< number of runs in pipelined mode
+    std::vector<Stage*> stages;             //!< tasks processing a frame during the current run in pipelined mode
 
 public:
     Impl():
-        measured(false)
+        measured(false), abort(false), frameBinder(nullptr), step(0)
     {}
 
     virtual ~Impl() {
         // destroying taskholders
         for (auto task : tasks)
             delete task;
+        for (auto stage : stages)
+            delete stage;
     }
 
     TaskHolder& getCurrentTask() {
@@ -180,18 +286,126 @@ public:
     ThreadIndex getMaxThreads() const {
         if (!measured)
             throw PipelineNotReady("Pipeline not measured; call measure() first.");
+        if (frameBinder) {
+            // all the tasks may run at the same time
+            int count = 0;
+            for (auto task : tasks)
+                count += std::max<int>(task->threadCount, 1);
+            return (ThreadIndex)std::min<int>(count, MAX_THREAD_INDEX);
+        }
         return maxThreadCount;
     }
 
-    void beforeProcessing(GraphicPipeline *gpu) {
+    void enablePipelining(FrameBinder* binder) {
+        std::lock_guard<std::mutex> lock(tasksAccess);
+        frameBinder = binder;
+        step = 0;
+    }
+
+    bool isPipelined() const {
+        return frameBinder != nullptr;
+    }
+
+    void beforeProcessing(ThreadIndex threadCount, GraphicPipeline *gpu) {
         this->gpu = gpu;
         abort = false;
+        if (frameBinder)
+            setUpStages(threadCount);
+    }
+
+    void afterProcessing(bool aborted) {
+        if (!frameBinder)
+            return;
+        for (auto stage : stages) {
+            stage->holder->getTask().afterProcessing(stage->threadCount, stage->onGpu ? gpu : nullptr, aborted || abort);
+            delete stage;
+        }
+        stages.clear();
+        step++;
+    }
+
+    /**
+        Binds the tasks to frames, distributes the threads among the tasks having a frame to process and prepares them.
+        The tasks are split into groups run concurrently, each group by its own subset of threads. Tasks using GPU are all in the
+        first group, as only the first thread has access to the GPU.
+    */
+    void setUpStages(ThreadIndex threadCount) {
+        std::vector<TaskHolder*> tasks;
+        {
+            std::lock_guard<std::mutex> lock(tasksAccess);
+            tasks = this->tasks;
+        }
+
+        // the binder is called with the task list unlocked, as it may access the pipeline
+        for (size_t i = 0; i < tasks.size() && i <= step; ++i)
+            if (frameBinder->bindFrame(*tasks[i], step - i)) {
+                stages.push_back(new Stage(tasks[i]));
+                stages.back()->onGpu = tasks[i]->executionMode != AbstractTask::TaskDeviceRequirement::CPU_ONLY && gpu;
+            }
+        if (stages.empty())
+            return;
+
+        const int numGroups = std::min<int>(threadCount, (int)stages.size());
+        bool gpuUsed = false;
+        for (auto stage : stages)
+            gpuUsed |= stage->onGpu;
+        int group = gpuUsed && numGroups > 1 ? 1 : 0;
+        for (auto stage : stages) {
+            const int g = stage->onGpu ? 0 : group;
+            if (!stage->onGpu)
+                group = (group + 1) % numGroups;
+            stage->firstThread = (ThreadIndex)(threadCount * g / numGroups);
+            const int groupSize = threadCount * (g + 1) / numGroups - stage->firstThread;
+            stage->threadCount = (ThreadIndex)std::max(1, std::min<int>(stage->holder->threadCount, groupSize));
+            stage->reset();
+            stage->holder->getTask().beforeProcessing(
+                stage->threadCount,
+                stage->onGpu ? ProcessingTarget::GPU : ProcessingTarget::CPU,
+                gpu
+            );
+        }
+    }
+
+    /**
+        Processing entry point in pipelined mode: runs the tasks of the group the calling thread belongs to
+    */
+    bool processStages(GraphicPipeline* gpu, TaskThread& thread) {
+        for (auto it = stages.begin(); it != stages.end(); ++it) {
+            Stage* stage = *it;
+            if (!stage->isRunBy(thread))
+                continue;
+            StageThread stageThread(thread, *stage);
+            auto startTime = std::chrono::high_resolution_clock::now();
+            bool result;
+            try {
+                if (stage->onGpu && gpu && thread.isManaging())
+                    result = stage->holder->getTask().processOnGPU(*gpu, stageThread);
+                else
+                    result = stage->holder->getTask().process(stageThread);
+            }
+            catch (...) {
+                // release the other threads of this and the following stages of the group waiting for this thread
+                for (; it != stages.end(); ++it)
+                    if ((*it)->isRunBy(thread))
+                        (*it)->leave(true);
+                throw;
+            }
+            stage->leave(false);
+            if (!result)
+                abort = true;
+            if (stageThread.isManaging())
+                stage->holder->time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+        }
+        return !abort;
     }
 
     /**
      * Processing entry point
      */
     bool process(GraphicPipeline* gpu, TaskThread& thread, CustomPipeline & pipeline) {
+        if (frameBinder)
+            return processStages(gpu, thread);
+
         // managing worker thread
         if (thread.isManaging()) {
             this->thread = &thread;
@@ -225,10 +439,11 @@ ThreadIndex CustomPipeline::getMaxThreads() const {
 }
 
 void CustomPipeline::beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline *gpu) {
-    impl->beforeProcessing(gpu);
+    impl->beforeProcessing(threadCount, gpu);
 }
 
 void CustomPipeline::afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted) {
+    impl->afterProcessing(aborted);
     AbstractTask::afterProcessing(threadCount, gpu, aborted);
 }
 
@@ -280,6 +495,14 @@ void CustomPipeline::measure() {
     impl->measure();
 }
 
+void CustomPipeline::enablePipelining(FrameBinder* binder) {
+    impl->enablePipelining(binder);
+}
+
+bool CustomPipeline::isPipelined() const {
+    return impl->isPipelined();
+}
+
 CustomPipeline::TaskHolder::TaskHolder(CustomPipeline::TaskHolder &&holder):
     task(holder.task),
     executionMode(holder.executionMode),
@@ -28,10 +28,14 @@ namespace Beatmup {
     /**
         Custom pipeline: a sequence of tasks to be executed as a whole.
         Acts as an AbstractTask. Built by adding tasks one by one and calling measure() at the end.
+
+        By default, every run of the pipeline runs its tasks one after the other. In pipelined mode (see enablePipelining()), the tasks
+        process consecutive frames of a stream concurrently instead, one frame per task.
     */
     class CustomPipeline : public AbstractTask {
     public:
         class TaskHolder;
+        class FrameBinder;
     private:
         class Impl;
         Impl* impl;
@@ -92,6 +96,24 @@ namespace Beatmup {
          */
         void measure();
 
+        /**
+            Enables or disables the pipelined mode.
+            In pipelined mode, every run of the pipeline advances a stream of frames by one step: the first task takes a new frame, and every
+            other task takes the frame processed by the previous task during the previous run. The tasks are run concurrently on disjoint sets
+            of threads, so that the throughput is limited by the slowest task rather than by all the tasks together. A frame thus leaves the
+            pipeline after as many runs as there are tasks.
+            The data passed from a task to the next one needs to be double-buffered, so that a task writes a frame while the next one reads the
+            previous frame. The tasks are bound to the buffers by the frame binder before every run.
+            GPU-using tasks are run by the thread having access to the GPU one after the other.
+            \param[in] binder      The frame binder, or null to disable the pipelined mode
+        */
+        void enablePipelining(FrameBinder* binder);
+
+        /**
+            \return `true` if the pipelined mode is enabled.
+        */
+        bool isPipelined() const;
+
         /**
             A task within a pipeline
          */
@@ -121,6 +143,25 @@ namespace Beatmup {
             float getRunTime() const { return time; }
         };
 
+        /**
+            Binds tasks to frames in pipelined mode
+        */
+        class FrameBinder {
+        public:
+            virtual ~FrameBinder() {}
+
+            /**
+                Called before a task processes a frame in pipelined mode.
+                Sets up the task inputs and outputs for the frame, typically picking one of two buffers according to the frame number parity.
+                Called in a single thread for all the tasks before any of them is run.
+                \param[in] task        The task
+                \param[in] frame       The frame number, counted from zero since the pipelined mode is enabled
+                \return `true` if the task is to process the frame, `false` to leave the task idle during the current run (e.g., when there
+                is no more frames to feed).
+            */
+            virtual bool bindFrame(TaskHolder& task, unsigned long frame) = 0;
+        };
+
         class PipelineNotReady : public Exception {
         public:
             PipelineNotReady(const char* message): Exception(message) {}
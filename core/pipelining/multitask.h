@@ -44,6 +44,9 @@ namespace Beatmup {
            in the pipeline;
          - Multitask::RepetitionPolicy::REPEAT_UPDATE forces task repetition one time on next run and just after switches the repetition policy to
            IGNORE_IF_UPTODATE.
+
+        The repetition policies are not applied in pipelined mode (see CustomPipeline::enablePipelining()): every task having a frame to
+        process is run.
     */
     class Multitask : public CustomPipeline {
     private:
@@ -0,0 +1,295 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "task_graph.h"
+#include "../bitmap/abstract_bitmap.h"
+#include "../exception.h"
+#include <algorithm>
+
+using namespace Beatmup;
+
+
+TaskGraph::Node::Node(TaskGraph& graph, AbstractTask& task):
+    graph(graph), task(task), numDependencies(0), pendingDependencies(0), submitted(false), pool(0), job(0), aborted(false), time(0)
+{}
+
+
+void TaskGraph::Node::beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu) {
+    startTime = std::chrono::high_resolution_clock::now();
+    aborted = false;
+    try {
+        // The node reports GPU-only tasks as able to run on CPU, so that the missing GPU is reported here and the node is finished.
+        // Otherwise the thread pool would fail the job before calling beforeProcessing(), and the graph would never complete.
+        if (target == ProcessingTarget::CPU && task.getUsedDevices() == TaskDeviceRequirement::GPU_ONLY)
+            throw RuntimeError("A task requires GPU, but GPU init is failed");
+        task.beforeProcessing(threadCount, target, gpu);
+    }
+    catch (...) {
+        // afterProcessing() is not called by the thread pool if beforeProcessing() fails
+        graph.fail(std::current_exception());
+        graph.finishNode(*this);
+        throw;
+    }
+}
+
+
+void TaskGraph::Node::afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted) {
+    try {
+        task.afterProcessing(threadCount, gpu, aborted);
+    }
+    catch (...) {
+        graph.fail(std::current_exception());
+        graph.finishNode(*this);
+        throw;
+    }
+    if (aborted || this->aborted)
+        graph.fail(std::make_exception_ptr(RuntimeError("A task of the graph is aborted")));
+    graph.finishNode(*this);
+}
+
+
+bool TaskGraph::Node::process(TaskThread& thread) {
+    try {
+        if (task.process(thread))
+            return true;
+    }
+    catch (...) {
+        graph.fail(std::current_exception());
+        throw;
+    }
+    aborted = true;
+    return false;
+}
+
+
+bool TaskGraph::Node::processOnGPU(GraphicPipeline& gpu, TaskThread& thread) {
+    try {
+        if (task.processOnGPU(gpu, thread))
+            return true;
+    }
+    catch (...) {
+        graph.fail(std::current_exception());
+        throw;
+    }
+    aborted = true;
+    return false;
+}
+
+
+AbstractTask::TaskDeviceRequirement TaskGraph::Node::getUsedDevices() const {
+    const TaskDeviceRequirement devices = task.getUsedDevices();
+    return devices == TaskDeviceRequirement::GPU_ONLY ? TaskDeviceRequirement::GPU_OR_CPU : devices;
+}
+
+
+ThreadIndex TaskGraph::Node::getMaxThreads() const {
+    return task.getMaxThreads();
+}
+
+
+TaskGraph::TaskGraph():
+    context(nullptr), numRunning(0), running(false), time(0)
+{}
+
+
+TaskGraph::~TaskGraph() {
+    waitForJobs();
+    for (auto node : nodes)
+        delete node;
+}
+
+
+TaskGraph::Node& TaskGraph::addTask(AbstractTask& task, const std::vector<AbstractBitmap*>& inputs, const std::vector<AbstractBitmap*>& outputs) {
+    RuntimeError::check(!isRunning(), "Cannot modify a running task graph");
+    for (auto node : nodes)
+        InvalidArgument::check(&node->task != &task, "The task is already in the graph");
+    for (auto bitmap : inputs)
+        NullTaskInput::check(bitmap, "task graph node input bitmap");
+    for (auto bitmap : outputs)
+        NullTaskInput::check(bitmap, "task graph node output bitmap");
+
+    Node* node = new Node(*this, task);
+    node->inputs = inputs;
+    auto dependOn = [node](Node* other) {
+        if (other && other != node && std::find(other->dependents.begin(), other->dependents.end(), node) == other->dependents.end()) {
+            other->dependents.push_back(node);
+            node->numDependencies++;
+        }
+    };
+
+    // read after write
+    for (auto bitmap : inputs)
+        dependOn(bitmaps[bitmap].writer);
+
+    // write after write and write after read
+    for (auto bitmap : outputs) {
+        const BitmapAccess& access = bitmaps[bitmap];
+        dependOn(access.writer);
+        for (auto reader : access.readers)
+            dependOn(reader);
+    }
+
+    // update bitmaps access
+    for (auto bitmap : inputs)
+        bitmaps[bitmap].readers.push_back(node);
+    for (auto bitmap : outputs) {
+        BitmapAccess& access = bitmaps[bitmap];
+        access.writer = node;
+        access.readers.clear();
+    }
+
+    nodes.push_back(node);
+    return *node;
+}
+
+
+void TaskGraph::clear() {
+    RuntimeError::check(!isRunning(), "Cannot modify a running task graph");
+    waitForJobs();
+    for (auto node : nodes)
+        delete node;
+    nodes.clear();
+    bitmaps.clear();
+}
+
+
+std::shared_future<void> TaskGraph::submit(Context& context) {
+    waitForJobs();
+
+    std::lock_guard<std::mutex> lock(access);
+    this->context = &context;
+    runningPerPool.assign(context.numThreadPools(), 0);
+    numRunning = 0;
+    exception = nullptr;
+    completion = std::promise<void>();
+    future = completion.get_future().share();
+    startTime = std::chrono::high_resolution_clock::now();
+    time = 0;
+
+    std::vector<Node*> ready;
+    for (auto node : nodes) {
+        node->pendingDependencies = node->numDependencies;
+        node->submitted = false;
+        node->time = 0;
+        if (node->numDependencies == 0)
+            ready.push_back(node);
+    }
+
+    if (ready.empty())
+        completion.set_value();
+    else {
+        running = true;
+        launch(ready);
+    }
+    return future;
+}
+
+
+float TaskGraph::run(Context& context) {
+    submit(context).get();
+    return time;
+}
+
+
+bool TaskGraph::isRunning() {
+    std::lock_guard<std::mutex> lock(access);
+    return running;
+}
+
+
+PoolIndex TaskGraph::choosePool(const Node& node) const {
+    // the GPU is only accessible in the main pool, as well as the pixel data transfers from GPU
+    if (node.task.getUsedDevices() != AbstractTask::TaskDeviceRequirement::CPU_ONLY)
+        return 0;
+    for (auto bitmap : node.inputs)
+        if (!bitmap->isUpToDate(ProcessingTarget::CPU))
+            return 0;
+
+    // pick the least busy pool, preferring the last ones to keep the main pool available for GPU tasks
+    PoolIndex best = (PoolIndex)(runningPerPool.size() - 1);
+    for (PoolIndex pool = best; pool > 0; --pool)
+        if (runningPerPool[pool - 1] < runningPerPool[best])
+            best = pool - 1;
+    return best;
+}
+
+
+void TaskGraph::launch(const std::vector<Node*>& ready) {
+    // Submitting with the run state locked: the jobs are known once it is unlocked.
+    for (auto node : ready) {
+        node->pool = choosePool(*node);
+        runningPerPool[node->pool]++;
+        numRunning++;
+        node->submitted = true;
+        node->job = context->submitTask(*node, node->pool);
+    }
+}
+
+
+void TaskGraph::fail(std::exception_ptr exception) {
+    std::lock_guard<std::mutex> lock(access);
+    if (!this->exception)
+        this->exception = exception;
+}
+
+
+void TaskGraph::finishNode(Node& node) {
+    std::lock_guard<std::mutex> lock(access);
+    const auto now = std::chrono::high_resolution_clock::now();
+    node.time = std::chrono::duration<float, std::milli>(now - node.startTime).count();
+    runningPerPool[node.pool]--;
+    numRunning--;
+
+    // submit the dependent nodes getting ready, unless failed
+    if (!exception) {
+        std::vector<Node*> ready;
+        for (auto dependent : node.dependents)
+            if (--dependent->pendingDependencies == 0)
+                ready.push_back(dependent);
+        launch(ready);
+    }
+
+    if (numRunning == 0) {
+        running = false;
+        time = std::chrono::duration<float, std::milli>(now - startTime).count();
+        if (exception)
+            completion.set_exception(exception);
+        else
+            completion.set_value();
+    }
+}
+
+
+void TaskGraph::waitForJobs() {
+    if (!context)
+        return;
+    if (future.valid())
+        future.wait();
+
+    // The graph is complete, but the thread pools may still be finishing the jobs of the last nodes.
+    std::vector<Node*> submitted;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        for (auto node : nodes)
+            if (node->submitted)
+                submitted.push_back(node);
+    }
+    for (auto node : submitted)
+        context->waitForJob(node->job, node->pool);
+}
@@ -0,0 +1,175 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "../context.h"
+#include "../parallelism.h"
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace Beatmup {
+    class AbstractBitmap;
+
+    /**
+        Graph of tasks ordered by the bitmaps they read and write, run by a Context.
+        Every task is added to the graph with the bitmaps it reads and the bitmaps it writes. A task depends on every task added before it
+        that writes a bitmap the task reads or writes, or that reads a bitmap the task writes. When the graph is submitted, a task is submitted
+        to a thread pool as soon as all the tasks it depends on are done, so that independent branches of the graph run concurrently.
+
+        Tasks that may use GPU, as well as tasks reading bitmaps not up to date on CPU, are run in the main pool, the only one having access to
+        the GPU. Other tasks are run in the pool having the smallest number of tasks of the graph running at the moment.
+
+        If a task fails or is aborted, or if a task requires GPU but GPU init is failed, no more tasks are submitted, and the graph completes with an exception once the running tasks are done.
+        As for any submitted task, the exception is also stored by the thread pool (see Context::check()).
+        The graph must not be modified while running. A task may be added to the graph only once.
+    */
+    class TaskGraph : public Object {
+        TaskGraph(const TaskGraph&) = delete;	//!< disabling copying constructor
+    public:
+        /**
+            A task in the graph
+        */
+        class Node : private AbstractTask {
+            friend class TaskGraph;
+        private:
+            TaskGraph& graph;
+            AbstractTask& task;
+            std::vector<AbstractBitmap*> inputs;    //!< bitmaps read by the task
+            std::vector<Node*> dependents;          //!< nodes depending on this one
+            int numDependencies;                    //!< number of nodes this one depends on
+            int pendingDependencies;                //!< number of nodes this one depends on and not done yet in the current run
+            bool submitted;                         //!< if `true`, the node is submitted to a thread pool during the current run
+            PoolIndex pool;                         //!< thread pool the node is submitted to
+            Job job;                                //!< job of the node
+            std::atomic<bool> aborted;              //!< if `true`, the task returned `false` when processing
+            std::chrono::high_resolution_clock::time_point startTime;
+            float time;                             //!< task run time in ms
+
+            Node(TaskGraph& graph, AbstractTask& task);
+
+            void beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu);
+            void afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted);
+            bool process(TaskThread& thread);
+            bool processOnGPU(GraphicPipeline& gpu, TaskThread& thread);
+            TaskDeviceRequirement getUsedDevices() const;
+            ThreadIndex getMaxThreads() const;
+
+        public:
+            inline AbstractTask& getTask() const { return task; }
+
+            /**
+                \return the number of nodes this node depends on.
+            */
+            inline int getDependencyCount() const { return numDependencies; }
+
+            /**
+                \return the index of the thread pool the task was run in during the last run of the graph.
+            */
+            inline PoolIndex getPool() const { return pool; }
+
+            /**
+                \return the time the task took to run during the last run of the graph, in milliseconds, from the start of its preparation to
+                the end of its teardown. The time spent in the thread pool queue is not included.
+            */
+            inline float getRunTime() const { return time; }
+        };
+
+    private:
+        /**
+            Nodes accessing a bitmap
+        */
+        struct BitmapAccess {
+            Node* writer;                           //!< last node writing the bitmap
+            std::vector<Node*> readers;             //!< nodes reading the bitmap since the last writing
+        };
+
+        std::vector<Node*> nodes;
+        std::map<const AbstractBitmap*, BitmapAccess> bitmaps;
+
+        std::mutex access;                          //!< run state access control
+        Context* context;                           //!< context the graph is running in
+        std::vector<int> runningPerPool;            //!< number of nodes currently running in every thread pool
+        int numRunning;                             //!< number of nodes currently running
+        bool running;                               //!< if `true`, the graph is running
+        std::exception_ptr exception;               //!< first exception occurred during the current run
+        std::promise<void> completion;
+        std::shared_future<void> future;
+        std::chrono::high_resolution_clock::time_point startTime;
+        float time;                                 //!< graph run time in ms
+
+        PoolIndex choosePool(const Node& node) const;
+        void launch(const std::vector<Node*>& ready);
+        void fail(std::exception_ptr exception);
+        void finishNode(Node& node);
+        void waitForJobs();
+
+    public:
+        TaskGraph();
+        ~TaskGraph();
+
+        /**
+            Adds a task to the graph.
+            \param[in] task         The task
+            \param[in] inputs       Bitmaps read by the task
+            \param[in] outputs      Bitmaps written by the task
+            \return the new node of the graph.
+        */
+        Node& addTask(AbstractTask& task, const std::vector<AbstractBitmap*>& inputs, const std::vector<AbstractBitmap*>& outputs);
+
+        /**
+            Removes all the tasks from the graph.
+        */
+        void clear();
+
+        /**
+            Submits the graph to a context.
+            Tasks having no dependencies are submitted immediately; the rest are submitted as the tasks they depend on are done.
+            The call does not block.
+            \param[in] context      The context
+            \return a future getting ready once all the tasks are done, or holding the exception thrown by a failed task.
+        */
+        std::shared_future<void> submit(Context& context);
+
+        /**
+            Runs the graph in a context. Blocks until all the tasks are done.
+            Rethrows the exception thrown by a failed task, if any.
+            \param[in] context      The context
+            \return the graph run time in milliseconds.
+        */
+        float run(Context& context);
+
+        /**
+            \return `true` if the graph is running.
+        */
+        bool isRunning();
+
+        inline size_t getNodeCount() const { return nodes.size(); }
+        inline Node& getNode(size_t index) const { return *nodes[index]; }
+
+        /**
+            \return the time the last run of the graph took in milliseconds, from its submission to the end of its last task.
+        */
+        inline float getRunTime() const { return time; }
+    };
+}
@@ -27,3 +27,9 @@
 #endif
 
 #endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#define BEATMUP_ARCH_X86_64
+
+#endif
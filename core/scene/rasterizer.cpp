@@ -0,0 +1,514 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "rasterizer.h"
+#include "../bitmap/bitmap_access.h"
+#include "../bitmap/processing.h"
+#include "../exception.h"
+#include "../utils/utils.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace Beatmup;
+
+
+namespace Kernels {
+    static const float BYTE_TO_FLOAT = 1 / 255.0f;
+
+    inline float toFloat(pixbyte value) { return value * BYTE_TO_FLOAT; }
+    inline float toFloat(pixfloat value) { return value; }
+    inline void fromFloat(float value, pixbyte& to) { to = pixfloat2pixbyte(value); }
+    inline void fromFloat(float value, pixfloat& to) { to = value; }
+
+    inline pixfloat4 toFloat(const color4i& color) {
+        return pixfloat4(color.r * BYTE_TO_FLOAT, color.g * BYTE_TO_FLOAT, color.b * BYTE_TO_FLOAT, color.a * BYTE_TO_FLOAT);
+    }
+
+
+    /**
+        Converts pixels of a given data type and number of channels to floating point RGBA values, as sampled on GPU, and back
+    */
+    template<typename T, int channels> class Pixel;
+
+    template<typename T> class Pixel<T, 1> {
+    public:
+        static inline pixfloat4 get(const T* p) {
+            const float v = toFloat(p[0]);
+            return pixfloat4(v, v, v, 1.0f);
+        }
+        static inline void set(T* p, const pixfloat4& value) {
+            fromFloat(value.r, p[0]);
+        }
+    };
+
+    template<typename T> class Pixel<T, 3> {
+    public:
+        static inline pixfloat4 get(const T* p) {
+            return pixfloat4(toFloat(p[CHANNELS_3.R]), toFloat(p[CHANNELS_3.G]), toFloat(p[CHANNELS_3.B]), 1.0f);
+        }
+        static inline void set(T* p, const pixfloat4& value) {
+            fromFloat(value.r, p[CHANNELS_3.R]);
+            fromFloat(value.g, p[CHANNELS_3.G]);
+            fromFloat(value.b, p[CHANNELS_3.B]);
+        }
+    };
+
+    template<typename T> class Pixel<T, 4> {
+    public:
+        static inline pixfloat4 get(const T* p) {
+            return pixfloat4(toFloat(p[CHANNELS_4.R]), toFloat(p[CHANNELS_4.G]), toFloat(p[CHANNELS_4.B]), toFloat(p[CHANNELS_4.A]));
+        }
+        static inline void set(T* p, const pixfloat4& value) {
+            fromFloat(value.r, p[CHANNELS_4.R]);
+            fromFloat(value.g, p[CHANNELS_4.G]);
+            fromFloat(value.b, p[CHANNELS_4.B]);
+            fromFloat(value.a, p[CHANNELS_4.A]);
+        }
+    };
+
+
+    /**
+        Calls Func<T, channels>::process(bitmap, args) for a given non-mask bitmap
+    */
+    template<template<typename, int> class Func, class Bitmap, typename... Args>
+    inline void dispatch(Bitmap& bitmap, Args&&... args) {
+        switch (bitmap.getPixelFormat()) {
+        case SingleByte:
+            Func<pixbyte, 1>::process(bitmap, args...);
+            break;
+        case TripleByte:
+            Func<pixbyte, 3>::process(bitmap, args...);
+            break;
+        case QuadByte:
+            Func<pixbyte, 4>::process(bitmap, args...);
+            break;
+        case SingleFloat:
+            Func<pixfloat, 1>::process(bitmap, args...);
+            break;
+        case TripleFloat:
+            Func<pixfloat, 3>::process(bitmap, args...);
+            break;
+        case QuadFloat:
+            Func<pixfloat, 4>::process(bitmap, args...);
+            break;
+        default:
+            throw BitmapProcessing::ProcessingActionNotImplemented(bitmap.getPixelFormat());
+        }
+    }
+
+
+    /**
+        Reads a tile of a bitmap into floating point pixels
+    */
+    template<typename T, int channels> class LoadTile {
+    public:
+        static void process(const AbstractBitmap& bitmap, const IntRectangle& tile, pixfloat4* buffer, int bufferStride) {
+            for (int y = tile.a.y; y < tile.b.y; ++y, buffer += bufferStride) {
+                const T* data = (const T*)bitmap.getData(tile.a.x, y);
+                for (int x = 0; x < tile.width(); ++x, data += channels)
+                    buffer[x] = Pixel<T, channels>::get(data);
+            }
+        }
+    };
+
+
+    /**
+        Writes floating point pixels to a tile of a bitmap
+    */
+    template<typename T, int channels> class StoreTile {
+    public:
+        static void process(AbstractBitmap& bitmap, const IntRectangle& tile, const pixfloat4* buffer, int bufferStride) {
+            for (int y = tile.a.y; y < tile.b.y; ++y, buffer += bufferStride) {
+                T* data = (T*)bitmap.getData(tile.a.x, y);
+                for (int x = 0; x < tile.width(); ++x, data += channels)
+                    Pixel<T, channels>::set(data, buffer[x]);
+            }
+        }
+    };
+
+
+    /**
+        Premultiplied alpha blending, as done on GPU
+    */
+    inline void blend(pixfloat4& dst, const pixfloat4& src) {
+        dst = src + dst * (1.0f - src.a);
+    }
+
+
+    /**
+        Blends a tile with a bitmap repeated over the output, with no interpolation
+    */
+    template<typename T, int channels> class PaveTile {
+    public:
+        static void process(const AbstractBitmap& bitmap, const IntRectangle& tile, pixfloat4* buffer, int bufferStride) {
+            const int width = bitmap.getWidth(), height = bitmap.getHeight();
+            for (int y = tile.a.y; y < tile.b.y; ++y, buffer += bufferStride) {
+                const T* row = (const T*)bitmap.getData(0, y % height);
+                for (int x = 0; x < tile.width(); ++x)
+                    blend(buffer[x], Pixel<T, channels>::get(row + ((tile.a.x + x) % width) * channels));
+            }
+        }
+    };
+
+
+    /**
+        Samples a mask bitmap with no interpolation
+    */
+    class MaskSampler {
+    private:
+        const pixbyte* data;
+        int stride, width, height;
+        int bits, pixelsPerByte, maxValue;
+        float scale;
+
+    public:
+        MaskSampler(const AbstractBitmap* mask):
+            data(mask ? mask->getData(0, 0) : nullptr), stride(mask ? mask->getStride() : 0),
+            width(mask ? mask->getWidth() : 0), height(mask ? mask->getHeight() : 0),
+            bits(mask ? mask->getBitsPerPixel() : 8), pixelsPerByte(8 / bits), maxValue((1 << bits) - 1), scale(1.0f / maxValue)
+        {}
+
+        inline float operator()(const Point& pos) const {
+            const int
+                x = std::min(std::max((int)std::floor(pos.x * width), 0), width - 1),
+                y = std::min(std::max((int)std::floor(pos.y * height), 0), height - 1);
+            const pixbyte byte = data[(msize)y * stride + x / pixelsPerByte];
+            return ((byte >> ((x % pixelsPerByte) * bits)) & maxValue) * scale;
+        }
+    };
+
+
+    /**
+        Samples a bitmap with bilinear interpolation and clamping to edge, in texture coordinates
+    */
+    template<typename T, int channels> class Sampler {
+    private:
+        const pixbyte* data;
+        int stride, width, height;
+
+        inline pixfloat4 fetch(int x, int y) const {
+            return Pixel<T, channels>::get((const T*)(data + (msize)y * stride) + x * channels);
+        }
+
+    public:
+        Sampler(const AbstractBitmap& bitmap):
+            data(bitmap.getData(0, 0)), stride(bitmap.getStride()), width(bitmap.getWidth()), height(bitmap.getHeight())
+        {}
+
+        inline pixfloat4 operator()(const Point& pos) const {
+            const float u = pos.x * width - 0.5f, v = pos.y * height - 0.5f;
+            const float fu = std::floor(u), fv = std::floor(v);
+            const float wx = u - fu, wy = v - fv;
+            const int
+                x0 = std::min(std::max((int)fu, 0), width - 1),
+                y0 = std::min(std::max((int)fv, 0), height - 1),
+                x1 = std::min(std::max((int)fu + 1, 0), width - 1),
+                y1 = std::min(std::max((int)fv + 1, 0), height - 1);
+            return (fetch(x0, y0) * (1 - wx) + fetch(x1, y0) * wx) * (1 - wy) + (fetch(x0, y1) * (1 - wx) + fetch(x1, y1) * wx) * wy;
+        }
+    };
+
+
+    inline bool isInsideUnitSquare(const Point& pos) {
+        return pos.x >= 0 && pos.y >= 0 && pos.x < 1 && pos.y < 1;
+    }
+
+
+    /**
+        Narrows a range of pixels [first, last) in a row to the ones having a coordinate in [0, 1), given the coordinate origin and step.
+        The range is computed with a margin; the pixels are expected to be tested individually.
+    */
+    inline void clipSpan(float origin, float step, int& first, int& last) {
+        if (step == 0) {
+            if (origin < 0 || origin >= 1)
+                last = first;
+            return;
+        }
+        float lo = -origin / step, hi = (1 - origin) / step;
+        if (step < 0)
+            std::swap(lo, hi);
+        if (lo >= last || hi < first) {
+            last = first;
+            return;
+        }
+        if (lo > first)
+            first = std::max(first, (int)std::floor(lo) - 1);
+        if (hi < last)
+            last = std::min(last, (int)std::ceil(hi) + 1);
+    }
+}
+
+
+template<typename T, int channels>
+void SceneRasterizer::renderItem(const Item& item, const IntRectangle& area, const IntRectangle& tile, pixfloat4* buffer) const {
+    const float invWidth = 1.0f / output->getWidth(), invHeight = 1.0f / output->getHeight();
+    const Kernels::Sampler<T, channels> sample(*item.bitmap);
+    const Kernels::MaskSampler mask(item.mask);
+
+    // unit square coordinates increment per output pixel
+    const Point step = item.quadMapping.matrix(invWidth, 0.0f);
+
+    for (int y = area.a.y; y < area.b.y; ++y) {
+        const Point origin = item.quadMapping(Point((area.a.x + 0.5f) * invWidth, (y + 0.5f) * invHeight));
+        int first = 0, last = area.width();
+        Kernels::clipSpan(origin.x, step.x, first, last);
+        Kernels::clipSpan(origin.y, step.y, first, last);
+        pixfloat4* pixels = buffer + (y - tile.a.y) * TILE_SIZE + (area.a.x - tile.a.x);
+
+        for (int x = first; x < last; ++x) {
+            const Point pos(origin.x + x * step.x, origin.y + x * step.y);
+            if (!Kernels::isInsideUnitSquare(pos))
+                continue;
+
+            switch (item.type) {
+            case Item::Type::BITMAP:
+                Kernels::blend(pixels[x], sample(pos) * item.modulation);
+                break;
+
+            case Item::Type::MASKED: {
+                const Point texCoord = item.imageMapping(pos);
+                const float alpha = Kernels::isInsideUnitSquare(texCoord) ? mask(pos) : 0.0f;
+                pixfloat4 color = item.bgColor;
+                if (alpha > 0)
+                    color = color * (1.0f - alpha) + sample(texCoord) * alpha;
+                Kernels::blend(pixels[x], color * item.modulation);
+                break;
+            }
+
+            case Item::Type::SHAPED: {
+                // distance to the shape border, in the same way as in the rendering program
+                const float radius = item.cornerRadius;
+                const float
+                    cx = radius - std::min(pos.x, 1.0f - pos.x) * item.borderProfile.x,
+                    cy = radius - std::min(pos.y, 1.0f - pos.y) * item.borderProfile.y;
+                const float r = radius > 0 && cx > 0 && cy > 0 ? std::sqrt(cx * cx + cy * cy) : std::max(cx, cy);
+                const float alpha = std::min(std::max((radius - item.border - r) / (item.slope + 0.00098f), 0.0f), 1.0f);
+                if (alpha <= 0)
+                    break;
+                const Point texCoord = item.imageMapping(pos);
+                const pixfloat4 color = Kernels::isInsideUnitSquare(texCoord) ? sample(texCoord) : item.bgColor;
+                Kernels::blend(pixels[x], color * alpha * item.modulation);
+                break;
+            }
+            }
+        }
+    }
+}
+
+
+void SceneRasterizer::processTile(const IntRectangle& tile, pixfloat4* buffer) const {
+    // skipping tiles not covered by anything
+    bool covered = background != nullptr;
+    for (auto it = items.cbegin(); it != items.cend() && !covered; ++it) {
+        IntRectangle area(it->area);
+        area.limit(tile);
+        covered = !area.empty();
+    }
+    if (!covered)
+        return;
+
+    const int bufferStride = TILE_SIZE;
+    Kernels::dispatch<Kernels::LoadTile>(*output, tile, buffer, bufferStride);
+
+    if (background)
+        Kernels::dispatch<Kernels::PaveTile>(*background, tile, buffer, bufferStride);
+
+    for (const auto& item : items) {
+        IntRectangle area(item.area);
+        area.limit(tile);
+        if (area.empty())
+            continue;
+
+        switch (item.bitmap->getPixelFormat()) {
+        case SingleByte:
+            renderItem<pixbyte, 1>(item, area, tile, buffer);
+            break;
+        case TripleByte:
+            renderItem<pixbyte, 3>(item, area, tile, buffer);
+            break;
+        case QuadByte:
+            renderItem<pixbyte, 4>(item, area, tile, buffer);
+            break;
+        case SingleFloat:
+            renderItem<pixfloat, 1>(item, area, tile, buffer);
+            break;
+        case TripleFloat:
+            renderItem<pixfloat, 3>(item, area, tile, buffer);
+            break;
+        case QuadFloat:
+            renderItem<pixfloat, 4>(item, area, tile, buffer);
+            break;
+        default:
+            throw BitmapProcessing::ProcessingActionNotImplemented(item.bitmap->getPixelFormat());
+        }
+    }
+
+    Kernels::dispatch<Kernels::StoreTile>(*output, tile, buffer, bufferStride);
+}
+
+
+bool SceneRasterizer::addItem(Item& item, const AffineMapping& mapping) {
+    if (!mapping.matrix.isInvertible())
+        return false;
+    item.quadMapping = mapping.getInverse();
+
+    // finding the output pixels covered by the unit square; pixel centers are at half-integer positions
+    const float width = (float)output->getWidth(), height = (float)output->getHeight();
+    const Point corners[] = { mapping(Point(0, 0)), mapping(Point(1, 0)), mapping(Point(0, 1)), mapping(Point(1, 1)) };
+    float x1 = corners[0].x, y1 = corners[0].y, x2 = x1, y2 = y1;
+    for (int i = 1; i < 4; ++i) {
+        x1 = std::min(x1, corners[i].x);
+        y1 = std::min(y1, corners[i].y);
+        x2 = std::max(x2, corners[i].x);
+        y2 = std::max(y2, corners[i].y);
+    }
+    x1 = std::max(x1 * width - 0.5f, -1.0f);
+    y1 = std::max(y1 * height - 0.5f, -1.0f);
+    x2 = std::min(x2 * width - 0.5f, width);
+    y2 = std::min(y2 * height - 0.5f, height);
+    if (x2 < x1 || y2 < y1)
+        return false;
+    item.area = IntRectangle((int)std::floor(x1), (int)std::floor(y1), (int)std::ceil(x2) + 1, (int)std::ceil(y2) + 1);
+    item.area.limit(IntRectangle(0, 0, output->getWidth(), output->getHeight()));
+    if (item.area.empty())
+        return false;
+
+    items.push_back(item);
+    return true;
+}
+
+
+int SceneRasterizer::getTileCount(const AbstractBitmap& output) {
+    return ceili(output.getWidth(), TILE_SIZE) * ceili(output.getHeight(), TILE_SIZE);
+}
+
+
+void SceneRasterizer::prepare(AbstractBitmap& output, const AbstractBitmap* background, int referenceWidth, ThreadIndex threadCount) {
+    if (output.isMask())
+        throw ImplementationUnsupported("Rendering a scene to a mask bitmap on CPU");
+    if (background && background->isMask())
+        throw ImplementationUnsupported("Paving the background with a mask bitmap on CPU");
+    this->output = &output;
+    this->background = background;
+    outputWidth = referenceWidth > 0 ? referenceWidth : output.getWidth();
+    items.clear();
+    buffers = AlignedMemory(threadCount * TILE_SIZE * TILE_SIZE * sizeof(pixfloat4), output.getContext().getMemoryPool(), 64);
+}
+
+
+void SceneRasterizer::addBitmapLayer(const Scene::BitmapLayer& layer, const AffineMapping& mapping) {
+    const AbstractBitmap* bitmap = layer.getBitmap();
+    if (!bitmap)
+        return;
+    if (bitmap->isMask())
+        throw ImplementationUnsupported("Rendering a mask bitmap in a scene on CPU");
+
+    Item item;
+    item.type = Item::Type::BITMAP;
+    item.bitmap = bitmap;
+    item.mask = nullptr;
+    item.modulation = Kernels::toFloat(layer.getModulationColor());
+
+    AffineMapping arMapping(mapping * layer.getBitmapMapping());
+    arMapping.matrix.scale(1.0f, bitmap->getInvAspectRatio());
+    addItem(item, arMapping);
+}
+
+
+void SceneRasterizer::addMaskedBitmapLayer(const Scene::MaskedBitmapLayer& layer, const AffineMapping& mapping) {
+    const AbstractBitmap *bitmap = layer.getBitmap(), *mask = layer.getMask();
+    if (!bitmap || !mask)
+        return;
+    if (bitmap->isMask())
+        throw ImplementationUnsupported("Rendering a mask bitmap in a scene on CPU");
+    if (!mask->isMask() && mask->getPixelFormat() != SingleByte)
+        throw ImplementationUnsupported("Masking with a multichannel or floating point bitmap on CPU");
+
+    AffineMapping arImgMapping(layer.getBitmapMapping()), arMaskMapping(layer.getMaskMapping());
+    arImgMapping.matrix.scale(1.0f, bitmap->getInvAspectRatio());
+    arMaskMapping.matrix.scale(1.0f, bitmap->getInvAspectRatio());
+    if (!arImgMapping.matrix.isInvertible())
+        return;
+
+    Item item;
+    item.type = Item::Type::MASKED;
+    item.bitmap = bitmap;
+    item.mask = mask;
+    item.imageMapping = arImgMapping.getInverse() * arMaskMapping;
+    item.modulation = Kernels::toFloat(layer.getModulationColor());
+    item.bgColor = Kernels::toFloat(layer.getBackgroundColor());
+    addItem(item, mapping * arMaskMapping);
+}
+
+
+void SceneRasterizer::addShapedBitmapLayer(const Scene::ShapedBitmapLayer& layer, const AffineMapping& mapping) {
+    const AbstractBitmap* bitmap = layer.getBitmap();
+    if (!bitmap)
+        return;
+    if (bitmap->isMask())
+        throw ImplementationUnsupported("Rendering a mask bitmap in a scene on CPU");
+
+    AffineMapping arImgMapping(layer.getBitmapMapping()), arMaskMapping(layer.getMaskMapping());
+    arImgMapping.matrix.scale(1.0f, bitmap->getInvAspectRatio());
+    arMaskMapping.matrix.scale(1.0f, bitmap->getInvAspectRatio());
+    if (!arImgMapping.matrix.isInvertible())
+        return;
+
+    Item item;
+    item.type = Item::Type::SHAPED;
+    item.bitmap = bitmap;
+    item.mask = nullptr;
+    item.imageMapping = arImgMapping.getInverse() * arMaskMapping;
+    item.modulation = Kernels::toFloat(layer.getModulationColor());
+    item.bgColor = Kernels::toFloat(layer.getBackgroundColor());
+
+    // computing border profile in pixels
+    Matrix2 mat = mapping.matrix * arMaskMapping.matrix;
+    mat.prescale(1.0f, output->getInvAspectRatio());
+    const float scale = layer.getInPixels() ? outputWidth : 1;
+    item.borderProfile = Point(scale * mat.getScalingX(), scale * mat.getScalingY());
+    item.cornerRadius = layer.getCornerRadius() + layer.getBorderWidth();
+    item.slope = layer.getSlopeWidth();
+    item.border = layer.getBorderWidth();
+    addItem(item, mapping * arMaskMapping);
+}
+
+
+void SceneRasterizer::process(TaskThread& thread) {
+    pixfloat4* buffer = buffers.ptr<pixfloat4>(thread.currentThread() * TILE_SIZE * TILE_SIZE);
+    const int numTilesX = ceili(output->getWidth(), TILE_SIZE);
+    msize start, stop;
+    while (thread.nextChunk(getTileCount(*output), 1, start, stop))
+        for (msize i = start; i < stop; ++i) {
+            if (thread.isTaskAborted())
+                return;
+            const int x = (int)(i % numTilesX) * TILE_SIZE, y = (int)(i / numTilesX) * TILE_SIZE;
+            IntRectangle tile(x, y, x + TILE_SIZE, y + TILE_SIZE);
+            tile.limit(IntRectangle(0, 0, output->getWidth(), output->getHeight()));
+            processTile(tile, buffer);
+        }
+}
+
+
+void SceneRasterizer::release() {
+    buffers.free();
+    items.clear();
+    output = nullptr;
+    background = nullptr;
+}
@@ -0,0 +1,130 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "scene.h"
+#include "../bitmap/abstract_bitmap.h"
+#include "../bitmap/pixel_arithmetic.h"
+#include "../geometry.h"
+#include "../memory.h"
+#include "../parallelism.h"
+#include <vector>
+
+namespace Beatmup {
+
+    /**
+        \internal
+        Scene rendering on CPU.
+        Reproduces the output of the GPU rendering programs: the layers are affinely mapped to the output, sampled with bilinear
+        interpolation, masked or shaped, modulated and blended with premultiplied alpha, one after another.
+        The output bitmap is split into square tiles distributed among threads. Every tile is loaded into a floating point scratch buffer,
+        then every layer intersecting the tile is rasterized there scanline by scanline, and the tile is written back to the output bitmap.
+        Unlike on GPU, the intermediate results are thus not rounded to the output pixel format after every layer.
+        Bitmaps and masks are accessed by their pixel data in RAM; they have to be locked for reading on CPU by the caller.
+        Used by SceneRenderer. Not intended to be directly used by the application.
+    */
+    class SceneRasterizer {
+    private:
+        /**
+            A bitmap layer to render, with all its parameters resolved in the output coordinates
+        */
+        struct Item {
+            enum class Type {
+                BITMAP,
+                MASKED,
+                SHAPED
+            } type;
+            const AbstractBitmap* bitmap;
+            const AbstractBitmap* mask;
+            AffineMapping quadMapping;          //!< maps the output pixel centers in normalized coordinates to the layer unit square
+            AffineMapping imageMapping;         //!< maps the layer unit square to the bitmap texture coordinates
+            pixfloat4 modulation;               //!< modulation color
+            pixfloat4 bgColor;                  //!< color filling masked and shaped layers where the bitmap is not present
+            Point borderProfile;                //!< shaped layer border scaling factors
+            float cornerRadius, slope, border;  //!< shaped layer shape parameters
+            IntRectangle area;                  //!< output pixels area covered by the layer
+        };
+
+        static const int TILE_SIZE = 64;        //!< tile size in pixels
+
+        std::vector<Item> items;
+        AbstractBitmap* output;
+        const AbstractBitmap* background;       //!< bitmap paving the output before rendering the layers
+        int outputWidth;                        //!< output width used for sizes given in pixels
+        AlignedMemory buffers;                  //!< scratch buffers of all threads, one tile each
+
+        bool addItem(Item& item, const AffineMapping& mapping);
+        template<typename T, int channels> void renderItem(const Item& item, const IntRectangle& area, const IntRectangle& tile, pixfloat4* buffer) const;
+        void processTile(const IntRectangle& tile, pixfloat4* buffer) const;
+
+    public:
+        SceneRasterizer(): output(nullptr), background(nullptr), outputWidth(0) {}
+
+        /**
+            \return the number of tiles to process for a given output bitmap.
+        */
+        static int getTileCount(const AbstractBitmap& output);
+
+        /**
+            Sets up the output and allocates scratch buffers. To be called before adding the layers.
+            \param[in] output           The output bitmap
+            \param[in] background       A bitmap to pave the output with before rendering, may be null
+            \param[in] referenceWidth   Value overriding output width for elements that have their size in pixels; ignored if not positive
+            \param[in] threadCount      Number of threads
+        */
+        void prepare(AbstractBitmap& output, const AbstractBitmap* background, int referenceWidth, ThreadIndex threadCount);
+
+        /**
+            Adds a bitmap layer to render on top of previously added layers.
+            \param[in] layer        The layer
+            \param[in] mapping      The layer mapping to normalized output coordinates, including the one of the layer itself
+        */
+        void addBitmapLayer(const Scene::BitmapLayer& layer, const AffineMapping& mapping);
+
+        /**
+            Adds a masked bitmap layer to render on top of previously added layers.
+            \param[in] layer        The layer
+            \param[in] mapping      The layer mapping to normalized output coordinates, including the one of the layer itself
+        */
+        void addMaskedBitmapLayer(const Scene::MaskedBitmapLayer& layer, const AffineMapping& mapping);
+
+        /**
+            Adds a shaped bitmap layer to render on top of previously added layers.
+            \param[in] layer        The layer
+            \param[in] mapping      The layer mapping to normalized output coordinates, including the one of the layer itself
+        */
+        void addShapedBitmapLayer(const Scene::ShapedBitmapLayer& layer, const AffineMapping& mapping);
+
+        /**
+            Renders the added layers. Called by every thread running the task.
+        */
+        void process(TaskThread& thread);
+
+        /**
+            Frees the scratch buffers and forgets the added layers.
+        */
+        void release();
+
+        /**
+            \return `true` if prepared and not released yet.
+        */
+        inline bool isReady() const { return (bool)buffers; }
+    };
+
+}
@@ -58,6 +58,87 @@ void SceneRenderer::renderLayer(RenderingContext& context, TaskThread& thread, S
 }
 
 
+/**
+    \internal
+    Recursive scene rendering instruction on CPU: passes the bitmap layers to the rasterizer and locks their bitmaps
+*/
+void SceneRenderer::rasterizeLayer(GraphicPipeline* gpu, Scene::Layer& layer, const AffineMapping& base, unsigned int recursionLevel) {
+    if (recursionLevel >= MAX_RECURSION_LEVEL)
+        return;
+
+    const AffineMapping mapping(base * layer.getMapping());
+
+    switch (layer.getType()) {
+    case Scene::Layer::Type::SceneLayer: {
+        const Scene& scene = layer.castTo<Scene::SceneLayer>().getScene();
+        for (int i = 0; i < scene.getLayerCount(); ++i) {
+            Scene::Layer& l = scene.getLayer(i);
+            if (l.isVisible())
+                rasterizeLayer(gpu, l, mapping, recursionLevel + 1);
+        }
+    }
+    break;
+
+    case Scene::Layer::Type::BitmapLayer: {
+        Scene::BitmapLayer& bitmapLayer = layer.castTo<Scene::BitmapLayer>();
+        bitmapLayer.invAr = bitmapLayer.bitmap ? bitmapLayer.bitmap->getInvAspectRatio() : 0;
+        if (bitmapLayer.bitmap) {
+            readLock(gpu, bitmapLayer.bitmap, ProcessingTarget::CPU);
+            rasterizer.addBitmapLayer(bitmapLayer, mapping);
+        }
+    }
+    break;
+
+    case Scene::Layer::Type::MaskedBitmapLayer: {
+        Scene::MaskedBitmapLayer& maskedLayer = layer.castTo<Scene::MaskedBitmapLayer>();
+        maskedLayer.invAr = maskedLayer.bitmap ? maskedLayer.bitmap->getInvAspectRatio() : 0;
+        if (maskedLayer.bitmap && maskedLayer.mask) {
+            readLock(gpu, maskedLayer.bitmap, ProcessingTarget::CPU);
+            readLock(gpu, maskedLayer.mask, ProcessingTarget::CPU);
+            rasterizer.addMaskedBitmapLayer(maskedLayer, mapping);
+        }
+    }
+    break;
+
+    case Scene::Layer::Type::ShapedBitmapLayer: {
+        Scene::ShapedBitmapLayer& shapedLayer = layer.castTo<Scene::ShapedBitmapLayer>();
+        shapedLayer.invAr = shapedLayer.bitmap ? shapedLayer.bitmap->getInvAspectRatio() : 0;
+        if (shapedLayer.bitmap) {
+            readLock(gpu, shapedLayer.bitmap, ProcessingTarget::CPU);
+            rasterizer.addShapedBitmapLayer(shapedLayer, mapping);
+        }
+    }
+    break;
+
+    case Scene::Layer::Type::ShadedBitmapLayer:
+        if (layer.castTo<Scene::ShadedBitmapLayer>().getShader())
+            throw ImplementationUnsupported("Rendering shaded bitmap layers on CPU");
+        break;
+    }
+}
+
+
+void SceneRenderer::computeOutputCoords() {
+    outputCoords.setIdentity();
+    switch (outputMapping) {
+    case FIT_WIDTH_TO_TOP:
+        outputCoords.matrix.scale(1.0f, resolution.getAspectRatio());
+        break;
+    case FIT_WIDTH:
+        outputCoords.matrix.scale(1.0f, resolution.getAspectRatio());
+        outputCoords.setCenterPosition(Point(0.5f, 0.5f));
+        break;
+    case FIT_HEIGHT:
+        outputCoords.matrix.scale(resolution.getInvAspectRatio(), 1.0f);
+        outputCoords.setCenterPosition(Point(0.5f, 0.5f));
+        break;
+    case STRETCH:
+        // identity is okay
+        break;
+    }
+}
+
+
 const Scene* SceneRenderer::getScene() const {
     return scene;
 }
@@ -108,8 +189,9 @@ void SceneRenderer::setBackgroundImage(AbstractBitmap* bitmap) {
 }
 
 
-void SceneRenderer::setOutputPixelsFetching(bool fetch) {
+void SceneRenderer::setOutputPixelsFetching(bool fetch, bool async) {
     this->outputPixelsFetching = fetch;
+    this->outputPixelsFetchingAsync = async;
 }
 
 
@@ -141,6 +223,56 @@ void SceneRenderer::beforeProcessing(ThreadIndex threadCount, ProcessingTarget t
 
     // reset camera frame
     cameraFrame = nullptr;
+
+    // render on CPU: collect the layers
+    if (target == ProcessingTarget::CPU && scene) {
+        NullTaskInput::check(output, "output bitmap");
+        resolution = output->getSize();
+        computeOutputCoords();
+        rasterizer.prepare(*output, background, referenceWidth, threadCount);
+        writeLock(gpu, output, ProcessingTarget::CPU);
+        readLock(gpu, output, ProcessingTarget::CPU);
+        if (background)
+            readLock(gpu, background, ProcessingTarget::CPU);
+
+        try {
+            Scene::LockGuard lock(scene);
+            for (int i = 0; i < scene->getLayerCount(); ++i) {
+                Scene::Layer& layer = scene->getLayer(i);
+                if (layer.isVisible())
+                    rasterizeLayer(gpu, layer, outputCoords);
+            }
+        }
+        catch (...) {
+            rasterizer.release();
+            unlockAll();
+            throw;
+        }
+    }
+}
+
+
+void SceneRenderer::afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted) {
+    if (rasterizer.isReady()) {
+        rasterizer.release();
+        unlockAll();
+    }
+}
+
+
+AbstractTask::TaskDeviceRequirement SceneRenderer::getUsedDevices() const {
+    // on-screen rendering requires GPU
+    if (!output)
+        return TaskDeviceRequirement::GPU_ONLY;
+    return isUsingGpuIfAvailable ? TaskDeviceRequirement::GPU_OR_CPU : TaskDeviceRequirement::CPU_ONLY;
+}
+
+
+ThreadIndex SceneRenderer::getMaxThreads() const {
+    // rendering on GPU is done in a single thread
+    if (!output || (isUsingGpuIfAvailable && output->getContext().isGpuReady()))
+        return 1;
+    return AbstractTask::validThreadCount(SceneRasterizer::getTileCount(*output));
 }
 
 
@@ -175,23 +307,7 @@ bool SceneRenderer::doRender(GraphicPipeline& gpu, TaskThread& thread) {
     gpu.switchMode(GraphicPipeline::Mode::RENDERING);
 
     // compute initial mapping
-    outputCoords.setIdentity();
-    switch (outputMapping) {
-    case FIT_WIDTH_TO_TOP:
-        outputCoords.matrix.scale(1.0f, resolution.getAspectRatio());
-        break;
-    case FIT_WIDTH:
-        outputCoords.matrix.scale(1.0f, resolution.getAspectRatio());
-        outputCoords.setCenterPosition(Point(0.5f, 0.5f));
-        break;
-    case FIT_HEIGHT:
-        outputCoords.matrix.scale(resolution.getInvAspectRatio(), 1.0f);
-        outputCoords.setCenterPosition(Point(0.5f, 0.5f));
-        break;
-    case STRETCH:
-        // identity is okay
-        break;
-    }
+    computeOutputCoords();
 
     // go
     for (int i = 0; i < scene->getLayerCount() && !thread.isTaskAborted(); ++i) {
@@ -204,7 +320,7 @@ bool SceneRenderer::doRender(GraphicPipeline& gpu, TaskThread& thread) {
     if (!thread.isTaskAborted()) {
         if (!output)
             gpu.swapBuffers();
-        else if (outputPixelsFetching) {
+        else if (outputPixelsFetching && !(outputPixelsFetchingAsync && gpu.pullPixelsAsync(*output))) {
             context.writeLock(&gpu, output, ProcessingTarget::CPU);
             gpu.pullPixels(*output);
             context.unlock(output);
@@ -228,7 +344,9 @@ bool SceneRenderer::processOnGPU(GraphicPipeline& gpu, TaskThread& thread) {
 
 
 bool SceneRenderer::process(TaskThread& thread) {
-    throw RuntimeError("GPU is required for rendering");
+    // worker threads of a GPU run have nothing to do
+    if (rasterizer.isReady())
+        rasterizer.process(thread);
     return true;
 }
 
@@ -237,8 +355,9 @@ SceneRenderer::SceneRenderer():
     scene(nullptr), background(nullptr), output(nullptr),
     outputMapping(FIT_WIDTH_TO_TOP),
     referenceWidth(0),
-    outputPixelsFetching(false),
-    eventListener(nullptr)
+    outputPixelsFetching(false), outputPixelsFetchingAsync(false),
+    eventListener(nullptr),
+    isUsingGpuIfAvailable(true)
 {}
 
 
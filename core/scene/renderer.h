@@ -18,15 +18,19 @@
 
 #pragma once
 #include "scene.h"
-#include "../gpu/gpu_task.h"
+#include "rasterizer.h"
+#include "../bitmap/content_lock.h"
+#include "../context.h"
 #include <map>
 
 namespace Beatmup {
     /**
         AbstractTask rendering a Scene.
         The rendering may be done to a given bitmap or on screen, if the platform supports on-screen rendering.
+        When rendering to a bitmap and GPU is not available, the scene is rendered on CPU by SceneRasterizer. Shaded bitmap layers are not
+        supported in this case.
     */
-    class SceneRenderer : public GpuTask {
+    class SceneRenderer : public AbstractTask, private BitmapContentLock {
     public:
         /**
             Scene coordinates to output (screen or bitmap) pixel coordinates mapping
@@ -47,18 +51,26 @@ namespace Beatmup {
         ImageResolution resolution;                 //!< last rendered resolution
         int referenceWidth;                         //!< value overriding output width for elements that have their size in pixels, in order to render a resolution-independent picture
         bool outputPixelsFetching;                  //!< if `true`, the output bitmap data is fetched from GPU to CPU RAM every time the rendering is done
+        bool outputPixelsFetchingAsync;             //!< if `true`, the output bitmap data fetching is only started when the rendering is done
         GL::TextureHandler* cameraFrame;            //!< last got camera frame; set to NULL before rendering, then asked from outside through eventListener
         RenderingContext::EventListener* eventListener;
+        SceneRasterizer rasterizer;                 //!< CPU rendering backend
+        bool isUsingGpuIfAvailable;                 //!< if `false`, the rendering to a bitmap is done on CPU even if GPU is available
 
         static const unsigned int
             MAX_RECURSION_LEVEL = 256;
         void renderLayer(RenderingContext& context, TaskThread& thread, Scene::Layer& layer, const AffineMapping& base, unsigned int recursionLevel = 0);
+        void rasterizeLayer(GraphicPipeline* gpu, Scene::Layer& layer, const AffineMapping& base, unsigned int recursionLevel = 0);
+        void computeOutputCoords();
         bool doRender(GraphicPipeline& gpu, TaskThread& thread);
 
     protected:
         bool process(TaskThread& thread);
         bool processOnGPU(GraphicPipeline& gpu, TaskThread& thread);
         void beforeProcessing(ThreadIndex threadCount, ProcessingTarget target, GraphicPipeline* gpu);
+        void afterProcessing(ThreadIndex threadCount, GraphicPipeline* gpu, bool aborted);
+        TaskDeviceRequirement getUsedDevices() const;
+        ThreadIndex getMaxThreads() const;
     public:
         SceneRenderer();
         ~SceneRenderer();
@@ -112,15 +124,24 @@ namespace Beatmup {
             Otherwise, if the image is to be further processed inside %Beatmup, the pixel transfer likely introduces an unnecessary latency and may
             cause FPS drop in real-time rendering.
             Has no effect in on-screen rendering.
+            In asynchronous mode, the transfer is only started when the rendering is done, so that the rendering task does not wait for the
+            pixels. The transfer is completed when the output bitmap is locked for reading on CPU. This requires GL ES 3.0 or desktop GL; with
+            GL ES 2.0 the pixels are pulled synchronously.
             \param[in] fetch    If `true`, pixels are pulled to CPU memory.
+            \param[in] async    If `true`, pixels are pulled asynchronously.
         */
-        void setOutputPixelsFetching(bool fetch);
+        void setOutputPixelsFetching(bool fetch, bool async = false);
 
         /**
             Reports whether the output bitmap pixels are automatically offloaded from GPU to CPU memory every time the rendering is done.
         */
         bool getOutputPixelsFetching() const;
 
+        /**
+            Reports whether the output bitmap pixels are fetched asynchronously.
+        */
+        inline bool isOutputPixelsFetchingAsync() const { return outputPixelsFetchingAsync; }
+
         /**
             Sets an image to pave the background.
         */
@@ -143,4 +164,12 @@ namespace Beatmup {
         Scene::Layer* pickLayer(float x, float y, bool inPixels) const;
 
         void setRenderingEventListener(RenderingContext::EventListener* eventListener);
+
+        /**
+            Defines the device rendering the scene to a bitmap.
+            When GPU is not available or not used, the scene is rendered on CPU. Its output then differs from the one obtained on GPU by
+            rounding. On-screen rendering always requires GPU.
+            \param[in] useGpu    If `true`, GPU will be used when available, otherwise the scene is rendered on CPU.
+        */
+        inline void setUsingGpuIfAvailable(bool useGpu) { isUsingGpuIfAvailable = useGpu; }
     };}
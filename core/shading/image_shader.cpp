@@ -18,6 +18,8 @@
 
 #include "image_shader.h"
 #include "../gpu/program.h"
+#include "../gpu/program_cache.h"
+#include "../gpu/recycle_bin.h"
 #include "../gpu/bgl.h"
 #include "../debug.h"
 
@@ -99,12 +101,12 @@ void ImageShader::prepare(GraphicPipeline& gpu, GL::TextureHandler* input, const
 
         // link program
         GL::Extensions textureExtension = inputFormat == GL::TextureHandler::TextureFormat::OES_Ext ? GL::Extensions::EXTERNAL_TEXTURE : GL::Extensions::NONE;
-        GL::FragmentShader fragmentShader(gpu, sourceCode, GL::Extensions::BEATMUP_DIALECT + textureExtension);
+        GL::ProgramCache& cache = recycleBin.getContext().getProgramCache();
         if (!program) {
-            program = new GL::RenderingProgram(gpu, fragmentShader);
+            program = new GL::RenderingProgram(gpu, sourceCode, GL::Extensions::BEATMUP_DIALECT + textureExtension, cache);
         }
         else {
-            program->link(gpu, fragmentShader);
+            program->make(gpu, sourceCode, GL::Extensions::BEATMUP_DIALECT + textureExtension, cache);
         }
 
         upToDate = true;
@@ -153,12 +155,12 @@ void ImageShader::prepare(GraphicPipeline& gpu, AbstractBitmap* output) {
     // link program if not yet
     if (!program || !upToDate) {
         // link program
-        GL::FragmentShader fragmentShader(gpu, sourceCode, GL::Extensions::BEATMUP_DIALECT);
+        GL::ProgramCache& cache = recycleBin.getContext().getProgramCache();
         if (!program) {
-            program = new GL::RenderingProgram(gpu, fragmentShader);
+            program = new GL::RenderingProgram(gpu, sourceCode, GL::Extensions::BEATMUP_DIALECT, cache);
         }
         else {
-            program->link(gpu, fragmentShader);
+            program->make(gpu, sourceCode, GL::Extensions::BEATMUP_DIALECT, cache);
         }
 
         upToDate = true;
@@ -18,7 +18,13 @@
 
 #pragma once
 #include "parallelism.h"
+#include "platform.h"
+#include "utils/mpsc_queue.h"
+#include <atomic>
 #include <deque>
+#ifdef BEATMUP_ARCH_X86_64
+#include <emmintrin.h>
+#endif
 
 
 namespace Beatmup {
@@ -32,41 +38,179 @@ namespace Beatmup {
     is scheduled for execution and gets attributed a corresponding Job number. Jobs are used to cancel the scheduled
     runs and track whether they have been conducted or not.
     Exceptions thrown during the tasks execution in different threads are rethrown in the caller threads.
+    Jobs are submitted through a lock-free queue and started in the order they are submitted. A job starts as soon as there are enough idle workers to run it, so that several jobs
+    may run at the same time if their overall number of threads fits the pool size. Jobs of the same task never run at the same time. The graphic pipeline is only accessible in the managing
+    worker thread (#0) of the main pool: tasks using it, and all the tasks of the main pool once it is set up, get this worker as their first
+    thread.
 */
 class Beatmup::ThreadPool {
+    class ActiveJob;
+
+    /**
+        Hands out chunks of work items to the threads running a task, with work stealing.
+        Every thread owns a range of chunks. The owner takes chunks one by one from the beginning of its range. Once the range is empty, the
+        thread steals a half of the chunks left at the end of the largest range of the other threads. Both operations are lock-free.
+    */
+    class ChunkDispenser {
+    private:
+        /**
+            Range of chunks owned by a thread. Its bounds are packed in a single atomic word: the index of the first chunk is in the upper
+            32 bits, the index of the chunk following the last one is in the lower 32 bits.
+        */
+        struct Range {
+            std::atomic<uint64_t> bounds;
+            char padding[64 - sizeof(std::atomic<uint64_t>)];      //!< keeps ranges in different cache lines
+        };
+
+        static inline uint64_t pack(uint32_t first, uint32_t last) {
+            return ((uint64_t)first << 32) | last;
+        }
+
+        Range* ranges;
+        ThreadIndex numRanges;
+        std::mutex setupAccess;
+        std::atomic<int> round;         //!< synchronization round the ranges are set up for
+        msize numItems, chunkSize;
+
+        /**
+            Distributes chunks among threads
+        */
+        void setup(ThreadIndex numThreads, msize numItems, msize chunkSize) {
+            InvalidArgument::check(chunkSize > 0, "Chunk size must be positive");
+            const msize numChunks = (numItems + chunkSize - 1) / chunkSize;
+            RuntimeError::check(numChunks <= (msize)UINT32_MAX, "Too many chunks of work items");
+            if (numRanges < numThreads) {
+                delete[] ranges;
+                ranges = new Range[numThreads];
+                numRanges = numThreads;
+            }
+            for (ThreadIndex t = 0; t < numThreads; ++t)
+                ranges[t].bounds.store(pack(
+                    (uint32_t)(numChunks * t / numThreads),
+                    (uint32_t)(numChunks * (t + 1) / numThreads)
+                ), std::memory_order_relaxed);
+            this->numItems = numItems;
+            this->chunkSize = chunkSize;
+        }
+
+    public:
+        ChunkDispenser(): ranges(nullptr), numRanges(0), round(-1), numItems(0), chunkSize(0) {}
+
+        ~ChunkDispenser() {
+            delete[] ranges;
+        }
+
+        bool next(ThreadIndex thread, ThreadIndex numThreads, int syncRound, msize numItems, msize chunkSize, msize& start, msize& stop) {
+            // set up ranges once per synchronization round, by the first thread coming in
+            if (round.load(std::memory_order_acquire) != syncRound) {
+                std::lock_guard<std::mutex> lock(setupAccess);
+                if (round.load(std::memory_order_relaxed) != syncRound) {
+                    setup(numThreads, numItems, chunkSize);
+                    round.store(syncRound, std::memory_order_release);
+                }
+            }
+            BEATMUP_ASSERT_DEBUG(numItems == this->numItems && chunkSize == this->chunkSize);
+
+            uint32_t chunk;
+            bool found = false;
+
+            // take a chunk from the own range
+            std::atomic<uint64_t>& own = ranges[thread].bounds;
+            uint64_t bounds = own.load();
+            while (!found) {
+                const uint32_t first = (uint32_t)(bounds >> 32), last = (uint32_t)bounds;
+                if (first >= last)
+                    break;
+                if (own.compare_exchange_weak(bounds, pack(first + 1, last))) {
+                    chunk = first;
+                    found = true;
+                }
+            }
+
+            // steal chunks from the thread having the most of them
+            while (!found) {
+                ThreadIndex victim = 0;
+                uint32_t maxLeft = 0;
+                for (ThreadIndex i = 1; i < numThreads; ++i) {
+                    const ThreadIndex t = (thread + i) % numThreads;
+                    const uint64_t b = ranges[t].bounds.load();
+                    const uint32_t first = (uint32_t)(b >> 32), last = (uint32_t)b;
+                    if (first < last && last - first > maxLeft) {
+                        maxLeft = last - first;
+                        victim = t;
+                        bounds = b;
+                    }
+                }
+                if (maxLeft == 0)
+                    return false;
+
+                const uint32_t first = (uint32_t)(bounds >> 32), last = (uint32_t)bounds, split = last - (maxLeft + 1) / 2;
+                if (ranges[victim].bounds.compare_exchange_strong(bounds, pack(first, split))) {
+                    // the first stolen chunk is taken right away, the rest becomes the own range
+                    chunk = split;
+                    own.store(pack(split + 1, last));
+                    found = true;
+                }
+            }
+
+            start = (msize)chunk * this->chunkSize;
+            stop = std::min(start + this->chunkSize, this->numItems);
+            return true;
+        }
+    };
+
+
+
 
     class TaskThreadImpl : public TaskThread {
     private:
         inline void threadFunc() {
-            index == 0 ? pool.managingThreadFunc(*this) : pool.workerThreadFunc(*this);
+            pool.workerThreadFunc(*this);
         }
 
     public:
         inline TaskThreadImpl(ThreadIndex index, ThreadPool& pool) :
-            TaskThread(index),
-            pool(pool), index(index), isRunning(false), isTerminating(false),
+            TaskThread(0),
+            pool(pool), workerIndex(index), job(nullptr), syncRound(0), isTerminating(false),
             internalThread(&TaskThreadImpl::threadFunc, this)
         {}
 
         virtual inline ~TaskThreadImpl() {}
 
         ThreadIndex numThreads() const {
-            return pool.currentWorkerCount;
+            return job->threadCount;
         }
 
         bool isTaskAborted() const {
-            return pool.abortExternally;
+            return job->abortExternally;
         }
 
         void synchronize() {
+            syncRound++;
             if (numThreads() > 1)
-                pool.synchronizeThread(*this);
+                job->synchronize(*this);
+        }
+
+        bool nextChunk(msize numItems, msize chunkSize, msize& start, msize& stop) {
+            return job->chunkDispenser.next(index, numThreads(), syncRound, numItems, chunkSize, start, stop);
+        }
+
+        /**
+            Assigns the worker to a job.
+            \param job      The job
+            \param index    Index of the worker among the threads running the job
+        */
+        inline void assign(ActiveJob* job, ThreadIndex index) {
+            this->job = job;
+            this->index = index;
+            syncRound = 0;
         }
 
         ThreadPool& pool;
-        ThreadIndex index;              //!< current thread index
-        bool isRunning;                 //!< if not, the thread sleeps
-        bool isTerminating;             //!< if `true`, the thread is requested to terminate
+        const ThreadIndex workerIndex;  //!< worker index in the pool
+        ActiveJob* job;                 //!< job the worker is assigned to, `nullptr` if idle
+        int syncRound;                  //!< number of times synchronize() is called in the current task
+        std::atomic<bool> isTerminating;    //!< if `true`, the thread is requested to terminate
         std::thread internalThread;     //!< worker thread
     };
 
@@ -135,316 +279,474 @@ private:
         AnotherThreadFailed() {}
     };
 
+    typedef struct {
+        Job id;
+        AbstractTask* task;
+        TaskExecutionMode mode;
+        ActiveJob* active;              //!< state of the job if it is running, `nullptr` if it waits in the queue
+    } JobContext;
+
     /**
-        Managing (#0) worker thread function
+        State of a running job shared by the workers running it.
+        Workers running the job are synchronized with a barrier. A worker waiting for the others spins for a while first, and then falls
+        asleep if the others are still not there. The barrier state is a single atomic word containing the generation number in its upper
+        32 bits and the number of workers arrived in the current generation in its lower 32 bits. The last worker arriving increments the
+        generation and resets the counter in a single atomic operation, which releases the waiting workers. Workers having finished the
+        task leave the job and are no longer waited for.
     */
-    inline void managingThreadFunc(TaskThreadImpl& thread) {
-        eventListener.threadCreated(myIndex);
+    class ActiveJob {
+    private:
+        static const int SPIN_COUNT = 1000;     //!< number of times a waiting worker checks the condition before falling asleep
+
+        std::atomic<uint64_t> barrier;          //!< barrier state: generation number and number of workers arrived
+        std::atomic<int> remainingWorkers;      //!< number of workers still running the task
+        std::atomic<int> departedWorkers;       //!< number of workers that left the job
+        std::atomic<int> parkedWorkers;         //!< number of workers sleeping in waitFor()
+        std::mutex parking;
+        std::condition_variable parkingCvar;    //!< gets notified when the job state changes and there are sleeping workers
+
+        static inline void pause() {
+#if defined(BEATMUP_ARCH_X86_64)
+            _mm_pause();
+#elif defined(__GNUC__) && (defined(__aarch64__) || defined(BEATMUP_ARCH_ARM))
+            asm volatile("yield");
+#endif
+        }
 
-        // locks
-        std::unique_lock<std::mutex> lock(jobsAccess, std::defer_lock);
-        std::unique_lock<std::mutex> workersLock(workersAccess, std::defer_lock);
+        /**
+            \return number of times a worker checks the condition before sleeping, or zero if there is a single core.
+        */
+        static inline int getSpinCount() {
+            static const int spinCount = std::thread::hardware_concurrency() > 1 ? SPIN_COUNT : 0;
+            return spinCount;
+        }
 
-        while (!thread.isTerminating) {
-            // wait while a task is got
-            lock.lock();
-            while (jobs.empty() && !thread.isTerminating)
-                jobsCvar.wait(lock);
+        /**
+            Releases the barrier if all the workers still running the task have arrived.
+            \param state       The barrier state as seen by the caller
+        */
+        inline void tryRelease(uint64_t state) {
+            const uint32_t generation = (uint32_t)(state >> 32);
+            while ((uint32_t)(state >> 32) == generation) {
+                const uint32_t arrived = (uint32_t)state;
+                if (arrived == 0 || (int)arrived < remainingWorkers.load())
+                    return;
+                if (barrier.compare_exchange_weak(state, (uint64_t)(generation + 1) << 32)) {
+                    wakeUp();
+                    return;
+                }
+            }
+        }
 
-            if (thread.isTerminating) {
-                lock.unlock();
-                break;
+    public:
+        const Job id;
+        AbstractTask* const task;
+        const TaskExecutionMode mode;
+        const ThreadIndex threadCount;  //!< number of workers running the job
+        ChunkDispenser chunkDispenser;  //!< distributes work items among the workers
+        GraphicPipeline* gpu;           //!< graphic pipeline passed to the task, if any
+        std::atomic<bool>
+            started,                    //!< if `true`, beforeProcessing() is done and the workers may start
+            failFlag;                   //!< communicates to all the workers that the task is to skip because of a problem
+        bool
+            useGpu,                     //!< if `true`, the task runs on GPU
+            abortExternally,            //!< if `true`, the task is aborted externally
+            abortInternally,            //!< if `true`, the task aborts itself: beforeProcessing(), process() or processOnGPU() returned `false`
+            repeatFlag;                 //!< if `true`, the task is asked to be repeated
+
+        ActiveJob(const JobContext& job, ThreadIndex threadCount) :
+            barrier(0), remainingWorkers(threadCount), departedWorkers(0), parkedWorkers(0),
+            id(job.id), task(job.task), mode(job.mode),
+            threadCount(threadCount),
+            gpu(nullptr),
+            started(false), failFlag(false),
+            useGpu(false),
+            abortExternally(false), abortInternally(false),
+            repeatFlag(false)
+        {}
+
+        /**
+            Blocks until a condition is met. Spins first, then sleeps until woken up by wakeUp().
+            \param isMet       Functor returning `true` when the condition is met
+        */
+        template<class Condition> inline void waitFor(const Condition& isMet) {
+            for (int i = getSpinCount(); i > 0; --i) {
+                if (isMet())
+                    return;
+                pause();
             }
 
-            // fetch a task
-            syncHitsCount = 0;
-            syncHitsBound = 0;
-            abortExternally = abortInternally = false;
-            failFlag = false;
-            repeatFlag = false;
-            if (!jobs.empty()) {
-                currentJob = jobs.front();
-                currentWorkerCount = remainingWorkers = std::min(currentJob.task->getMaxThreads(), threadCount);
+            std::unique_lock<std::mutex> lock(parking);
+            parkedWorkers++;
+            while (!isMet())
+                parkingCvar.wait(lock);
+            parkedWorkers--;
+        }
+
+        /**
+            Wakes up the workers sleeping in waitFor() to check their conditions again.
+        */
+        inline void wakeUp() {
+            if (parkedWorkers.load() > 0) {
+                // Acquiring the lock ensures a worker about to sleep either sees the new state or is already waiting.
+                // Notifying once the lock is released avoids waking the workers up just to block on the lock.
+                { std::lock_guard<std::mutex> lock(parking); }
+                parkingCvar.notify_all();
             }
-            else
-                currentJob.task = nullptr;
+        }
 
-            // release queue access
-            lock.unlock();
+        /**
+            Blocks until all the other workers running the task reach the same synchronization point or leave the job.
+            Throws AnotherThreadFailed if a worker failed.
+        */
+        inline void synchronize(TaskThreadImpl& thread) {
+            const uint64_t state = barrier.fetch_add(1) + 1;
+            const uint32_t generation = (uint32_t)(state >> 32);
+            tryRelease(state);
 
-            // test execution mode
-            AbstractTask::TaskDeviceRequirement exTarget;
-            bool useGpuForCurrentTask = false;
-            if (currentJob.task) {
-                exTarget = currentJob.task->getUsedDevices();
-
-                if (exTarget != AbstractTask::TaskDeviceRequirement::CPU_ONLY && myIndex == 0) {
-                    // test GPU if not yet
-                    if (!isGpuTested) {
-                        try {
-                            gpu = new GraphicPipeline();
-                        }
-                        catch (...) {
-                            eventListener.gpuInitFail(myIndex, std::current_exception());
-                            std::lock_guard<std::mutex> lock(exceptionsAccess);
-                            exceptions.push_back(std::current_exception());
-                            gpu = nullptr;
-                        }
-                        isGpuTested = true;
-                    }
+            // Do not check if the task aborted here to keep threads synchronized.
+            waitFor([&]() {
+                return (uint32_t)(barrier.load() >> 32) != generation || failFlag || thread.isTerminating;
+            });
 
-                    useGpuForCurrentTask = (gpu != nullptr);
-                }
+            if (failFlag)
+                throw AnotherThreadFailed();
+        }
 
-                // run beforeProcessing
-                try {
-                    if (!useGpuForCurrentTask && exTarget == AbstractTask::TaskDeviceRequirement::GPU_ONLY)
-                        throw Beatmup::RuntimeError(
-                            myIndex == 0 ?
-                            "A task requires GPU, but GPU init is failed" :
-                            "A task requiring GPU may only be run in the main pool"
-                        );
-                    currentJob.task->beforeProcessing(currentWorkerCount, useGpuForCurrentTask ? ProcessingTarget::GPU : ProcessingTarget::CPU, gpu);
-                }
-                catch (...) {
-                    eventListener.taskFail(myIndex, *currentJob.task, std::current_exception());
-                    std::lock_guard<std::mutex> lock(exceptionsAccess);
-                    exceptions.push_back(std::current_exception());
-                    failFlag = true;
-                }
+        /**
+            Called by a worker once it is done with the task. The job state may not be accessed by the worker after this call, except
+            the first worker of the job.
+        */
+        inline void leave() {
+            remainingWorkers--;
+            tryRelease(barrier.load());
+            std::lock_guard<std::mutex> lock(parking);
+            departedWorkers++;
+            parkingCvar.notify_all();
+        }
 
-                // drop the task if failed
-                if (failFlag) {
-                    lock.lock();
-                    jobs.pop_front();
-                    lock.unlock();
-                }
+        /**
+            Blocks the first worker of the job until the other workers leave the job.
+            \return `false` if the pool is terminating, so that the workers might still run.
+        */
+        inline bool waitForWorkers(TaskThreadImpl& thread) {
+            waitFor([&]() { return departedWorkers == threadCount || thread.isTerminating; });
+            // ensure the last departed worker released the lock
+            std::lock_guard<std::mutex> lock(parking);
+            return departedWorkers == threadCount;
+        }
+
+        /**
+            Wakes up the workers in the pool termination.
+        */
+        inline void terminate() {
+            std::lock_guard<std::mutex> lock(parking);
+            parkingCvar.notify_all();
+        }
+    };
+
+
+    /**
+        Worker thread function
+    */
+    inline void workerThreadFunc(TaskThreadImpl& thread) {
+        eventListener.threadCreated(myIndex);
+        std::unique_lock<std::mutex> lock(jobsAccess);
+
+        while (!thread.isTerminating) {
+            // wait for a job
+            if (!thread.job) {
+                workersCvar.wait(lock);
+                continue;
+            }
+
+            ActiveJob& job = *thread.job;
+            const bool isFirst = thread.currentThread() == 0;
+            lock.unlock();
+
+            /* UNLOCKED SECTION */
+            // the first thread starts the job, the others wait for it
+            bool startFailed = false;
+            if (isFirst) {
+                startFailed = !startJob(thread, job);
+                job.started = true;
+                job.wakeUp();
             }
+            else
+                job.waitFor([&]() { return job.started || thread.isTerminating; });
+
+            if (thread.isTerminating)
+                break;
+
+            if (!job.failFlag)
+                runJob(thread, job);
+
+            if (isFirst) {
+                // wait until all the workers stop
+                job.leave();
+                if (!job.waitForWorkers(thread))
+                    break;      // terminating; the job is dropped by the pool destructor
+
+                // finalize, ask if want to repeat
+                const bool repeat = !startFailed && finishJob(job);
+
+                // drop the job
+                lock.lock();
+                for (auto it = jobs.begin(); it != jobs.end(); ++it)
+                    if (it->active == &job) {
+                        if (!(job.repeatFlag || repeat) || job.failFlag)
+                            jobs.erase(it);
+                        else
+                            it->active = nullptr;
+                        break;
+                    }
+                delete &job;
 
-            // if failed, go to next iteration
-            if (failFlag) {
                 // send a signal to threads waiting for the task to finish
                 jobsCvar.notify_all();
-                continue;
+            }
+            else {
+                job.leave();
+                lock.lock();
             }
 
-            // wake up workers
-            workersLock.lock();
-            for (ThreadIndex t = 0; t < threadCount; t++)
-                workers[t]->isRunning = true;
-            workersLock.unlock();
-            workersCvar.notify_all();    // go!
+            // become available for another job
+            thread.job = nullptr;
+            idleWorkers++;
+            dispatch();
+        }
+
+        if (lock.owns_lock())
+            lock.unlock();
+        eventListener.threadTerminating(myIndex);
+
+        // deleting graphic pipeline instance
+        if (gpu && thread.workerIndex == 0 && myIndex == 0)
+            delete gpu;
+    }
+
 
-            // do the job
-            if (currentJob.task)
+    /**
+        Prepares a job to run: sets up the GPU if needed and calls beforeProcessing().
+        Called by the first thread of the job.
+        \return `false` if the job failed to start.
+    */
+    inline bool startJob(TaskThreadImpl& thread, ActiveJob& job) {
+        const AbstractTask::TaskDeviceRequirement exTarget = job.task->getUsedDevices();
+
+        // GPU is only accessible in the managing thread of the main pool
+        if (thread.workerIndex == 0 && myIndex == 0) {
+            // test GPU if not yet
+            if (exTarget != AbstractTask::TaskDeviceRequirement::CPU_ONLY && !isGpuTested) {
+                GraphicPipeline* newGpu = nullptr;
                 try {
-                    do {
-                        bool result = useGpuForCurrentTask ? currentJob.task->processOnGPU(*gpu, thread) : currentJob.task->process(thread);
-                        if (!result) {
-                            abortInternally = true;
-                        }
-                    } while (currentJob.mode == TaskExecutionMode::PERSISTENT && !abortInternally && !abortExternally);
-                }
-                catch (AnotherThreadFailed) {
-                    // nothing special to do here
+                    newGpu = new GraphicPipeline();
                 }
                 catch (...) {
-                    eventListener.taskFail(myIndex, *currentJob.task, std::current_exception());
+                    eventListener.gpuInitFail(myIndex, std::current_exception());
                     std::lock_guard<std::mutex> lock(exceptionsAccess);
                     exceptions.push_back(std::current_exception());
-                    failFlag = true;
                 }
+                std::lock_guard<std::mutex> lock(jobsAccess);
+                gpu = newGpu;
+                isGpuTested = true;
+            }
 
-            // finalizing
-            workersLock.lock();
+            job.gpu = gpu;
+            job.useGpu = (exTarget != AbstractTask::TaskDeviceRequirement::CPU_ONLY && gpu != nullptr);
+        }
 
-            // decrease remaining workers count
-            remainingWorkers--;
+        // run beforeProcessing
+        try {
+            if (!job.useGpu && exTarget == AbstractTask::TaskDeviceRequirement::GPU_ONLY)
+                throw Beatmup::RuntimeError(
+                    myIndex == 0 ?
+                    "A task requires GPU, but GPU init is failed" :
+                    "A task requiring GPU may only be run in the main pool"
+                );
+            job.task->beforeProcessing(job.threadCount, job.useGpu ? ProcessingTarget::GPU : ProcessingTarget::CPU, job.gpu);
+        }
+        catch (...) {
+            eventListener.taskFail(myIndex, *job.task, std::current_exception());
+            std::lock_guard<std::mutex> lock(exceptionsAccess);
+            exceptions.push_back(std::current_exception());
+            job.failFlag = true;
+            return false;
+        }
 
-            // notify other workers if they're waiting for synchro
-            synchroCvar.notify_all();
+        return true;
+    }
 
-            // wait until all the workers stop
-            while (remainingWorkers > 0 && !thread.isTerminating)
-                workersCvar.wait(workersLock);
 
-            // call afterProcessing
-            if (currentJob.task)
-                try {
-                    currentJob.task->afterProcessing(currentWorkerCount, useGpuForCurrentTask ? gpu : nullptr, abortExternally);
-                }
-                catch (...) {
-                    eventListener.taskFail(myIndex, *currentJob.task, std::current_exception());
-                    std::lock_guard<std::mutex> lock(exceptionsAccess);
-                    exceptions.push_back(std::current_exception());
-                    failFlag = true;
+    /**
+        Runs the task in a worker thread
+    */
+    inline void runJob(TaskThreadImpl& thread, ActiveJob& job) {
+        try {
+            do {
+                bool result = job.useGpu && thread.currentThread() == 0 ? job.task->processOnGPU(*job.gpu, thread) : job.task->process(thread);
+                if (!result) {
+                    job.abortInternally = true;
                 }
+            } while (job.mode == TaskExecutionMode::PERSISTENT && !job.abortInternally && !job.abortExternally && !thread.isTerminating);
+        }
+        catch (const AnotherThreadFailed&) {
+            // nothing special to do here
+        }
+        catch (...) {
+            eventListener.taskFail(myIndex, *job.task, std::current_exception());
+            std::lock_guard<std::mutex> lock(exceptionsAccess);
+            exceptions.push_back(std::current_exception());
+            job.failFlag = true;
+        }
+    }
 
-            workersLock.unlock();
-
-            // unlock graphic pipeline, if used
-            if (useGpuForCurrentTask && gpu) {
-                gpu->flush();
-            }
 
-            // call taskDone, ask if want to repeat
-            bool internalRepeatFlag = false;
-            if (!failFlag)
-                internalRepeatFlag = eventListener.taskDone(myIndex, *currentJob.task, abortExternally);
+    /**
+        Calls afterProcessing() once all the workers are done with a job.
+        Called by the first thread of the job.
+        \return `true` if the task is asked to be repeated.
+    */
+    inline bool finishJob(ActiveJob& job) {
+        try {
+            job.task->afterProcessing(job.threadCount, job.useGpu ? job.gpu : nullptr, job.abortExternally);
+        }
+        catch (...) {
+            eventListener.taskFail(myIndex, *job.task, std::current_exception());
+            std::lock_guard<std::mutex> lock(exceptionsAccess);
+            exceptions.push_back(std::current_exception());
+            job.failFlag = true;
+        }
 
-            // drop the task
-            lock.lock();
-            if (!(repeatFlag || internalRepeatFlag) || failFlag) {
-                jobs.pop_front();
+        // unlock graphic pipeline, if used
+        if (job.useGpu)
+            job.gpu->flush();
 
-                // send a signal to threads waiting for the task to finish
-                jobsCvar.notify_all();
-            }
+        // call taskDone, ask if want to repeat
+        if (job.failFlag)
+            return false;
+        return eventListener.taskDone(myIndex, *job.task, job.abortExternally);
+    }
 
-            lock.unlock();
-        }
-        eventListener.threadTerminating(myIndex);
 
-        // deleting graphic pipeline instance
-        if (gpu && myIndex == 0)
-            delete gpu;
+    /**
+        \return the number of workers a given task is run in.
+    */
+    inline ThreadIndex getWorkerCount(const AbstractTask& task) const {
+        return std::min(task.getMaxThreads(), threadCount);
     }
 
 
     /**
-        Ordinary worker thread function
+        Checks whether a given task needs to be run by the managing thread.
+        This is the case if the task may use GPU, or if the GPU is set up (in this case the task may need to transfer pixels from/to GPU).
     */
-    inline void workerThreadFunc(TaskThreadImpl& thread) {
-        eventListener.threadCreated(myIndex);
-        std::unique_lock<std::mutex> lock(workersAccess);
-        Job myLastJob = (Job)-1;
-        while (!thread.isTerminating) {
-            // wait for a job
-            while ((!thread.isRunning || thread.index >= currentWorkerCount || myLastJob - currentJob.id >= 0)
-                    && !thread.isTerminating)
-            {
-                std::this_thread::yield();
-                workersCvar.wait(lock);
-            }
-            if (thread.isTerminating) {
-                lock.unlock();
-                break;
-            }
+    inline bool needsManagingThread(const AbstractTask& task) const {
+        return myIndex == 0 && (gpu || task.getUsedDevices() != AbstractTask::TaskDeviceRequirement::CPU_ONLY);
+    }
 
-            // do the job
-            JobContext job = currentJob;
-            lock.unlock();
 
-            /* UNLOCKED SECTION */
-            try {
-                do {
-                    if (!job.task->process(thread)) {
-                        abortInternally = true;
-                    }
-                } while (job.mode == TaskExecutionMode::PERSISTENT && !abortInternally && !abortExternally && !thread.isTerminating);
-            }
-            catch (AnotherThreadFailed) {
-                // nothing special to do here
-            }
-            catch (...) {
-                eventListener.taskFail(myIndex, *job.task, std::current_exception());
-                std::lock_guard<std::mutex> lock(exceptionsAccess);
-                exceptions.push_back(std::current_exception());
-                failFlag = true;
-            }
+    /**
+        Moves the jobs submitted through the lock-free queue to the jobs queue.
+        The jobs access must be locked by the caller, which makes the caller the only consumer of the submission queue.
+    */
+    inline void fetchSubmittedJobs() {
+        JobContext job;
+        while (submittedJobs.pop(job))
+            jobs.push_back(job);
+    }
 
-            // finalizing
-            lock.lock();
 
-            // decrease remaining workers count
-            myLastJob = job.id;
-            remainingWorkers--;
+    /**
+        Checks whether a given task is being run by an active job.
+        The jobs access must be locked by the caller.
+    */
+    inline bool isTaskRunning(const AbstractTask* task) const {
+        for (const JobContext& _ : jobs)
+            if (_.active && _.task == task)
+                return true;
+        return false;
+    }
 
-            // notify other workers if they're waiting for synchro
-            synchroCvar.notify_all();
 
-            // stop
-            thread.isRunning = false;
+    /**
+        Starts queued jobs on idle workers, in the order of submission, as long as there are enough idle workers.
+        Jobs of a task that is already running are skipped and stay queued, so that runs of the same task never overlap.
+        The jobs access must be locked by the caller.
+    */
+    inline void dispatch() {
+        fetchSubmittedJobs();
 
-            // send a signal to other workers
-            workersCvar.notify_all();
-        }
+        ThreadIndex idleCount = 0;
+        for (ThreadIndex t = 0; t < threadCount; t++)
+            if (!workers[t]->job)
+                idleCount++;
 
-        eventListener.threadTerminating(myIndex);
-    }
+        bool assigned = false;
+        for (auto& it : jobs) {
+            if (it.active || isTaskRunning(it.task))
+                continue;
+            const ThreadIndex count = getWorkerCount(*it.task);
+            const bool useManagingThread = needsManagingThread(*it.task);
+            if (idleCount < count || (useManagingThread && workers[0]->job))
+                break;
 
+            it.active = new ActiveJob(it, count);
+            ThreadIndex index = 0;
+            if (useManagingThread)
+                workers[0]->assign(it.active, index++);
 
-    inline void synchronizeThread(TaskThreadImpl& thread) {
-        std::unique_lock<std::mutex> lock(synchro);    //<------- LOCKING HERE
-        syncHitsCount++;
+            // take workers from the end to keep the managing thread available for GPU tasks
+            for (ThreadIndex t = threadCount; index < count && t > 0; t--)
+                if (!workers[t - 1]->job)
+                    workers[t - 1]->assign(it.active, index++);
+            BEATMUP_ASSERT_DEBUG(index == count);
 
-        // check if this thread is the last one passing the synchronization point
-        if (syncHitsCount >= syncHitsBound + remainingWorkers) {
-            syncHitsBound = syncHitsCount;
-            lock.unlock();    //<------- UNLOCKING HERE
-            // do not block, wake up the others
-            synchroCvar.notify_all();
+            idleCount -= count;
+            idleWorkers -= count;
+            assigned = true;
         }
 
-        else {
-            // Wait while other threads reach this synchronization point or the remaining number of workers drops
-            // (at the end of the task), or pool is terminating.
-            // Do not check if the task aborted here to keep threads synchronized.
-            const int myBound = syncHitsBound;
-            while (!thread.isTerminating  &&  !failFlag  &&  myBound + remainingWorkers - syncHitsCount > 0)
-                synchroCvar.wait(lock);
+        if (assigned)
+            workersCvar.notify_all();    // go!
+    }
 
-            lock.unlock();    //<------- UNLOCKING HERE
-        }
 
-        if (failFlag)
-            throw AnotherThreadFailed();
+    /**
+        \return a queued job by its number, or `nullptr` if not found.
+    */
+    inline JobContext* findJob(Job job) {
+        for (JobContext& _ : jobs)
+            if (_.id == job)
+                return &_;
+        return nullptr;
     }
 
-    typedef struct {
-        Job id;
-        AbstractTask* task;
-        TaskExecutionMode mode;
-    } JobContext;
 
     TaskThreadImpl** workers;       //!< workers instances
 
     GraphicPipeline* gpu;           //!< THE graphic pipeline to run tasks on GPU
 
-    std::deque<JobContext> jobs;    //!< jobs queue
+    std::deque<JobContext> jobs;    //!< jobs queue, including the running jobs
+    MpscQueue<JobContext>
+        submittedJobs;              //!< jobs submitted and not yet moved to the jobs queue
     std::deque<std::exception_ptr>
         exceptions;                 //!< exceptions thrown in this pool
 
-    JobContext currentJob;          //!< job being run at the moment
-    Job jobCounter;
+    std::atomic<Job> jobCounter;
 
     ThreadIndex threadCount;        //!< actual number of workers
-
-    ThreadIndex
-        currentWorkerCount,
-        remainingWorkers;           //!< number of workers performing the current task right now
+    std::atomic<int> idleWorkers;   //!< number of workers not assigned to a job, used to decide whether to wake up workers on submission
 
     std::condition_variable
-        synchroCvar,                //!< gets notified about workers synchronization
         jobsCvar,                   //!< gets notified about the jobs queue updates
         workersCvar;                //!< gets notified about workers lifecycle updates
 
     std::mutex
-        synchro,                    //!< workers synchronization control within the current task
-        workersAccess,              //!< workers lifecycle access control
-        jobsAccess,                 //!< jobs queue access control
+        jobsAccess,                 //!< jobs queue and workers assignment access control
         exceptionsAccess;           //!< exceptions queue access control
 
-    int
-        syncHitsCount,              //!< number of times synchronization is hit so far by all workers together
-        syncHitsBound;              //!< last sync hits count when all the workers were synchronized
-
-    bool
-        isGpuTested,                //!< if `true`, there was an attempt to warm up the GPU
-        abortExternally,            //!< if `true`, the task is aborted externally
-        abortInternally,            //!< if `true`, the task aborts itself: beforeProcessing(), process() or processOnGPU() returned `false`
-        failFlag,                   //!< communicates to all the threads that the current task is to skip because of a problem
-        repeatFlag;                 //!< if `true`, the current task is asked to be repeated
+    bool isGpuTested;               //!< if `true`, there was an attempt to warm up the GPU
 
     EventListener& eventListener;
 
@@ -453,17 +755,14 @@ public:
 
     inline ThreadPool(const PoolIndex index, const ThreadIndex limitThreadCount, EventListener & listener) :
         gpu(nullptr),
-        currentJob{0, nullptr},
         jobCounter(1),
         threadCount(limitThreadCount),
-        currentWorkerCount(0), remainingWorkers(0),
-        syncHitsCount(0), syncHitsBound(0),
+        idleWorkers(limitThreadCount),
         isGpuTested(false),
-        abortExternally(false), abortInternally(false),
-        failFlag(false), repeatFlag(false),
         eventListener(listener),
         myIndex(index)
     {
+        std::lock_guard<std::mutex> lock(jobsAccess);
         workers = new TaskThreadImpl*[threadCount];
         // spawning workers
         for (ThreadIndex t = 0; t < threadCount; t++)
@@ -474,12 +773,15 @@ public:
     inline ~ThreadPool() {
         // set termination flags
         {
-            std::lock_guard<std::mutex> lockJobs(jobsAccess), lockWorkers(workersAccess), lockSync(synchro);
-            abortExternally = true;
+            std::lock_guard<std::mutex> lock(jobsAccess);
             for (ThreadIndex t = 0; t < threadCount; t++)
                 workers[t]->isTerminating = true;
+            for (JobContext& _ : jobs)
+                if (_.active) {
+                    _.active->abortExternally = true;
+                    _.active->terminate();
+                }
         }
-        synchroCvar.notify_all();
         jobsCvar.notify_all();
         workersCvar.notify_all();
         // no wait here!
@@ -488,6 +790,10 @@ public:
             delete workers[t];
         }
         delete[] workers;
+
+        // drop jobs interrupted by termination
+        for (JobContext& _ : jobs)
+            delete _.active;
     }
 
 
@@ -514,59 +820,63 @@ public:
     inline void resize(ThreadIndex newThreadCount) {
         if (newThreadCount == threadCount)
             return;
-        std::unique_lock<std::mutex> jobsLock(jobsAccess);
+        std::unique_lock<std::mutex> lock(jobsAccess);
         // wait for task, if any
+        fetchSubmittedJobs();
         while (!jobs.empty())
-            jobsCvar.wait(jobsLock);
+            jobsCvar.wait(lock);
 
-        std::unique_lock<std::mutex> workersLock(workersAccess);
-        // set termination flags for threads to be stopped, if any
-        for (ThreadIndex t = newThreadCount; t < threadCount; t++)
+        // set termination flags for threads to be stopped, if any, and exclude them from dispatching
+        const ThreadIndex oldThreadCount = threadCount;
+        for (ThreadIndex t = newThreadCount; t < oldThreadCount; t++)
             workers[t]->isTerminating = true;
+        if (newThreadCount < oldThreadCount) {
+            threadCount = newThreadCount;
+            idleWorkers -= oldThreadCount - newThreadCount;
+        }
 
         // unlock and notify
-        workersLock.unlock();
-        synchroCvar.notify_all();
-        jobsCvar.notify_all();
+        lock.unlock();
         workersCvar.notify_all();
 
         // join
-        for (ThreadIndex t = newThreadCount; t < threadCount; t++) {
+        for (ThreadIndex t = newThreadCount; t < oldThreadCount; t++) {
             workers[t]->internalThread.join();
             delete workers[t];
         }
 
         // spawn new threads if needed
-        workersLock.lock();
-        if (threadCount < newThreadCount) {
+        lock.lock();
+        if (oldThreadCount < newThreadCount) {
             TaskThreadImpl** newWorkers = new TaskThreadImpl*[newThreadCount];
-            for (ThreadIndex t = 0; t < threadCount; t++)
+            for (ThreadIndex t = 0; t < oldThreadCount; t++)
                 newWorkers[t] = workers[t];
-            for (ThreadIndex t = threadCount; t < newThreadCount; t++)
+            for (ThreadIndex t = oldThreadCount; t < newThreadCount; t++)
                 newWorkers[t] = new TaskThreadImpl(t, *this);
             delete[] workers;
             workers = newWorkers;
+            idleWorkers += newThreadCount - oldThreadCount;
         }
         // update thread count
         threadCount = newThreadCount;
-
-        workersLock.unlock();
-        jobsLock.unlock();
+        dispatch();
     }
 
 
     /**
         Adds a new task to the jobs queue.
+        Lock-free if all the workers are busy: the job is then started by a worker once it is done with its current job.
     */
     inline Job submitTask(AbstractTask& task, const TaskExecutionMode mode) {
-        std::unique_lock<std::mutex> lock(jobsAccess);
         const Job job = jobCounter++;
+        submittedJobs.push(JobContext{job, &task, mode, nullptr});
 
-        // add new job
-        jobs.emplace_back(JobContext{job, &task, mode});
-
-        lock.unlock();
-        jobsCvar.notify_all();
+        // Wake up idle workers if any. Workers fetch submitted jobs after becoming idle, so either the new job is seen by a worker
+        // becoming idle, or the worker is seen idle here.
+        if (idleWorkers.load() > 0) {
+            std::lock_guard<std::mutex> lock(jobsAccess);
+            dispatch();
+        }
         return job;
     }
 
@@ -577,19 +887,17 @@ public:
         \param abortCurrent    if `true` and the task is currently running, abort signal is sent.
     */
     inline Job repeatTask(AbstractTask& task, bool abortCurrent) {
-        std::unique_lock<std::mutex> lock(jobsAccess);
-
-        // check if the rask is running now, ask for repeat if it is
-        if (!jobs.empty() && jobs.front().task == &task) {
-            repeatFlag = true;
-            if (abortCurrent)
-                abortExternally = true;
-            return jobs.front().id;
-        }
+        std::lock_guard<std::mutex> lock(jobsAccess);
+        fetchSubmittedJobs();
 
-        // check whether it is in the queue
+        // check whether the task is running or queued, ask for repeat if it is running
         for (const JobContext& _ : jobs)
             if (_.task == &task) {
+                if (_.active) {
+                    _.active->repeatFlag = true;
+                    if (abortCurrent)
+                        _.active->abortExternally = true;
+                }
                 return _.id;
             }
 
@@ -598,12 +906,10 @@ public:
         jobs.emplace_back(JobContext{
             job,
             &task,
-            TaskExecutionMode::NORMAL
+            TaskExecutionMode::NORMAL,
+            nullptr
         });
-
-        // unlock the jobs access, notify workers
-        lock.unlock();
-        jobsCvar.notify_all();
+        dispatch();
         return job;
     }
 
@@ -613,31 +919,27 @@ public:
     */
     inline void waitForJob(Job job) {
         std::unique_lock<std::mutex> lock(jobsAccess);
+        fetchSubmittedJobs();
 #ifdef BEATMUP_DEBUG
-        if (currentJob.task && currentJob.id != job && currentJob.mode == TaskExecutionMode::PERSISTENT && !abortExternally) {
-            class BlockingOnPersistentJob : public Exception {
-            public:
-                BlockingOnPersistentJob(): Exception("Waiting for a persistent job to finish: potential deadlock") {}
-            };
-            throw BlockingOnPersistentJob();
+        const JobContext* waited = findJob(job);
+        if (waited && !waited->active) {
+            // check whether the job may start at all
+            ThreadIndex persistentCount = 0;
+            for (const JobContext& _ : jobs)
+                if (_.active && _.mode == TaskExecutionMode::PERSISTENT && !_.active->abortExternally)
+                    persistentCount += _.active->threadCount;
+            if (persistentCount > 0 && threadCount - persistentCount < getWorkerCount(*waited->task)) {
+                class BlockingOnPersistentJob : public Exception {
+                public:
+                    BlockingOnPersistentJob(): Exception("Waiting for a persistent job to finish: potential deadlock") {}
+                };
+                throw BlockingOnPersistentJob();
+            }
         }
 #endif
-        while (true) {
-            // check if the job is in the queue
-            bool found = false;
-            for (const JobContext& _ : jobs)
-                if (_.id == job) {
-                    found = true;
-                    break;
-                }
-
-            // if not, done
-            if (!found)
-                return;
-
-            // otherwise wait a round and check again
+        // wait while the job is in the queue
+        while (findJob(job))
             jobsCvar.wait(lock);
-        }
     }
 
 
@@ -647,11 +949,13 @@ public:
     */
     bool abortJob(Job job) {
         std::unique_lock<std::mutex> lock(jobsAccess);
+        fetchSubmittedJobs();
 
-        // check if the rask is running now, abort if it is
-        if (currentJob.task && currentJob.id == job) {
-            abortExternally = true;
-            while (!jobs.empty() && currentJob.task && currentJob.id == job)
+        // check if the job is running now, abort if it is
+        JobContext* context = findJob(job);
+        if (context && context->active) {
+            context->active->abortExternally = true;
+            while ((context = findJob(job)) && context->active && context->active->abortExternally)
                 jobsCvar.wait(lock);
             return true;
         }
@@ -671,6 +975,7 @@ public:
     */
     void wait() {
         std::unique_lock<std::mutex> lock(jobsAccess);
+        fetchSubmittedJobs();
         while (!jobs.empty())
             jobsCvar.wait(lock);
     }
@@ -681,6 +986,7 @@ public:
     */
     inline bool busy() {
         std::lock_guard<std::mutex> lock(jobsAccess);
+        fetchSubmittedJobs();
         return !jobs.empty();
     }
 
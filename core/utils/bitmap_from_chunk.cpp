@@ -17,11 +17,20 @@
 */
 
 #include "bitmap_from_chunk.h"
+#include <cstring>
 
 using namespace Beatmup;
 
 bool BitmapFromChunk::process(TaskThread& thread) {
-    collection->fetch(chunkId, bitmap->getData(0, 0), bitmap->getMemorySize());
+    if (bitmap->isDense())
+        collection->fetch(chunkId, bitmap->getData(0, 0), bitmap->getMemorySize());
+    else {
+        // copy row by row
+        const Chunk chunk(*collection, chunkId);
+        const msize rowSize = bitmap->getMemorySize() / bitmap->getHeight();
+        for (int y = 0; y < bitmap->getHeight(); ++y)
+            memcpy(bitmap->getData(0, y), chunk.ptr<pixbyte>(y * rowSize), rowSize);
+    }
     return true;
 }
 
@@ -17,6 +17,7 @@
 */
 
 #include "chunkfile.h"
+#include <cstring>
 
 using namespace Beatmup;
 
@@ -129,6 +130,109 @@ void ChunkFile::close() {
 }
 
 
+MappedChunkFile::MappedChunkFile(const std::string& filename, bool openNow) :
+    filename(filename)
+{
+    if (openNow)
+        open();
+}
+
+
+MappedChunkFile::~MappedChunkFile() {
+    close();
+}
+
+
+void MappedChunkFile::open() {
+    if (mapping.isMapped())
+        return;
+
+    mapping.map(filename);
+    if (!mapping.isMapped()) {
+        // empty file: nothing to map
+        map.clear();
+        return;
+    }
+
+    try {
+        parse();
+    }
+    catch (...) {
+        close();
+        throw;
+    }
+}
+
+
+void MappedChunkFile::close() {
+    mapping.unmap();
+}
+
+
+void MappedChunkFile::parse() {
+    map.clear();
+    msize pos = 0;
+    while (pos < mapping.getSize()) {
+        // read id
+        id_size_t idLength;
+        if (mapping.getSize() - pos < sizeof(id_size_t))
+            throw IOError(filename, "Unexpected end of file when reading chunk header");
+        memcpy(&idLength, mapping.getData() + pos, sizeof(id_size_t));
+        pos += sizeof(id_size_t);
+        if (mapping.getSize() - pos < (msize)idLength + sizeof(chunksize_t))
+            throw IOError(filename, "Unexpected end of file when reading chunk header");
+        std::string id(reinterpret_cast<const char*>(mapping.getData() + pos), idLength);
+        pos += idLength;
+
+        // read length
+        ChunkDesc chunkDesc;
+        memcpy(&chunkDesc.size, mapping.getData() + pos, sizeof(chunksize_t));
+        pos += sizeof(chunksize_t);
+
+        // skip content
+        if (mapping.getSize() - pos < chunkDesc.size)
+            throw IOError(filename, "Unexpected end of file when reading chunk content");
+        chunkDesc.pos = pos;
+        map[id] = chunkDesc;
+        pos += chunkDesc.size;
+    }
+}
+
+
+chunksize_t MappedChunkFile::chunkSize(const std::string& id) const {
+    const auto& chunk = map.find(id);
+    return chunk == map.end() ? 0 : chunk->second.size;
+}
+
+
+chunksize_t MappedChunkFile::fetch(const std::string& id, void* data, const chunksize_t limit) {
+    const auto& chunk = map.find(id);
+    if (chunk == map.end())
+        return 0;
+    RuntimeError::check(mapping.isMapped(), "Cannot read chunk " + id + ": the file is not open");
+    const chunksize_t size = chunk->second.size < limit ? chunk->second.size : limit;
+    memcpy(data, mapping.getData() + chunk->second.pos, size);
+    return size;
+}
+
+
+const void* MappedChunkFile::chunkData(const std::string& id) const {
+    if (!mapping.isMapped())
+        return nullptr;
+    const auto& chunk = map.find(id);
+    return chunk == map.end() ? nullptr : mapping.getData() + chunk->second.pos;
+}
+
+
+void MappedChunkFile::save(const std::string& filename, bool append) {
+    ChunkFileWriter writer(filename, append);
+    for (auto it : map) {
+        Chunk chunk(*this, it.first);
+        writer(it.first, chunk(), chunk.size());
+    }
+}
+
+
 ChunkFileWriter::ChunkFileWriter(const std::string& filename, bool append) :
     stream(filename, std::ios::binary | (append ? std::ios::out | std::ios::app | std::ios::ate : std::ios::out))
 {
@@ -150,18 +254,23 @@ void ChunkFileWriter::operator()(const std::string& id, const void* data, const
 }
 
 
-Chunk::Chunk(size_t size) : chunkSize(size) {
+Chunk::Chunk(size_t size) : chunkSize(size), owned(true) {
     data = malloc(size);
 }
 
 
 Chunk::Chunk(ChunkCollection& collection, const std::string& id):
-    Chunk(collection.chunkSize(id))
+    chunkSize(collection.chunkSize(id)), owned(false)
 {
 #ifdef BEATMUP_DEBUG
     DebugAssertion::check(collection.chunkExists(id), "Chunk not found: " + id);
 #endif
-    collection.fetch(id, data, chunkSize);
+    data = const_cast<void*>(collection.chunkData(id));
+    if (!data) {
+        owned = true;
+        data = malloc(chunkSize);
+        collection.fetch(id, data, chunkSize);
+    }
 }
 
 
@@ -171,5 +280,6 @@ void Chunk::writeTo(ChunkFileWriter& file, const std::string& id) const {
 
 
 Chunk::~Chunk() {
-    free(data);
+    if (owned)
+        free(data);
 }
@@ -19,6 +19,7 @@
 #pragma once
 #include "../exception.h"
 #include "input_stream.h"
+#include "file_mapping.h"
 #include <fstream>
 #include <map>
 #include <vector>
@@ -77,6 +78,15 @@ namespace Beatmup {
         */
         virtual chunksize_t fetch(const std::string& id, void* data, const chunksize_t limit) = 0;
 
+        /**
+            Provides direct read-only access to a chunk content if the collection keeps it in addressable memory, so that it can be used
+            without copying.
+            \param[in] id       The chunk id
+            \return pointer to the chunk content valid until the collection is closed, or `nullptr` if the chunk is not found or the
+            collection does not provide direct access to its content.
+        */
+        virtual const void* chunkData(const std::string& id) const { return nullptr; }
+
         /**
             Saves the collection to a file.
             \param[in] filename     The name of the file to write chunks to
@@ -185,6 +195,66 @@ namespace Beatmup {
         void close();
     };
 
+    /**
+        File containing chunks mapped in memory.
+        Unlike ChunkFile, the chunks content is never copied when the file is opened or when the chunks are accessed through Chunk: the file
+        is mapped in the process address space, and only the chunk headers are read to build the list of available chunks. The chunks
+        content is then read from disk by the operating system when accessed for the first time. This makes the cost of opening big files
+        (e.g., neural network model data) proportional to the amount of data actually used.
+    */
+    class MappedChunkFile : public ChunkCollection {
+    private:
+        typedef struct {
+            chunksize_t size;
+            msize pos;
+        } ChunkDesc;
+
+        std::map<std::string, ChunkDesc> map;
+        const std::string filename;
+        FileMapping mapping;                //!< the mapped file content
+
+        /**
+            Goes through the mapped file content to build the list of existing chunks.
+        */
+        void parse();
+
+    public:
+        /**
+            Creates a read-only chunk collection from a file.
+            \param[in] filename     The file name / path
+            \param[in] openNow      If `true`, the file is mapped right away. Otherwise it is done on open() call.
+                                    No information is available about chunks in the file until it is opened.
+        */
+        MappedChunkFile(const std::string& filename, bool openNow = true);
+        ~MappedChunkFile();
+
+        /**
+            Maps the file in memory and collects the information about available chunks.
+            Does nothing if the file is already open.
+        */
+        void open();
+
+        /**
+            Unmaps the file. The information about available chunks is kept, but the chunks content is no longer accessible; pointers
+            returned by chunkData() become invalid.
+        */
+        void close();
+
+        inline bool isOpen() const { return mapping.isMapped(); }
+
+        inline size_t size() const { return map.size(); }
+
+        inline bool chunkExists(const std::string& id) const { return map.find(id) != map.end(); }
+
+        chunksize_t chunkSize(const std::string& id) const;
+
+        chunksize_t fetch(const std::string& id, void* data, const chunksize_t limit);
+
+        const void* chunkData(const std::string& id) const;
+
+        void save(const std::string& filename, bool append = false);
+    };
+
     /**
         Writes chunks to a file
     */
@@ -211,11 +281,12 @@ namespace Beatmup {
     private:
         size_t chunkSize;
         void* data;
+        bool owned;         //!< if `false`, the chunk refers to the content kept by a collection and does not own it
     public:
         /**
             Makes an empty chunk.
         */
-        inline Chunk(): chunkSize(0), data(nullptr) {}
+        inline Chunk(): chunkSize(0), data(nullptr), owned(true) {}
 
         /**
             Allocates a chunk of a given size.
@@ -225,6 +296,8 @@ namespace Beatmup {
 
         /**
             Reads a chunk from a collection.
+            If the collection provides direct access to the chunk content (see ChunkCollection::chunkData()), the chunk refers to it without
+            copying. In this case the chunk content is read-only and remains accessible until the collection is closed.
             \param[in] collection   The collection to read from
             \param[in] id           The chunk id to find in the collection
         */
@@ -232,18 +305,21 @@ namespace Beatmup {
 
         ~Chunk();
 
-        inline Chunk(Chunk&& chunk): chunkSize(chunk.chunkSize), data(chunk.data) {
+        inline Chunk(Chunk&& chunk): chunkSize(chunk.chunkSize), data(chunk.data), owned(chunk.owned) {
             chunk.data = nullptr;
             chunk.chunkSize = 0;
+            chunk.owned = true;
         }
 
         inline Chunk& operator=(Chunk&& chunk) {
-            if (data)
+            if (data && owned)
                 free(data);
             chunkSize = chunk.chunkSize;
             data = chunk.data;
+            owned = chunk.owned;
             chunk.data = nullptr;
             chunk.chunkSize = 0;
+            chunk.owned = true;
             return *this;
         }
 
@@ -256,6 +332,11 @@ namespace Beatmup {
 
         inline size_t size() const { return chunkSize; }
 
+        /**
+            \return `false` if the chunk refers to the content kept by the collection it is read from, `true` if it holds its own copy.
+        */
+        inline bool isOwning() const { return owned; }
+
         inline void* operator()() { return data; }
         inline const void* operator()() const { return data; }
 
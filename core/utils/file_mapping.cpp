@@ -0,0 +1,177 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "file_mapping.h"
+#include "../exception.h"
+
+#if BEATMUP_PLATFORM_WINDOWS
+    #include <windows.h>
+    #undef min
+    #undef max
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+using namespace Beatmup;
+
+
+FileMapping::FileMapping() :
+    data(nullptr), size(0), writable(false)
+#if BEATMUP_PLATFORM_WINDOWS
+    , fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+#endif
+{}
+
+
+FileMapping::~FileMapping() {
+    unmap();
+}
+
+
+void FileMapping::map(const std::string& filename, bool writable, msize size) {
+    unmap();
+    this->filename = filename;
+    this->writable = writable;
+
+#if BEATMUP_PLATFORM_WINDOWS
+    fileHandle = CreateFileA(filename.c_str(),
+        writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+        FILE_SHARE_READ, nullptr,
+        writable ? OPEN_ALWAYS : OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        throw IOError(filename, "Cannot open file");
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+        unmap();
+        throw IOError(filename, "Cannot get file size");
+    }
+    if (size == 0)
+        size = (msize)fileSize.QuadPart;
+    else if ((msize)fileSize.QuadPart < size && !writable) {
+        unmap();
+        throw IOError(filename, "File is too small");
+    }
+    if (size == 0) {
+        // empty file: nothing to map
+        unmap();
+        return;
+    }
+    // a writable mapping bigger than the file extends the file
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+        (DWORD)((uint64_t)size >> 32), (DWORD)size, nullptr);
+    if (mappingHandle)
+        data = static_cast<uint8_t*>(MapViewOfFile(mappingHandle, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size));
+    if (!data) {
+        unmap();
+        throw IOError(filename, "Cannot map file in memory");
+    }
+#else
+    const int fd = ::open(filename.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (fd < 0)
+        throw IOError(filename, "Cannot open file");
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw IOError(filename, "Cannot get file size");
+    }
+    if (size == 0)
+        size = (msize)info.st_size;
+    else if ((msize)info.st_size < size) {
+        if (!writable || ftruncate(fd, (off_t)size) != 0) {
+            ::close(fd);
+            throw IOError(filename, writable ? "Cannot extend file" : "File is too small");
+        }
+    }
+    if (size == 0) {
+        // empty file: nothing to map
+        ::close(fd);
+        return;
+    }
+    void* addr = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    ::close(fd);    // the mapping keeps the file referenced
+    if (addr == MAP_FAILED)
+        throw IOError(filename, "Cannot map file in memory");
+    data = static_cast<uint8_t*>(addr);
+#endif
+
+    this->size = size;
+}
+
+
+void FileMapping::unmap() {
+#if BEATMUP_PLATFORM_WINDOWS
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (data)
+        munmap(data, size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+
+void FileMapping::adviseSequentialAccess() {
+#if !BEATMUP_PLATFORM_WINDOWS
+    if (data)
+        madvise(data, size, MADV_SEQUENTIAL);
+#endif
+}
+
+
+void FileMapping::unload(const void* start, msize size) {
+    if (!data || size == 0)
+        return;
+#if BEATMUP_PLATFORM_WINDOWS
+    if (writable)
+        FlushViewOfFile(start, size);
+    // removes the pages from the process working set; they stay in the file cache until reclaimed by the system
+    VirtualUnlock(const_cast<void*>(start), size);
+#else
+    // only the pages entirely covered by the range are dropped; pages shared with neighboring content stay
+    static const uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    const uintptr_t
+        first = ((uintptr_t)start + pageSize - 1) / pageSize * pageSize,
+        last = ((uintptr_t)start + size) / pageSize * pageSize;
+    // dropping shared file-backed pages keeps their modified content: it is written to the file by the system
+    if (first < last)
+        madvise((void*)first, last - first, MADV_DONTNEED);
+#endif
+}
+
+
+void FileMapping::flush() {
+    if (!data || !writable)
+        return;
+#if BEATMUP_PLATFORM_WINDOWS
+    FlushViewOfFile(data, size);
+    FlushFileBuffers(fileHandle);
+#else
+    msync(data, size, MS_SYNC);
+#endif
+}
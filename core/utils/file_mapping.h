@@ -0,0 +1,87 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2020, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "../basic_types.h"
+#include <string>
+
+namespace Beatmup {
+    /**
+        A file mapped in the process address space.
+        The file content is loaded by the operating system on demand when accessed. Read-only mappings are private to the process; writable
+        mappings are shared, i.e., the modifications are written back to the file.
+    */
+    class FileMapping {
+    private:
+        std::string filename;
+        uint8_t* data;                      //!< address of the mapped file content
+        msize size;                         //!< mapped size in bytes
+        bool writable;
+#if BEATMUP_PLATFORM_WINDOWS
+        void *fileHandle, *mappingHandle;
+#endif
+
+    public:
+        FileMapping();
+        ~FileMapping();
+
+        FileMapping(const FileMapping&) = delete;
+        FileMapping& operator=(const FileMapping&) = delete;
+
+        /**
+            Maps a file in memory. The mapping previously set up, if any, is released first.
+            \param[in] filename     The file name / path
+            \param[in] writable     If `true`, the file is opened for reading and writing, and is created if it does not exist. Otherwise,
+                                    the file is opened read-only and must exist.
+            \param[in] size         Number of bytes to map from the beginning of the file. If zero, the entire file is mapped. A writable
+                                    file smaller than the requested size is extended with zeros; a read-only one causes an IOError.
+            An empty file is not mapped and is not an error: isMapped() returns `false` then.
+        */
+        void map(const std::string& filename, bool writable = false, msize size = 0);
+
+        /**
+            Releases the mapping. Does nothing if nothing is mapped.
+        */
+        void unmap();
+
+        /**
+            Hints the operating system that the mapped content is going to be accessed mostly sequentially.
+        */
+        void adviseSequentialAccess();
+
+        /**
+            Unloads a range of the mapped content from memory. It is loaded again from the file when accessed next time.
+            The modified content of a writable mapping is written back to the file.
+            \param[in] start        Address of the first byte of the range in the mapping
+            \param[in] size         Size of the range in bytes
+        */
+        void unload(const void* start, msize size);
+
+        /**
+            Writes the modified content of a writable mapping to the file and waits till the writing is complete.
+        */
+        void flush();
+
+        inline const uint8_t* getData() const { return data; }
+        inline uint8_t* getData() { return data; }
+        inline msize getSize() const { return size; }
+        inline bool isMapped() const { return data != nullptr; }
+        inline bool isWritable() const { return writable; }
+        inline const std::string& getFilename() const { return filename; }
+    };
+}
@@ -0,0 +1,101 @@
+/*
+    Beatmup image and signal processing library
+    Copyright (C) 2019, lnstadrum
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <atomic>
+#include <thread>
+
+
+namespace Beatmup {
+
+    /**
+        Unbounded lock-free FIFO queue with multiple producers and a single consumer.
+        Any number of threads may push() concurrently, but only one thread at a time may pop().
+        Producers only perform a single atomic exchange per item and never wait for each other or for the consumer. The consumer never misses
+        a pushed item: if a producer is interrupted in the middle of push(), pop() waits until the item is linked.
+        The queue is a linked list of nodes ending with a "stub" node the consumer reads the items from.
+    */
+    template<typename T> class MpscQueue {
+    private:
+        struct Node {
+            std::atomic<Node*> next;
+            T value;
+            Node(): next(nullptr) {}
+            Node(const T& value): next(nullptr), value(value) {}
+        };
+
+        std::atomic<Node*> head;        //!< last pushed node
+        Node* tail;                     //!< stub node; the next node holds the first item in the queue
+
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+    public:
+        inline MpscQueue(): head(new Node()) {
+            tail = head.load();
+        }
+
+        inline ~MpscQueue() {
+            T value;
+            while (pop(value));
+            delete tail;
+        }
+
+        /**
+            Adds an item to the end of the queue. Can be called from any thread.
+            \param[in] value    The item
+        */
+        inline void push(const T& value) {
+            Node* node = new Node(value);
+            Node* prev = head.exchange(node);
+            // The node is linked to the previous one right after. If the producer is preempted in between, the consumer sees a
+            // non-empty queue with an unlinked node and waits for the link (see pop()), so that no pushed item is ever missed.
+            prev->next.store(node);
+        }
+
+        /**
+            Takes the first item out of the queue. Only one thread at a time may call this function.
+            \param[out] value   The item
+            \return `true` if an item is taken, `false` if the queue is empty.
+        */
+        inline bool pop(T& value) {
+            Node* next = tail->next.load();
+            if (!next) {
+                if (head.load() == tail)
+                    return false;
+                // an item is pushed, but its producer did not link it yet; wait until it does
+                do {
+                    std::this_thread::yield();
+                    next = tail->next.load();
+                } while (!next);
+            }
+            value = next->value;
+            delete tail;
+            tail = next;
+            return true;
+        }
+
+        /**
+            \return `true` if there is no items to pop. Only meaningful in the consumer thread.
+        */
+        inline bool empty() const {
+            return head.load() == tail;
+        }
+    };
+
+}
@@ -27,6 +27,7 @@ Profiler::Profiler() : total(0) {}
 
 void Beatmup::Profiler::reset() {
     tracks.clear();
+    counters.clear();
     total = 0;
 }
 
@@ -53,7 +54,19 @@ void Profiler::lap() {
     total += sample;
 }
 
+void Profiler::count(const std::string& counter, uint64_t value) {
+    counters[counter] = value;
+}
+
+uint64_t Profiler::getCounter(const std::string& counter) const {
+    auto it = counters.find(counter);
+    return it == counters.end() ? 0 : it->second;
+}
+
 void Profiler::report(std::ostream& stream, ReportType type) const {
+    for (const auto& _ : counters)
+        stream << _.first << ": " << _.second << std::endl;
+
     if (tracks.empty())
         return;
 
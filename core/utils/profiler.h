@@ -26,7 +26,8 @@
 
 namespace Beatmup {
     /**
-        Collects running time statistics of multiple tracks
+        Collects running time statistics of multiple tracks.
+        Also keeps named counters (e.g., memory sizes in bytes) reported together with the running time.
     */
     class Profiler {
     private:
@@ -39,6 +40,7 @@ namespace Beatmup {
         };
         
         std::map<std::string, Track> tracks;
+        std::map<std::string, uint64_t> counters;
         std::vector<std::pair<std::string, std::chrono::system_clock::time_point>> running;
         time_t total;
 
@@ -52,6 +54,19 @@ namespace Beatmup {
         
         void operator ()(const std::string& track);
         void lap();
+
+        /**
+            Sets a counter value.
+            \param[in] counter     The counter name
+            \param[in] value       The new value
+        */
+        void count(const std::string& counter, uint64_t value);
+
+        /**
+            Returns a counter value, or zero if the counter is never set.
+        */
+        uint64_t getCounter(const std::string& counter) const;
+
         void report(std::ostream&, ReportType type = ReportType::FULL) const;
 
         inline time_t getTotal() const { return total; }
@@ -80,6 +80,7 @@ PYBIND11_MODULE(beatmup, module) {
             ImageShader
             IntegerContour2D
             InternalBitmap
+            MappedChunkFile
             Metric
             Multitask
             PixelFormat
@@ -442,6 +443,7 @@ PYBIND11_MODULE(beatmup, module) {
         .value("LINEAR",           BitmapResampler::Mode::LINEAR,           "first order: bilinear interpolation")
         .value("CUBIC",            BitmapResampler::Mode::CUBIC,            "third order: bicubic interpolation")
         .value("CONVNET",          BitmapResampler::Mode::CONVNET,          "upsampling x2 using a convolutional neural network")
+        .value("LANCZOS",          BitmapResampler::Mode::LANCZOS,          "Lanczos filter of order 3; antialiasing when downsampling")
         .export_values();
 
     /**
@@ -1214,6 +1216,22 @@ PYBIND11_MODULE(beatmup, module) {
                         No information is available about chunks in the file until it is opened.
         )doc");
 
+    /**
+     * MappedChunkFile
+     */
+    py::class_<MappedChunkFile, ChunkCollection>(module, "MappedChunkFile",
+        R"doc(
+            File containing chunks mapped in memory.
+            Only the chunk headers are read when the file is opened; the chunks content is read from disk when accessed for the first time.
+        )doc")
+        .def(py::init<const std::string&, bool>(), py::arg("filename"), py::arg("open_now") = true, R"doc(
+            Creates a memory-mapped chunkfile accessor.
+
+            :param filename:  the file name / path
+            :param open_now:  if `true`, the file is mapped right away. Otherwise it is done on open() call.
+                        No information is available about chunks in the file until it is opened.
+        )doc");
+
     /**
      * Python::WritableChunkCollection
      */
@@ -1599,7 +1617,45 @@ PYBIND11_MODULE(beatmup, module) {
                 :image:            The image
                 :operation:        The operation
                 :input_index:      The input index of the operation
-            )doc");
+            )doc")
+
+        .def("connect", (void (NNets::InferenceTask::*)(const std::vector<AbstractBitmap*>&, const std::string&, int))&NNets::InferenceTask::connect,
+            py::arg("images"), py::arg("op_name"), py::arg("input_index") = 0,
+            py::keep_alive<1, 2, 1>(),     // task alive => images alive
+            R"doc(
+                Connects a batch of images to a specific operation input.
+                The inference is run for every image of the batch in a single run of the task.
+
+                :images:      list of images
+                :op_name:     the operation name
+                :input_index: the input index of the operation
+            )doc")
+
+        .def("connect", (void (NNets::InferenceTask::*)(const std::vector<AbstractBitmap*>&, NNets::AbstractOperation&, int))&NNets::InferenceTask::connect,
+            py::arg("images"), py::arg("operation"), py::arg("input_index") = 0,
+            py::keep_alive<1, 2, 1>(),     // task alive => images alive
+            R"doc(
+                Connects a batch of images to a specific operation input.
+                The inference is run for every image of the batch in a single run of the task.
+
+                :images:           list of images
+                :operation:        The operation
+                :input_index:      The input index of the operation
+            )doc")
+
+        .def("get_batch_size", &NNets::InferenceTask::getBatchSize,
+            "Returns the number of images the inference is run for in every run of the task")
+
+        .def("enable_gpu", &NNets::InferenceTask::enableGpu, py::arg("enable"),
+            R"doc(
+                Enables or disables GPU use for the inference.
+                When disabled, the model is prepared and run on CPU.
+
+                :enable:           If `False`, the inference is run on CPU
+            )doc")
+
+        .def("is_gpu_enabled", &NNets::InferenceTask::isGpuEnabled,
+            "Returns `True` if the inference is allowed to run on GPU");
 
     /**
      * NNets::Classifier
@@ -1610,7 +1666,7 @@ PYBIND11_MODULE(beatmup, module) {
             Makes a runnable AbstractTask from a Model. Adds an image input and a vector of probabilities for output.
         )doc")
 
-        .def("__call__", &NNets::Classifier::operator(),
+        .def("__call__", (const std::vector<float>& (NNets::Classifier::*)(AbstractBitmap&))&NNets::Classifier::operator(),
             R"doc(
                 Classifies an image (blocking).
                 The very first call includes the model preparation and might be slow as hell. Subsequent calls only run the inference and are likely
@@ -1621,7 +1677,17 @@ PYBIND11_MODULE(beatmup, module) {
                 Returns a vector of probabilities per class.
             )doc")
 
-        .def("start", &NNets::Classifier::start,
+        .def("__call__", (const std::vector<std::vector<float>>& (NNets::Classifier::*)(const std::vector<AbstractBitmap*>&))&NNets::Classifier::operator(),
+            R"doc(
+                Classifies a batch of images (blocking).
+                The inference is run for all the images in a single task run.
+
+                :param inputs:   List of input images
+
+                Returns a list of vectors of probabilities per class, one per image.
+            )doc")
+
+        .def("start", (Job (NNets::Classifier::*)(AbstractBitmap&))&NNets::Classifier::start,
             R"doc(
                 Initiates the classification of a given image.
                 The call is non-blocking.
@@ -1631,7 +1697,20 @@ PYBIND11_MODULE(beatmup, module) {
                 Returns a job corresponding to the submitted task.
             )doc")
 
+        .def("start", (Job (NNets::Classifier::*)(const std::vector<AbstractBitmap*>&))&NNets::Classifier::start,
+            R"doc(
+                Initiates the classification of a batch of images.
+                The call is non-blocking.
+
+                :param inputs:   List of input images
+
+                Returns a job corresponding to the submitted task.
+            )doc")
+
         .def("get_probabilities", &NNets::Classifier::getProbabilities,
-            "Returns the last classification results (vector of probabilities per class).");
+            "Returns the last classification results (vector of probabilities per class).")
+
+        .def("get_batch_probabilities", &NNets::Classifier::getBatchProbabilities,
+            "Returns the last classification results of every image in the batch (list of vectors of probabilities per class).");
 
 }
\ No newline at end of file
@@ -128,6 +128,13 @@ def test_model(error_threshold):
             # compare
             error = numpy.max(numpy.abs(test_output - ref_output))
             if VERBOSE: print('Error: %0.4f for %d layers mapping %s to %s' % (error, len(ref_model.layers), input_image.shape, test_output.shape))
+
+            # run inference on CPU and compare
+            inference.enable_gpu(False)
+            ctx.perform_task(inference)
+            cpu_output = numpy.asarray(head.get_probabilities()) if softmax else test_model.get_output_data(head)
+            cpu_error = numpy.max(numpy.abs(cpu_output - ref_output))
+            if VERBOSE: print('CPU error: %0.4f' % cpu_error)
             del ctx
 
             # export
@@ -135,6 +142,7 @@ def test_model(error_threshold):
 
             # assert
             self.assertLess(error, error_threshold)
+            self.assertLess(cpu_error, error_threshold)
 
         return wrapped
     return wrap